@@ -425,7 +425,7 @@ void av_noreturn exit_program(int ret)
     for (i = 0; i < nb_input_streams; i++) {
         av_freep(&input_streams[i]->decoded_frame);
         av_dict_free(&input_streams[i]->opts);
-        free_buffer_pool(&input_streams[i]->buffer_pool);
+        av_dict_free(&input_streams[i]->segment_opts);
         avfilter_unref_bufferp(&input_streams[i]->sub2video.ref);
         av_freep(&input_streams[i]->filters);
         av_freep(&input_streams[i]);
@@ -757,18 +757,20 @@ static void do_subtitle_out(AVFormatContext *s,
     }
 }
 
-static void do_video_out(AVFormatContext *s,
-                         OutputStream *ost,
-                         AVFrame *in_picture,
-                         float quality)
+/**
+ * Compute how many times a picture must be encoded to follow the video sync
+ * method.
+ *
+ * @param sync_opts pts of the next encoded picture, updated for the methods
+ *                  which follow the input timestamps
+ */
+static int video_sync_frames(AVFormatContext *s, OutputStream *ost,
+                             double sync_ipts, int64_t *sync_opts)
 {
-    int ret, format_video_sync;
-    AVPacket pkt;
     AVCodecContext *enc = ost->st->codec;
-    int nb_frames, i;
-    double sync_ipts, delta;
+    int nb_frames, format_video_sync;
+    double delta;
     double duration = 0;
-    int frame_size = 0;
     InputStream *ist = NULL;
 
     if (ost->source_index >= 0)
@@ -777,8 +779,7 @@ static void do_video_out(AVFormatContext *s,
     if(ist && ist->st->start_time != AV_NOPTS_VALUE && ist->st->first_dts != AV_NOPTS_VALUE && ost->frame_rate.num)
         duration = 1/(av_q2d(ost->frame_rate) * av_q2d(enc->time_base));
 
-    sync_ipts = in_picture->pts;
-    delta = sync_ipts - ost->sync_opts + duration;
+    delta = sync_ipts - *sync_opts + duration;
 
     /* by default, we output a single frame */
     nb_frames = 1;
@@ -799,16 +800,31 @@ static void do_video_out(AVFormatContext *s,
         if (delta <= -0.6)
             nb_frames = 0;
         else if (delta > 0.6)
-            ost->sync_opts = lrint(sync_ipts);
+            *sync_opts = lrint(sync_ipts);
         break;
     case VSYNC_DROP:
     case VSYNC_PASSTHROUGH:
-        ost->sync_opts = lrint(sync_ipts);
+        *sync_opts = lrint(sync_ipts);
         break;
     default:
         av_assert0(0);
     }
 
+    return nb_frames;
+}
+
+static void do_video_out(AVFormatContext *s,
+                         OutputStream *ost,
+                         AVFrame *in_picture,
+                         float quality)
+{
+    int ret;
+    AVPacket pkt;
+    AVCodecContext *enc = ost->st->codec;
+    int nb_frames, i;
+    int frame_size = 0;
+
+    nb_frames = video_sync_frames(s, ost, in_picture->pts, &ost->sync_opts);
     nb_frames = FFMIN(nb_frames, ost->max_frames - ost->frame_number);
     if (nb_frames == 0) {
         nb_frames_drop++;
@@ -1610,34 +1626,12 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output)
 
     frame_sample_aspect= av_opt_ptr(avcodec_get_frame_class(), decoded_frame, "sample_aspect_ratio");
     for (i = 0; i < ist->nb_filters; i++) {
-        int changed =      ist->st->codec->width   != ist->filters[i]->filter->outputs[0]->w
-                        || ist->st->codec->height  != ist->filters[i]->filter->outputs[0]->h
-                        || ist->st->codec->pix_fmt != ist->filters[i]->filter->outputs[0]->format;
         // XXX what an ugly hack
         if (ist->filters[i]->graph->nb_outputs == 1)
             ist->filters[i]->graph->outputs[0]->ost->last_quality = quality;
 
         if (!frame_sample_aspect->num)
             *frame_sample_aspect = ist->st->sample_aspect_ratio;
-        if (ist->dr1 && decoded_frame->type==FF_BUFFER_TYPE_USER && !changed) {
-            FrameBuffer      *buf = decoded_frame->opaque;
-            AVFilterBufferRef *fb = avfilter_get_video_buffer_ref_from_arrays(
-                                        decoded_frame->data, decoded_frame->linesize,
-                                        AV_PERM_READ | AV_PERM_PRESERVE,
-                                        ist->st->codec->width, ist->st->codec->height,
-                                        ist->st->codec->pix_fmt);
-
-            avfilter_copy_frame_props(fb, decoded_frame);
-            fb->buf->priv           = buf;
-            fb->buf->free           = filter_release_buffer;
-
-            av_assert0(buf->refcount>0);
-            buf->refcount++;
-            av_buffersrc_add_ref(ist->filters[i]->filter, fb,
-                                 AV_BUFFERSRC_FLAG_NO_CHECK_FORMAT |
-                                 AV_BUFFERSRC_FLAG_NO_COPY |
-                                 AV_BUFFERSRC_FLAG_PUSH);
-        } else
         if(av_buffersrc_add_frame(ist->filters[i]->filter, decoded_frame, AV_BUFFERSRC_FLAG_PUSH)<0) {
             av_log(NULL, AV_LOG_FATAL, "Failed to inject frame into filter network\n");
             exit_program(1);
@@ -1863,13 +1857,8 @@ static int init_input_stream(int ist_index, char *error, int error_len)
             return AVERROR(EINVAL);
         }
 
-        ist->dr1 = (codec->capabilities & CODEC_CAP_DR1) && !do_deinterlace;
-        if (codec->type == AVMEDIA_TYPE_VIDEO && ist->dr1) {
-            ist->st->codec->get_buffer     = codec_get_buffer;
-            ist->st->codec->release_buffer = codec_release_buffer;
-            ist->st->codec->opaque         = &ist->buffer_pool;
-        }
-
+        if (segment_threads > 1)
+            av_dict_copy(&ist->segment_opts, ist->opts, 0);
         if (!av_dict_get(ist->opts, "threads", NULL, 0))
             av_dict_set(&ist->opts, "threads", "auto", 0);
         if (avcodec_open2(ist->st->codec, codec, &ist->opts) < 0) {
@@ -2257,6 +2246,8 @@ static int transcode_init(void)
                 memcpy(ost->st->codec->subtitle_header, dec->subtitle_header, dec->subtitle_header_size);
                 ost->st->codec->subtitle_header_size = dec->subtitle_header_size;
             }
+            if (segment_threads > 1)
+                av_dict_copy(&ost->segment_opts, ost->opts, 0);
             if (!av_dict_get(ost->opts, "threads", NULL, 0))
                 av_dict_set(&ost->opts, "threads", "auto", 0);
             if (avcodec_open2(ost->st->codec, codec, &ost->opts) < 0) {
@@ -2926,6 +2917,630 @@ static int transcode_step(void)
     return reap_filters();
 }
 
+#if HAVE_PTHREADS
+/*
+ * Segment transcoding: the input is cut at keyframes taken from the index,
+ * and each part is decoded, filtered and encoded by its own thread. The main
+ * thread writes the packets of the segments one after the other.
+ */
+typedef struct Segment {
+    int index;
+    AVIndexEntry start;         ///< keyframe the segment starts at
+    AVIndexEntry end;           ///< keyframe the next segment starts at
+    int last;                   ///< no next segment, read until EOF
+
+    AVFormatContext *ic;
+    AVCodecContext  *dec;
+    AVCodecContext  *enc;
+    FilterGraph      fg;
+    InputFilter     *ifilter;
+    OutputFilter    *ofilter;
+    AVFrame         *frame;
+    int64_t          sync_opts;
+    int              forced_kf_index;
+    int              nb_frames_dup;
+    int              nb_frames_drop;
+
+    pthread_t        thread;
+    int              thread_started;
+    AVFifoBuffer    *packets;   ///< encoded packets, protected by segment_lock
+    int              finished;  ///< protected by segment_lock
+    int              ret;
+} Segment;
+
+static Segment *segments;
+static int nb_segments;
+static int cur_segment;             ///< segment whose packets are being written
+static int64_t segment_last_dts = AV_NOPTS_VALUE;
+static OutputStream *segment_ost;   ///< the video stream cut into segments
+static pthread_mutex_t segment_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  segment_cond = PTHREAD_COND_INITIALIZER;
+static volatile int segment_abort;
+
+static int segment_queue_packet(Segment *seg, AVPacket *pkt)
+{
+    int ret = 0;
+
+    av_dup_packet(pkt);
+    pthread_mutex_lock(&segment_lock);
+    if (av_fifo_space(seg->packets) < sizeof(*pkt))
+        ret = av_fifo_realloc2(seg->packets, 2 * av_fifo_size(seg->packets));
+    if (ret >= 0) {
+        av_fifo_generic_write(seg->packets, pkt, sizeof(*pkt), NULL);
+        pthread_cond_signal(&segment_cond);
+    }
+    pthread_mutex_unlock(&segment_lock);
+    if (ret < 0)
+        av_free_packet(pkt);
+    return ret;
+}
+
+/* same as do_video_out(), with the encoder of the segment */
+static int segment_encode_frame(Segment *seg, AVFrame *in_picture)
+{
+    OutputStream    *ost = segment_ost;
+    AVFormatContext   *s = output_files[0]->ctx;
+    AVCodecContext  *enc = seg->enc;
+    int nb_frames, got_packet, i, ret;
+    AVPacket pkt;
+
+    if (!in_picture) {
+        if (s->oformat->flags & AVFMT_RAWPICTURE &&
+            enc->codec->id == AV_CODEC_ID_RAWVIDEO)
+            return 0;
+        do {
+            av_init_packet(&pkt);
+            pkt.data = NULL;
+            pkt.size = 0;
+            if ((ret = avcodec_encode_video2(enc, &pkt, NULL, &got_packet)) < 0)
+                return ret;
+            if (got_packet) {
+                if (pkt.pts != AV_NOPTS_VALUE)
+                    pkt.pts = av_rescale_q(pkt.pts, enc->time_base, ost->st->time_base);
+                if (pkt.dts != AV_NOPTS_VALUE)
+                    pkt.dts = av_rescale_q(pkt.dts, enc->time_base, ost->st->time_base);
+                if ((ret = segment_queue_packet(seg, &pkt)) < 0)
+                    return ret;
+            }
+        } while (got_packet);
+        return 0;
+    }
+
+    nb_frames = video_sync_frames(s, ost, in_picture->pts, &seg->sync_opts);
+    if (nb_frames == 0) {
+        seg->nb_frames_drop++;
+        return 0;
+    } else if (nb_frames > 1) {
+        if (nb_frames > dts_error_threshold * 30) {
+            seg->nb_frames_drop++;
+            return 0;
+        }
+        seg->nb_frames_dup += nb_frames - 1;
+    }
+
+    for (i = 0; i < nb_frames; i++) {
+        AVFrame big_picture = *in_picture;
+
+        if (s->oformat->flags & AVFMT_RAWPICTURE &&
+            enc->codec->id == AV_CODEC_ID_RAWVIDEO) {
+            /* the AVPicture written by do_video_out() points to the frame,
+             * which is gone when the packet gets muxed: store a copy of the
+             * picture behind it */
+            int size = avpicture_get_size(enc->pix_fmt, enc->width, enc->height);
+            AVPicture *pict;
+
+            if (size < 0)
+                return size;
+            if ((ret = av_new_packet(&pkt, sizeof(*pict) + size)) < 0)
+                return ret;
+            pict = (AVPicture *)pkt.data;
+            avpicture_fill(pict, pkt.data + sizeof(*pict), enc->pix_fmt,
+                           enc->width, enc->height);
+            av_picture_copy(pict, (AVPicture *)in_picture, enc->pix_fmt,
+                            enc->width, enc->height);
+            pkt.size   = sizeof(*pict);
+            pkt.pts    = av_rescale_q(seg->sync_opts, enc->time_base, ost->st->time_base);
+            pkt.flags |= AV_PKT_FLAG_KEY;
+            if ((ret = segment_queue_packet(seg, &pkt)) < 0)
+                return ret;
+            seg->sync_opts++;
+            continue;
+        }
+
+        big_picture.pts = seg->sync_opts;
+        if (enc->flags & (CODEC_FLAG_INTERLACED_DCT|CODEC_FLAG_INTERLACED_ME) &&
+            ost->top_field_first >= 0)
+            big_picture.top_field_first = !!ost->top_field_first;
+        big_picture.quality = enc->global_quality;
+        if (!enc->me_threshold)
+            big_picture.pict_type = 0;
+        if (seg->forced_kf_index < ost->forced_kf_count &&
+            big_picture.pts >= ost->forced_kf_pts[seg->forced_kf_index]) {
+            big_picture.pict_type = AV_PICTURE_TYPE_I;
+            seg->forced_kf_index++;
+        }
+
+        av_init_packet(&pkt);
+        pkt.data = NULL;
+        pkt.size = 0;
+        if ((ret = avcodec_encode_video2(enc, &pkt, &big_picture, &got_packet)) < 0)
+            return ret;
+        if (got_packet) {
+            if (pkt.pts == AV_NOPTS_VALUE && !(enc->codec->capabilities & CODEC_CAP_DELAY))
+                pkt.pts = seg->sync_opts;
+            if (pkt.pts != AV_NOPTS_VALUE)
+                pkt.pts = av_rescale_q(pkt.pts, enc->time_base, ost->st->time_base);
+            if (pkt.dts != AV_NOPTS_VALUE)
+                pkt.dts = av_rescale_q(pkt.dts, enc->time_base, ost->st->time_base);
+            if ((ret = segment_queue_packet(seg, &pkt)) < 0)
+                return ret;
+        }
+        seg->sync_opts++;
+    }
+    return 0;
+}
+
+/* same as reap_filters(), for the filtergraph of the segment */
+static int segment_filter_frame(Segment *seg, AVFrame *frame)
+{
+    AVFilterContext *sink = seg->ofilter->filter;
+    AVFilterBufferRef *picref;
+    AVFrame filtered_frame;
+    int ret;
+
+    if (frame)
+        ret = av_buffersrc_add_frame(seg->ifilter->filter, frame, AV_BUFFERSRC_FLAG_PUSH);
+    else
+        ret = av_buffersrc_add_ref(seg->ifilter->filter, NULL, 0);
+    if (ret < 0)
+        return ret;
+
+    while ((ret = av_buffersink_get_buffer_ref(sink, &picref,
+                                               AV_BUFFERSINK_FLAG_NO_REQUEST)) >= 0) {
+        avcodec_get_frame_defaults(&filtered_frame);
+        avfilter_copy_buf_props(&filtered_frame, picref);
+        if (picref->pts != AV_NOPTS_VALUE)
+            filtered_frame.pts = av_rescale_q(picref->pts, sink->inputs[0]->time_base,
+                                              seg->enc->time_base);
+        /* the first picture of a segment decides where its frames start */
+        if (seg->sync_opts == AV_NOPTS_VALUE) {
+            OutputStream *ost = seg->ofilter->ost;
+
+            seg->sync_opts = seg->index ? filtered_frame.pts : 0;
+            while (seg->forced_kf_index < ost->forced_kf_count &&
+                   ost->forced_kf_pts[seg->forced_kf_index] < seg->sync_opts)
+                seg->forced_kf_index++;
+        }
+        ret = segment_encode_frame(seg, &filtered_frame);
+        avfilter_unref_buffer(picref);
+        if (ret < 0)
+            return ret;
+    }
+    if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+        return ret;
+
+    return frame ? 0 : segment_encode_frame(seg, NULL);
+}
+
+static int segment_is_end(Segment *seg, const AVPacket *pkt)
+{
+    if (seg->end.pos >= 0 && pkt->pos >= 0)
+        return pkt->pos >= seg->end.pos;
+    return pkt->dts != AV_NOPTS_VALUE && pkt->dts >= seg->end.timestamp;
+}
+
+/*
+ * The segment covers the pictures displayed from its starting keyframe
+ * (included) to the starting keyframe of the next segment (excluded), so
+ * that pictures displayed before a keyframe but decoded after it are
+ * neither lost nor encoded twice. The keyframes are found by their pts, or
+ * by counting the decoded keyframes if the demuxer does not set it.
+ */
+static void *segment_thread(void *arg)
+{
+    Segment *seg = arg;
+    InputStream *ist = input_streams[segment_ost->source_index];
+    InputFile *ifile = input_files[ist->file_index];
+    AVStream *st = seg->ic->streams[ist->st->index];
+    int64_t ts_offset = av_rescale_q(ifile->ts_offset, AV_TIME_BASE_Q, st->time_base);
+    int64_t start_ts = AV_NOPTS_VALUE, end_ts = AV_NOPTS_VALUE;
+    int64_t last_ts = AV_NOPTS_VALUE;
+    int key_packets = 0, key_frames = 0, start_key = 0, end_key = 0;
+    int got_frame, eof = 0, ret = 0;
+    AVPacket pkt;
+
+    if (seg->index &&
+        (ret = av_seek_frame(seg->ic, st->index, seg->start.timestamp,
+                             AVSEEK_FLAG_BACKWARD)) < 0)
+        goto end;
+
+    while (ret >= 0 && !segment_abort && !received_sigterm) {
+        int64_t ts;
+
+        if (!eof) {
+            ret = av_read_frame(seg->ic, &pkt);
+            if (ret == AVERROR(EAGAIN)) {
+                av_usleep(10000);
+                ret = 0;
+                continue;
+            }
+            if (ret < 0) {
+                eof = 1;
+                ret = 0;
+            } else if (pkt.stream_index != st->index ||
+                       (seg->index && !key_packets && !(pkt.flags & AV_PKT_FLAG_KEY))) {
+                av_free_packet(&pkt);
+                continue;
+            } else if (pkt.flags & AV_PKT_FLAG_KEY) {
+                key_packets++;
+                if (seg->index && key_packets == 1) {
+                    start_ts  = pkt.pts;
+                    start_key = pkt.pts == AV_NOPTS_VALUE;
+                } else if (!seg->last && !end_key && end_ts == AV_NOPTS_VALUE &&
+                           segment_is_end(seg, &pkt)) {
+                    end_ts  = pkt.pts;
+                    end_key = pkt.pts == AV_NOPTS_VALUE ? key_packets : 0;
+                }
+            }
+        }
+        if (eof) {
+            av_init_packet(&pkt);
+            pkt.data = NULL;
+            pkt.size = 0;
+        }
+
+        avcodec_get_frame_defaults(seg->frame);
+        ret = avcodec_decode_video2(seg->dec, seg->frame, &got_frame, &pkt);
+        if (!eof)
+            av_free_packet(&pkt);
+        if (ret < 0)
+            break;
+        ret = 0;
+        if (!got_frame) {
+            if (eof)
+                break;
+            continue;
+        }
+
+        key_frames += seg->frame->key_frame;
+        ts = av_frame_get_best_effort_timestamp(seg->frame);
+        /* the frames flushed out of the decoder may have no timestamp */
+        if (ts == AV_NOPTS_VALUE && last_ts != AV_NOPTS_VALUE && ist->st->r_frame_rate.num)
+            ts = last_ts + av_rescale_q(1, av_inv_q(ist->st->r_frame_rate), st->time_base);
+        last_ts = ts;
+        if ((end_ts != AV_NOPTS_VALUE && ts >= end_ts) ||
+            (end_key && key_frames >= end_key))
+            break;
+        if ((start_ts != AV_NOPTS_VALUE && ts < start_ts) ||
+            (start_key && !key_frames) || ts == AV_NOPTS_VALUE)
+            continue;
+
+        seg->frame->pts = ts + ts_offset;
+        if (ist->st->sample_aspect_ratio.num)
+            seg->frame->sample_aspect_ratio = ist->st->sample_aspect_ratio;
+        ret = segment_filter_frame(seg, seg->frame);
+    }
+    if (ret >= 0 && !segment_abort && !received_sigterm)
+        ret = segment_filter_frame(seg, NULL);
+
+end:
+    pthread_mutex_lock(&segment_lock);
+    seg->ret      = ret;
+    seg->finished = 1;
+    pthread_cond_signal(&segment_cond);
+    pthread_mutex_unlock(&segment_lock);
+    return NULL;
+}
+
+/**
+ * Check if the job has a single video stream transcoded from an indexed
+ * input, which can be cut into segment_threads parts. The other streams
+ * are transcoded as usual by the main thread.
+ */
+static int can_transcode_segments(void)
+{
+    OutputStream *ost = NULL;
+    OutputFile   *of  = output_files[0];
+    InputStream  *ist;
+    AVStream     *st;
+    int i, nb_keyframes = 0;
+
+    if (nb_input_files != 1 || nb_output_files != 1) {
+        av_log(NULL, AV_LOG_WARNING, "Segment threads need one input and one output file, disabling them.\n");
+        return 0;
+    }
+    for (i = 0; i < nb_output_streams; i++) {
+        if (output_streams[i]->st->codec->codec_type != AVMEDIA_TYPE_VIDEO)
+            continue;
+        if (ost) {
+            av_log(NULL, AV_LOG_WARNING, "Segment threads need a single video output stream, disabling them.\n");
+            return 0;
+        }
+        ost = output_streams[i];
+    }
+    if (!ost || !ost->encoding_needed ||
+        !ost->filter || ost->filter->graph->graph_desc || ost->source_index < 0) {
+        av_log(NULL, AV_LOG_WARNING, "Segment threads need a video stream encoded with a simple filtergraph, disabling them.\n");
+        return 0;
+    }
+    ist = input_streams[ost->source_index];
+    st  = ist->st;
+    if (of->start_time || of->recording_time != INT64_MAX || of->shortest ||
+        ost->max_frames != INT64_MAX || of->limit_filesize != UINT64_MAX ||
+        ist->framerate.num || ist->ts_scale != 1.0 || ost->logfile ||
+        same_quant || do_deinterlace || vstats_filename) {
+        av_log(NULL, AV_LOG_WARNING, "Segment threads do not support the requested options, disabling them.\n");
+        return 0;
+    }
+
+    if (avformat_build_index(input_files[0]->ctx, st->index) < 0) {
+        av_log(NULL, AV_LOG_WARNING, "Could not build the index of the input, disabling segment threads.\n");
+        return 0;
+    }
+    for (i = 0; i < st->nb_index_entries; i++)
+        nb_keyframes += !!(st->index_entries[i].flags & AVINDEX_KEYFRAME);
+    if (!input_files[0]->ctx->pb || !input_files[0]->ctx->pb->seekable ||
+        nb_keyframes < segment_threads) {
+        av_log(NULL, AV_LOG_WARNING, "Input is not seekable or has too few keyframes in its index, disabling segment threads.\n");
+        return 0;
+    }
+    segment_ost = ost;
+    return 1;
+}
+
+static int init_segment(Segment *seg, AVIndexEntry *start)
+{
+    OutputStream *ost = segment_ost;
+    InputStream  *ist = input_streams[ost->source_index];
+    AVFormatContext *ic = input_files[0]->ctx;
+    AVDictionary *opts = NULL;
+    int i, ret;
+
+    seg->start     = *start;
+    seg->sync_opts = AV_NOPTS_VALUE;
+    if (!(seg->packets = av_fifo_alloc(16 * sizeof(AVPacket))) ||
+        !(seg->frame   = avcodec_alloc_frame()))
+        return AVERROR(ENOMEM);
+
+    if (!(seg->ic = avformat_alloc_context()))
+        return AVERROR(ENOMEM);
+    seg->ic->interrupt_callback = int_cb;
+    if ((ret = avformat_open_input(&seg->ic, ic->filename, ic->iformat, NULL)) < 0)
+        return ret;
+    if (seg->ic->nb_streams <= ist->st->index ||
+        seg->ic->streams[ist->st->index]->codec->codec_id != ist->st->codec->codec_id)
+        return AVERROR(EINVAL);
+    for (i = 0; i < seg->ic->nb_streams; i++)
+        seg->ic->streams[i]->discard = i == ist->st->index ? AVDISCARD_NONE : AVDISCARD_ALL;
+
+    if (!(seg->dec = avcodec_alloc_context3(ist->dec)))
+        return AVERROR(ENOMEM);
+    if ((ret = avcodec_copy_context(seg->dec, ist->st->codec)) < 0)
+        return ret;
+    av_dict_copy(&opts, ist->segment_opts, 0);
+    if (!av_dict_get(opts, "threads", NULL, 0))
+        av_dict_set(&opts, "threads", "1", 0);
+    ret = avcodec_open2(seg->dec, ist->dec, &opts);
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+
+    /* the encoder of the output stream was already opened, drop what its
+     * init allocated before opening the copy */
+    if (!(seg->enc = avcodec_alloc_context3(ost->enc)))
+        return AVERROR(ENOMEM);
+    if ((ret = avcodec_copy_context(seg->enc, ost->st->codec)) < 0)
+        return ret;
+    av_freep(&seg->enc->extradata);
+    seg->enc->extradata_size = 0;
+    seg->enc->coded_frame    = NULL;
+    seg->enc->stats_out      = NULL;
+    av_dict_copy(&opts, ost->segment_opts, 0);
+    if (!av_dict_get(opts, "threads", NULL, 0))
+        av_dict_set(&opts, "threads", "1", 0);
+    ret = avcodec_open2(seg->enc, ost->enc, &opts);
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+
+    seg->fg.index = nb_filtergraphs + seg->index;
+    seg->fg.inputs  = &seg->ifilter;
+    seg->fg.outputs = &seg->ofilter;
+    seg->fg.nb_inputs = seg->fg.nb_outputs = 1;
+    if (!(seg->ifilter = av_mallocz(sizeof(*seg->ifilter))) ||
+        !(seg->ofilter = av_mallocz(sizeof(*seg->ofilter))))
+        return AVERROR(ENOMEM);
+    seg->ifilter->ist   = ist;
+    seg->ifilter->graph = &seg->fg;
+    seg->ofilter->ost   = ost;
+    seg->ofilter->graph = &seg->fg;
+    return configure_filtergraph(&seg->fg);
+}
+
+static void free_segments(void)
+{
+    int i;
+
+    for (i = 0; i < segment_threads && segments; i++) {
+        Segment *seg = &segments[i];
+        AVPacket pkt;
+
+        if (seg->thread_started)
+            pthread_join(seg->thread, NULL);
+        while (seg->packets && av_fifo_size(seg->packets)) {
+            av_fifo_generic_read(seg->packets, &pkt, sizeof(pkt), NULL);
+            av_free_packet(&pkt);
+        }
+        av_fifo_free(seg->packets);
+        avfilter_graph_free(&seg->fg.graph);
+        if (seg->ifilter)
+            av_freep(&seg->ifilter->name);
+        if (seg->ofilter)
+            av_freep(&seg->ofilter->name);
+        av_freep(&seg->ifilter);
+        av_freep(&seg->ofilter);
+        if (seg->dec)
+            avcodec_close(seg->dec);
+        av_freep(&seg->dec);
+        if (seg->enc)
+            avcodec_close(seg->enc);
+        av_freep(&seg->enc);
+        av_freep(&seg->frame);
+        avformat_close_input(&seg->ic);
+    }
+    av_freep(&segments);
+}
+
+/**
+ * Set up segment transcoding if it was requested and the job allows it.
+ *
+ * @return the number of segments, 0 to transcode normally
+ */
+static int init_segments(void)
+{
+    InputStream *ist;
+    AVStream *st;
+    AVIndexEntry *entries;
+    int i, ret, nb_entries, prev = -1;
+
+    if (segment_threads <= 1 || !can_transcode_segments())
+        return 0;
+
+    if (!(segments = av_mallocz(segment_threads * sizeof(*segments))))
+        return AVERROR(ENOMEM);
+
+    ist        = input_streams[segment_ost->source_index];
+    st         = ist->st;
+    entries    = st->index_entries;
+    nb_entries = st->nb_index_entries;
+    for (i = 0; i < segment_threads; i++) {
+        int64_t first = entries[0].timestamp, last = entries[nb_entries - 1].timestamp;
+        int idx = i ? av_index_search_timestamp(st, first + (last - first) / segment_threads * i,
+                                                AVSEEK_FLAG_BACKWARD) : 0;
+
+        if (idx <= prev)
+            continue;
+        segments[nb_segments].index = nb_segments;
+        if ((ret = init_segment(&segments[nb_segments++], &entries[idx])) < 0)
+            goto fail;
+        if (nb_segments > 1)
+            segments[nb_segments - 2].end = entries[idx];
+        prev = idx;
+    }
+    segments[nb_segments - 1].last = 1;
+
+    for (i = 0; i < nb_segments; i++) {
+        if ((ret = pthread_create(&segments[i].thread, NULL, segment_thread, &segments[i]))) {
+            ret = AVERROR(ret);
+            goto fail;
+        }
+        segments[i].thread_started = 1;
+    }
+
+    /* the main loop only transcodes the other streams from now on */
+    ist->discard         = 1;
+    ist->st->discard     = AVDISCARD_ALL;
+    segment_ost->finished = 1;
+
+    av_log(NULL, AV_LOG_VERBOSE, "Transcoding %d segments in parallel.\n", nb_segments);
+    return nb_segments;
+fail:
+    av_log(NULL, AV_LOG_ERROR, "Could not set up segment %d for transcoding.\n", nb_segments - 1);
+    segment_abort = 1;
+    free_segments();
+    nb_segments = 0;
+    return ret;
+}
+
+/**
+ * Stop the segment threads and collect their statistics.
+ */
+static void uninit_segments(void)
+{
+    int i;
+
+    segment_abort = 1;
+    for (i = 0; i < nb_segments; i++) {
+        nb_frames_dup  += segments[i].nb_frames_dup;
+        nb_frames_drop += segments[i].nb_frames_drop;
+    }
+    free_segments();
+    nb_segments = 0;
+}
+
+/**
+ * @return 1 if the video of the segments is behind the other output
+ *         streams, so that the main loop should wait for it
+ */
+static int segments_behind(void)
+{
+    OutputStream *ost = choose_output();
+
+    return ost && av_compare_ts(segment_ost->st->cur_dts, segment_ost->st->time_base,
+                                ost->st->cur_dts, ost->st->time_base) < 0;
+}
+
+/**
+ * Write the packets the segment threads have produced so far, in the
+ * order of the segments.
+ *
+ * @param wait wait a bit for a packet if none is ready
+ * @return AVERROR_EOF once all the segments are written,
+ *         a negative error code on failure, 0 otherwise
+ */
+static int write_segment_packets(int wait)
+{
+    AVFormatContext *os = output_files[0]->ctx;
+    OutputStream   *ost = segment_ost;
+
+    while (cur_segment < nb_segments) {
+        Segment *seg = &segments[cur_segment];
+        AVPacket pkt;
+        int got_packet = 0, finished;
+
+        pthread_mutex_lock(&segment_lock);
+        if (av_fifo_size(seg->packets)) {
+            av_fifo_generic_read(seg->packets, &pkt, sizeof(pkt), NULL);
+            got_packet = 1;
+        } else if (!seg->finished && wait) {
+            int64_t t = av_gettime() + 100000;
+            struct timespec tv = { .tv_sec  =  t / 1000000,
+                                   .tv_nsec = (t % 1000000) * 1000 };
+            pthread_cond_timedwait(&segment_cond, &segment_lock, &tv);
+            wait = 0;
+            pthread_mutex_unlock(&segment_lock);
+            continue;
+        }
+        finished = seg->finished && !av_fifo_size(seg->packets);
+        pthread_mutex_unlock(&segment_lock);
+
+        if (got_packet) {
+            /* each segment starts from a flushed encoder, keep the dts
+             * increasing where they are joined */
+            if (pkt.dts != AV_NOPTS_VALUE && segment_last_dts != AV_NOPTS_VALUE &&
+                pkt.dts <= segment_last_dts &&
+                (pkt.pts == AV_NOPTS_VALUE || pkt.pts > segment_last_dts))
+                pkt.dts = segment_last_dts + 1;
+            if (pkt.dts != AV_NOPTS_VALUE)
+                segment_last_dts = pkt.dts;
+            video_size += pkt.size;
+            write_frame(os, &pkt, ost);
+            ost->frame_number++;
+            wait = 0;
+            continue;
+        }
+        if (!finished)
+            return 0;
+        if (seg->ret < 0) {
+            av_log(NULL, AV_LOG_ERROR, "Error while transcoding segment %d.\n", cur_segment);
+            return seg->ret;
+        }
+        cur_segment++;
+    }
+    return AVERROR_EOF;
+}
+#endif
+
 /*
  * The following code is the main loop of the file converter
  */
@@ -2948,7 +3563,9 @@ static int transcode(void)
     timer_start = av_gettime();
 
 #if HAVE_PTHREADS
-    if ((ret = init_input_threads()) < 0)
+    if ((ret = init_segments()) < 0)
+        goto fail;
+    if (!nb_segments && (ret = init_input_threads()) < 0)
         goto fail;
 #endif
 
@@ -2960,6 +3577,24 @@ static int transcode(void)
             if (check_keyboard_interaction(cur_time) < 0)
                 break;
 
+#if HAVE_PTHREADS
+        /* the video of the segment threads is written as it comes, the other
+         * streams are transcoded below and kept in step with it */
+        if (nb_segments) {
+            int wait = !need_output() || segments_behind();
+
+            ret = write_segment_packets(wait);
+            if (ret == AVERROR_EOF) {
+                uninit_segments();
+            } else if (ret < 0) {
+                goto fail;
+            } else if (wait) {
+                print_report(0, timer_start, cur_time);
+                continue;
+            }
+        }
+#endif
+
         /* check if there's any stream where output is still needed */
         if (!need_output()) {
             av_log(NULL, AV_LOG_VERBOSE, "No more output streams to write to, finishing.\n");
@@ -2980,6 +3615,7 @@ static int transcode(void)
     }
 #if HAVE_PTHREADS
     free_input_threads();
+    uninit_segments();
 #endif
 
     /* at the end of stream, we must flush the decoder buffers */
@@ -3025,6 +3661,7 @@ static int transcode(void)
  fail:
 #if HAVE_PTHREADS
     free_input_threads();
+    uninit_segments();
 #endif
 
     if (output_streams) {
@@ -3040,6 +3677,7 @@ static int transcode(void)
                 av_freep(&ost->st->codec->subtitle_header);
                 av_free(ost->forced_kf_pts);
                 av_dict_free(&ost->opts);
+                av_dict_free(&ost->segment_opts);
             }
         }
     }
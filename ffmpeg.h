@@ -218,6 +218,7 @@ typedef struct InputStream {
     int saw_first_ts;
     int showed_multi_packet_warning;
     AVDictionary *opts;
+    AVDictionary *segment_opts;         /* decoder options for the segment threads */
     AVRational framerate;               /* framerate forced with -r */
     int top_field_first;
 
@@ -244,10 +245,6 @@ typedef struct InputStream {
         int w, h;
     } sub2video;
 
-    /* a pool of free buffers for decoded data */
-    FrameBuffer *buffer_pool;
-    int dr1;
-
     /* decoded data from this stream goes into all those filters
      * currently video and audio only */
     InputFilter **filters;
@@ -322,6 +319,7 @@ typedef struct OutputStream {
     int64_t swr_dither_method;
     double swr_dither_scale;
     AVDictionary *opts;
+    AVDictionary *segment_opts;          /* encoder options for the segment threads */
     int finished;        /* no more packets should be written for this stream */
     int unavailable;                     /* true if the steram is unavailable (possibly temporarily) */
     int stream_copy;
@@ -378,6 +376,9 @@ extern int qp_hist;
 extern int same_quant;
 extern int stdin_interaction;
 extern int frame_bits_per_raw_sample;
+extern int filter_nbthreads;
+extern int filter_pipeline;
+extern int segment_threads;
 extern AVIOContext *progress_avio;
 
 extern const AVIOInterruptCB int_cb;
@@ -713,6 +713,8 @@ int configure_filtergraph(FilterGraph *fg)
     avfilter_graph_free(&fg->graph);
     if (!(fg->graph = avfilter_graph_alloc()))
         return AVERROR(ENOMEM);
+    fg->graph->nb_threads = filter_nbthreads;
+    fg->graph->pipeline_queue_size = filter_pipeline;
 
     if (simple) {
         OutputStream *ost = fg->outputs[0]->ost;
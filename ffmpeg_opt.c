@@ -77,6 +77,9 @@ int qp_hist           = 0;
 int same_quant        = 0;
 int stdin_interaction = 1;
 int frame_bits_per_raw_sample = 0;
+int filter_nbthreads  = 0;
+int filter_pipeline   = 0;
+int segment_threads   = 0;
 
 
 static int intra_only         = 0;
@@ -2312,6 +2315,12 @@ const OptionDef options[] = {
         "set stream filterchain", "filter_list" },
     { "filter_complex", HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_filter_complex },
         "create a complex filtergraph", "graph_description" },
+    { "filter_threads", HAS_ARG | OPT_INT,                           { &filter_nbthreads },
+        "number of threads used by each filtergraph", "count" },
+    { "filter_pipeline", HAS_ARG | OPT_INT,                          { &filter_pipeline },
+        "run each video filter in its own thread", "queue_size" },
+    { "segment_threads", HAS_ARG | OPT_INT | OPT_EXPERT,             { &segment_threads },
+        "transcode that many parts of the input in parallel", "count" },
     { "stats",          OPT_BOOL,                                    { &print_stats },
         "print progress report during encoding", },
     { "attach",         HAS_ARG | OPT_PERFILE | OPT_EXPERT,          { .func_arg = opt_attach },
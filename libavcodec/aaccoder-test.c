@@ -0,0 +1,125 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * AAC encoder quantization tests.
+ * The optimized abs_pow34 and quant_bands functions are run on random
+ * coefficients next to their C versions, for every scalefactor band width,
+ * and the output has to be bit-exact.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/cpu.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "aacenc.h"
+
+#undef printf
+#undef fprintf
+
+#define MAX_SIZE 96
+#define TRIALS   100
+
+static const int band_sizes[] = { 4, 8, 12, 16, 20, 24, 28, 32, 36, 44, 48,
+                                  52, 56, 64, 72, 80, 88, 92, 96 };
+static const int maxvals[]    = { 1, 2, 4, 7, 12, 16, 8191 };
+
+DECLARE_ALIGNED(16, static float, in)[MAX_SIZE];
+DECLARE_ALIGNED(16, static float, scaled_ref)[MAX_SIZE];
+DECLARE_ALIGNED(16, static float, scaled_new)[MAX_SIZE];
+DECLARE_ALIGNED(16, static int,   quant_ref)[MAX_SIZE];
+DECLARE_ALIGNED(16, static int,   quant_new)[MAX_SIZE];
+
+static AVLFG prng;
+
+static float rnd_coef(void)
+{
+    /* mostly small values, some large ones to hit the clipping */
+    float v = av_lfg_get(&prng) / (float)UINT32_MAX - 0.5f;
+    if (!(av_lfg_get(&prng) & 7))
+        v *= 100000.0f;
+    else
+        v *= 64.0f;
+    return v;
+}
+
+/**
+ * @return 1 if abs_pow34 differs, 2 if quant_bands differs, or both
+ */
+static int test_size(AACEncContext *c, AACEncContext *s, int size)
+{
+    int i, j, ret = 0;
+
+    for (i = 0; i < size; i++)
+        in[i] = rnd_coef();
+    if (!(av_lfg_get(&prng) & 3))
+        in[av_lfg_get(&prng) % size] = 0.0f;
+
+    c->abs_pow34(scaled_ref, in, size);
+    s->abs_pow34(scaled_new, in, size);
+    if (memcmp(scaled_ref, scaled_new, size * sizeof(*scaled_ref))) {
+        fprintf(stderr, "abs_pow34: mismatch (size %d)\n", size);
+        ret |= 1;
+    }
+
+    for (j = 0; j < FF_ARRAY_ELEMS(maxvals); j++) {
+        float Q34     = 0.001f + av_lfg_get(&prng) / (float)UINT32_MAX * 2.0f;
+        int is_signed = j & 1;
+
+        c->quant_bands(quant_ref, in, scaled_ref, size, Q34, is_signed, maxvals[j]);
+        s->quant_bands(quant_new, in, scaled_ref, size, Q34, is_signed, maxvals[j]);
+        if (memcmp(quant_ref, quant_new, size * sizeof(*quant_ref))) {
+            fprintf(stderr, "quant_bands: mismatch (size %d, maxval %d, "
+                    "signed %d)\n", size, maxvals[j], is_signed);
+            ret |= 2;
+        }
+    }
+    return ret;
+}
+
+int main(void)
+{
+    AACEncContext *c = av_mallocz(sizeof(*c));
+    AACEncContext *s = av_mallocz(sizeof(*s));
+    int cpu_flags = av_get_cpu_flags();
+    int i, j, ret = 0;
+
+    if (!c || !s)
+        return 1;
+
+    av_lfg_init(&prng, 1);
+
+    av_force_cpu_flags(0);
+    ff_aac_coder_init(c);
+    av_force_cpu_flags(cpu_flags);
+    ff_aac_coder_init(s);
+
+    for (i = 0; i < TRIALS; i++)
+        for (j = 0; j < FF_ARRAY_ELEMS(band_sizes); j++)
+            ret |= test_size(c, s, band_sizes[j]);
+
+    printf("abs_pow34: %s\n",   ret & 1 ? "failed" : "ok");
+    printf("quant_bands: %s\n", ret & 2 ? "failed" : "ok");
+
+    av_free(c);
+    av_free(s);
+    return !!ret;
+}
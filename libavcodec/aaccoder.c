@@ -83,7 +83,7 @@ static void quantize_bands(int *out, const float *in, const float *scaled,
     }
 }
 
-static void abs_pow34_v(float *out, const float *in, const int size)
+static void abs_pow34_v(float *out, const float *in, int size)
 {
 #ifndef USE_REALLY_FULL_SEARCH
     int i;
@@ -131,10 +131,10 @@ static av_always_inline float quantize_and_encode_band_cost_template(
         return cost * lambda;
     }
     if (!scaled) {
-        abs_pow34_v(s->scoefs, in, size);
+        s->abs_pow34(s->scoefs, in, size);
         scaled = s->scoefs;
     }
-    quantize_bands(s->qcoefs, in, scaled, size, Q34, !BT_UNSIGNED, maxval);
+    s->quant_bands(s->qcoefs, in, scaled, size, Q34, !BT_UNSIGNED, maxval);
     if (BT_UNSIGNED) {
         off = 0;
     } else {
@@ -323,7 +323,7 @@ static void encode_window_bands_info(AACEncContext *s, SingleChannelElement *sce
     float next_minrd = INFINITY;
     int next_mincb = 0;
 
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->abs_pow34(s->scoefs, sce->coeffs, 1024);
     start = win*128;
     for (cb = 0; cb < 12; cb++) {
         path[0][cb].cost     = 0.0f;
@@ -424,7 +424,7 @@ static void codebook_trellis_rate(AACEncContext *s, SingleChannelElement *sce,
     float next_minbits = INFINITY;
     int next_mincb = 0;
 
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->abs_pow34(s->scoefs, sce->coeffs, 1024);
     start = win*128;
     for (cb = 0; cb < 12; cb++) {
         path[0][cb].cost     = run_bits+4;
@@ -615,7 +615,7 @@ static void search_for_quantizers_anmr(AVCodecContext *avctx, AACEncContext *s,
         }
     }
     idx = 1;
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->abs_pow34(s->scoefs, sce->coeffs, 1024);
     for (w = 0; w < sce->ics.num_windows; w += sce->ics.group_len[w]) {
         start = w*128;
         for (g = 0; g < sce->ics.num_swb; g++) {
@@ -758,7 +758,7 @@ static void search_for_quantizers_twoloop(AVCodecContext *avctx,
 
     if (!allz)
         return;
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->abs_pow34(s->scoefs, sce->coeffs, 1024);
 
     for (w = 0; w < sce->ics.num_windows; w += sce->ics.group_len[w]) {
         start = w*128;
@@ -939,7 +939,7 @@ static void search_for_quantizers_faac(AVCodecContext *avctx, AACEncContext *s,
         }
     }
     memset(sce->sf_idx, 0, sizeof(sce->sf_idx));
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->abs_pow34(s->scoefs, sce->coeffs, 1024);
     for (w = 0; w < sce->ics.num_windows; w += sce->ics.group_len[w]) {
         start = w*128;
         for (g = 0;  g < sce->ics.num_swb; g++) {
@@ -1079,10 +1079,10 @@ static void search_for_ms(AACEncContext *s, ChannelElement *cpe,
                         S[i] =  M[i]
                               - sce1->coeffs[start+w2*128+i];
                     }
-                    abs_pow34_v(L34, sce0->coeffs+start+w2*128, sce0->ics.swb_sizes[g]);
-                    abs_pow34_v(R34, sce1->coeffs+start+w2*128, sce0->ics.swb_sizes[g]);
-                    abs_pow34_v(M34, M,                         sce0->ics.swb_sizes[g]);
-                    abs_pow34_v(S34, S,                         sce0->ics.swb_sizes[g]);
+                    s->abs_pow34(L34, sce0->coeffs+start+w2*128, sce0->ics.swb_sizes[g]);
+                    s->abs_pow34(R34, sce1->coeffs+start+w2*128, sce0->ics.swb_sizes[g]);
+                    s->abs_pow34(M34, M,                         sce0->ics.swb_sizes[g]);
+                    s->abs_pow34(S34, S,                         sce0->ics.swb_sizes[g]);
                     dist1 += quantize_band_cost(s, sce0->coeffs + start + w2*128,
                                                 L34,
                                                 sce0->ics.swb_sizes[g],
@@ -1141,3 +1141,14 @@ AACCoefficientsEncoder ff_aac_coders[AAC_CODER_NB] = {
         search_for_ms,
     },
 };
+
+av_cold void ff_aac_coder_init(AACEncContext *s)
+{
+    s->abs_pow34   = abs_pow34_v;
+    s->quant_bands = quantize_bands;
+
+#ifndef USE_REALLY_FULL_SEARCH
+    if (ARCH_X86)
+        ff_aac_coder_init_x86(s);
+#endif /* USE_REALLY_FULL_SEARCH */
+}
@@ -507,13 +507,64 @@ static void deinterleave_input_samples(AACEncContext *s, const AVFrame *frame)
     }
 }
 
+/**
+ * Search the quantizers and the stereo coding of one channel element,
+ * once the psychoacoustic analysis of the frame is done.
+ */
+static int search_channel_element(AVCodecContext *avctx, void *arg,
+                                  int jobnr, int threadnr)
+{
+    AACEncContext *s = avctx->priv_data;
+    AACEncContext *t = s->thread_ctx ? &s->thread_ctx[threadnr] : s;
+    ChannelElement *cpe = &s->cpe[jobnr];
+    FFPsyWindowInfo *wi = arg;
+    int i, ch, w, g, chans, start_ch = 0;
+
+    for (i = 0; i < jobnr; i++)
+        start_ch += s->chan_map[i+1] == TYPE_CPE ? 2 : 1;
+    chans = s->chan_map[jobnr+1] == TYPE_CPE ? 2 : 1;
+    wi   += start_ch;
+
+    for (ch = 0; ch < chans; ch++) {
+        t->cur_channel = start_ch + ch;
+        s->coder->search_for_quantizers(avctx, t, &cpe->ch[ch], s->lambda);
+    }
+    cpe->common_window = 0;
+    if (chans > 1
+        && wi[0].window_type[0] == wi[1].window_type[0]
+        && wi[0].window_shape   == wi[1].window_shape) {
+
+        cpe->common_window = 1;
+        for (w = 0; w < wi[0].num_windows; w++) {
+            if (wi[0].grouping[w] != wi[1].grouping[w]) {
+                cpe->common_window = 0;
+                break;
+            }
+        }
+    }
+    t->cur_channel = start_ch;
+    if (s->options.stereo_mode && cpe->common_window) {
+        if (s->options.stereo_mode > 0) {
+            IndividualChannelStream *ics = &cpe->ch[0].ics;
+            for (w = 0; w < ics->num_windows; w += ics->group_len[w])
+                for (g = 0;  g < ics->num_swb; g++)
+                    cpe->ms_mask[w*16+g] = 1;
+        } else if (s->coder->search_for_ms) {
+            s->coder->search_for_ms(t, cpe, s->lambda);
+        }
+    }
+    adjust_frame_information(t, cpe, chans);
+
+    return 0;
+}
+
 static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                             const AVFrame *frame, int *got_packet_ptr)
 {
     AACEncContext *s = avctx->priv_data;
     float **samples = s->planar_samples, *samples2, *la, *overlap;
     ChannelElement *cpe;
-    int i, ch, w, g, chans, tag, start_ch, ret;
+    int i, ch, w, chans, tag, start_ch, ret;
     int chan_el_counter[4];
     FFPsyWindowInfo windows[AAC_MAX_CHANNELS];
 
@@ -587,48 +638,33 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
 
         if ((avctx->frame_number & 0xFF)==1 && !(avctx->flags & CODEC_FLAG_BITEXACT))
             put_bitstream_info(avctx, s, LIBAVCODEC_IDENT);
+
+        /* the psychoacoustic model updates its bit reservoir state with
+         * each channel element, so it has to run in order */
         start_ch = 0;
-        memset(chan_el_counter, 0, sizeof(chan_el_counter));
         for (i = 0; i < s->chan_map[0]; i++) {
-            FFPsyWindowInfo* wi = windows + start_ch;
             const float *coeffs[2];
+            chans    = s->chan_map[i+1] == TYPE_CPE ? 2 : 1;
+            cpe      = &s->cpe[i];
+            for (ch = 0; ch < chans; ch++)
+                coeffs[ch] = cpe->ch[ch].coeffs;
+            s->psy.model->analyze(&s->psy, start_ch, coeffs, windows + start_ch);
+            start_ch += chans;
+        }
+        if (s->thread_ctx)
+            for (i = 0; i < avctx->thread_count; i++)
+                memcpy(&s->thread_ctx[i], s, sizeof(*s));
+        avctx->execute2(avctx, search_channel_element, windows, NULL,
+                        s->chan_map[0]);
+
+        start_ch = 0;
+        memset(chan_el_counter, 0, sizeof(chan_el_counter));
+        for (i = 0; i < s->chan_map[0]; i++) {
             tag      = s->chan_map[i+1];
             chans    = tag == TYPE_CPE ? 2 : 1;
             cpe      = &s->cpe[i];
             put_bits(&s->pb, 3, tag);
             put_bits(&s->pb, 4, chan_el_counter[tag]++);
-            for (ch = 0; ch < chans; ch++)
-                coeffs[ch] = cpe->ch[ch].coeffs;
-            s->psy.model->analyze(&s->psy, start_ch, coeffs, wi);
-            for (ch = 0; ch < chans; ch++) {
-                s->cur_channel = start_ch * 2 + ch;
-                s->coder->search_for_quantizers(avctx, s, &cpe->ch[ch], s->lambda);
-            }
-            cpe->common_window = 0;
-            if (chans > 1
-                && wi[0].window_type[0] == wi[1].window_type[0]
-                && wi[0].window_shape   == wi[1].window_shape) {
-
-                cpe->common_window = 1;
-                for (w = 0; w < wi[0].num_windows; w++) {
-                    if (wi[0].grouping[w] != wi[1].grouping[w]) {
-                        cpe->common_window = 0;
-                        break;
-                    }
-                }
-            }
-            s->cur_channel = start_ch * 2;
-            if (s->options.stereo_mode && cpe->common_window) {
-                if (s->options.stereo_mode > 0) {
-                    IndividualChannelStream *ics = &cpe->ch[0].ics;
-                    for (w = 0; w < ics->num_windows; w += ics->group_len[w])
-                        for (g = 0;  g < ics->num_swb; g++)
-                            cpe->ms_mask[w*16+g] = 1;
-                } else if (s->coder->search_for_ms) {
-                    s->coder->search_for_ms(s, cpe, s->lambda);
-                }
-            }
-            adjust_frame_information(s, cpe, chans);
             if (chans == 2) {
                 put_bits(&s->pb, 1, cpe->common_window);
                 if (cpe->common_window) {
@@ -686,6 +722,7 @@ static av_cold int aac_encode_end(AVCodecContext *avctx)
         ff_psy_preprocess_end(s->psypp);
     av_freep(&s->buffer.samples);
     av_freep(&s->cpe);
+    av_freep(&s->thread_ctx);
     ff_af_queue_close(&s->afq);
 #if FF_API_OLD_ENCODE_AUDIO
     av_freep(&avctx->coded_frame);
@@ -699,6 +736,7 @@ static av_cold int dsp_init(AVCodecContext *avctx, AACEncContext *s)
 
     ff_dsputil_init(&s->dsp, avctx);
     avpriv_float_dsp_init(&s->fdsp, avctx->flags & CODEC_FLAG_BITEXACT);
+    ff_aac_coder_init(s);
 
     // window init
     ff_kbd_window_init(ff_aac_kbd_long_1024, 4.0, 1024);
@@ -724,6 +762,9 @@ static av_cold int alloc_buffers(AVCodecContext *avctx, AACEncContext *s)
     for(ch = 0; ch < s->channels; ch++)
         s->planar_samples[ch] = s->buffer.samples + 3 * 1024 * ch;
 
+    if (avctx->active_thread_type & FF_THREAD_SLICE && avctx->thread_count > 1)
+        FF_ALLOC_OR_GOTO(avctx, s->thread_ctx, avctx->thread_count * sizeof(*s->thread_ctx), alloc_fail);
+
 #if FF_API_OLD_ENCODE_AUDIO
     if (!(avctx->coded_frame = avcodec_alloc_frame()))
         goto alloc_fail;
@@ -826,7 +867,7 @@ AVCodec ff_aac_encoder = {
     .close          = aac_encode_end,
     .supported_samplerates = avpriv_mpeg4audio_sample_rates,
     .capabilities   = CODEC_CAP_SMALL_LAST_FRAME | CODEC_CAP_DELAY |
-                      CODEC_CAP_EXPERIMENTAL,
+                      CODEC_CAP_SLICE_THREADS | CODEC_CAP_EXPERIMENTAL,
     .sample_fmts    = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_FLT,
                                                      AV_SAMPLE_FMT_NONE },
     .long_name      = NULL_IF_CONFIG_SMALL("AAC (Advanced Audio Coding)"),
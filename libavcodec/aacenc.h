@@ -80,11 +80,33 @@ typedef struct AACEncContext {
     DECLARE_ALIGNED(16, int,   qcoefs)[96];      ///< quantized coefficients
     DECLARE_ALIGNED(32, float, scoefs)[1024];    ///< scaled coefficients
 
+    /**
+     * Compute |in|^(3/4) of size coefficients, size is a nonzero multiple
+     * of 4 as all scalefactor band widths are.
+     */
+    void (*abs_pow34)(float *out, const float *in, int size);
+    /**
+     * Quantize size scaled coefficients with the step Q34, clipped to maxval
+     * and with the sign of in if is_signed, size is a nonzero multiple of 4.
+     */
+    void (*quant_bands)(int *out, const float *in, const float *scaled,
+                        int size, float Q34, int is_signed, int maxval);
+
     struct {
         float *samples;
     } buffer;
+
+    /**
+     * Copies of the context used by the slice threads for the quantizer
+     * search, which needs its own cur_channel and scratch buffers.
+     * NULL without slice threading.
+     */
+    struct AACEncContext *thread_ctx;
 } AACEncContext;
 
 extern float ff_aac_pow34sf_tab[428];
 
+void ff_aac_coder_init(AACEncContext *s);
+void ff_aac_coder_init_x86(AACEncContext *s);
+
 #endif /* AVCODEC_AACENC_H */
@@ -0,0 +1,148 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Decode PCM through avcodec_decode_audio_batch() while the channel count
+ * and packet size change between batches, and check the decoded samples and
+ * that the layout of the batch buffer stays inside the buffer.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/intreadwrite.h"
+#include "avcodec.h"
+#include "internal.h"
+
+#undef printf
+
+#define MAX_PKTS 4
+
+static const struct {
+    int channels, nb_samples, nb_pkts;
+} batches[] = {
+    { 8, 1024, 1 },
+    { 6, 1000, 1 },     /* reuses the buffer of the 8 channel batch */
+    { 6, 1000, 3 },
+    { 2,  333, 4 },
+    { 8,   17, 2 },
+    { 1, 4096, 1 },
+    { 5,  999, 2 },
+};
+
+static int sample_value(int pkt, int ch, int i)
+{
+    return (int16_t)(pkt * 7919 + ch * 1009 + i * 31);
+}
+
+static int test_codec(enum AVCodecID codec_id)
+{
+    AVCodec *codec = avcodec_find_decoder(codec_id);
+    AVCodecContext *avctx;
+    AVPacket pkts[MAX_PKTS];
+    AVFrame frame;
+    int b, i, j, ch, p, ret, err = 0;
+
+    if (!codec) {
+        printf("decoder not found\n");
+        return 1;
+    }
+    avctx = avcodec_alloc_context3(codec);
+    avctx->channels    = batches[0].channels;
+    avctx->sample_rate = 44100;
+    if (avcodec_open2(avctx, codec, NULL) < 0) {
+        printf("cannot open %s\n", codec->name);
+        return 1;
+    }
+
+    for (b = 0; b < FF_ARRAY_ELEMS(batches); b++) {
+        int channels   = batches[b].channels;
+        int nb_samples = batches[b].nb_samples;
+        int nb_pkts    = batches[b].nb_pkts;
+        int planar     = codec_id == AV_CODEC_ID_PCM_S16LE_PLANAR;
+        int got_frame, nb_planes, plane_size;
+        AVCodecInternal *avci = avctx->internal;
+
+        avctx->channels = channels;
+        for (i = 0; i < nb_pkts; i++) {
+            av_new_packet(&pkts[i], nb_samples * channels * 2);
+            for (ch = 0; ch < channels; ch++)
+                for (j = 0; j < nb_samples; j++)
+                    AV_WL16(pkts[i].data + 2 * (planar ? ch * nb_samples + j :
+                                                         j * channels + ch),
+                            sample_value(i, ch, j));
+        }
+
+        avcodec_get_frame_defaults(&frame);
+        ret = avcodec_decode_audio_batch(avctx, &frame, &got_frame,
+                                         pkts, nb_pkts);
+        printf("%s %d channels %d packets: ret %d, %d samples\n", codec->name,
+               channels, nb_pkts, ret, got_frame ? frame.nb_samples : 0);
+        if (ret != nb_pkts || !got_frame ||
+            frame.nb_samples != nb_samples * nb_pkts) {
+            err = 1;
+            goto next;
+        }
+
+        nb_planes  = planar ? channels : 1;
+        plane_size = avci->batch_capacity * 2 * (planar ? 1 : channels);
+        for (p = 0; p < nb_planes; p++) {
+            if (frame.extended_data[p] < avci->batch_buf ||
+                frame.extended_data[p] + plane_size >
+                avci->batch_buf + avci->batch_buf_size) {
+                printf("plane %d of %d samples outside of the %d byte buffer\n",
+                       p, avci->batch_capacity, avci->batch_buf_size);
+                err = 1;
+            }
+        }
+
+        for (i = 0; i < nb_pkts; i++)
+            for (ch = 0; ch < channels; ch++)
+                for (j = 0; j < nb_samples; j++) {
+                    int n = i * nb_samples + j;
+                    const uint8_t *s = planar ? frame.extended_data[ch] + 2 * n :
+                                       frame.extended_data[0] + 2 * (n * channels + ch);
+                    if ((int16_t)AV_RN16(s) != sample_value(i, ch, j)) {
+                        printf("mismatch at packet %d channel %d sample %d\n",
+                               i, ch, j);
+                        err = 1;
+                        goto next;
+                    }
+                }
+next:
+        for (i = 0; i < nb_pkts; i++)
+            av_free_packet(&pkts[i]);
+    }
+
+    avcodec_close(avctx);
+    av_free(avctx);
+    return err;
+}
+
+int main(void)
+{
+    int err = 0;
+
+    avcodec_register_all();
+
+    err |= test_codec(AV_CODEC_ID_PCM_S16LE);
+    err |= test_codec(AV_CODEC_ID_PCM_S16LE_PLANAR);
+
+    return err;
+}
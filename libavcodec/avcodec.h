@@ -29,6 +29,7 @@
 #include <errno.h>
 #include "libavutil/samplefmt.h"
 #include "libavutil/avutil.h"
+#include "libavutil/buffer.h"
 #include "libavutil/cpu.h"
 #include "libavutil/dict.h"
 #include "libavutil/log.h"
@@ -791,6 +792,13 @@ typedef struct RcOverride{
  * Audio encoder supports receiving a different number of samples in each call.
  */
 #define CODEC_CAP_VARIABLE_FRAME_SIZE 0x10000
+/**
+ * Encoder output does not depend on previous closed GOPs, so that they can
+ * be encoded in parallel by frame threads when CODEC_FLAG_CLOSED_GOP is set.
+ * The encoder must code the first frame after a flush as a key frame, and
+ * honor forced AV_PICTURE_TYPE_I input frames.
+ */
+#define CODEC_CAP_GOP_THREADS      0x20000
 /**
  * Codec is intra only.
  */
@@ -1403,6 +1411,20 @@ typedef struct AVFrame {
      * - decoding: Read by user.
      */
     int64_t channels;
+
+    /**
+     * Reference-counted buffers backing the data planes, NULL for planes
+     * which are not reference counted.
+     * They belong to whoever allocated the frame and are only valid as long
+     * as the frame data is. Take a new reference with av_buffer_ref() to keep
+     * the data after the frame has been released; the data must then be
+     * treated as read-only.
+     * Code outside libavcodec should access this field using:
+     * av_frame_get_plane_buffer(frame, plane)
+     * - encoding: unused
+     * - decoding: set by get_buffer(), read by user.
+     */
+    AVBufferRef *buf[AV_NUM_DATA_POINTERS];
 } AVFrame;
 
 /**
@@ -1427,6 +1449,14 @@ void          av_frame_set_metadata       (AVFrame *frame, AVDictionary *val);
 int     av_frame_get_decode_error_flags   (const AVFrame *frame);
 void    av_frame_set_decode_error_flags   (AVFrame *frame, int     val);
 
+/**
+ * Get the reference-counted buffer holding the given data plane of a frame.
+ *
+ * @return the buffer containing frame->data[plane], or NULL if the plane is
+ *         not reference counted
+ */
+AVBufferRef *av_frame_get_plane_buffer(const AVFrame *frame, int plane);
+
 struct AVCodecInternal;
 
 enum AVFieldOrder {
@@ -1661,6 +1691,13 @@ typedef struct AVCodecContext {
      * at the same time; threads might draw different parts of the same AVFrame,
      * or multiple AVFrames, and there is no guarantee that slices will be drawn
      * in order.
+     * With frame threading, it is called from the decoding threads, for
+     * different frames at the same time, and s is the copy of the context
+     * used by that thread: only opaque and the fields set by the user can
+     * be relied upon there.
+     * Decoders which reorder pictures only call it when the pictures are
+     * output in decoding order (has_b_frames is 0) or with
+     * SLICE_FLAG_CODED_ORDER.
      * The function is also used by hardware acceleration APIs.
      * It is called at least once during frame decoding to pass
      * the data needed for hardware render.
@@ -3861,6 +3898,44 @@ attribute_deprecated int avcodec_decode_audio3(AVCodecContext *avctx, int16_t *s
 int avcodec_decode_audio4(AVCodecContext *avctx, AVFrame *frame,
                           int *got_frame_ptr, const AVPacket *avpkt);
 
+/**
+ * Decode a batch of audio packets into a single frame.
+ *
+ * This works like calling avcodec_decode_audio4() on each packet in turn
+ * (including the repeated calls needed to consume a packet holding several
+ * frames) and concatenating the decoded samples. With the default
+ * get_buffer(), decoders write their output directly into the batch buffer,
+ * which is allocated once and grown as needed, so that small-frame codecs
+ * avoid the per-packet buffer setup and copy.
+ *
+ * The batch ends early before a packet carrying AV_PKT_DATA_PARAM_CHANGE
+ * side data, and after a packet which fails to decode or whose samples do
+ * not match the format, channel count, channel layout or sample rate of
+ * the samples already in the batch; the samples of that packet are then
+ * lost.
+ *
+ * @param      avctx the codec context
+ * @param[out] frame The AVFrame in which to store the decoded samples. Its
+ *                   timestamps and packet position are those of the first
+ *                   decoded frame of the batch and pkt_duration is the sum
+ *                   of the decoded frame durations. The sample data is
+ *                   owned by the codec context and is valid until the next
+ *                   call to this function or until the codec is closed.
+ * @param[out] got_frame_ptr Zero if no samples could be decoded, otherwise
+ *                           non-zero.
+ * @param[in]  pkts  array of nb_pkts input packets, with the same
+ *                   requirements as the packet of avcodec_decode_audio4();
+ *                   an empty packet drains the decoder of codecs with the
+ *                   CODEC_CAP_DELAY capability
+ * @param      nb_pkts number of packets in pkts
+ * @return the number of packets consumed from the start of pkts, the
+ *         remaining ones must be passed to the next call, or a negative
+ *         error code if the first packet could not be decoded
+ */
+int avcodec_decode_audio_batch(AVCodecContext *avctx, AVFrame *frame,
+                               int *got_frame_ptr, const AVPacket *pkts,
+                               int nb_pkts);
+
 /**
  * Decode the video frame of size avpkt->size from avpkt->data into picture.
  * Some decoders may support multiple frames in a single AVPacket, such
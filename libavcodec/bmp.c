@@ -23,6 +23,7 @@
 #include "bytestream.h"
 #include "bmp.h"
 #include "msrledec.h"
+#include "thread.h"
 
 static av_cold int bmp_decode_init(AVCodecContext *avctx){
     BMPContext *s = avctx->priv_data;
@@ -33,6 +34,15 @@ static av_cold int bmp_decode_init(AVCodecContext *avctx){
     return 0;
 }
 
+static av_cold int bmp_decode_init_thread_copy(AVCodecContext *avctx)
+{
+    BMPContext *s = avctx->priv_data;
+
+    avctx->coded_frame = &s->picture;
+
+    return 0;
+}
+
 static int bmp_decode_frame(AVCodecContext *avctx,
                             void *data, int *data_size,
                             AVPacket *avpkt)
@@ -206,10 +216,10 @@ static int bmp_decode_frame(AVCodecContext *avctx,
     }
 
     if(p->data[0])
-        avctx->release_buffer(avctx, p);
+        ff_thread_release_buffer(avctx, p);
 
     p->reference = 0;
-    if(avctx->get_buffer(avctx, p) < 0){
+    if(ff_thread_get_buffer(avctx, p) < 0){
         av_log(avctx, AV_LOG_ERROR, "get_buffer() failed\n");
         return -1;
     }
@@ -350,13 +360,14 @@ static av_cold int bmp_decode_end(AVCodecContext *avctx)
 }
 
 AVCodec ff_bmp_decoder = {
-    .name           = "bmp",
-    .type           = AVMEDIA_TYPE_VIDEO,
-    .id             = AV_CODEC_ID_BMP,
-    .priv_data_size = sizeof(BMPContext),
-    .init           = bmp_decode_init,
-    .close          = bmp_decode_end,
-    .decode         = bmp_decode_frame,
-    .capabilities   = CODEC_CAP_DR1,
-    .long_name      = NULL_IF_CONFIG_SMALL("BMP (Windows and OS/2 bitmap)"),
+    .name             = "bmp",
+    .type             = AVMEDIA_TYPE_VIDEO,
+    .id               = AV_CODEC_ID_BMP,
+    .priv_data_size   = sizeof(BMPContext),
+    .init             = bmp_decode_init,
+    .close            = bmp_decode_end,
+    .decode           = bmp_decode_frame,
+    .capabilities     = CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS,
+    .init_thread_copy = ONLY_IF_THREADS_ENABLED(bmp_decode_init_thread_copy),
+    .long_name        = NULL_IF_CONFIG_SMALL("BMP (Windows and OS/2 bitmap)"),
 };
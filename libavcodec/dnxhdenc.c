@@ -520,13 +520,18 @@ static av_always_inline int dnxhd_switch_matrix(DNXHDEncContext *ctx, int i)
     return component[i];
 }
 
-static int dnxhd_calc_bits_thread(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+/**
+ * Compute the bits and the distortion of the macroblocks of a row for the
+ * qscales from qscale_first to qscale_end - 1.
+ * The pixels are only loaded once per macroblock, and the DC coefficients,
+ * which do not depend on the qscale, are only coded once.
+ */
+static av_always_inline void dnxhd_calc_bits_row(AVCodecContext *avctx,
+                                                 DNXHDEncContext *ctx, int mb_y,
+                                                 int qscale_first, int qscale_end)
 {
-    DNXHDEncContext *ctx = avctx->priv_data;
-    int mb_y = jobnr, mb_x;
-    int qscale = ctx->qscale;
+    int mb_x, qscale;
     LOCAL_ALIGNED_16(DCTELEM, block, [64]);
-    ctx = ctx->thread[threadnr];
 
     ctx->m.last_dc[0] =
     ctx->m.last_dc[1] =
@@ -534,40 +539,61 @@ static int dnxhd_calc_bits_thread(AVCodecContext *avctx, void *arg, int jobnr, i
 
     for (mb_x = 0; mb_x < ctx->m.mb_width; mb_x++) {
         unsigned mb = mb_y * ctx->m.mb_width + mb_x;
-        int ssd     = 0;
-        int ac_bits = 0;
         int dc_bits = 0;
-        int i;
 
         dnxhd_get_blocks(ctx, mb_x, mb_y);
 
-        for (i = 0; i < 8; i++) {
-            DCTELEM *src_block = ctx->blocks[i];
-            int overflow, nbits, diff, last_index;
-            int n = dnxhd_switch_matrix(ctx, i);
+        for (qscale = qscale_first; qscale < qscale_end; qscale++) {
+            int ssd     = 0;
+            int ac_bits = 0;
+            int i;
+
+            for (i = 0; i < 8; i++) {
+                DCTELEM *src_block = ctx->blocks[i];
+                int overflow, nbits, diff, last_index;
+                int n = dnxhd_switch_matrix(ctx, i);
 
-            memcpy(block, src_block, 64*sizeof(*block));
-            last_index = ctx->m.dct_quantize(&ctx->m, block, 4&(2*i), qscale, &overflow);
-            ac_bits += dnxhd_calc_ac_bits(ctx, block, last_index);
+                memcpy(block, src_block, 64*sizeof(*block));
+                last_index = ctx->m.dct_quantize(&ctx->m, block, 4&(2*i), qscale, &overflow);
+                ac_bits += dnxhd_calc_ac_bits(ctx, block, last_index);
 
-            diff = block[0] - ctx->m.last_dc[n];
-            if (diff < 0) nbits = av_log2_16bit(-2*diff);
-            else          nbits = av_log2_16bit( 2*diff);
+                if (qscale == qscale_first) {
+                    diff = block[0] - ctx->m.last_dc[n];
+                    if (diff < 0) nbits = av_log2_16bit(-2*diff);
+                    else          nbits = av_log2_16bit( 2*diff);
 
-            av_assert1(nbits < ctx->cid_table->bit_depth + 4);
-            dc_bits += ctx->cid_table->dc_bits[nbits] + nbits;
+                    av_assert1(nbits < ctx->cid_table->bit_depth + 4);
+                    dc_bits += ctx->cid_table->dc_bits[nbits] + nbits;
 
-            ctx->m.last_dc[n] = block[0];
+                    ctx->m.last_dc[n] = block[0];
+                }
 
-            if (avctx->mb_decision == FF_MB_DECISION_RD || !RC_VARIANCE) {
-                dnxhd_unquantize_c(ctx, block, i, qscale, last_index);
-                ctx->m.dsp.idct(block);
-                ssd += dnxhd_ssd_block(block, src_block);
+                if (avctx->mb_decision == FF_MB_DECISION_RD || !RC_VARIANCE) {
+                    dnxhd_unquantize_c(ctx, block, i, qscale, last_index);
+                    ctx->m.dsp.idct(block);
+                    ssd += dnxhd_ssd_block(block, src_block);
+                }
             }
+            ctx->mb_rc[qscale][mb].ssd = ssd;
+            ctx->mb_rc[qscale][mb].bits = ac_bits+dc_bits+12+8*ctx->vlc_bits[0];
         }
-        ctx->mb_rc[qscale][mb].ssd = ssd;
-        ctx->mb_rc[qscale][mb].bits = ac_bits+dc_bits+12+8*ctx->vlc_bits[0];
     }
+}
+
+static int dnxhd_calc_bits_thread(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    DNXHDEncContext *ctx = avctx->priv_data;
+    int qscale = ctx->qscale;
+
+    dnxhd_calc_bits_row(avctx, ctx->thread[threadnr], jobnr, qscale, qscale + 1);
+    return 0;
+}
+
+static int dnxhd_calc_rdo_bits_thread(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    DNXHDEncContext *ctx = avctx->priv_data;
+
+    dnxhd_calc_bits_row(avctx, ctx->thread[threadnr], jobnr, 1, avctx->qmax);
     return 0;
 }
 
@@ -667,16 +693,45 @@ static int dnxhd_mb_var_thread(AVCodecContext *avctx, void *arg, int jobnr, int
     return 0;
 }
 
+/**
+ * Choose the qscales of the macroblocks of a row for the current lambda.
+ * slice_size[] holds the padded bits of each row until the slices are set up.
+ */
+static int dnxhd_rdo_qscale_thread(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    DNXHDEncContext *ctx = avctx->priv_data;
+    unsigned lambda = ctx->lambda;
+    int mb_y = jobnr, mb_x, q;
+    int bits = 0;
+
+    for (mb_x = 0; mb_x < ctx->m.mb_width; mb_x++) {
+        unsigned min = UINT_MAX;
+        int qscale = 1;
+        int mb = mb_y*ctx->m.mb_width+mb_x;
+        for (q = 1; q < avctx->qmax; q++) {
+            unsigned score = ctx->mb_rc[q][mb].bits*lambda+
+                ((unsigned)ctx->mb_rc[q][mb].ssd<<LAMBDA_FRAC_BITS);
+            if (score < min) {
+                min = score;
+                qscale = q;
+            }
+        }
+        bits += ctx->mb_rc[qscale][mb].bits;
+        ctx->mb_qscale[mb] = qscale;
+        ctx->mb_bits[mb] = ctx->mb_rc[qscale][mb].bits;
+    }
+    ctx->slice_size[mb_y] = (bits+31)&~31; // padding
+    return 0;
+}
+
 static int dnxhd_encode_rdo(AVCodecContext *avctx, DNXHDEncContext *ctx)
 {
     int lambda, up_step, down_step;
     int last_lower = INT_MAX, last_higher = 0;
-    int x, y, q;
+    int y;
+
+    avctx->execute2(avctx, dnxhd_calc_rdo_bits_thread, NULL, NULL, ctx->m.mb_height);
 
-    for (q = 1; q < avctx->qmax; q++) {
-        ctx->qscale = q;
-        avctx->execute2(avctx, dnxhd_calc_bits_thread, NULL, NULL, ctx->m.mb_height);
-    }
     up_step = down_step = 2<<LAMBDA_FRAC_BITS;
     lambda = ctx->lambda;
 
@@ -687,27 +742,10 @@ static int dnxhd_encode_rdo(AVCodecContext *avctx, DNXHDEncContext *ctx)
             lambda++;
             end = 1; // need to set final qscales/bits
         }
-        for (y = 0; y < ctx->m.mb_height; y++) {
-            for (x = 0; x < ctx->m.mb_width; x++) {
-                unsigned min = UINT_MAX;
-                int qscale = 1;
-                int mb = y*ctx->m.mb_width+x;
-                for (q = 1; q < avctx->qmax; q++) {
-                    unsigned score = ctx->mb_rc[q][mb].bits*lambda+
-                        ((unsigned)ctx->mb_rc[q][mb].ssd<<LAMBDA_FRAC_BITS);
-                    if (score < min) {
-                        min = score;
-                        qscale = q;
-                    }
-                }
-                bits += ctx->mb_rc[qscale][mb].bits;
-                ctx->mb_qscale[mb] = qscale;
-                ctx->mb_bits[mb] = ctx->mb_rc[qscale][mb].bits;
-            }
-            bits = (bits+31)&~31; // padding
-            if (bits > ctx->frame_bits)
-                break;
-        }
+        ctx->lambda = lambda;
+        avctx->execute2(avctx, dnxhd_rdo_qscale_thread, NULL, NULL, ctx->m.mb_height);
+        for (y = 0; y < ctx->m.mb_height; y++)
+            bits += ctx->slice_size[y];
         //av_dlog(ctx->m.avctx, "lambda %d, up %u, down %u, bits %d, frame %d\n",
         //        lambda, last_higher, last_lower, bits, ctx->frame_bits);
         if (end) {
@@ -23,6 +23,7 @@
 #include "libavutil/fifo.h"
 #include "libavutil/avassert.h"
 #include "libavutil/imgutils.h"
+#include "libavutil/opt.h"
 #include "avcodec.h"
 #include "internal.h"
 #include "thread.h"
@@ -43,6 +44,8 @@ typedef struct{
     void *outdata;
     int64_t return_code;
     unsigned index;
+    int nb_frames;              ///< number of frames in indata, GOP tasks only
+    int64_t first_frame;        ///< input number of the first frame, GOP tasks only
 } Task;
 
 typedef struct{
@@ -62,12 +65,157 @@ typedef struct{
 
     pthread_t worker[MAX_THREADS];
     int exit;
+
+    /**
+     * Number of frames per task when whole closed GOPs are given to the
+     * workers, 0 if each frame is a separate task (intra only codecs).
+     */
+    int gop_size;
+    AVFrame **gop;              ///< frames of the GOP being gathered
+    AVFifoBuffer *gop_fifo;     ///< packet fifo for the GOP being gathered
+    int gop_frames;
+    int64_t frame_number;       ///< number of frames submitted so far
+    /**
+     * GOP tasks of each worker. An encoder keeps some state from one GOP
+     * to the next, so the GOPs are given to the workers in turn for the
+     * output not to depend on which worker is free first.
+     */
+    AVFifoBuffer *gop_tasks[MAX_THREADS];
+    int nb_gops;                ///< number of GOPs submitted so far
+    int nb_workers;             ///< number of workers which picked their queue
+    int task_packets;           ///< packets returned from the current GOP task
+    int64_t max_pts;            ///< largest pts returned so far
 } ThreadContext;
 
+/**
+ * Copy the properties of a frame given to the encoder to the copy of it
+ * which waits for a worker.
+ */
+static void copy_frame_props(AVFrame *dst, const AVFrame *src)
+{
+    dst->pts                 = src->pts;
+    dst->pkt_pts             = src->pkt_pts;
+    dst->pkt_dts             = src->pkt_dts;
+    dst->pkt_duration        = src->pkt_duration;
+    dst->quality             = src->quality;
+    dst->pict_type           = src->pict_type;
+    dst->key_frame           = src->key_frame;
+    dst->interlaced_frame    = src->interlaced_frame;
+    dst->top_field_first     = src->top_field_first;
+    dst->repeat_pict         = src->repeat_pict;
+    dst->sample_aspect_ratio = src->sample_aspect_ratio;
+    dst->reordered_opaque    = src->reordered_opaque;
+    dst->opaque              = src->opaque;
+    dst->width               = src->width;
+    dst->height              = src->height;
+    dst->format              = src->format;
+    av_dict_copy(&dst->metadata, src->metadata, 0);
+}
+
+static void free_gop_frame(AVFrame **frame)
+{
+    av_dict_free(&(*frame)->metadata);
+    av_freep(&(*frame)->data[0]);
+    av_freep(frame);
+}
+
+static int encode_to_fifo(AVCodecContext *avctx, AVFifoBuffer *fifo,
+                          AVFrame *frame, int *got_packet)
+{
+    AVPacket pkt;
+    int ret;
+
+    av_init_packet(&pkt);
+    pkt.data = NULL;
+    pkt.size = 0;
+    ret = avcodec_encode_video2(avctx, &pkt, frame, got_packet);
+    if (ret < 0 || !*got_packet)
+        return ret;
+    if (av_dup_packet(&pkt) < 0 ||
+        av_fifo_realloc2(fifo, av_fifo_size(fifo) + sizeof(pkt)) < 0) {
+        av_free_packet(&pkt);
+        return AVERROR(ENOMEM);
+    }
+    av_fifo_generic_write(fifo, &pkt, sizeof(pkt), NULL);
+    return 0;
+}
+
+/**
+ * Encode the frames of a closed GOP and flush the encoder, so that the next
+ * GOP given to the same context does not reference this one.
+ */
+static int encode_gop(AVCodecContext *avctx, Task *task, AVFifoBuffer *fifo)
+{
+    AVFrame **frames = task->indata;
+    int i, got_packet, ret = 0;
+
+    for (i = 0; i < task->nb_frames; i++) {
+        if (ret >= 0)
+            ret = encode_to_fifo(avctx, fifo, frames[i], &got_packet);
+        free_gop_frame(&frames[i]);
+    }
+    av_freep(&task->indata);
+
+    while (ret >= 0) {
+        ret = encode_to_fifo(avctx, fifo, NULL, &got_packet);
+        if (!got_packet)
+            break;
+    }
+    return ret;
+}
+
+static void free_gop_task(Task *task)
+{
+    AVFifoBuffer *fifo = task->outdata;
+    AVPacket pkt;
+
+    while (av_fifo_size(fifo) >= sizeof(pkt)) {
+        av_fifo_generic_read(fifo, &pkt, sizeof(pkt), NULL);
+        av_free_packet(&pkt);
+    }
+    av_fifo_free(fifo);
+    task->outdata = NULL;
+}
+
+/**
+ * Duplicate the strings and binary data of the options of a private
+ * context copied with memcpy(), as each copy frees them when closed.
+ */
+static int dup_priv_options(void *obj)
+{
+    const AVOption *o = NULL;
+
+    while ((o = av_opt_next(obj, o))) {
+        uint8_t **p = (uint8_t **)((uint8_t *)obj + o->offset);
+
+        if (o->type == AV_OPT_TYPE_STRING && *p) {
+            if (!(*p = av_strdup(*p)))
+                return AVERROR(ENOMEM);
+        } else if (o->type == AV_OPT_TYPE_BINARY && *p) {
+            int len = *(int *)(p + 1);
+            uint8_t *data = av_malloc(len);
+
+            if (!data)
+                return AVERROR(ENOMEM);
+            memcpy(data, *p, len);
+            *p = data;
+        }
+    }
+    return 0;
+}
+
 static void * attribute_align_arg worker(void *v){
     AVCodecContext *avctx = v;
     ThreadContext *c = avctx->internal->frame_thread_encoder;
     AVPacket *pkt = NULL;
+    int64_t frames_encoded = 0;
+    AVFifoBuffer *task_fifo = c->task_fifo;
+
+    if (c->gop_size) {
+        pthread_mutex_lock(&c->task_fifo_mutex);
+        task_fifo = c->gop_tasks[c->nb_workers++];
+        pthread_mutex_unlock(&c->task_fifo_mutex);
+    }
 
     while(!c->exit){
         int got_packet, ret;
@@ -79,21 +227,39 @@ static void * attribute_align_arg worker(void *v){
         av_init_packet(pkt);
 
         pthread_mutex_lock(&c->task_fifo_mutex);
-        while (av_fifo_size(c->task_fifo) <= 0 || c->exit) {
+        while (av_fifo_size(task_fifo) <= 0 || c->exit) {
             if(c->exit){
                 pthread_mutex_unlock(&c->task_fifo_mutex);
                 goto end;
             }
             pthread_cond_wait(&c->task_fifo_cond, &c->task_fifo_mutex);
         }
-        av_fifo_generic_read(c->task_fifo, &task, sizeof(task), NULL);
+        av_fifo_generic_read(task_fifo, &task, sizeof(task), NULL);
         pthread_mutex_unlock(&c->task_fifo_mutex);
+
+        if (c->gop_size) {
+            /* the pictures of this task are numbered as in the whole
+             * stream, not as in the part this context has coded */
+            avctx->internal->picture_number_offset = task.first_frame -
+                                                     frames_encoded;
+            frames_encoded += task.nb_frames;
+            ret = encode_gop(avctx, &task, task.outdata);
+            pthread_mutex_lock(&c->finished_task_mutex);
+            c->finished_tasks[task.index].outdata = task.outdata;
+            c->finished_tasks[task.index].return_code = ret;
+            pthread_cond_signal(&c->finished_task_cond);
+            pthread_mutex_unlock(&c->finished_task_mutex);
+            continue;
+        }
+
         frame = task.indata;
 
         ret = avcodec_encode_video2(avctx, pkt, frame, &got_packet);
         pthread_mutex_lock(&c->buffer_mutex);
         c->parent_avctx->release_buffer(c->parent_avctx, frame);
         pthread_mutex_unlock(&c->buffer_mutex);
+        if (!(avctx->flags & CODEC_FLAG_INPUT_PRESERVED))
+            av_dict_free(&frame->metadata);
         av_freep(&frame);
         if(!got_packet)
             continue;
@@ -115,13 +281,24 @@ end:
 
 int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
     int i=0;
+    int gop_size = 0;
     ThreadContext *c;
 
 
-    if(   !(avctx->thread_type & FF_THREAD_FRAME)
-       || !(avctx->codec->capabilities & CODEC_CAP_INTRA_ONLY))
+    if(!(avctx->thread_type & FF_THREAD_FRAME))
         return 0;
 
+    if(!(avctx->codec->capabilities & CODEC_CAP_INTRA_ONLY)){
+        /* Closed GOPs do not depend on each other, so they can be encoded
+         * in parallel. Rate control then runs separately in each thread. */
+        if(   !(avctx->codec->capabilities & CODEC_CAP_GOP_THREADS)
+           || !(avctx->flags & CODEC_FLAG_CLOSED_GOP)
+           || avctx->flags & (CODEC_FLAG_PASS1 | CODEC_FLAG_PASS2)
+           || avctx->gop_size <= 1)
+            return 0;
+        gop_size = avctx->gop_size;
+    }
+
     if(!avctx->thread_count) {
         avctx->thread_count = ff_get_logical_cpus(avctx);
         avctx->thread_count = FFMIN(avctx->thread_count, MAX_THREADS);
@@ -139,6 +316,8 @@ int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
         return AVERROR(ENOMEM);
 
     c->parent_avctx = avctx;
+    c->gop_size = gop_size;
+    c->max_pts = AV_NOPTS_VALUE;
 
     c->task_fifo = av_fifo_alloc(sizeof(Task) * BUFFER_SIZE);
     if(!c->task_fifo)
@@ -150,6 +329,15 @@ int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
     pthread_cond_init(&c->task_fifo_cond, NULL);
     pthread_cond_init(&c->finished_task_cond, NULL);
 
+    if (gop_size) {
+        for (i = 0; i < avctx->thread_count; i++) {
+            if (!(c->gop_tasks[i] = av_fifo_alloc(sizeof(Task) * BUFFER_SIZE))) {
+                i = 0;
+                goto fail;
+            }
+        }
+    }
+
     for(i=0; i<avctx->thread_count ; i++){
         AVDictionary *tmp = NULL;
         AVCodecContext *thread_avctx = avcodec_alloc_context3(avctx->codec);
@@ -163,8 +351,20 @@ int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
             goto fail;
         }
         memcpy(thread_avctx->priv_data, avctx->priv_data, avctx->codec->priv_data_size);
+        if (avctx->codec->priv_class &&
+            dup_priv_options(thread_avctx->priv_data) < 0) {
+            av_freep(&thread_avctx->priv_data);
+            av_freep(&thread_avctx);
+            goto fail;
+        }
         thread_avctx->thread_count = 1;
         thread_avctx->active_thread_type &= ~FF_THREAD_FRAME;
+        if(gop_size){
+            thread_avctx->flags &= ~CODEC_FLAG_INPUT_PRESERVED;
+            /* GOPs start where the tasks start, keep the encoder from
+             * starting one earlier because of the frames it buffers */
+            thread_avctx->gop_size = gop_size + avctx->max_b_frames + 1;
+        }
 
         av_dict_copy(&tmp, options, 0);
         av_dict_set(&tmp, "threads", "1", 0);
@@ -203,6 +403,29 @@ void ff_frame_thread_encoder_free(AVCodecContext *avctx){
          pthread_join(c->worker[i], NULL);
     }
 
+    if (c->gop_size) {
+        int j;
+
+        for (j = 0; j < MAX_THREADS && c->gop_tasks[j]; j++) {
+            while (av_fifo_size(c->gop_tasks[j]) > 0) {
+                Task task;
+                av_fifo_generic_read(c->gop_tasks[j], &task, sizeof(task), NULL);
+                for (i = 0; i < task.nb_frames; i++)
+                    free_gop_frame(&((AVFrame **)task.indata)[i]);
+                av_freep(&task.indata);
+                free_gop_task(&task);
+            }
+            av_fifo_free(c->gop_tasks[j]);
+        }
+        for (i = 0; i < BUFFER_SIZE; i++)
+            if (c->finished_tasks[i].outdata)
+                free_gop_task(&c->finished_tasks[i]);
+        for (i = 0; i < c->gop_frames; i++)
+            free_gop_frame(&c->gop[i]);
+        av_freep(&c->gop);
+        av_fifo_free(c->gop_fifo);
+    }
+
     pthread_mutex_destroy(&c->task_fifo_mutex);
     pthread_mutex_destroy(&c->finished_task_mutex);
     pthread_mutex_destroy(&c->buffer_mutex);
@@ -212,6 +435,78 @@ void ff_frame_thread_encoder_free(AVCodecContext *avctx){
     av_freep(&avctx->internal->frame_thread_encoder);
 }
 
+/**
+ * Hand the gathered GOP to the workers.
+ */
+static void submit_gop(AVCodecContext *avctx, ThreadContext *c)
+{
+    AVFifoBuffer *fifo = c->gop_tasks[c->nb_gops++ % avctx->thread_count];
+    Task task = { 0 };
+
+    task.index       = c->task_index;
+    task.indata      = c->gop;
+    task.nb_frames   = c->gop_frames;
+    task.first_frame = c->frame_number - c->gop_frames;
+    task.outdata     = c->gop_fifo;
+    c->gop        = NULL;
+    c->gop_fifo   = NULL;
+    c->gop_frames = 0;
+
+    pthread_mutex_lock(&c->task_fifo_mutex);
+    av_fifo_generic_write(fifo, &task, sizeof(task), NULL);
+    pthread_cond_broadcast(&c->task_fifo_cond);
+    pthread_mutex_unlock(&c->task_fifo_mutex);
+
+    c->task_index = (c->task_index+1) % BUFFER_SIZE;
+}
+
+/**
+ * Return the next packet of the oldest GOP, in coded order.
+ * Only wait for a GOP to be encoded if all threads are busy or if flushing.
+ */
+static int get_gop_packet(AVCodecContext *avctx, AVPacket *pkt, int *got_packet_ptr, int flush)
+{
+    ThreadContext *c = avctx->internal->frame_thread_encoder;
+
+    while (c->task_index != c->finished_task_index) {
+        Task *task = &c->finished_tasks[c->finished_task_index];
+        int ret;
+
+        pthread_mutex_lock(&c->finished_task_mutex);
+        if (!task->outdata && !flush &&
+            (c->task_index - c->finished_task_index) % BUFFER_SIZE <= avctx->thread_count) {
+            pthread_mutex_unlock(&c->finished_task_mutex);
+            return 0;
+        }
+        while (!task->outdata)
+            pthread_cond_wait(&c->finished_task_cond, &c->finished_task_mutex);
+        pthread_mutex_unlock(&c->finished_task_mutex);
+
+        if (av_fifo_size(task->outdata) >= sizeof(*pkt)) {
+            av_fifo_generic_read(task->outdata, pkt, sizeof(*pkt), NULL);
+            /* Each GOP was encoded from a flushed encoder, so its first
+             * packet has no reordering delay applied to its dts. Use the
+             * dts the encoder would have produced without the flush. */
+            if (!c->task_packets++ && c->max_pts != AV_NOPTS_VALUE &&
+                pkt->dts != pkt->pts)
+                pkt->dts = c->max_pts;
+            if (pkt->pts != AV_NOPTS_VALUE &&
+                (c->max_pts == AV_NOPTS_VALUE || pkt->pts > c->max_pts))
+                c->max_pts = pkt->pts;
+            *got_packet_ptr = 1;
+            return 0;
+        }
+
+        ret = task->return_code;
+        free_gop_task(task);
+        c->task_packets = 0;
+        c->finished_task_index = (c->finished_task_index+1) % BUFFER_SIZE;
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
 int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt, const AVFrame *frame, int *got_packet_ptr){
     ThreadContext *c = avctx->internal->frame_thread_encoder;
     Task task;
@@ -219,6 +514,45 @@ int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt, const AVF
 
     av_assert1(!*got_packet_ptr);
 
+    if (c->gop_size) {
+        /* the frames wait for the rest of their GOP, so always copy them */
+        if (frame) {
+            AVFrame *new;
+
+            /* a forced I-frame starts a new GOP, as without threads */
+            if (frame->pict_type == AV_PICTURE_TYPE_I && c->gop_frames)
+                submit_gop(avctx, c);
+
+            /* whole GOPs are queued, which can be more frames than
+             * get_buffer() supports, so allocate them separately */
+            if (!c->gop)
+                c->gop = av_malloc(c->gop_size * sizeof(*c->gop));
+            if (!c->gop_fifo)
+                c->gop_fifo = av_fifo_alloc(sizeof(AVPacket));
+            if (!c->gop || !c->gop_fifo)
+                return AVERROR(ENOMEM);
+            new = avcodec_alloc_frame();
+            if (!new)
+                return AVERROR(ENOMEM);
+            ret = av_image_alloc(new->data, new->linesize, avctx->width,
+                                 avctx->height, avctx->pix_fmt, 32);
+            if (ret < 0) {
+                av_freep(&new);
+                return ret;
+            }
+            copy_frame_props(new, frame);
+            av_image_copy(new->data, new->linesize, (const uint8_t **)frame->data,
+                          frame->linesize, avctx->pix_fmt, avctx->width, avctx->height);
+            if (!c->gop_frames)
+                new->pict_type = AV_PICTURE_TYPE_I;
+            c->gop[c->gop_frames++] = new;
+            c->frame_number++;
+        }
+        if (c->gop_frames == c->gop_size || (!frame && c->gop_frames))
+            submit_gop(avctx, c);
+        return get_gop_packet(avctx, pkt, got_packet_ptr, !frame);
+    }
+
     if(frame){
         if(!(avctx->flags & CODEC_FLAG_INPUT_PRESERVED)){
             AVFrame *new = avcodec_alloc_frame();
@@ -229,9 +563,7 @@ int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt, const AVF
             pthread_mutex_unlock(&c->buffer_mutex);
             if(ret<0)
                 return ret;
-            new->pts = frame->pts;
-            new->quality = frame->quality;
-            new->pict_type = frame->pict_type;
+            copy_frame_props(new, frame);
             av_image_copy(new->data, new->linesize, (const uint8_t **)frame->data, frame->linesize,
                           avctx->pix_fmt, avctx->width, avctx->height);
             frame = new;
@@ -785,6 +785,15 @@ static void free_tables(H264Context *h, int free_rbsp)
     av_freep(&h->mb2b_xy);
     av_freep(&h->mb2br_xy);
 
+#if HAVE_THREADS
+    if (h->lf_context) {
+        pthread_cond_destroy(&h->lf_cond);
+        pthread_mutex_destroy(&h->lf_mutex);
+        av_freep(&h->lf_context);
+        av_freep(&h->lf_queue);
+    }
+#endif
+
     for (i = 0; i < MAX_THREADS; i++) {
         hx = h->thread_context[i];
         if (!hx)
@@ -3401,6 +3410,24 @@ static int fill_filter_caches(H264Context *h, int mb_type)
     return 0;
 }
 
+#define LF_PASS_ALL    0
+#define LF_PASS_BACKUP 1    ///< only save the unfiltered borders, queue the call
+#define LF_PASS_FILTER 2    ///< only filter, the borders are already saved
+
+static void queue_loop_filter(H264Context *h, int start_x, int end_x)
+{
+#if HAVE_THREADS
+    pthread_mutex_lock(&h->lf_mutex);
+    h->lf_queue[h->lf_queued][0] = h->s.mb_y;
+    h->lf_queue[h->lf_queued][1] = start_x;
+    h->lf_queue[h->lf_queued][2] = end_x;
+    h->lf_queue[h->lf_queued][3] = 0;
+    h->lf_queued++;
+    pthread_cond_signal(&h->lf_cond);
+    pthread_mutex_unlock(&h->lf_mutex);
+#endif
+}
+
 static void loop_filter(H264Context *h, int start_x, int end_x)
 {
     MpegEncContext *const s = &h->s;
@@ -3448,8 +3475,11 @@ static void loop_filter(H264Context *h, int start_x, int end_x)
                     linesize   = h->mb_linesize   = s->linesize;
                     uvlinesize = h->mb_uvlinesize = s->uvlinesize;
                 }
-                backup_mb_border(h, dest_y, dest_cb, dest_cr, linesize,
-                                 uvlinesize, 0);
+                if (h->lf_pass != LF_PASS_FILTER)
+                    backup_mb_border(h, dest_y, dest_cb, dest_cr, linesize,
+                                     uvlinesize, 0);
+                if (h->lf_pass == LF_PASS_BACKUP)
+                    continue;
                 if (fill_filter_caches(h, mb_type))
                     continue;
                 h->chroma_qp[0] = get_chroma_qp(h, 0, s->current_picture.f.qscale_table[mb_xy]);
@@ -3463,6 +3493,10 @@ static void loop_filter(H264Context *h, int start_x, int end_x)
                                            dest_cr, linesize, uvlinesize);
                 }
             }
+        if (h->lf_pass == LF_PASS_BACKUP) {
+            s->mb_y = end_mb_y - FRAME_MBAFF;
+            queue_loop_filter(h, start_x, end_x);
+        }
     }
     h->slice_type   = old_slice_type;
     s->mb_x         = end_x;
@@ -3494,6 +3528,11 @@ static void decode_finish_row(H264Context *h)
     int deblock_border = (16 + 4) << FRAME_MBAFF;
 
     if (h->deblocking_filter) {
+        /* the row is drawn by the deblocking thread once it is filtered */
+        if (h->lf_pass == LF_PASS_BACKUP) {
+            h->lf_queue[h->lf_queued - 1][3] = 1;
+            return;
+        }
         if ((top + height) >= pic_height)
             height += deblock_border;
         top -= deblock_border;
@@ -3508,6 +3547,12 @@ static void decode_finish_row(H264Context *h)
         top    = 0;
     }
 
+    if (h->defer_draw_band) {
+        h->band_top    = FFMIN(h->band_top,    top);
+        h->band_bottom = FFMAX(h->band_bottom, top + height);
+        return;
+    }
+
     ff_draw_horiz_band(s, top, height);
 
     if (s->dropable)
@@ -3684,6 +3729,103 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
     }
 }
 
+#if HAVE_THREADS
+static int init_deblock_thread(H264Context *h)
+{
+    MpegEncContext *const s = &h->s;
+
+    if (h->lf_context)
+        return 0;
+
+    h->lf_context = av_malloc(sizeof(H264Context));
+    h->lf_queue   = av_malloc((s->mb_height + 1) * sizeof(*h->lf_queue));
+    if (!h->lf_context || !h->lf_queue)
+        goto fail;
+    if (pthread_mutex_init(&h->lf_mutex, NULL))
+        goto fail;
+    if (pthread_cond_init(&h->lf_cond, NULL)) {
+        pthread_mutex_destroy(&h->lf_mutex);
+        goto fail;
+    }
+    return 0;
+
+fail:
+    av_freep(&h->lf_context);
+    av_freep(&h->lf_queue);
+    return AVERROR(ENOMEM);
+}
+
+/**
+ * Run the queued loop_filter() calls, staying one call behind the
+ * decoding: the intra prediction of a row temporarily writes the saved
+ * unfiltered borders into the last line of the row above.
+ */
+static void deblock_queued_rows(H264Context *h)
+{
+    H264Context *const lf = h->lf_context;
+    int i, queued;
+
+    for (i = 0; ; i++) {
+        pthread_mutex_lock(&h->lf_mutex);
+        while (h->lf_queued <= i + 1 && !h->lf_decode_done)
+            pthread_cond_wait(&h->lf_cond, &h->lf_mutex);
+        queued = h->lf_queued;
+        pthread_mutex_unlock(&h->lf_mutex);
+
+        if (i >= queued)
+            break;
+
+        lf->s.mb_y = h->lf_queue[i][0];
+        loop_filter(lf, h->lf_queue[i][1], h->lf_queue[i][2]);
+        if (h->lf_queue[i][3])
+            decode_finish_row(lf);
+    }
+}
+
+static int decode_slice_deblock_thread(AVCodecContext *avctx, void *arg,
+                                       int jobnr, int threadnr)
+{
+    H264Context *h = arg;
+    int ret;
+
+    if (jobnr) {
+        deblock_queued_rows(h);
+        return 0;
+    }
+
+    ret = decode_slice(avctx, &h);
+
+    pthread_mutex_lock(&h->lf_mutex);
+    h->lf_decode_done = 1;
+    pthread_cond_signal(&h->lf_cond);
+    pthread_mutex_unlock(&h->lf_mutex);
+
+    return ret;
+}
+
+/**
+ * Decode a single slice while another slice thread deblocks the
+ * finished MB rows.
+ */
+static int execute_deblock_thread(H264Context *h)
+{
+    AVCodecContext *const avctx = h->s.avctx;
+    int ret[2];
+
+    memcpy(h->lf_context, h, sizeof(H264Context));
+    h->lf_context->lf_pass = LF_PASS_FILTER;
+    h->lf_pass             = LF_PASS_BACKUP;
+    h->lf_queued           = 0;
+    h->lf_decode_done      = 0;
+
+    avctx->execute2(avctx, decode_slice_deblock_thread, h, ret, 2);
+
+    h->lf_pass = LF_PASS_ALL;
+
+    return ret[0];
+}
+#endif
+
 /**
  * Call decode_slice() for each context.
  *
@@ -3701,18 +3843,39 @@ static int execute_decode_slices(H264Context *h, int context_count)
         s->avctx->codec->capabilities & CODEC_CAP_HWACCEL_VDPAU)
         return 0;
     if (context_count == 1) {
+#if HAVE_THREADS
+        if (h->deblock_thread && h->deblocking_filter &&
+            avctx->active_thread_type & FF_THREAD_SLICE &&
+            avctx->thread_count > 1 && !init_deblock_thread(h))
+            return execute_deblock_thread(h);
+#endif
         return decode_slice(avctx, &h);
     } else {
+        int top = INT_MAX, bottom = 0;
+
         for (i = 1; i < context_count; i++) {
             hx                    = h->thread_context[i];
             hx->s.err_recognition = avctx->err_recognition;
             hx->s.error_count     = 0;
             hx->x264_build        = h->x264_build;
         }
+        for (i = 0; i < context_count; i++) {
+            hx                  = h->thread_context[i];
+            hx->defer_draw_band = 1;
+            hx->band_top        = INT_MAX;
+            hx->band_bottom     = 0;
+        }
 
         avctx->execute(avctx, decode_slice, h->thread_context,
                        NULL, context_count, sizeof(void *));
 
+        for (i = 0; i < context_count; i++) {
+            hx                  = h->thread_context[i];
+            hx->defer_draw_band = 0;
+            top                 = FFMIN(top,    hx->band_top);
+            bottom              = FFMAX(bottom, hx->band_bottom);
+        }
+
         /* pull back stuff from slices to master context */
         hx                   = h->thread_context[context_count - 1];
         s->mb_x              = hx->s.mb_x;
@@ -3721,6 +3884,10 @@ static int execute_decode_slices(H264Context *h, int context_count)
         s->picture_structure = hx->s.picture_structure;
         for (i = 1; i < context_count; i++)
             h->s.error_count += h->thread_context[i]->s.error_count;
+
+        /* the slices are consecutive, so are the rows they completed */
+        if (bottom > top)
+            ff_draw_horiz_band(s, top, bottom - top);
     }
 
     return 0;
@@ -4201,6 +4368,7 @@ static const AVProfile profiles[] = {
 static const AVOption h264_options[] = {
     {"is_avc", "is avc", offsetof(H264Context, is_avc), FF_OPT_TYPE_INT, {.dbl = 0}, 0, 1, 0},
     {"nal_length_size", "nal_length_size", offsetof(H264Context, nal_length_size), FF_OPT_TYPE_INT, {.dbl = 0}, 0, 4, 0},
+    {"deblock_thread", "deblock single slice pictures on another slice thread", offsetof(H264Context, deblock_thread), FF_OPT_TYPE_INT, {.dbl = 0}, 0, 1, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_VIDEO_PARAM},
     {NULL}
 };
 
@@ -4226,7 +4394,7 @@ AVCodec ff_h264_decoder = {
     .init                  = ff_h264_decode_init,
     .close                 = h264_decode_end,
     .decode                = decode_frame,
-    .capabilities          = /*CODEC_CAP_DRAW_HORIZ_BAND |*/ CODEC_CAP_DR1 |
+    .capabilities          = CODEC_CAP_DRAW_HORIZ_BAND | CODEC_CAP_DR1 |
                              CODEC_CAP_DELAY | CODEC_CAP_SLICE_THREADS |
                              CODEC_CAP_FRAME_THREADS,
     .flush                 = flush_dpb,
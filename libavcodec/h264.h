@@ -35,6 +35,13 @@
 #include "h264dsp.h"
 #include "h264pred.h"
 #include "rectangle.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#elif HAVE_W32THREADS
+#include "w32pthreads.h"
+#elif HAVE_OS2THREADS
+#include "os2threads.h"
+#endif
 
 #define interlaced_dct interlaced_dct_is_a_bad_name
 #define mb_intra       mb_intra_is_not_initialized_see_mb_type
@@ -532,6 +539,33 @@ typedef struct H264Context {
     int single_decode_warning;
 
     int last_slice_type;
+
+    /**
+     * Set while the slices are decoded in parallel. The finished rows are
+     * then only recorded in band_top/band_bottom and drawn by the master
+     * context once all the slices are done, since the rows at the slice
+     * boundaries are written by two threads.
+     */
+    int defer_draw_band;
+    int band_top, band_bottom;
+
+    /**
+     * Deblocking post-pass, enabled with the deblock_thread option.
+     * When a single slice is decoded with slice threads, the decoding
+     * context only saves the unfiltered borders and queues its
+     * loop_filter() calls in lf_queue, they are run on lf_context by
+     * another thread one MB row behind the decoding.
+     */
+    int deblock_thread;
+    int lf_pass;                ///< LF_PASS_*
+    struct H264Context *lf_context;
+    int16_t (*lf_queue)[4];     ///< mb_y, start_x, end_x, row finished
+    int lf_queued;
+    int lf_decode_done;
+#if HAVE_THREADS
+    pthread_mutex_t lf_mutex;
+    pthread_cond_t  lf_cond;
+#endif
     /** @} */
 
     /**
@@ -0,0 +1,334 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Check the rows the H.264 decoder passes to draw_horiz_band(): they must
+ * come in order for each picture, cover it entirely before it is output,
+ * and only be drawn when the pictures are output in decoding order or with
+ * SLICE_FLAG_CODED_ORDER. The stream is made of I_PCM macroblocks, written
+ * by the test itself, with several slices per picture.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "libavutil/intreadwrite.h"
+#include "avcodec.h"
+#include "golomb.h"
+#include "put_bits.h"
+
+#undef printf
+
+#define MB_WIDTH        11
+#define MB_HEIGHT        9
+#define WIDTH           (MB_WIDTH  * 16)
+#define HEIGHT          (MB_HEIGHT * 16)
+#define NB_PICTURES     12
+#define NB_SLICES        3
+#define MAX_BUFFERS     32
+
+static uint8_t pixel(int pic, int plane, int x, int y)
+{
+    return 1 + ((x * 3 + y * 5 + pic * 7 + plane * 64) & 0xfe);
+}
+
+/* write an rbsp as a NAL unit with a start code and emulation prevention */
+static uint8_t *write_nal(uint8_t *dst, int type, const uint8_t *rbsp, int size)
+{
+    int i, zeros = 0;
+
+    AV_WB32(dst, 1);
+    dst   += 4;
+    *dst++ = 0x60 | type;
+    for (i = 0; i < size; i++) {
+        if (zeros == 2 && rbsp[i] <= 3) {
+            *dst++ = 3;
+            zeros  = 0;
+        }
+        zeros  = rbsp[i] ? 0 : zeros + 1;
+        *dst++ = rbsp[i];
+    }
+    return dst;
+}
+
+static int finish_rbsp(PutBitContext *pb)
+{
+    put_bits(pb, 1, 1);
+    flush_put_bits(pb);
+    return put_bits_count(pb) >> 3;
+}
+
+static uint8_t *write_headers(uint8_t *dst, uint8_t *rbsp, int size,
+                              int bitstream_restriction)
+{
+    PutBitContext pb;
+
+    init_put_bits(&pb, rbsp, size);
+    put_bits(&pb, 8, 66);               /* profile_idc: baseline */
+    put_bits(&pb, 8, 0);                /* constraint flags */
+    put_bits(&pb, 8, 30);               /* level_idc */
+    set_ue_golomb(&pb, 0);              /* seq_parameter_set_id */
+    set_ue_golomb(&pb, 0);              /* log2_max_frame_num_minus4 */
+    set_ue_golomb(&pb, 2);              /* pic_order_cnt_type */
+    set_ue_golomb(&pb, 1);              /* max_num_ref_frames */
+    put_bits(&pb, 1, 0);                /* gaps_in_frame_num_allowed_flag */
+    set_ue_golomb(&pb, MB_WIDTH  - 1);
+    set_ue_golomb(&pb, MB_HEIGHT - 1);
+    put_bits(&pb, 1, 1);                /* frame_mbs_only_flag */
+    put_bits(&pb, 1, 1);                /* direct_8x8_inference_flag */
+    put_bits(&pb, 1, 0);                /* frame_cropping_flag */
+    put_bits(&pb, 1, bitstream_restriction); /* vui_parameters_present_flag */
+    if (bitstream_restriction) {
+        put_bits(&pb, 8, 0);            /* aspect ratio ... pic_struct flags */
+        put_bits(&pb, 1, 1);            /* bitstream_restriction_flag */
+        put_bits(&pb, 1, 1);            /* motion_vectors_over_pic_boundaries */
+        set_ue_golomb(&pb, 0);          /* max_bytes_per_pic_denom */
+        set_ue_golomb(&pb, 0);          /* max_bits_per_mb_denom */
+        set_ue_golomb(&pb, 16);         /* log2_max_mv_length_horizontal */
+        set_ue_golomb(&pb, 16);         /* log2_max_mv_length_vertical */
+        set_ue_golomb(&pb, 0);          /* num_reorder_frames */
+        set_ue_golomb(&pb, 1);          /* max_dec_frame_buffering */
+    }
+    dst = write_nal(dst, 7, rbsp, finish_rbsp(&pb));
+
+    init_put_bits(&pb, rbsp, size);
+    set_ue_golomb(&pb, 0);              /* pic_parameter_set_id */
+    set_ue_golomb(&pb, 0);              /* seq_parameter_set_id */
+    put_bits(&pb, 1, 0);                /* entropy_coding_mode_flag */
+    put_bits(&pb, 1, 0);                /* bottom_field_pic_order_in_frame_present */
+    set_ue_golomb(&pb, 0);              /* num_slice_groups_minus1 */
+    set_ue_golomb(&pb, 0);              /* num_ref_idx_l0_default_active_minus1 */
+    set_ue_golomb(&pb, 0);              /* num_ref_idx_l1_default_active_minus1 */
+    put_bits(&pb, 3, 0);                /* weighted_pred_flag, weighted_bipred_idc */
+    set_se_golomb(&pb, 0);              /* pic_init_qp_minus26 */
+    set_se_golomb(&pb, 0);              /* pic_init_qs_minus26 */
+    set_se_golomb(&pb, 0);              /* chroma_qp_index_offset */
+    put_bits(&pb, 1, 0);                /* deblocking_filter_control_present_flag */
+    put_bits(&pb, 1, 0);                /* constrained_intra_pred_flag */
+    put_bits(&pb, 1, 0);                /* redundant_pic_cnt_present_flag */
+    return write_nal(dst, 8, rbsp, finish_rbsp(&pb));
+}
+
+/* write one picture as NB_SLICES IDR slices of I_PCM macroblocks */
+static uint8_t *write_picture(uint8_t *dst, uint8_t *rbsp, int size, int pic)
+{
+    int slice, mb, x, y, plane;
+
+    for (slice = 0; slice < NB_SLICES; slice++) {
+        int first = slice       * MB_WIDTH * MB_HEIGHT / NB_SLICES;
+        int end   = (slice + 1) * MB_WIDTH * MB_HEIGHT / NB_SLICES;
+        PutBitContext pb;
+
+        init_put_bits(&pb, rbsp, size);
+        set_ue_golomb(&pb, first);      /* first_mb_in_slice */
+        set_ue_golomb(&pb, 7);          /* slice_type: I */
+        set_ue_golomb(&pb, 0);          /* pic_parameter_set_id */
+        put_bits(&pb, 4, 0);            /* frame_num */
+        set_ue_golomb(&pb, pic & 1);    /* idr_pic_id */
+        put_bits(&pb, 2, 0);            /* no_output_of_prior_pics, long_term_reference */
+        set_se_golomb(&pb, 0);          /* slice_qp_delta */
+        for (mb = first; mb < end; mb++) {
+            int mb_x = mb % MB_WIDTH, mb_y = mb / MB_WIDTH;
+
+            set_ue_golomb(&pb, 25);     /* mb_type: I_PCM */
+            put_bits(&pb, -put_bits_count(&pb) & 7, 0); /* pcm_alignment_zero_bits */
+            for (y = 0; y < 16; y++)
+                for (x = 0; x < 16; x++)
+                    put_bits(&pb, 8, pixel(pic, 0, mb_x * 16 + x, mb_y * 16 + y));
+            for (plane = 1; plane < 3; plane++)
+                for (y = 0; y < 8; y++)
+                    for (x = 0; x < 8; x++)
+                        put_bits(&pb, 8, pixel(pic, plane, mb_x * 8 + x, mb_y * 8 + y));
+        }
+        dst = write_nal(dst, 5, rbsp, finish_rbsp(&pb));
+    }
+    return dst;
+}
+
+static struct {
+    uint8_t *data;
+    int next_y;
+} buffers[MAX_BUFFERS];
+static int nb_buffers, errors;
+#if HAVE_PTHREADS
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static int find_buffer(uint8_t *data)
+{
+    int i;
+
+    for (i = 0; i < nb_buffers; i++)
+        if (buffers[i].data == data)
+            return i;
+    if (nb_buffers == MAX_BUFFERS)
+        return -1;
+    buffers[nb_buffers].data   = data;
+    buffers[nb_buffers].next_y = 0;
+    return nb_buffers++;
+}
+
+/* called from the decoding threads, possibly at the same time */
+static void draw_horiz_band(AVCodecContext *avctx, const AVFrame *src,
+                            int offset[AV_NUM_DATA_POINTERS],
+                            int y, int type, int height)
+{
+    int i;
+
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&lock);
+#endif
+    if ((i = find_buffer(src->data[0])) < 0) {
+        errors++;
+    } else {
+        /* a new picture starts at the top of the buffer */
+        if (!y)
+            buffers[i].next_y = 0;
+        if (y != buffers[i].next_y || height <= 0 || type != 3 ||
+            offset[0] != y * src->linesize[0]) {
+            printf("rows %d-%d drawn after row %d\n", y, y + height - 1,
+                   buffers[i].next_y - 1);
+            errors++;
+        }
+        buffers[i].next_y = y + height;
+    }
+#if HAVE_PTHREADS
+    pthread_mutex_unlock(&lock);
+#endif
+}
+
+static int check_frame(const AVFrame *frame, int pic)
+{
+    int x, y, plane, i = find_buffer(frame->data[0]);
+
+    for (plane = 0; plane < 3; plane++)
+        for (y = 0; y < HEIGHT >> !!plane; y++)
+            for (x = 0; x < WIDTH >> !!plane; x++)
+                if (frame->data[plane][y * frame->linesize[plane] + x] !=
+                    pixel(pic, plane, x, y)) {
+                    printf("picture %d differs at %d,%d plane %d\n",
+                           pic, x, y, plane);
+                    errors++;
+                    return 0;
+                }
+    return i >= 0 && buffers[i].next_y == HEIGHT;
+}
+
+static int run(const uint8_t *stream, const uint8_t **pics, int threads,
+               int thread_type, int slice_flags, int has_b_frames)
+{
+    AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_H264);
+    AVCodecContext *avctx = avcodec_alloc_context3(codec);
+    AVFrame frame;
+    AVPacket pkt;
+    int i, got_frame, nb_out = 0, nb_drawn = 0;
+
+    avctx->thread_count    = threads;
+    avctx->thread_type     = thread_type;
+    avctx->slice_flags     = slice_flags;
+    avctx->has_b_frames    = has_b_frames;
+    /* assume reordering unless the SPS rules it out */
+    avctx->strict_std_compliance = FF_COMPLIANCE_STRICT;
+    avctx->draw_horiz_band = draw_horiz_band;
+    if (avcodec_open2(avctx, codec, NULL) < 0) {
+        printf("cannot open the decoder\n");
+        return 1;
+    }
+    nb_buffers = 0;
+
+    av_init_packet(&pkt);
+    /* after the last picture, flush until no delayed picture is left */
+    for (i = 0; i <= NB_PICTURES || got_frame; i++) {
+        if (i < NB_PICTURES) {
+            pkt.data = (uint8_t *)(i ? pics[i - 1] : stream);
+            pkt.size = pics[i] - pkt.data;
+        } else {
+            pkt.data = NULL;
+            pkt.size = 0;
+        }
+        avcodec_get_frame_defaults(&frame);
+        if (avcodec_decode_video2(avctx, &frame, &got_frame, &pkt) < 0) {
+            printf("error decoding picture %d\n", i);
+            errors++;
+            break;
+        }
+        if (got_frame)
+            nb_drawn += check_frame(&frame, nb_out++);
+    }
+    printf("%d thread(s), %s%s%s: %d pictures, %d entirely drawn before output\n",
+           threads, thread_type == FF_THREAD_FRAME ? "frame" : "slice",
+           has_b_frames ? ", delayed by the caller" : "",
+           slice_flags ? ", coded order" : "", nb_out, nb_drawn);
+
+    avcodec_close(avctx);
+    av_free(avctx);
+    return 0;
+}
+
+int main(void)
+{
+    static const struct {
+        int threads, thread_type;
+    } configs[] = {
+        { 1, FF_THREAD_SLICE },
+        { 3, FF_THREAD_SLICE },
+        { 3, FF_THREAD_FRAME },
+    };
+    int size = 2 * (WIDTH * HEIGHT * 3 / 2 + 4096);
+    uint8_t *rbsp = av_malloc(size), *stream = av_malloc(NB_PICTURES * size);
+    const uint8_t *pics[NB_PICTURES];
+    int restriction, i, c;
+
+    avcodec_register_all();
+
+    /* without bitstream_restriction_flag, the decoder must assume that
+     * pictures may be reordered, so rows are only drawn in coded order */
+    for (restriction = 1; restriction >= 0; restriction--) {
+        uint8_t *end = write_headers(stream, rbsp, size, restriction);
+
+        for (i = 0; i < NB_PICTURES; i++)
+            pics[i] = end = write_picture(end, rbsp, size, i);
+
+        printf("%s reordering\n", restriction ? "without" : "with possible");
+        for (c = 0; c < FF_ARRAY_ELEMS(configs); c++) {
+            int threads = configs[c].threads, type = configs[c].thread_type;
+
+            errors += run(stream, pics, threads, type, 0, 0);
+            if (restriction) {
+                /* a delay set by the caller (e.g. from the container) is
+                 * kept even though the SPS says pictures are not reordered */
+                errors += run(stream, pics, threads, type, 0, 2);
+                errors += run(stream, pics, threads, type,
+                              SLICE_FLAG_CODED_ORDER, 2);
+            } else {
+                errors += run(stream, pics, threads, type,
+                              SLICE_FLAG_CODED_ORDER, 0);
+            }
+        }
+    }
+
+    av_free(rbsp);
+    av_free(stream);
+    return !!errors;
+}
@@ -0,0 +1,271 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Check that deblocking on a separate slice thread (deblock_thread) gives
+ * the same pictures as the serial decode. The stream, written by the test
+ * itself, has one slice per picture with I_PCM and I_16x16 macroblocks in
+ * a checkerboard. The I_16x16 macroblocks are coded at a high QP without
+ * residual, so the loop filter changes all their edges and their intra
+ * prediction reads the unfiltered rows above them.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/adler32.h"
+#include "libavutil/intreadwrite.h"
+#include "avcodec.h"
+#include "golomb.h"
+#include "put_bits.h"
+
+#undef printf
+
+#define MB_WIDTH        11
+#define MB_HEIGHT        9
+#define WIDTH           (MB_WIDTH  * 16)
+#define HEIGHT          (MB_HEIGHT * 16)
+#define NB_PICTURES      6
+
+static uint8_t pixel(int pic, int plane, int x, int y)
+{
+    return 112 + plane * 8 + ((x * 3 + y * 5 + pic * 7) & 15);
+}
+
+/* write an rbsp as a NAL unit with a start code and emulation prevention */
+static uint8_t *write_nal(uint8_t *dst, int type, const uint8_t *rbsp, int size)
+{
+    int i, zeros = 0;
+
+    AV_WB32(dst, 1);
+    dst   += 4;
+    *dst++ = 0x60 | type;
+    for (i = 0; i < size; i++) {
+        if (zeros == 2 && rbsp[i] <= 3) {
+            *dst++ = 3;
+            zeros  = 0;
+        }
+        zeros  = rbsp[i] ? 0 : zeros + 1;
+        *dst++ = rbsp[i];
+    }
+    return dst;
+}
+
+static int finish_rbsp(PutBitContext *pb)
+{
+    put_bits(pb, 1, 1);
+    flush_put_bits(pb);
+    return put_bits_count(pb) >> 3;
+}
+
+static uint8_t *write_headers(uint8_t *dst, uint8_t *rbsp, int size)
+{
+    PutBitContext pb;
+
+    init_put_bits(&pb, rbsp, size);
+    put_bits(&pb, 8, 66);               /* profile_idc: baseline */
+    put_bits(&pb, 8, 0);                /* constraint flags */
+    put_bits(&pb, 8, 30);               /* level_idc */
+    set_ue_golomb(&pb, 0);              /* seq_parameter_set_id */
+    set_ue_golomb(&pb, 0);              /* log2_max_frame_num_minus4 */
+    set_ue_golomb(&pb, 2);              /* pic_order_cnt_type */
+    set_ue_golomb(&pb, 1);              /* max_num_ref_frames */
+    put_bits(&pb, 1, 0);                /* gaps_in_frame_num_allowed_flag */
+    set_ue_golomb(&pb, MB_WIDTH  - 1);
+    set_ue_golomb(&pb, MB_HEIGHT - 1);
+    put_bits(&pb, 1, 1);                /* frame_mbs_only_flag */
+    put_bits(&pb, 1, 1);                /* direct_8x8_inference_flag */
+    put_bits(&pb, 1, 0);                /* frame_cropping_flag */
+    put_bits(&pb, 1, 0);                /* vui_parameters_present_flag */
+    dst = write_nal(dst, 7, rbsp, finish_rbsp(&pb));
+
+    init_put_bits(&pb, rbsp, size);
+    set_ue_golomb(&pb, 0);              /* pic_parameter_set_id */
+    set_ue_golomb(&pb, 0);              /* seq_parameter_set_id */
+    put_bits(&pb, 1, 0);                /* entropy_coding_mode_flag */
+    put_bits(&pb, 1, 0);                /* bottom_field_pic_order_in_frame_present */
+    set_ue_golomb(&pb, 0);              /* num_slice_groups_minus1 */
+    set_ue_golomb(&pb, 0);              /* num_ref_idx_l0_default_active_minus1 */
+    set_ue_golomb(&pb, 0);              /* num_ref_idx_l1_default_active_minus1 */
+    put_bits(&pb, 3, 0);                /* weighted_pred_flag, weighted_bipred_idc */
+    set_se_golomb(&pb, 0);              /* pic_init_qp_minus26 */
+    set_se_golomb(&pb, 0);              /* pic_init_qs_minus26 */
+    set_se_golomb(&pb, 0);              /* chroma_qp_index_offset */
+    put_bits(&pb, 1, 0);                /* deblocking_filter_control_present_flag */
+    put_bits(&pb, 1, 0);                /* constrained_intra_pred_flag */
+    put_bits(&pb, 1, 0);                /* redundant_pic_cnt_present_flag */
+    return write_nal(dst, 8, rbsp, finish_rbsp(&pb));
+}
+
+/* write one picture as a single IDR slice */
+static uint8_t *write_picture(uint8_t *dst, uint8_t *rbsp, int size, int pic)
+{
+    int mb_x, mb_y, x, y, plane;
+    PutBitContext pb;
+
+    init_put_bits(&pb, rbsp, size);
+    set_ue_golomb(&pb, 0);              /* first_mb_in_slice */
+    set_ue_golomb(&pb, 7);              /* slice_type: I */
+    set_ue_golomb(&pb, 0);              /* pic_parameter_set_id */
+    put_bits(&pb, 4, 0);                /* frame_num */
+    set_ue_golomb(&pb, pic & 1);        /* idr_pic_id */
+    put_bits(&pb, 2, 0);                /* no_output_of_prior_pics, long_term_reference */
+    set_se_golomb(&pb, 20 + pic % 3);   /* slice_qp_delta */
+    for (mb_y = 0; mb_y < MB_HEIGHT; mb_y++) {
+        for (mb_x = 0; mb_x < MB_WIDTH; mb_x++) {
+            if ((mb_x + mb_y + pic) & 1) {
+                set_ue_golomb(&pb, 3);  /* mb_type: I_16x16, DC, no residual */
+                set_ue_golomb(&pb, 0);  /* intra_chroma_pred_mode: DC */
+                set_se_golomb(&pb, 0);  /* mb_qp_delta */
+                /* luma DC coeff_token without coefficients. The left and
+                 * top neighbors are I_PCM, which count as 16 coefficients
+                 * per block, so nC is 16 unless neither is available. */
+                if (mb_x || mb_y)
+                    put_bits(&pb, 6, 3);
+                else
+                    put_bits(&pb, 1, 1);
+                continue;
+            }
+            set_ue_golomb(&pb, 25);     /* mb_type: I_PCM */
+            put_bits(&pb, -put_bits_count(&pb) & 7, 0); /* pcm_alignment_zero_bits */
+            for (y = 0; y < 16; y++)
+                for (x = 0; x < 16; x++)
+                    put_bits(&pb, 8, pixel(pic, 0, mb_x * 16 + x, mb_y * 16 + y));
+            for (plane = 1; plane < 3; plane++)
+                for (y = 0; y < 8; y++)
+                    for (x = 0; x < 8; x++)
+                        put_bits(&pb, 8, pixel(pic, plane, mb_x * 8 + x, mb_y * 8 + y));
+        }
+    }
+    return write_nal(dst, 5, rbsp, finish_rbsp(&pb));
+}
+
+static uint32_t checksum(const AVFrame *frame)
+{
+    uint32_t crc = 0;
+    int y, plane;
+
+    for (plane = 0; plane < 3; plane++)
+        for (y = 0; y < HEIGHT >> !!plane; y++)
+            crc = av_adler32_update(crc, frame->data[plane] + y * frame->linesize[plane],
+                                    WIDTH >> !!plane);
+    return crc;
+}
+
+/**
+ * Decode the stream and store the checksum of each picture.
+ * @return the number of pictures output, or -1 on error
+ */
+static int run(const uint8_t *stream, const uint8_t **pics, int threads,
+               int deblock_thread, int skip_loop_filter,
+               uint32_t crcs[NB_PICTURES])
+{
+    AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_H264);
+    AVCodecContext *avctx = avcodec_alloc_context3(codec);
+    AVDictionary *opts = NULL;
+    AVFrame frame;
+    AVPacket pkt;
+    int i, got_frame, nb_out = 0;
+
+    avctx->thread_count = threads;
+    avctx->thread_type  = FF_THREAD_SLICE;
+    if (skip_loop_filter)
+        avctx->skip_loop_filter = AVDISCARD_ALL;
+    av_dict_set(&opts, "deblock_thread", deblock_thread ? "1" : "0", 0);
+    if (avcodec_open2(avctx, codec, &opts) < 0) {
+        printf("cannot open the decoder\n");
+        av_dict_free(&opts);
+        return -1;
+    }
+    av_dict_free(&opts);
+
+    av_init_packet(&pkt);
+    for (i = 0; i <= NB_PICTURES || got_frame; i++) {
+        if (i < NB_PICTURES) {
+            pkt.data = (uint8_t *)(i ? pics[i - 1] : stream);
+            pkt.size = pics[i] - pkt.data;
+        } else {
+            pkt.data = NULL;
+            pkt.size = 0;
+        }
+        avcodec_get_frame_defaults(&frame);
+        if (avcodec_decode_video2(avctx, &frame, &got_frame, &pkt) < 0) {
+            printf("error decoding picture %d\n", i);
+            nb_out = -1;
+            break;
+        }
+        if (got_frame && nb_out < NB_PICTURES)
+            crcs[nb_out++] = checksum(&frame);
+    }
+
+    avcodec_close(avctx);
+    av_free(avctx);
+    return nb_out;
+}
+
+int main(void)
+{
+    static const int thread_counts[] = { 2, 3 };
+    int size = WIDTH * HEIGHT * 3 + 4096;
+    uint8_t *rbsp = av_malloc(size), *stream = av_malloc(NB_PICTURES * size);
+    const uint8_t *pics[NB_PICTURES];
+    uint32_t ref[NB_PICTURES], crcs[NB_PICTURES];
+    uint8_t *end;
+    int i, t, errors = 0;
+
+    if (!rbsp || !stream)
+        return 1;
+
+    avcodec_register_all();
+
+    end = write_headers(stream, rbsp, size);
+    for (i = 0; i < NB_PICTURES; i++)
+        pics[i] = end = write_picture(end, rbsp, size, i);
+
+    if (run(stream, pics, 1, 0, 0, ref) != NB_PICTURES)
+        return 1;
+    for (i = 0; i < NB_PICTURES; i++)
+        printf("picture %d: 0x%08x\n", i, ref[i]);
+
+    /* the test is useless if the filter leaves the pictures unchanged */
+    if (run(stream, pics, 1, 0, 1, crcs) != NB_PICTURES)
+        return 1;
+    for (i = 0; i < NB_PICTURES; i++) {
+        if (crcs[i] == ref[i]) {
+            printf("picture %d: not changed by the loop filter\n", i);
+            errors++;
+        }
+    }
+
+    for (t = 0; t < FF_ARRAY_ELEMS(thread_counts); t++) {
+        if (run(stream, pics, thread_counts[t], 1, 0, crcs) != NB_PICTURES)
+            return 1;
+        for (i = 0; i < NB_PICTURES; i++) {
+            if (crcs[i] != ref[i]) {
+                printf("picture %d: 0x%08x with deblock_thread and %d threads\n",
+                       i, crcs[i], thread_counts[t]);
+                errors++;
+            }
+        }
+    }
+
+    av_free(rbsp);
+    av_free(stream);
+    return !!errors;
+}
@@ -0,0 +1,574 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * H.264 high bit depth DSP and intra prediction tests.
+ * First the C functions are run alone and a CRC of their output is
+ * printed for comparison with the reference. Then every optimized function
+ * is run on random input next to its C version for each set of CPU flags
+ * up to the detected (or given) one, and the output has to be bit-exact.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/crc.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "h264.h"
+#include "h264dsp.h"
+#include "h264pred.h"
+
+#undef printf
+#undef fprintf
+
+#define WIDTH   64
+#define HEIGHT  48
+#define STRIDE  (WIDTH * 2)
+#define TRIALS  200
+
+#define PIX(buf, x, y) ((uint8_t *)((buf) + (y) * WIDTH + (x)))
+
+DECLARE_ALIGNED(16, static uint16_t, pix_ref)[HEIGHT * WIDTH];
+DECLARE_ALIGNED(16, static uint16_t, pix_new)[HEIGHT * WIDTH];
+DECLARE_ALIGNED(16, static uint16_t, pix_src)[HEIGHT * WIDTH];
+DECLARE_ALIGNED(16, static int32_t, coef_ref)[16 * 16 * 3];
+DECLARE_ALIGNED(16, static int32_t, coef_new)[16 * 16 * 3];
+
+static int block_offset[48];
+static AVLFG prng;
+static int bit_depth, chroma_format_idc, cpu_flags;
+static int failed;
+static int crc_pass;
+static uint32_t crc;
+
+static int rnd(int min, int max)
+{
+    return min + av_lfg_get(&prng) % (max - min + 1);
+}
+
+/**
+ * @return 1 if a test has to be skipped because the function has no
+ *         optimized version, all functions are run in the CRC pass
+ */
+static int skip(int same)
+{
+    return same && !crc_pass;
+}
+
+/**
+ * Add the pixels or coefficients to the CRC, in little-endian order so
+ * that the reference does not depend on the host.
+ */
+static void checksum(const void *buf, int size)
+{
+    static uint8_t le[FFMAX(sizeof(pix_ref), sizeof(coef_ref))];
+    int i;
+
+    if (!crc_pass)
+        return;
+    if (buf == coef_ref) {
+        for (i = 0; i < size / 4; i++)
+            AV_WL32(le + 4 * i, coef_ref[i]);
+    } else {
+        for (i = 0; i < size / 2; i++)
+            AV_WL16(le + 2 * i, pix_ref[i]);
+    }
+    crc = av_crc(av_crc_get_table(AV_CRC_32_IEEE), crc, le, size);
+}
+
+static void print_checksum(const char *name)
+{
+    if (crc_pass)
+        printf("%s: %08x\n", name, crc);
+    crc = 0;
+}
+
+static void report(const char *name)
+{
+    fprintf(stderr, "%s: mismatch (bit depth %d, chroma format %d, cpu flags 0x%x)\n",
+            name, bit_depth, chroma_format_idc, cpu_flags);
+    failed = 1;
+}
+
+/**
+ * Fill both pixel buffers with the same data. With noise == 0 every pixel
+ * is random, otherwise the pixels differ from a common base by at most
+ * noise, so that the loop filters actually modify the edges.
+ */
+static void init_pixels(int noise)
+{
+    int i, max = (1 << bit_depth) - 1;
+    int base = rnd(0, max);
+
+    for (i = 0; i < HEIGHT * WIDTH; i++)
+        pix_ref[i] = noise ? av_clip(base + rnd(-noise, noise), 0, max)
+                           : rnd(0, max);
+    memcpy(pix_new, pix_ref, sizeof(pix_ref));
+}
+
+static int pixels_differ(void)
+{
+    return memcmp(pix_ref, pix_new, sizeof(pix_ref));
+}
+
+/**
+ * Fill a cleared size x size coefficient block: empty, DC only or sparse.
+ * @return the number of nonzero coefficients, not counting the DC
+ *         coefficient if dc_separate is set
+ */
+static int fill_block(int32_t *block, int size, int dc_separate)
+{
+    int i, nnz = 0;
+
+    switch (rnd(0, 3)) {
+    case 0:
+        break;
+    case 1:
+        block[0] = rnd(-4096, 4095);
+        break;
+    default:
+        for (i = 0; i < size * size; i++)
+            if (!rnd(0, 3))
+                block[i] = rnd(-1024, 1023);
+    }
+    for (i = dc_separate; i < size * size; i++)
+        nnz += !!block[i];
+    return nnz;
+}
+
+typedef void (*idct_func)(uint8_t *dst, DCTELEM *block, int stride);
+typedef void (*idct_multi_func)(uint8_t *dst, const int *block_offset,
+                                DCTELEM *block, int stride,
+                                const uint8_t nnzc[15 * 8]);
+
+static void test_idct(const char *name, idct_func f_ref, idct_func f_new,
+                      int size, int dc_only)
+{
+    int n;
+
+    if (skip(f_ref == f_new))
+        return;
+    for (n = 0; n < TRIALS; n++) {
+        init_pixels(0);
+        memset(coef_ref, 0, sizeof(coef_ref));
+        if (dc_only)
+            coef_ref[0] = rnd(-4096, 4095);
+        else
+            fill_block(coef_ref, size, 0);
+        memcpy(coef_new, coef_ref, sizeof(coef_ref));
+        f_ref(PIX(pix_ref, 8, 8), (DCTELEM *)coef_ref, STRIDE);
+        f_new(PIX(pix_new, 8, 8), (DCTELEM *)coef_new, STRIDE);
+        if (pixels_differ()) {
+            report(name);
+            return;
+        }
+        checksum(pix_ref, sizeof(pix_ref));
+    }
+    print_checksum(name);
+}
+
+static void test_idct_multi(const char *name, idct_multi_func f_ref,
+                            idct_multi_func f_new, int size, int dc_separate)
+{
+    uint8_t nnzc[15 * 8];
+    int i, n, step = size == 8 ? 4 : 1;
+
+    if (skip(f_ref == f_new))
+        return;
+    for (n = 0; n < TRIALS; n++) {
+        init_pixels(0);
+        memset(coef_ref, 0, sizeof(coef_ref));
+        memset(nnzc, 0, sizeof(nnzc));
+        for (i = 0; i < 16; i += step)
+            nnzc[scan8[i]] = fill_block(coef_ref + i * 16, size, dc_separate);
+        memcpy(coef_new, coef_ref, sizeof(coef_ref));
+        f_ref(PIX(pix_ref, 8, 8), block_offset, (DCTELEM *)coef_ref, STRIDE, nnzc);
+        f_new(PIX(pix_new, 8, 8), block_offset, (DCTELEM *)coef_new, STRIDE, nnzc);
+        if (pixels_differ()) {
+            report(name);
+            return;
+        }
+        checksum(pix_ref, sizeof(pix_ref));
+    }
+    print_checksum(name);
+}
+
+static void test_idct_add8(H264DSPContext *ref, H264DSPContext *new)
+{
+    uint8_t nnzc[15 * 8];
+    uint8_t *dst_ref[2] = { PIX(pix_ref, 8, 8), PIX(pix_ref, 32, 8) };
+    uint8_t *dst_new[2] = { PIX(pix_new, 8, 8), PIX(pix_new, 32, 8) };
+    int i, j, n, blk;
+
+    if (skip(ref->h264_idct_add8 == new->h264_idct_add8))
+        return;
+    for (n = 0; n < TRIALS; n++) {
+        init_pixels(0);
+        memset(coef_ref, 0, sizeof(coef_ref));
+        memset(nnzc, 0, sizeof(nnzc));
+        for (j = 1; j < 3; j++) {
+            for (i = 0; i < 4 * chroma_format_idc; i++) {
+                blk = j * 16 + i;
+                /* the lower 4:2:2 blocks take their nnz from scan8[blk + 4] */
+                nnzc[scan8[blk + (i >= 4) * 4]] = fill_block(coef_ref + blk * 16, 4, 1);
+            }
+        }
+        memcpy(coef_new, coef_ref, sizeof(coef_ref));
+        ref->h264_idct_add8(dst_ref, block_offset, (DCTELEM *)coef_ref, STRIDE, nnzc);
+        new->h264_idct_add8(dst_new, block_offset, (DCTELEM *)coef_new, STRIDE, nnzc);
+        if (pixels_differ()) {
+            report("h264_idct_add8");
+            return;
+        }
+        checksum(pix_ref, sizeof(pix_ref));
+    }
+    print_checksum("h264_idct_add8");
+}
+
+static void test_dc_dequant(H264DSPContext *ref, H264DSPContext *new)
+{
+    int i, n, qmul;
+
+    if (!skip(ref->h264_luma_dc_dequant_idct == new->h264_luma_dc_dequant_idct)) {
+        for (n = 0; n < TRIALS; n++) {
+            memset(coef_ref, 0, sizeof(coef_ref));
+            for (i = 0; i < 16; i++)
+                coef_ref[512 + i] = rnd(-2048, 2047);
+            memcpy(coef_new, coef_ref, sizeof(coef_ref));
+            qmul = rnd(1, 4096);
+            ref->h264_luma_dc_dequant_idct((DCTELEM *)coef_ref, (DCTELEM *)(coef_ref + 512), qmul);
+            new->h264_luma_dc_dequant_idct((DCTELEM *)coef_new, (DCTELEM *)(coef_new + 512), qmul);
+            if (memcmp(coef_ref, coef_new, sizeof(coef_ref))) {
+                report("h264_luma_dc_dequant_idct");
+                break;
+            }
+            checksum(coef_ref, sizeof(coef_ref));
+        }
+        print_checksum("h264_luma_dc_dequant_idct");
+    }
+    if (!skip(ref->h264_chroma_dc_dequant_idct == new->h264_chroma_dc_dequant_idct)) {
+        for (n = 0; n < TRIALS; n++) {
+            for (i = 0; i < 16 * 8; i++)
+                coef_ref[i] = rnd(-2048, 2047);
+            memcpy(coef_new, coef_ref, sizeof(coef_ref));
+            qmul = rnd(1, 4096);
+            ref->h264_chroma_dc_dequant_idct((DCTELEM *)coef_ref, qmul);
+            new->h264_chroma_dc_dequant_idct((DCTELEM *)coef_new, qmul);
+            if (memcmp(coef_ref, coef_new, sizeof(coef_ref))) {
+                report("h264_chroma_dc_dequant_idct");
+                break;
+            }
+            checksum(coef_ref, sizeof(coef_ref));
+        }
+        print_checksum("h264_chroma_dc_dequant_idct");
+    }
+}
+
+static void test_weight(H264DSPContext *ref, H264DSPContext *new)
+{
+    static const char *const names[2][4] = {
+        { "weight_16", "weight_8", "weight_4", "weight_2" },
+        { "biweight_16", "biweight_8", "biweight_4", "biweight_2" },
+    };
+    int i, n, height, log2_denom, wd, ws, offset;
+
+    for (i = 0; i < 4; i++) {
+        if (!skip(ref->weight_h264_pixels_tab[i] == new->weight_h264_pixels_tab[i])) {
+            for (n = 0; n < TRIALS; n++) {
+                init_pixels(0);
+                height     = 2 << rnd(0, 3);
+                log2_denom = rnd(0, 7);
+                wd         = rnd(-128, 127);
+                offset     = rnd(-128, 127);
+                ref->weight_h264_pixels_tab[i](PIX(pix_ref, 16, 16), STRIDE, height,
+                                               log2_denom, wd, offset);
+                new->weight_h264_pixels_tab[i](PIX(pix_new, 16, 16), STRIDE, height,
+                                               log2_denom, wd, offset);
+                if (pixels_differ()) {
+                    report(names[0][i]);
+                    break;
+                }
+                checksum(pix_ref, sizeof(pix_ref));
+            }
+            print_checksum(names[0][i]);
+        }
+        if (!skip(ref->biweight_h264_pixels_tab[i] == new->biweight_h264_pixels_tab[i])) {
+            for (n = 0; n < TRIALS; n++) {
+                init_pixels(0);
+                for (height = 0; height < HEIGHT * WIDTH; height++)
+                    pix_src[height] = rnd(0, (1 << bit_depth) - 1);
+                height     = 2 << rnd(0, 3);
+                log2_denom = rnd(0, 7);
+                /* the sum of the weights has to fit in 8 bits */
+                wd         = rnd(-128, 127);
+                ws         = av_clip(rnd(-128, 127), -128 - wd, 127 - wd);
+                offset     = rnd(-128, 127);
+                ref->biweight_h264_pixels_tab[i](PIX(pix_ref, 16, 16), PIX(pix_src, 16, 16),
+                                                 STRIDE, height, log2_denom, wd, ws, offset);
+                new->biweight_h264_pixels_tab[i](PIX(pix_new, 16, 16), PIX(pix_src, 16, 16),
+                                                 STRIDE, height, log2_denom, wd, ws, offset);
+                if (pixels_differ()) {
+                    report(names[1][i]);
+                    break;
+                }
+                checksum(pix_ref, sizeof(pix_ref));
+            }
+            print_checksum(names[1][i]);
+        }
+    }
+}
+
+typedef void (*loop_filter_func)(uint8_t *pix, int stride, int alpha, int beta,
+                                 int8_t *tc0);
+typedef void (*loop_filter_intra_func)(uint8_t *pix, int stride, int alpha,
+                                       int beta);
+
+static void test_loop_filter(const char *name, loop_filter_func f_ref,
+                             loop_filter_func f_new,
+                             loop_filter_intra_func f_intra_ref,
+                             loop_filter_intra_func f_intra_new)
+{
+    int8_t tc0[4];
+    int i, n, alpha, beta;
+
+    if (skip(f_ref == f_new && f_intra_ref == f_intra_new))
+        return;
+    for (n = 0; n < TRIALS; n++) {
+        init_pixels(4 << rnd(0, 5));
+        alpha = rnd(0, 255);
+        beta  = rnd(0, 18);
+        for (i = 0; i < 4; i++)
+            tc0[i] = rnd(-1, 25);
+        if (f_ref) {
+            f_ref(PIX(pix_ref, 16, 16), STRIDE, alpha, beta, tc0);
+            f_new(PIX(pix_new, 16, 16), STRIDE, alpha, beta, tc0);
+        } else {
+            f_intra_ref(PIX(pix_ref, 16, 16), STRIDE, alpha, beta);
+            f_intra_new(PIX(pix_new, 16, 16), STRIDE, alpha, beta);
+        }
+        if (pixels_differ()) {
+            report(name);
+            return;
+        }
+        checksum(pix_ref, sizeof(pix_ref));
+    }
+    print_checksum(name);
+}
+
+#define LOOP_FILTER(name) \
+    test_loop_filter(#name, ref->name, new->name, NULL, NULL)
+#define LOOP_FILTER_INTRA(name) \
+    test_loop_filter(#name, NULL, NULL, ref->name, new->name)
+
+static void test_h264dsp(void)
+{
+    H264DSPContext ref_ctx, new_ctx, *ref = &ref_ctx, *new = &new_ctx;
+
+    av_force_cpu_flags(0);
+    ff_h264dsp_init(ref, bit_depth, chroma_format_idc);
+    av_force_cpu_flags(cpu_flags);
+    ff_h264dsp_init(new, bit_depth, chroma_format_idc);
+
+    test_idct("h264_idct_add",     ref->h264_idct_add,     new->h264_idct_add,     4, 0);
+    test_idct("h264_idct_dc_add",  ref->h264_idct_dc_add,  new->h264_idct_dc_add,  4, 1);
+    test_idct("h264_idct8_add",    ref->h264_idct8_add,    new->h264_idct8_add,    8, 0);
+    test_idct("h264_idct8_dc_add", ref->h264_idct8_dc_add, new->h264_idct8_dc_add, 8, 1);
+    test_idct_multi("h264_idct_add16",      ref->h264_idct_add16,
+                    new->h264_idct_add16,      4, 0);
+    test_idct_multi("h264_idct_add16intra", ref->h264_idct_add16intra,
+                    new->h264_idct_add16intra, 4, 1);
+    test_idct_multi("h264_idct8_add4",      ref->h264_idct8_add4,
+                    new->h264_idct8_add4,      8, 0);
+    test_idct_add8(ref, new);
+    test_dc_dequant(ref, new);
+    test_weight(ref, new);
+
+    LOOP_FILTER(h264_v_loop_filter_luma);
+    LOOP_FILTER(h264_h_loop_filter_luma);
+    LOOP_FILTER(h264_h_loop_filter_luma_mbaff);
+    LOOP_FILTER_INTRA(h264_v_loop_filter_luma_intra);
+    LOOP_FILTER_INTRA(h264_h_loop_filter_luma_intra);
+    LOOP_FILTER_INTRA(h264_h_loop_filter_luma_mbaff_intra);
+    LOOP_FILTER(h264_v_loop_filter_chroma);
+    LOOP_FILTER(h264_h_loop_filter_chroma);
+    LOOP_FILTER(h264_h_loop_filter_chroma_mbaff);
+    LOOP_FILTER_INTRA(h264_v_loop_filter_chroma_intra);
+    LOOP_FILTER_INTRA(h264_h_loop_filter_chroma_intra);
+    LOOP_FILTER_INTRA(h264_h_loop_filter_chroma_mbaff_intra);
+}
+
+static void test_h264pred(void)
+{
+    H264PredContext ref, new;
+    char name[32];
+    int i, n, topleft, topright;
+
+    memset(&ref, 0, sizeof(ref));
+    memset(&new, 0, sizeof(new));
+    av_force_cpu_flags(0);
+    ff_h264_pred_init(&ref, AV_CODEC_ID_H264, bit_depth, chroma_format_idc);
+    av_force_cpu_flags(cpu_flags);
+    ff_h264_pred_init(&new, AV_CODEC_ID_H264, bit_depth, chroma_format_idc);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(ref.pred4x4); i++) {
+        if (!ref.pred4x4[i] || skip(ref.pred4x4[i] == new.pred4x4[i]))
+            continue;
+        snprintf(name, sizeof(name), "pred4x4[%d]", i);
+        for (n = 0; n < TRIALS; n++) {
+            init_pixels(0);
+            ref.pred4x4[i](PIX(pix_ref, 16, 16), PIX(pix_ref, 20, 15), STRIDE);
+            new.pred4x4[i](PIX(pix_new, 16, 16), PIX(pix_new, 20, 15), STRIDE);
+            if (pixels_differ()) {
+                report(name);
+                break;
+            }
+            checksum(pix_ref, sizeof(pix_ref));
+        }
+        print_checksum(name);
+    }
+    for (i = 0; i < FF_ARRAY_ELEMS(ref.pred8x8l); i++) {
+        if (!ref.pred8x8l[i] || skip(ref.pred8x8l[i] == new.pred8x8l[i]))
+            continue;
+        snprintf(name, sizeof(name), "pred8x8l[%d]", i);
+        for (n = 0; n < TRIALS; n++) {
+            init_pixels(0);
+            topleft  = rnd(0, 1) << 15;
+            topright = rnd(0, 1) << 14;
+            ref.pred8x8l[i](PIX(pix_ref, 16, 16), topleft, topright, STRIDE);
+            new.pred8x8l[i](PIX(pix_new, 16, 16), topleft, topright, STRIDE);
+            if (pixels_differ()) {
+                report(name);
+                break;
+            }
+            checksum(pix_ref, sizeof(pix_ref));
+        }
+        print_checksum(name);
+    }
+    /* with chroma_format_idc 2 these are the 8x16 predictors */
+    for (i = 0; i < FF_ARRAY_ELEMS(ref.pred8x8); i++) {
+        if (!ref.pred8x8[i] || skip(ref.pred8x8[i] == new.pred8x8[i]))
+            continue;
+        snprintf(name, sizeof(name), "pred8x%d[%d]", 8 * chroma_format_idc, i);
+        for (n = 0; n < TRIALS; n++) {
+            init_pixels(0);
+            ref.pred8x8[i](PIX(pix_ref, 16, 16), STRIDE);
+            new.pred8x8[i](PIX(pix_new, 16, 16), STRIDE);
+            if (pixels_differ()) {
+                report(name);
+                break;
+            }
+            checksum(pix_ref, sizeof(pix_ref));
+        }
+        print_checksum(name);
+    }
+    for (i = 0; i < FF_ARRAY_ELEMS(ref.pred16x16); i++) {
+        if (!ref.pred16x16[i] || skip(ref.pred16x16[i] == new.pred16x16[i]))
+            continue;
+        snprintf(name, sizeof(name), "pred16x16[%d]", i);
+        for (n = 0; n < TRIALS; n++) {
+            init_pixels(0);
+            ref.pred16x16[i](PIX(pix_ref, 16, 16), STRIDE);
+            new.pred16x16[i](PIX(pix_new, 16, 16), STRIDE);
+            if (pixels_differ()) {
+                report(name);
+                break;
+            }
+            checksum(pix_ref, sizeof(pix_ref));
+        }
+        print_checksum(name);
+    }
+}
+
+static void help(void)
+{
+    printf("usage: h264dsp-test [-h] [-c cpuflags]\n"
+           "-c cpuflags  test with at most these CPU flags (default: detected)\n");
+}
+
+int main(int argc, char **argv)
+{
+    int i, c, max_flags, flags;
+
+    av_lfg_init(&prng, 1);
+    max_flags = av_get_cpu_flags();
+
+    for (;;) {
+        c = getopt(argc, argv, "hc:");
+        if (c == -1)
+            break;
+        switch (c) {
+        case 'c':
+            max_flags = 0;
+            if (av_parse_cpu_caps((unsigned *)&max_flags, optarg) < 0)
+                return 1;
+            break;
+        case 'h':
+        default:
+            help();
+            return 1;
+        }
+    }
+
+    for (i = 0; i < 16; i++) {
+        int x = 4 * ((scan8[i] - scan8[0]) & 7) * 2;
+        int y = 4 * ((scan8[i] - scan8[0]) >> 3);
+        block_offset[i] = block_offset[16 + i] = block_offset[32 + i] = x + y * STRIDE;
+    }
+
+    /* the C functions alone, the CRCs are compared with the reference */
+    crc_pass = 1;
+    for (bit_depth = 9; bit_depth <= 10; bit_depth++) {
+        for (chroma_format_idc = 1; chroma_format_idc <= 2; chroma_format_idc++) {
+            printf("bit depth %d, chroma format %d\n", bit_depth, chroma_format_idc);
+            test_h264dsp();
+            test_h264pred();
+        }
+    }
+    crc_pass = 0;
+
+    /* test each set of CPU flags that the detected flags contain, adding
+     * one flag at a time in order, so that the functions of the lower
+     * instruction sets are not hidden by the higher ones */
+    cpu_flags = 0;
+    for (i = 0; i < 32; i++) {
+        flags = max_flags & (1U << i);
+        if (!flags)
+            continue;
+        cpu_flags |= flags;
+        for (bit_depth = 9; bit_depth <= 10; bit_depth++) {
+            for (chroma_format_idc = 1; chroma_format_idc <= 2; chroma_format_idc++) {
+                test_h264dsp();
+                test_h264pred();
+            }
+        }
+    }
+    av_force_cpu_flags(-1);
+
+    return failed;
+}
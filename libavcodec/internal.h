@@ -31,6 +31,7 @@
 #include "avcodec.h"
 
 typedef struct InternalBuffer {
+    AVBufferRef *buf[AV_NUM_DATA_POINTERS];
     uint8_t *base[AV_NUM_DATA_POINTERS];
     uint8_t *data[AV_NUM_DATA_POINTERS];
     int linesize[AV_NUM_DATA_POINTERS];
@@ -42,6 +43,19 @@ typedef struct InternalBuffer {
     int nb_channels;
 } InternalBuffer;
 
+/**
+ * Pools of the planes of the video frames allocated by the default
+ * get_buffer(), for the current frame parameters.
+ */
+typedef struct FramePool {
+    AVBufferPool *pools[4];
+    int linesize[4];
+    int offset[4];              ///< offset of the data from the buffer start
+    int width, height;
+    enum PixelFormat pix_fmt;
+    int emu_edge;
+} FramePool;
+
 typedef struct AVCodecInternal {
     /**
      * internal buffer count
@@ -55,6 +69,12 @@ typedef struct AVCodecInternal {
      */
     InternalBuffer *buffer;
 
+    /**
+     * video frame buffer pools
+     * used by default get/release/reget_buffer().
+     */
+    FramePool pool;
+
     /**
      * Whether the parent AVCodecContext is a copy of the context which had
      * init() called on it.
@@ -85,10 +105,37 @@ typedef struct AVCodecInternal {
 
     void *frame_thread_encoder;
 
+    /**
+     * Number of pictures of the stream before the ones given to this
+     * encoder, which were encoded by other contexts. Set by the frame
+     * thread encoder for each GOP, added to the picture numbers which are
+     * written into the bitstream.
+     */
+    int64_t picture_number_offset;
+
     /**
      * Number of audio samples to skip at the start of the next decoded frame
      */
     int skip_samples;
+
+    /**
+     * Output frame of avcodec_decode_audio_batch(), NULL outside of it.
+     * While it is set, the default get_buffer() hands out the part of the
+     * batch buffer following the samples already decoded, so that decoders
+     * write into the batch directly.
+     */
+    AVFrame *batch_frame;
+    int batch_channels;         ///< channel count of the samples in batch_frame
+    int batch_pkts_left;        ///< packets left in the batch, to size the buffer
+    int batch_capacity;         ///< number of samples batch_buf can hold
+    uint8_t *batch_buf;
+    int batch_buf_size;
+    /**
+     * plane pointers of batch_buf, followed by the plane pointers of the
+     * window handed out by get_buffer()
+     */
+    uint8_t **batch_planes;
+    int batch_nb_planes;
 } AVCodecInternal;
 
 struct AVCodecDefault {
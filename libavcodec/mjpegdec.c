@@ -38,6 +38,7 @@
 #include "mjpeg.h"
 #include "mjpegdec.h"
 #include "jpeglsdec.h"
+#include "thread.h"
 
 
 static int build_vlc(VLC *vlc, const uint8_t *bits_table,
@@ -63,20 +64,46 @@ static int build_vlc(VLC *vlc, const uint8_t *bits_table,
                               huff_code, 2, 2, huff_sym, 2, 2, use_static);
 }
 
+/* build the VLCs of a table class and index and remember their source */
+static int init_huffman_table(MJpegDecodeContext *s, int class, int index,
+                              const uint8_t *bits_table,
+                              const uint8_t *val_table, int nb_codes)
+{
+    int i, n = 0, ret;
+
+    for (i = 1; i <= 16; i++)
+        n += bits_table[i];
+
+    s->huff_nb_codes[class][index] = 0;
+    ff_free_vlc(&s->vlcs[class][index]);
+    if ((ret = build_vlc(&s->vlcs[class][index], bits_table, val_table,
+                         nb_codes, 0, class > 0)) < 0)
+        return ret;
+    if (class > 0) {
+        ff_free_vlc(&s->vlcs[2][index]);
+        if ((ret = build_vlc(&s->vlcs[2][index], bits_table, val_table,
+                             nb_codes, 0, 0)) < 0)
+            return ret;
+    }
+
+    s->huff_bits[class][index][0] = 0;
+    memcpy(s->huff_bits[class][index] + 1, bits_table + 1, 16);
+    memset(s->huff_vals[class][index], 0, 256);
+    memcpy(s->huff_vals[class][index], val_table, n);
+    s->huff_nb_codes[class][index] = nb_codes;
+    return 0;
+}
+
 static void build_basic_mjpeg_vlc(MJpegDecodeContext *s)
 {
-    build_vlc(&s->vlcs[0][0], ff_mjpeg_bits_dc_luminance,
-              ff_mjpeg_val_dc, 12, 0, 0);
-    build_vlc(&s->vlcs[0][1], ff_mjpeg_bits_dc_chrominance,
-              ff_mjpeg_val_dc, 12, 0, 0);
-    build_vlc(&s->vlcs[1][0], ff_mjpeg_bits_ac_luminance,
-              ff_mjpeg_val_ac_luminance, 251, 0, 1);
-    build_vlc(&s->vlcs[1][1], ff_mjpeg_bits_ac_chrominance,
-              ff_mjpeg_val_ac_chrominance, 251, 0, 1);
-    build_vlc(&s->vlcs[2][0], ff_mjpeg_bits_ac_luminance,
-              ff_mjpeg_val_ac_luminance, 251, 0, 0);
-    build_vlc(&s->vlcs[2][1], ff_mjpeg_bits_ac_chrominance,
-              ff_mjpeg_val_ac_chrominance, 251, 0, 0);
+    init_huffman_table(s, 0, 0, ff_mjpeg_bits_dc_luminance,
+                       ff_mjpeg_val_dc, 12);
+    init_huffman_table(s, 0, 1, ff_mjpeg_bits_dc_chrominance,
+                       ff_mjpeg_val_dc, 12);
+    init_huffman_table(s, 1, 0, ff_mjpeg_bits_ac_luminance,
+                       ff_mjpeg_val_ac_luminance, 251);
+    init_huffman_table(s, 1, 1, ff_mjpeg_bits_ac_chrominance,
+                       ff_mjpeg_val_ac_chrominance, 251);
 }
 
 av_cold int ff_mjpeg_decode_init(AVCodecContext *avctx)
@@ -118,6 +145,95 @@ av_cold int ff_mjpeg_decode_init(AVCodecContext *avctx)
     return 0;
 }
 
+av_cold int ff_mjpeg_decode_init_thread_copy(AVCodecContext *avctx)
+{
+    MJpegDecodeContext *s = avctx->priv_data;
+    int class, index, i;
+
+    s->avctx       = avctx;
+    s->picture_ptr = &s->picture;
+    avcodec_get_frame_defaults(&s->picture);
+
+    s->buffer            = NULL;
+    s->buffer_size       = 0;
+    s->qscale_table      = NULL;
+    s->ljpeg_buffer      = NULL;
+    s->ljpeg_buffer_size = 0;
+    s->restart_pos       = NULL;
+    s->restart_pos_size  = 0;
+    for (i = 0; i < MAX_COMPONENTS; i++) {
+        s->blocks[i]   = NULL;
+        s->last_nnz[i] = NULL;
+    }
+
+    memset(s->vlcs, 0, sizeof(s->vlcs));
+    for (class = 0; class < 2; class++)
+        for (index = 0; index < 4; index++)
+            if (s->huff_nb_codes[class][index])
+                init_huffman_table(s, class, index,
+                                   s->huff_bits[class][index],
+                                   s->huff_vals[class][index],
+                                   s->huff_nb_codes[class][index]);
+    return 0;
+}
+
+/*
+ * Only the state that outlives a frame is copied. The previous thread may
+ * still be decoding its last scan, which does not touch any of it.
+ */
+int ff_mjpeg_decode_update_thread_context(AVCodecContext *dst,
+                                          const AVCodecContext *src)
+{
+    MJpegDecodeContext *s = dst->priv_data, *s1 = src->priv_data;
+    int class, index, ret;
+
+    memcpy(s->quant_matrixes, s1->quant_matrixes, sizeof(s->quant_matrixes));
+    memcpy(s->qscale, s1->qscale, sizeof(s->qscale));
+
+    for (class = 0; class < 2; class++) {
+        for (index = 0; index < 4; index++) {
+            if (!s1->huff_nb_codes[class][index] ||
+                (s->huff_nb_codes[class][index] == s1->huff_nb_codes[class][index] &&
+                 !memcmp(s->huff_bits[class][index], s1->huff_bits[class][index], 17) &&
+                 !memcmp(s->huff_vals[class][index], s1->huff_vals[class][index], 256)))
+                continue;
+            if ((ret = init_huffman_table(s, class, index,
+                                          s1->huff_bits[class][index],
+                                          s1->huff_vals[class][index],
+                                          s1->huff_nb_codes[class][index])) < 0)
+                return ret;
+        }
+    }
+
+    if (s->width != s1->width || !s->qscale_table) {
+        av_freep(&s->qscale_table);
+        s->qscale_table = av_mallocz((s1->width + 15) / 16);
+        if (!s->qscale_table)
+            return AVERROR(ENOMEM);
+    }
+    s->width         = s1->width;
+    s->height        = s1->height;
+    s->interlaced    = s1->interlaced;
+    s->bottom_field  = s1->bottom_field;
+    s->first_picture = s1->first_picture;
+
+    s->rgb                = s1->rgb;
+    s->rct                = s1->rct;
+    s->pegasus_rct        = s1->pegasus_rct;
+    s->buggy_avid         = s1->buggy_avid;
+    s->cs_itu601          = s1->cs_itu601;
+    s->interlace_polarity = s1->interlace_polarity;
+
+    s->maxval = s1->maxval;
+    s->near   = s1->near;
+    s->t1     = s1->t1;
+    s->t2     = s1->t2;
+    s->t3     = s1->t3;
+    s->reset  = s1->reset;
+
+    return 0;
+}
+
 
 /* quantize tables */
 int ff_mjpeg_decode_dqt(MJpegDecodeContext *s)
@@ -190,19 +306,11 @@ int ff_mjpeg_decode_dht(MJpegDecodeContext *s)
         len -= n;
 
         /* build VLC and flush previous vlc if present */
-        ff_free_vlc(&s->vlcs[class][index]);
         av_log(s->avctx, AV_LOG_DEBUG, "class=%d index=%d nb_codes=%d\n",
                class, index, code_max + 1);
-        if ((ret = build_vlc(&s->vlcs[class][index], bits_table, val_table,
-                             code_max + 1, 0, class > 0)) < 0)
+        if ((ret = init_huffman_table(s, class, index, bits_table, val_table,
+                                      code_max + 1)) < 0)
             return ret;
-
-        if (class > 0) {
-            ff_free_vlc(&s->vlcs[2][index]);
-            if ((ret = build_vlc(&s->vlcs[2][index], bits_table, val_table,
-                                 code_max + 1, 0, 0)) < 0)
-                return ret;
-        }
     }
     return 0;
 }
@@ -423,9 +531,9 @@ int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
     }
 
     if (s->picture_ptr->data[0])
-        s->avctx->release_buffer(s->avctx, s->picture_ptr);
+        ff_thread_release_buffer(s->avctx, s->picture_ptr);
 
-    if (s->avctx->get_buffer(s->avctx, s->picture_ptr) < 0) {
+    if (ff_thread_get_buffer(s->avctx, s->picture_ptr) < 0) {
         av_log(s->avctx, AV_LOG_ERROR, "get_buffer() failed\n");
         return -1;
     }
@@ -461,10 +569,11 @@ int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
     return 0;
 }
 
-static inline int mjpeg_decode_dc(MJpegDecodeContext *s, int dc_index)
+static inline int mjpeg_decode_dc(MJpegDecodeContext *s, GetBitContext *gb,
+                                  int dc_index)
 {
     int code;
-    code = get_vlc2(&s->gb, s->vlcs[0][dc_index].table, 9, 2);
+    code = get_vlc2(gb, s->vlcs[0][dc_index].table, 9, 2);
     if (code < 0) {
         av_log(s->avctx, AV_LOG_WARNING,
                "mjpeg_decode_dc: bad vlc: %d:%d (%p)\n",
@@ -473,46 +582,47 @@ static inline int mjpeg_decode_dc(MJpegDecodeContext *s, int dc_index)
     }
 
     if (code)
-        return get_xbits(&s->gb, code);
+        return get_xbits(gb, code);
     else
         return 0;
 }
 
 /* decode block and dequantize */
-static int decode_block(MJpegDecodeContext *s, DCTELEM *block, int component,
+static int decode_block(MJpegDecodeContext *s, GetBitContext *gb,
+                        DCTELEM *block, int *last_dc,
                         int dc_index, int ac_index, int16_t *quant_matrix)
 {
     int code, i, j, level, val;
 
     /* DC coef */
-    val = mjpeg_decode_dc(s, dc_index);
+    val = mjpeg_decode_dc(s, gb, dc_index);
     if (val == 0xffff) {
         av_log(s->avctx, AV_LOG_ERROR, "error dc\n");
         return AVERROR_INVALIDDATA;
     }
-    val = val * quant_matrix[0] + s->last_dc[component];
-    s->last_dc[component] = val;
+    val = val * quant_matrix[0] + *last_dc;
+    *last_dc = val;
     block[0] = val;
     /* AC coefs */
     i = 0;
-    {OPEN_READER(re, &s->gb);
+    {OPEN_READER(re, gb);
     do {
-        UPDATE_CACHE(re, &s->gb);
-        GET_VLC(code, re, &s->gb, s->vlcs[1][ac_index].table, 9, 2);
+        UPDATE_CACHE(re, gb);
+        GET_VLC(code, re, gb, s->vlcs[1][ac_index].table, 9, 2);
 
         i += ((unsigned)code) >> 4;
             code &= 0xf;
         if (code) {
             if (code > MIN_CACHE_BITS - 16)
-                UPDATE_CACHE(re, &s->gb);
+                UPDATE_CACHE(re, gb);
 
             {
-                int cache = GET_CACHE(re, &s->gb);
+                int cache = GET_CACHE(re, gb);
                 int sign  = (~cache) >> 31;
                 level     = (NEG_USR32(sign ^ cache,code) ^ sign) - sign;
             }
 
-            LAST_SKIP_BITS(re, &s->gb, code);
+            LAST_SKIP_BITS(re, gb, code);
 
             if (i > 63) {
                 av_log(s->avctx, AV_LOG_ERROR, "error count: %d\n", i);
@@ -522,7 +632,7 @@ static int decode_block(MJpegDecodeContext *s, DCTELEM *block, int component,
             block[j] = level * quant_matrix[j];
         }
     } while (i < 63);
-    CLOSE_READER(re, &s->gb);}
+    CLOSE_READER(re, gb);}
 
     return 0;
 }
@@ -533,7 +643,7 @@ static int decode_dc_progressive(MJpegDecodeContext *s, DCTELEM *block,
 {
     int val;
     s->dsp.clear_block(block);
-    val = mjpeg_decode_dc(s, dc_index);
+    val = mjpeg_decode_dc(s, &s->gb, dc_index);
     if (val == 0xffff) {
         av_log(s->avctx, AV_LOG_ERROR, "error dc\n");
         return AVERROR_INVALIDDATA;
@@ -757,7 +867,7 @@ static int ljpeg_decode_rgb_scan(MJpegDecodeContext *s, int nb_components, int p
 
                 PREDICT(pred, topleft[i], top[i], left[i], modified_predictor);
 
-                dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                 if(dc == 0xFFFF)
                     return -1;
 
@@ -836,7 +946,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
                     for(j=0; j<n; j++) {
                         int pred, dc;
 
-                        dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                        dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                         if(dc == 0xFFFF)
                             return -1;
                         if(bits<=8){
@@ -904,7 +1014,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
                     for (j = 0; j < n; j++) {
                         int pred;
 
-                        dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                        dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                         if(dc == 0xFFFF)
                             return -1;
                         if(bits<=8){
@@ -954,11 +1064,92 @@ static av_always_inline void mjpeg_copy_block(uint8_t *dst, const uint8_t *src,
     }
 }
 
+typedef struct RestartSlices {
+    uint8_t *data[MAX_COMPONENTS];
+    int linesize[MAX_COMPONENTS];
+    int nb_components;
+    int nb_intervals;             ///< number of restart intervals in the scan
+    int nb_jobs;
+    int end_bits;                 ///< bit position at the end of the last interval
+    int error;
+} RestartSlices;
+
+/* Decode consecutive restart intervals of a sequential scan. */
+static int decode_restart_intervals(AVCodecContext *avctx, void *arg,
+                                    int jobnr, int threadnr)
+{
+    MJpegDecodeContext *s = avctx->priv_data;
+    RestartSlices *rs     = arg;
+    int nb_mcus  = s->mb_width * s->mb_height;
+    int first    = jobnr       * rs->nb_intervals / rs->nb_jobs;
+    int last     = (jobnr + 1) * rs->nb_intervals / rs->nb_jobs;
+    int interval, mcu, i;
+    LOCAL_ALIGNED_16(DCTELEM, block, [64]);
+
+    for (interval = first; interval < last; interval++) {
+        GetBitContext gb = s->gb;
+        int last_dc[MAX_COMPONENTS];
+        int end = FFMIN((interval + 1) * s->restart_interval, nb_mcus);
+
+        if (interval)
+            skip_bits_long(&gb, s->restart_pos[interval - 1] * 8 -
+                                get_bits_count(&gb));
+        for (i = 0; i < rs->nb_components; i++)
+            last_dc[i] = 1024;
+
+        for (mcu = interval * s->restart_interval; mcu < end; mcu++) {
+            int mb_x = mcu % s->mb_width;
+            int mb_y = mcu / s->mb_width;
+
+            if (get_bits_left(&gb) < 0) {
+                av_log(avctx, AV_LOG_ERROR, "overread %d\n", -get_bits_left(&gb));
+                rs->error = AVERROR_INVALIDDATA;
+                break;
+            }
+            for (i = 0; i < rs->nb_components; i++) {
+                int n = s->nb_blocks[i];
+                int c = s->comp_index[i];
+                int h = s->h_scount[i];
+                int v = s->v_scount[i];
+                int x = 0, y = 0, j;
+
+                for (j = 0; j < n; j++) {
+                    int block_offset = ((rs->linesize[c] * (v * mb_y + y) * 8) +
+                                        (h * mb_x + x) * 8) >> avctx->lowres;
+
+                    s->dsp.clear_block(block);
+                    if (decode_block(s, &gb, block, &last_dc[i],
+                                     s->dc_index[i], s->ac_index[i],
+                                     s->quant_matrixes[s->quant_index[c]]) < 0) {
+                        av_log(avctx, AV_LOG_ERROR,
+                               "error y=%d x=%d\n", mb_y, mb_x);
+                        rs->error = AVERROR_INVALIDDATA;
+                        break;
+                    }
+                    s->dsp.idct_put(rs->data[c] + block_offset,
+                                    rs->linesize[c], block);
+                    if (++x == h) {
+                        x = 0;
+                        y++;
+                    }
+                }
+                if (j < n)
+                    break;
+            }
+            if (i < rs->nb_components)
+                break;
+        }
+        if (interval == rs->nb_intervals - 1)
+            rs->end_bits = get_bits_count(&gb);
+    }
+    return 0;
+}
+
 static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
                              int Al, const uint8_t *mb_bitmask,
                              const AVFrame *reference)
 {
-    int i, mb_x, mb_y;
+    int i, mb_x, mb_y, nb_intervals = 0;
     uint8_t *data[MAX_COMPONENTS];
     const uint8_t *reference_data[MAX_COMPONENTS];
     int linesize[MAX_COMPONENTS];
@@ -988,6 +1179,32 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
         }
     }
 
+    /* Restart intervals only depend on the scan headers, so they can be
+     * decoded in parallel once the RSTn markers have been located. Some
+     * encoders also put one after the last interval. */
+    if (s->restart_interval)
+        nb_intervals = (s->mb_width * s->mb_height + s->restart_interval - 1) /
+                       s->restart_interval;
+    if ((s->avctx->active_thread_type & FF_THREAD_SLICE) &&
+        !s->progressive && !s->interlaced && !mb_bitmask && nb_intervals > 1 &&
+        (s->nb_restart_pos == nb_intervals - 1 ||
+         s->nb_restart_pos == nb_intervals)) {
+        RestartSlices rs = { { 0 } };
+
+        memcpy(rs.data,     data,     sizeof(rs.data));
+        memcpy(rs.linesize, linesize, sizeof(rs.linesize));
+        rs.nb_components = nb_components;
+        rs.nb_intervals  = nb_intervals;
+        /* a few jobs per thread to even out busy and flat picture parts */
+        rs.nb_jobs       = FFMIN(rs.nb_intervals, 4 * s->avctx->thread_count);
+        rs.end_bits      = get_bits_count(&s->gb);
+        s->avctx->execute2(s->avctx, decode_restart_intervals, &rs, NULL,
+                           rs.nb_jobs);
+        skip_bits_long(&s->gb, rs.end_bits - get_bits_count(&s->gb));
+        s->restart_count = 0;
+        return rs.error;
+    }
+
     for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
         for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
             const int copy_mb = mb_bitmask && !get_bits1(&mb_bitmask_gb);
@@ -1023,7 +1240,7 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
                                              linesize[c], s->avctx->lowres);
                         else {
                             s->dsp.clear_block(s->block);
-                            if (decode_block(s, s->block, i,
+                            if (decode_block(s, &s->gb, s->block, &s->last_dc[i],
                                              s->dc_index[i], s->ac_index[i],
                                              s->quant_matrixes[s->quant_index[c]]) < 0) {
                                 av_log(s->avctx, AV_LOG_ERROR,
@@ -1521,7 +1738,11 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
     if (start_code == SOS && !s->ls) {
         const uint8_t *src = *buf_ptr;
         uint8_t *dst = s->buffer;
+        /* the RSTn positions are only needed to decode in slices */
+        int find_restarts = s->avctx->active_thread_type & FF_THREAD_SLICE;
 
+        s->nb_restart_pos  = find_restarts ? 0 : -1;
+        s->scan_end_marker = -1;
         while (src < buf_end) {
             uint8_t x = *(src++);
 
@@ -1531,10 +1752,21 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
                     while (src < buf_end && x == 0xff)
                         x = *(src++);
 
-                    if (x >= 0xd0 && x <= 0xd7)
+                    if (x >= 0xd0 && x <= 0xd7) {
                         *(dst++) = x;
-                    else if (x)
+                        if (s->nb_restart_pos >= 0) {
+                            int *pos = av_fast_realloc(s->restart_pos, &s->restart_pos_size,
+                                                       (s->nb_restart_pos + 1) * sizeof(*pos));
+                            if (pos) {
+                                s->restart_pos = pos;
+                                s->restart_pos[s->nb_restart_pos++] = dst - s->buffer;
+                            } else
+                                s->nb_restart_pos = -1;
+                        }
+                    } else if (x) {
+                        s->scan_end_marker = x;
                         break;
+                    }
                 }
             }
         }
@@ -1551,6 +1783,8 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
         PutBitContext pb;
 
         s->cur_scan++;
+        s->nb_restart_pos  = -1;
+        s->scan_end_marker = -1;
 
         /* find marker */
         while (src + t < buf_end) {
@@ -1559,6 +1793,7 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
                 while ((src + t < buf_end) && x == 0xff)
                     x = src[t++];
                 if (x & 0x80) {
+                    s->scan_end_marker = x;
                     t -= 2;
                     break;
                 }
@@ -1721,6 +1956,11 @@ eoi_parser:
 
                 goto the_end;
             case SOS:
+                /* Nothing the next frame depends on changes after a scan
+                 * that is directly followed by EOI. Interlaced fields may
+                 * continue in the next packet. */
+                if (s->scan_end_marker == EOI && !s->interlaced)
+                    ff_thread_finish_setup(avctx);
                 if ((ret = ff_mjpeg_decode_sos(s, NULL, NULL)) < 0 &&
                     (avctx->err_recognition & AV_EF_EXPLODE))
                     return ret;
@@ -1825,12 +2065,13 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
     int i, j;
 
     if (s->picture_ptr && s->picture_ptr->data[0])
-        avctx->release_buffer(avctx, s->picture_ptr);
+        ff_thread_release_buffer(avctx, s->picture_ptr);
 
     av_free(s->buffer);
     av_free(s->qscale_table);
     av_freep(&s->ljpeg_buffer);
     s->ljpeg_buffer_size = 0;
+    av_freep(&s->restart_pos);
 
     for (i = 0; i < 3; i++) {
         for (j = 0; j < 4; j++)
@@ -1867,10 +2108,13 @@ AVCodec ff_mjpeg_decoder = {
     .init           = ff_mjpeg_decode_init,
     .close          = ff_mjpeg_decode_end,
     .decode         = ff_mjpeg_decode_frame,
-    .capabilities   = CODEC_CAP_DR1,
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS |
+                      CODEC_CAP_SLICE_THREADS,
     .max_lowres     = 3,
     .long_name      = NULL_IF_CONFIG_SMALL("MJPEG (Motion JPEG)"),
     .priv_class     = &mjpegdec_class,
+    .init_thread_copy      = ONLY_IF_THREADS_ENABLED(ff_mjpeg_decode_init_thread_copy),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(ff_mjpeg_decode_update_thread_context),
 };
 #endif
 #if CONFIG_THP_DECODER
@@ -1882,8 +2126,10 @@ AVCodec ff_thp_decoder = {
     .init           = ff_mjpeg_decode_init,
     .close          = ff_mjpeg_decode_end,
     .decode         = ff_mjpeg_decode_frame,
-    .capabilities   = CODEC_CAP_DR1,
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS,
     .max_lowres     = 3,
     .long_name      = NULL_IF_CONFIG_SMALL("Nintendo Gamecube THP video"),
+    .init_thread_copy      = ONLY_IF_THREADS_ENABLED(ff_mjpeg_decode_init_thread_copy),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(ff_mjpeg_decode_update_thread_context),
 };
 #endif
@@ -48,6 +48,10 @@ typedef struct MJpegDecodeContext {
 
     int16_t quant_matrixes[4][64];
     VLC vlcs[3][4];
+    /* tables the VLCs are built from, to rebuild them in other threads */
+    uint8_t huff_bits[2][4][17];
+    uint8_t huff_vals[2][4][256];
+    int huff_nb_codes[2][4];
     int qscale[4];      ///< quantizer scale calculated from quant_matrixes
 
     int org_height;  /* size given at codec init */
@@ -100,6 +104,10 @@ typedef struct MJpegDecodeContext {
 
     int restart_interval;
     int restart_count;
+    int *restart_pos;             ///< offsets of the data following each RSTn in the unescaped scan
+    unsigned int restart_pos_size;
+    int nb_restart_pos;           ///< number of RSTn in the unescaped scan, -1 if unknown
+    int scan_end_marker;          ///< marker following the unescaped scan, -1 if none
 
     int buggy_avid;
     int cs_itu601;
@@ -117,6 +125,9 @@ typedef struct MJpegDecodeContext {
 } MJpegDecodeContext;
 
 int ff_mjpeg_decode_init(AVCodecContext *avctx);
+int ff_mjpeg_decode_init_thread_copy(AVCodecContext *avctx);
+int ff_mjpeg_decode_update_thread_context(AVCodecContext *dst,
+                                          const AVCodecContext *src);
 int ff_mjpeg_decode_end(AVCodecContext *avctx);
 int ff_mjpeg_decode_frame(AVCodecContext *avctx,
                           void *data, int *data_size,
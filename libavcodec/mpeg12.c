@@ -1143,20 +1143,51 @@ static av_cold int mpeg_decode_init(AVCodecContext *avctx)
     return 0;
 }
 
+static av_cold int mpeg_decode_init_thread_copy(AVCodecContext *avctx)
+{
+    Mpeg1Context *s = avctx->priv_data;
+
+    s->mpeg_enc_ctx.avctx = avctx;
+
+    return 0;
+}
+
 static int mpeg_decode_update_thread_context(AVCodecContext *avctx, const AVCodecContext *avctx_from)
 {
     Mpeg1Context *ctx = avctx->priv_data, *ctx_from = avctx_from->priv_data;
     MpegEncContext *s = &ctx->mpeg_enc_ctx, *s1 = &ctx_from->mpeg_enc_ctx;
     int err;
 
-    if (avctx == avctx_from || !ctx_from->mpeg_enc_ctx_allocated || !s1->context_initialized)
+    if (avctx == avctx_from)
+        return 0;
+
+    avctx->codec_id = avctx_from->codec_id;
+
+    if (!ctx_from->mpeg_enc_ctx_allocated || !s1->context_initialized) {
+        /* no picture has been started yet (the input may begin in the
+         * middle of a GOP), pass on the headers parsed so far */
+        if (!s->context_initialized) {
+            memcpy(ctx, ctx_from, sizeof(Mpeg1Context));
+            s->avctx = avctx;
+        }
         return 0;
+    }
 
     err = ff_mpeg_update_thread_context(avctx, avctx_from);
     if (err) return err;
 
-    if (!ctx->mpeg_enc_ctx_allocated)
-        memcpy(s + 1, s1 + 1, sizeof(Mpeg1Context) - sizeof(MpegEncContext));
+    memcpy(s + 1, s1 + 1, sizeof(Mpeg1Context) - sizeof(MpegEncContext));
+
+    // sequence and GOP header info
+    s->codec_id             = s1->codec_id;
+    s->width                = s1->width;
+    s->height               = s1->height;
+    s->aspect_ratio_info    = s1->aspect_ratio_info;
+    s->frame_rate_index     = s1->frame_rate_index;
+    s->bit_rate             = s1->bit_rate;
+    s->closed_gop           = s1->closed_gop;
+    memcpy(s->intra_matrix, s1->intra_matrix,
+           (char *) (s1->chroma_inter_matrix + 64) - (char *) s1->intra_matrix);
 
     if (!(s->pict_type == AV_PICTURE_TYPE_B || s->low_delay))
         s->picture_number++;
@@ -1241,6 +1272,7 @@ static int mpeg_decode_postinit(AVCodecContext *avctx)
     Mpeg1Context *s1 = avctx->priv_data;
     MpegEncContext *s = &s1->mpeg_enc_ctx;
     uint8_t old_permutation[64];
+    int reinit = 1;
 
     if ((s1->mpeg_enc_ctx_allocated == 0) ||
         avctx->coded_width  != s->width   ||
@@ -1254,9 +1286,23 @@ static int mpeg_decode_postinit(AVCodecContext *avctx)
 
         if (s1->mpeg_enc_ctx_allocated) {
             ParseContext pc = s->parse_context;
-            s->parse_context.buffer = 0;
-            ff_MPV_common_end(s);
-            s->parse_context = pc;
+
+            /* the pictures are shared with the other threads and cannot
+             * be reallocated while they are decoding */
+            if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME)) {
+                if (avctx->coded_width  != s->width  || s1->save_width  != s->width  ||
+                    avctx->coded_height != s->height || s1->save_height != s->height ||
+                    s1->save_progressive_seq != s->progressive_sequence) {
+                    av_log_missing_feature(avctx,
+                                           "Frame size changing with frame threads is", 0);
+                    return AVERROR_PATCHWELCOME;
+                }
+                reinit = 0;
+            } else {
+                s->parse_context.buffer = 0;
+                ff_MPV_common_end(s);
+                s->parse_context = pc;
+            }
         }
 
         if ((s->width == 0) || (s->height == 0))
@@ -1328,19 +1374,21 @@ static int mpeg_decode_postinit(AVCodecContext *avctx)
             if (avctx->idct_algo == FF_IDCT_AUTO)
                 avctx->idct_algo = FF_IDCT_SIMPLE;
 
-        /* Quantization matrices may need reordering
-         * if DCT permutation is changed. */
-        memcpy(old_permutation, s->dsp.idct_permutation, 64 * sizeof(uint8_t));
+        if (reinit) {
+            /* Quantization matrices may need reordering
+             * if DCT permutation is changed. */
+            memcpy(old_permutation, s->dsp.idct_permutation, 64 * sizeof(uint8_t));
 
-        if (ff_MPV_common_init(s) < 0)
-            return -2;
+            if (ff_MPV_common_init(s) < 0)
+                return -2;
 
-        quant_matrix_rebuild(s->intra_matrix,        old_permutation, s->dsp.idct_permutation);
-        quant_matrix_rebuild(s->inter_matrix,        old_permutation, s->dsp.idct_permutation);
-        quant_matrix_rebuild(s->chroma_intra_matrix, old_permutation, s->dsp.idct_permutation);
-        quant_matrix_rebuild(s->chroma_inter_matrix, old_permutation, s->dsp.idct_permutation);
+            quant_matrix_rebuild(s->intra_matrix,        old_permutation, s->dsp.idct_permutation);
+            quant_matrix_rebuild(s->inter_matrix,        old_permutation, s->dsp.idct_permutation);
+            quant_matrix_rebuild(s->chroma_intra_matrix, old_permutation, s->dsp.idct_permutation);
+            quant_matrix_rebuild(s->chroma_inter_matrix, old_permutation, s->dsp.idct_permutation);
 
-        s1->mpeg_enc_ctx_allocated = 1;
+            s1->mpeg_enc_ctx_allocated = 1;
+        }
     }
     return 0;
 }
@@ -1599,9 +1647,6 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
         }
 
         *s->current_picture_ptr->f.pan_scan = s1->pan_scan;
-
-        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME))
-            ff_thread_finish_setup(avctx);
     } else { // second field
         int i;
 
@@ -1624,6 +1669,12 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
         }
     }
 
+    /* both fields of a field picture are decoded by the same thread,
+     * the next one may only start with the following picture */
+    if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME) &&
+        !s->first_field)
+        ff_thread_finish_setup(avctx);
+
     if (avctx->hwaccel) {
         if (avctx->hwaccel->start_frame(avctx, buf, buf_size) < 0)
             return -1;
@@ -1784,7 +1835,9 @@ static int mpeg_decode_slice(MpegEncContext *s, int mb_y,
             const int mb_size = 16 >> s->avctx->lowres;
 
             ff_draw_horiz_band(s, mb_size*(s->mb_y >> field_pic), mb_size);
-            ff_MPV_report_decode_progress(s);
+            /* the rows of a field picture are complete with the second field */
+            if (!field_pic || !s->first_field)
+                ff_MPV_report_decode_progress(s);
 
             s->mb_x = 0;
             s->mb_y += 1 << field_pic;
@@ -2554,6 +2607,7 @@ static void flush(AVCodecContext *avctx)
     Mpeg1Context *s = avctx->priv_data;
 
     s->sync=0;
+    s->mpeg_enc_ctx.first_field = 0;
 
     ff_mpeg_flush(avctx);
 }
@@ -2590,10 +2644,11 @@ AVCodec ff_mpeg1video_decoder = {
     .decode                = mpeg_decode_frame,
     .capabilities          = CODEC_CAP_DRAW_HORIZ_BAND | CODEC_CAP_DR1 |
                              CODEC_CAP_TRUNCATED | CODEC_CAP_DELAY |
-                             CODEC_CAP_SLICE_THREADS,
+                             CODEC_CAP_SLICE_THREADS | CODEC_CAP_FRAME_THREADS,
     .flush                 = flush,
     .max_lowres            = 3,
     .long_name             = NULL_IF_CONFIG_SMALL("MPEG-1 video"),
+    .init_thread_copy      = ONLY_IF_THREADS_ENABLED(mpeg_decode_init_thread_copy),
     .update_thread_context = ONLY_IF_THREADS_ENABLED(mpeg_decode_update_thread_context)
 };
 
@@ -2607,11 +2662,13 @@ AVCodec ff_mpeg2video_decoder = {
     .decode         = mpeg_decode_frame,
     .capabilities   = CODEC_CAP_DRAW_HORIZ_BAND | CODEC_CAP_DR1 |
                       CODEC_CAP_TRUNCATED | CODEC_CAP_DELAY |
-                      CODEC_CAP_SLICE_THREADS,
+                      CODEC_CAP_SLICE_THREADS | CODEC_CAP_FRAME_THREADS,
     .flush          = flush,
     .max_lowres     = 3,
     .long_name      = NULL_IF_CONFIG_SMALL("MPEG-2 video"),
     .profiles       = NULL_IF_CONFIG_SMALL(mpeg2_video_profiles),
+    .init_thread_copy      = ONLY_IF_THREADS_ENABLED(mpeg_decode_init_thread_copy),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(mpeg_decode_update_thread_context)
 };
 
 //legacy decoder
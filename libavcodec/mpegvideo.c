@@ -2576,7 +2576,17 @@ void ff_draw_horiz_band(MpegEncContext *s, int y, int h){
         int offset[AV_NUM_DATA_POINTERS];
         int i;
 
-        if(s->pict_type==AV_PICTURE_TYPE_B || s->low_delay || (s->avctx->slice_flags&SLICE_FLAG_CODED_ORDER))
+        if (s->codec_id == AV_CODEC_ID_H264 &&
+            !(s->avctx->codec->capabilities & CODEC_CAP_HWACCEL_VDPAU)) {
+            /* the output order of H.264 pictures is only known after
+             * reordering, so rows are only drawn as they are decoded if
+             * the pictures are output in that order, i.e. if no picture
+             * is delayed (low_delay can be set with a nonzero has_b_frames
+             * coming from the container) */
+            if (s->avctx->has_b_frames && !(s->avctx->slice_flags & SLICE_FLAG_CODED_ORDER))
+                return;
+            src = &s->current_picture_ptr->f;
+        } else if(s->pict_type==AV_PICTURE_TYPE_B || s->low_delay || (s->avctx->slice_flags&SLICE_FLAG_CODED_ORDER))
             src = &s->current_picture_ptr->f;
         else if(s->last_picture_ptr)
             src = &s->last_picture_ptr->f;
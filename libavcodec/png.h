@@ -66,4 +66,6 @@ int ff_png_pass_row_size(int pass, int bits_per_pixel, int width);
 
 void ff_add_png_paeth_prediction(uint8_t *dst, uint8_t *src, uint8_t *top, int w, int bpp);
 
+void ff_sub_png_paeth_prediction(uint8_t *dst, uint8_t *src, uint8_t *top, int w, int bpp);
+
 #endif /* AVCODEC_PNG_H */
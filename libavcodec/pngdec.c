@@ -26,6 +26,7 @@
 #include "bytestream.h"
 #include "png.h"
 #include "pngdsp.h"
+#include "thread.h"
 
 /* TODO:
  * - add 16 bit depth support
@@ -41,6 +42,7 @@ typedef struct PNGDecContext {
     GetByteContext gb;
     AVFrame picture1, picture2;
     AVFrame *current_picture, *last_picture;
+    AVFrame prev_picture;   ///< frame threading: previous frame, owned by another thread
 
     int state;
     int width, height;
@@ -154,33 +156,6 @@ static void png_put_interlaced_row(uint8_t *dst, int width,
     }
 }
 
-void ff_add_png_paeth_prediction(uint8_t *dst, uint8_t *src, uint8_t *top, int w, int bpp)
-{
-    int i;
-    for(i = 0; i < w; i++) {
-        int a, b, c, p, pa, pb, pc;
-
-        a = dst[i - bpp];
-        b = top[i];
-        c = top[i - bpp];
-
-        p = b - c;
-        pc = a - c;
-
-        pa = abs(p);
-        pb = abs(pc);
-        pc = abs(p + pc);
-
-        if (pa <= pb && pa <= pc)
-            p = a;
-        else if (pb <= pc)
-            p = b;
-        else
-            p = c;
-        dst[i] = p + src[i];
-    }
-}
-
 #define UNROLL1(bpp, op) {\
                  r = dst[0];\
     if(bpp >= 2) g = dst[1];\
@@ -398,7 +373,9 @@ static int decode_frame(AVCodecContext *avctx,
     int64_t sig;
     int ret;
 
-    FFSWAP(AVFrame *, s->current_picture, s->last_picture);
+    /* with frame threading, last_picture is set by update_thread_context() */
+    if (!(avctx->active_thread_type & FF_THREAD_FRAME))
+        FFSWAP(AVFrame *, s->current_picture, s->last_picture);
     avctx->coded_frame= s->current_picture;
     p = s->current_picture;
 
@@ -511,13 +488,14 @@ static int decode_frame(AVCodecContext *avctx,
                     goto fail;
                 }
                 if(p->data[0])
-                    avctx->release_buffer(avctx, p);
+                    ff_thread_release_buffer(avctx, p);
 
                 p->reference= 3;
-                if(avctx->get_buffer(avctx, p) < 0){
+                if(ff_thread_get_buffer(avctx, p) < 0){
                     av_log(avctx, AV_LOG_ERROR, "get_buffer() failed\n");
                     goto fail;
                 }
+                ff_thread_finish_setup(avctx);
                 p->pict_type= AV_PICTURE_TYPE_I;
                 p->key_frame= 1;
                 p->interlaced_frame = !!s->interlace_type;
@@ -686,6 +664,8 @@ static int decode_frame(AVCodecContext *avctx,
             uint8_t *pd = s->current_picture->data[0];
             uint8_t *pd_last = s->last_picture->data[0];
 
+            ff_thread_await_progress(s->last_picture, INT_MAX, 0);
+
             for(j=0; j < s->height; j++) {
                 for(i=0; i < s->width * s->bpp; i++) {
                     pd[i] += pd_last[i];
@@ -701,6 +681,8 @@ static int decode_frame(AVCodecContext *avctx,
 
     ret = bytestream2_tell(&s->gb);
  the_end:
+    if (p->data[0])
+        ff_thread_report_progress(p, INT_MAX, 0);
     inflateEnd(&s->zstream);
     av_free(crow_buf_base);
     s->crow_buf = NULL;
@@ -726,6 +708,34 @@ static av_cold int png_dec_init(AVCodecContext *avctx)
     return 0;
 }
 
+static av_cold int png_dec_init_thread_copy(AVCodecContext *avctx)
+{
+    PNGDecContext *s = avctx->priv_data;
+
+    s->current_picture = &s->picture1;
+    s->last_picture    = &s->prev_picture;
+    avctx->coded_frame = s->current_picture;
+
+    return 0;
+}
+
+static int update_thread_context(AVCodecContext *dst, const AVCodecContext *src)
+{
+    PNGDecContext *psrc = src->priv_data;
+    PNGDecContext *pdst = dst->priv_data;
+
+    if (dst == src)
+        return 0;
+
+    /* the pictures are not swapped with frame threading, delta frames are
+     * added to the frame of the previous thread */
+    pdst->current_picture = &pdst->picture1;
+    pdst->last_picture    = &pdst->prev_picture;
+    pdst->prev_picture    = *psrc->current_picture;
+
+    return 0;
+}
+
 static av_cold int png_dec_end(AVCodecContext *avctx)
 {
     PNGDecContext *s = avctx->priv_data;
@@ -739,13 +749,15 @@ static av_cold int png_dec_end(AVCodecContext *avctx)
 }
 
 AVCodec ff_png_decoder = {
-    .name           = "png",
-    .type           = AVMEDIA_TYPE_VIDEO,
-    .id             = AV_CODEC_ID_PNG,
-    .priv_data_size = sizeof(PNGDecContext),
-    .init           = png_dec_init,
-    .close          = png_dec_end,
-    .decode         = decode_frame,
-    .capabilities   = CODEC_CAP_DR1 /*| CODEC_CAP_DRAW_HORIZ_BAND*/,
-    .long_name      = NULL_IF_CONFIG_SMALL("PNG (Portable Network Graphics) image"),
+    .name                  = "png",
+    .type                  = AVMEDIA_TYPE_VIDEO,
+    .id                    = AV_CODEC_ID_PNG,
+    .priv_data_size        = sizeof(PNGDecContext),
+    .init                  = png_dec_init,
+    .close                 = png_dec_end,
+    .decode                = decode_frame,
+    .init_thread_copy      = ONLY_IF_THREADS_ENABLED(png_dec_init_thread_copy),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(update_thread_context),
+    .capabilities          = CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS /*| CODEC_CAP_DRAW_HORIZ_BAND*/,
+    .long_name             = NULL_IF_CONFIG_SMALL("PNG (Portable Network Graphics) image"),
 };
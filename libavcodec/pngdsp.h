@@ -32,6 +32,13 @@ typedef struct PNGDSPContext {
     /* this might write to dst[w] */
     void (*add_paeth_prediction)(uint8_t *dst, uint8_t *src,
                                  uint8_t *top, int w, int bpp);
+
+    /* encoder side: dst[i] = src[i] - prediction, with the left neighbour
+     * taken from src[i - bpp], dst must not overlap src */
+    void (*sub_paeth_prediction)(uint8_t *dst, uint8_t *src,
+                                 uint8_t *top, int w, int bpp);
+    void (*sub_avg_prediction)(uint8_t *dst, uint8_t *src,
+                               uint8_t *top, int w, int bpp);
 } PNGDSPContext;
 
 void ff_pngdsp_init(PNGDSPContext *dsp);
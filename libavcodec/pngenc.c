@@ -23,6 +23,7 @@
 #include "bytestream.h"
 #include "dsputil.h"
 #include "png.h"
+#include "pngdsp.h"
 
 #include "libavutil/avassert.h"
 
@@ -36,8 +37,23 @@
 
 #define IOBUF_SIZE 4096
 
+/* images with less filtered data per thread are compressed in one stream */
+#define MIN_BAND_SIZE (64 * 1024)
+
+typedef struct PNGBand {
+    int y_start, y_end;
+    uint8_t *scratch;               ///< rows tried by the mixed filter
+    unsigned int scratch_size;
+    uint8_t *buf;                   ///< compressed band
+    unsigned int buf_size;
+    int len;
+    uLong adler;
+    int ret;
+} PNGBand;
+
 typedef struct PNGEncContext {
     DSPContext dsp;
+    PNGDSPContext pngdsp;
 
     uint8_t *bytestream;
     uint8_t *bytestream_start;
@@ -48,6 +64,16 @@ typedef struct PNGEncContext {
 
     z_stream zstream;
     uint8_t buf[IOBUF_SIZE];
+
+    /* slice threading */
+    int compression_level;
+    int row_size;
+    int bpp;
+    uint8_t *filtered;              ///< filter type byte and filtered row, for each row
+    unsigned int filtered_size;
+    PNGBand *bands;
+    int max_bands;
+    int nb_bands;
 } PNGEncContext;
 
 static void png_get_interlaced_row(uint8_t *dst, int row_size,
@@ -88,34 +114,7 @@ static void png_get_interlaced_row(uint8_t *dst, int row_size,
     }
 }
 
-static void sub_png_paeth_prediction(uint8_t *dst, uint8_t *src, uint8_t *top, int w, int bpp)
-{
-    int i;
-    for(i = 0; i < w; i++) {
-        int a, b, c, p, pa, pb, pc;
-
-        a = src[i - bpp];
-        b = top[i];
-        c = top[i - bpp];
-
-        p = b - c;
-        pc = a - c;
-
-        pa = abs(p);
-        pb = abs(pc);
-        pc = abs(p + pc);
-
-        if (pa <= pb && pa <= pc)
-            p = a;
-        else if (pb <= pc)
-            p = b;
-        else
-            p = c;
-        dst[i] = src[i] - p;
-    }
-}
-
-static void png_filter_row(DSPContext *dsp, uint8_t *dst, int filter_type,
+static void png_filter_row(PNGEncContext *s, uint8_t *dst, int filter_type,
                            uint8_t *src, uint8_t *top, int size, int bpp)
 {
     int i;
@@ -125,22 +124,21 @@ static void png_filter_row(DSPContext *dsp, uint8_t *dst, int filter_type,
         memcpy(dst, src, size);
         break;
     case PNG_FILTER_VALUE_SUB:
-        dsp->diff_bytes(dst, src, src-bpp, size);
+        s->dsp.diff_bytes(dst, src, src-bpp, size);
         memcpy(dst, src, bpp);
         break;
     case PNG_FILTER_VALUE_UP:
-        dsp->diff_bytes(dst, src, top, size);
+        s->dsp.diff_bytes(dst, src, top, size);
         break;
     case PNG_FILTER_VALUE_AVG:
         for(i = 0; i < bpp; i++)
             dst[i] = src[i] - (top[i] >> 1);
-        for(; i < size; i++)
-            dst[i] = src[i] - ((src[i-bpp] + top[i]) >> 1);
+        s->pngdsp.sub_avg_prediction(dst+i, src+i, top+i, size-i, bpp);
         break;
     case PNG_FILTER_VALUE_PAETH:
         for(i = 0; i < bpp; i++)
             dst[i] = src[i] - top[i];
-        sub_png_paeth_prediction(dst+i, src+i, top+i, size-i, bpp);
+        s->pngdsp.sub_paeth_prediction(dst+i, src+i, top+i, size-i, bpp);
         break;
     }
 }
@@ -157,7 +155,7 @@ static uint8_t *png_choose_filter(PNGEncContext *s, uint8_t *dst,
         int cost, bcost = INT_MAX;
         uint8_t *buf1 = dst, *buf2 = dst + size + 16;
         for(pred=0; pred<5; pred++) {
-            png_filter_row(&s->dsp, buf1+1, pred, src, top, size, bpp);
+            png_filter_row(s, buf1+1, pred, src, top, size, bpp);
             buf1[0] = pred;
             cost = 0;
             for(i=0; i<=size; i++)
@@ -169,7 +167,7 @@ static uint8_t *png_choose_filter(PNGEncContext *s, uint8_t *dst,
         }
         return buf2;
     } else {
-        png_filter_row(&s->dsp, dst+1, pred, src, top, size, bpp);
+        png_filter_row(s, dst+1, pred, src, top, size, bpp);
         dst[0] = pred;
         return dst;
     }
@@ -215,6 +213,133 @@ static int png_write_row(PNGEncContext *s, const uint8_t *data, int size)
     return 0;
 }
 
+static int png_filter_band(AVCodecContext *avctx, void *arg,
+                           int jobnr, int threadnr)
+{
+    PNGEncContext *s = avctx->priv_data;
+    PNGBand *band    = &s->bands[jobnr];
+    AVFrame *p       = &s->picture;
+    int y;
+
+    for (y = band->y_start; y < band->y_end; y++) {
+        uint8_t *dst = s->filtered + y * (s->row_size + 1);
+        uint8_t *src = p->data[0] + y * p->linesize[0];
+        uint8_t *top = y ? src - p->linesize[0] : NULL;
+        uint8_t *crow;
+
+        if (s->filter_type == PNG_FILTER_VALUE_MIXED) {
+            crow = png_choose_filter(s, band->scratch, src, top, s->row_size, s->bpp);
+            memcpy(dst, crow, s->row_size + 1);
+        } else
+            png_choose_filter(s, dst, src, top, s->row_size, s->bpp);
+    }
+    return 0;
+}
+
+/**
+ * Compress one band of filtered rows as a raw deflate stream. All bands but
+ * the last end with a sync flush, so that the streams concatenate to a
+ * single zlib stream. The window of the preceding band is preset as
+ * dictionary to keep the matches across band boundaries.
+ * The deflate output thus depends on the number of bands, only the decoded
+ * image is the same for all thread counts.
+ */
+static int png_deflate_band(AVCodecContext *avctx, void *arg,
+                            int jobnr, int threadnr)
+{
+    PNGEncContext *s = avctx->priv_data;
+    PNGBand *band    = &s->bands[jobnr];
+    int last         = jobnr == s->nb_bands - 1;
+    int offset       = jobnr ? 0 : 2; // zlib header
+    uint8_t *data    = s->filtered + band->y_start * (s->row_size + 1);
+    int size         = (band->y_end - band->y_start) * (s->row_size + 1);
+    z_stream zstream;
+    int ret;
+
+    band->ret = -1;
+    zstream.zalloc = ff_png_zalloc;
+    zstream.zfree  = ff_png_zfree;
+    zstream.opaque = NULL;
+    if (deflateInit2(&zstream, s->compression_level,
+                     Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return -1;
+    if (jobnr) {
+        int dict_size = FFMIN(data - s->filtered, 32768);
+        deflateSetDictionary(&zstream, data - dict_size, dict_size);
+    }
+
+    zstream.next_in   = data;
+    zstream.avail_in  = size;
+    zstream.next_out  = band->buf + offset;
+    zstream.avail_out = band->buf_size - offset - 4; // adler32
+    ret = deflate(&zstream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    if (ret == (last ? Z_STREAM_END : Z_OK) &&
+        !zstream.avail_in && zstream.avail_out) {
+        band->len   = zstream.next_out - band->buf;
+        band->adler = adler32(adler32(0, Z_NULL, 0), data, size);
+        band->ret   = 0;
+    }
+    deflateEnd(&zstream);
+    return band->ret;
+}
+
+static int png_write_bands(AVCodecContext *avctx)
+{
+    PNGEncContext *s = avctx->priv_data;
+    int stride       = s->row_size + 1;
+    int i, y = 0;
+    uLong adler = 0;
+
+    av_fast_malloc(&s->filtered, &s->filtered_size, avctx->height * stride);
+    if (!s->filtered)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < s->nb_bands; i++) {
+        PNGBand *band = &s->bands[i];
+
+        band->y_start = y;
+        band->y_end   = y = (i + 1) * avctx->height / s->nb_bands;
+        if (s->filter_type == PNG_FILTER_VALUE_MIXED) {
+            av_fast_malloc(&band->scratch, &band->scratch_size,
+                           (s->row_size + 32) * 2);
+            if (!band->scratch)
+                return AVERROR(ENOMEM);
+        }
+        av_fast_malloc(&band->buf, &band->buf_size,
+                       deflateBound(&s->zstream, (band->y_end - band->y_start) * stride) + 16);
+        if (!band->buf)
+            return AVERROR(ENOMEM);
+    }
+
+    avctx->execute2(avctx, png_filter_band,  NULL, NULL, s->nb_bands);
+    avctx->execute2(avctx, png_deflate_band, NULL, NULL, s->nb_bands);
+
+    for (i = 0; i < s->nb_bands; i++) {
+        PNGBand *band = &s->bands[i];
+
+        if (band->ret < 0)
+            return -1;
+        if (!i) {
+            int level = s->compression_level == Z_DEFAULT_COMPRESSION ?
+                        6 : s->compression_level;
+            int level_flags = level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
+            int header = (Z_DEFLATED + (7 << 4)) << 8 | level_flags << 6;
+
+            AV_WB16(band->buf, header + 31 - header % 31);
+            adler = band->adler;
+        } else
+            adler = adler32_combine(adler, band->adler,
+                                    (band->y_end - band->y_start) * stride);
+        if (i == s->nb_bands - 1) {
+            AV_WB32(band->buf + band->len, adler);
+            band->len += 4;
+        }
+        if (s->bytestream_end - s->bytestream < band->len + 12)
+            return -1;
+        png_write_chunk(&s->bytestream, MKTAG('I', 'D', 'A', 'T'), band->buf, band->len);
+    }
+    return 0;
+}
+
 static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                         const AVFrame *pict, int *got_packet)
 {
@@ -292,11 +417,20 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                        Z_DEFLATED, 15, 8, Z_DEFAULT_STRATEGY);
     if (ret != Z_OK)
         return -1;
+    s->compression_level = compression_level;
+    s->row_size          = row_size;
+    s->bpp               = bits_per_pixel >> 3;
+
+    /* the bands are filtered and compressed by separate threads */
+    s->nb_bands = 1;
+    if (s->max_bands > 1 && !is_progressive)
+        s->nb_bands = FFMIN3(s->max_bands, avctx->height,
+                             avctx->height * (int64_t)(row_size + 1) / MIN_BAND_SIZE);
 
     enc_row_size    = deflateBound(&s->zstream, row_size);
     max_packet_size = avctx->height * (int64_t)(enc_row_size +
                                        ((enc_row_size + IOBUF_SIZE - 1) / IOBUF_SIZE) * 12)
-                      + FF_MIN_BUFFER_SIZE;
+                      + FF_MIN_BUFFER_SIZE + s->nb_bands * 32;
     if (max_packet_size > INT_MAX)
         return AVERROR(ENOMEM);
     if ((ret = ff_alloc_packet2(avctx, pkt, max_packet_size)) < 0)
@@ -386,6 +520,10 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                 }
             }
         }
+    } else if (s->nb_bands > 1) {
+        if (png_write_bands(avctx) < 0)
+            goto fail;
+        goto iend;
     } else {
         top = NULL;
         for(y = 0; y < avctx->height; y++) {
@@ -411,6 +549,7 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
             goto fail;
         }
     }
+ iend:
     png_write_chunk(&s->bytestream, MKTAG('I', 'E', 'N', 'D'), NULL, 0);
 
     pkt->size   = s->bytestream - s->bytestream_start;
@@ -435,11 +574,34 @@ static av_cold int png_enc_init(AVCodecContext *avctx){
     avcodec_get_frame_defaults(&s->picture);
     avctx->coded_frame= &s->picture;
     ff_dsputil_init(&s->dsp, avctx);
+    ff_pngdsp_init(&s->pngdsp);
 
     s->filter_type = av_clip(avctx->prediction_method, PNG_FILTER_VALUE_NONE, PNG_FILTER_VALUE_MIXED);
     if(avctx->pix_fmt == PIX_FMT_MONOBLACK)
         s->filter_type = PNG_FILTER_VALUE_NONE;
 
+    if (avctx->active_thread_type & FF_THREAD_SLICE && avctx->thread_count > 1) {
+        s->bands = av_mallocz(avctx->thread_count * sizeof(*s->bands));
+        if (!s->bands)
+            return AVERROR(ENOMEM);
+        s->max_bands = avctx->thread_count;
+    }
+
+    return 0;
+}
+
+static av_cold int png_enc_close(AVCodecContext *avctx)
+{
+    PNGEncContext *s = avctx->priv_data;
+    int i;
+
+    for (i = 0; i < s->max_bands; i++) {
+        av_freep(&s->bands[i].scratch);
+        av_freep(&s->bands[i].buf);
+    }
+    av_freep(&s->bands);
+    av_freep(&s->filtered);
+
     return 0;
 }
 
@@ -450,6 +612,8 @@ AVCodec ff_png_encoder = {
     .priv_data_size = sizeof(PNGEncContext),
     .init           = png_enc_init,
     .encode2        = encode_frame,
+    .close          = png_enc_close,
+    .capabilities   = CODEC_CAP_SLICE_THREADS,
     .pix_fmts       = (const enum PixelFormat[]){
         PIX_FMT_RGB24, PIX_FMT_RGBA,
         PIX_FMT_RGB48BE, PIX_FMT_RGBA64BE,
@@ -176,12 +176,15 @@ typedef struct ProresThreadData {
     struct TrellisNode *nodes;
 } ProresThreadData;
 
+typedef struct ProresRow {
+    uint8_t *buf;               ///< coded slices of the row, with their headers
+    unsigned int buf_size;
+    int size;                   ///< size of the coded row or a negative error code
+} ProresRow;
+
 typedef struct ProresContext {
     AVClass *class;
-    DECLARE_ALIGNED(16, DCTELEM, blocks)[MAX_PLANES][64 * 4 * MAX_MBS_PER_SLICE];
-    DECLARE_ALIGNED(16, uint16_t, emu_buf)[16*16];
     int16_t quants[MAX_STORED_Q][64];
-    int16_t custom_q[64];
     const uint8_t *quant_mat;
 
     ProresDSPContext dsp;
@@ -202,11 +205,13 @@ typedef struct ProresContext {
     int quant_sel;
 
     int frame_size_upper_bound;
+    int max_slice_size;
 
     int profile;
     const struct prores_profile *profile_info;
 
     int *slice_q;
+    ProresRow *rows;
 
     ProresThreadData *tdata;
 } ProresContext;
@@ -399,7 +404,7 @@ static int encode_slice_plane(ProresContext *ctx, PutBitContext *pb,
 static int encode_slice(AVCodecContext *avctx, const AVFrame *pic,
                         PutBitContext *pb,
                         int sizes[4], int x, int y, int quant,
-                        int mbs_per_slice)
+                        int mbs_per_slice, ProresThreadData *td)
 {
     ProresContext *ctx = avctx->priv_data;
     int i, xp, yp;
@@ -420,7 +425,7 @@ static int encode_slice(AVCodecContext *avctx, const AVFrame *pic,
     } else if (quant < MAX_STORED_Q) {
         qmat = ctx->quants[quant];
     } else {
-        qmat = ctx->custom_q;
+        qmat = td->custom_q;
         for (i = 0; i < 64; i++)
             qmat[i] = ctx->quant_mat[i] * quant;
     }
@@ -448,10 +453,10 @@ static int encode_slice(AVCodecContext *avctx, const AVFrame *pic,
 
         get_slice_data(ctx, src, linesize, xp, yp,
                        pwidth, avctx->height / ctx->pictures_per_frame,
-                       ctx->blocks[0], ctx->emu_buf,
+                       td->blocks[0], td->emu_buf,
                        mbs_per_slice, num_cblocks, is_chroma);
         sizes[i] = encode_slice_plane(ctx, pb, src, linesize,
-                                      mbs_per_slice, ctx->blocks[0],
+                                      mbs_per_slice, td->blocks[0],
                                       num_cblocks, plane_factor,
                                       qmat);
         total_size += sizes[i];
@@ -735,17 +740,69 @@ static int find_quant_thread(AVCodecContext *avctx, void *arg,
     return 0;
 }
 
+/**
+ * Code the slices of a picture row into the row buffer, and store their
+ * sizes in the seek table passed as arg.
+ */
+static int encode_row_thread(AVCodecContext *avctx, void *arg,
+                             int jobnr, int threadnr)
+{
+    ProresContext *ctx = avctx->priv_data;
+    ProresThreadData *td = ctx->tdata + threadnr;
+    ProresRow *row = ctx->rows + jobnr;
+    uint8_t *slice_sizes = (uint8_t*)arg + jobnr * ctx->slices_width * 2;
+    uint8_t *buf, *slice_hdr;
+    PutBitContext pb;
+    int slice_hdr_size = 2 + 2 * (ctx->num_planes - 1);
+    int mbs_per_slice = ctx->mbs_per_slice;
+    int x, y = jobnr, i, mb, q, slice_size;
+    int sizes[4] = { 0 };
+
+    row->size = 0;
+    for (x = mb = 0; x < ctx->mb_width; x += mbs_per_slice, mb++) {
+        q = ctx->force_quant ? ctx->force_quant
+                             : ctx->slice_q[mb + y * ctx->slices_width];
+
+        while (ctx->mb_width - x < mbs_per_slice)
+            mbs_per_slice >>= 1;
+
+        buf = av_fast_realloc(row->buf, &row->buf_size,
+                              row->size + ctx->max_slice_size);
+        if (!buf) {
+            row->size = AVERROR(ENOMEM);
+            return row->size;
+        }
+        row->buf = buf;
+        buf     += row->size;
+
+        bytestream_put_byte(&buf, slice_hdr_size << 3);
+        slice_hdr = buf;
+        buf += slice_hdr_size - 1;
+        init_put_bits(&pb, buf, (ctx->max_slice_size - slice_hdr_size) * 8);
+        encode_slice(avctx, avctx->coded_frame, &pb, sizes, x, y, q,
+                     mbs_per_slice, td);
+
+        bytestream_put_byte(&slice_hdr, q);
+        slice_size = slice_hdr_size + sizes[ctx->num_planes - 1];
+        for (i = 0; i < ctx->num_planes - 1; i++) {
+            bytestream_put_be16(&slice_hdr, sizes[i]);
+            slice_size += sizes[i];
+        }
+        bytestream_put_be16(&slice_sizes, slice_size);
+        row->size += slice_size;
+    }
+
+    return 0;
+}
+
 static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                         const AVFrame *pic, int *got_packet)
 {
     ProresContext *ctx = avctx->priv_data;
-    uint8_t *orig_buf, *buf, *slice_hdr, *slice_sizes, *tmp;
+    uint8_t *orig_buf, *buf, *slice_sizes, *tmp;
     uint8_t *picture_size_pos;
-    PutBitContext pb;
-    int x, y, i, mb, q = 0;
-    int sizes[4] = { 0 };
-    int slice_hdr_size = 2 + 2 * (ctx->num_planes - 1);
-    int frame_size, picture_size, slice_size;
+    int y, i;
+    int frame_size, picture_size;
     int pkt_size, ret;
     uint8_t frame_flags;
 
@@ -819,30 +876,21 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                 return ret;
         }
 
+        ret = avctx->execute2(avctx, encode_row_thread, slice_sizes, NULL,
+                              ctx->mb_height);
+        if (ret)
+            return ret;
+
         for (y = 0; y < ctx->mb_height; y++) {
-            int mbs_per_slice = ctx->mbs_per_slice;
-            for (x = mb = 0; x < ctx->mb_width; x += mbs_per_slice, mb++) {
-                q = ctx->force_quant ? ctx->force_quant
-                                     : ctx->slice_q[mb + y * ctx->slices_width];
-
-                while (ctx->mb_width - x < mbs_per_slice)
-                    mbs_per_slice >>= 1;
-
-                bytestream_put_byte(&buf, slice_hdr_size << 3);
-                slice_hdr = buf;
-                buf += slice_hdr_size - 1;
-                init_put_bits(&pb, buf, (pkt_size - (buf - orig_buf)) * 8);
-                encode_slice(avctx, pic, &pb, sizes, x, y, q, mbs_per_slice);
-
-                bytestream_put_byte(&slice_hdr, q);
-                slice_size = slice_hdr_size + sizes[ctx->num_planes - 1];
-                for (i = 0; i < ctx->num_planes - 1; i++) {
-                    bytestream_put_be16(&slice_hdr, sizes[i]);
-                    slice_size += sizes[i];
-                }
-                bytestream_put_be16(&slice_sizes, slice_size);
-                buf += slice_size - slice_hdr_size;
+            ProresRow *row = ctx->rows + y;
+
+            if (row->size < 0)
+                return row->size;
+            if (row->size > pkt->data + pkt_size - buf) {
+                av_log(avctx, AV_LOG_ERROR, "frame does not fit into its upper bound\n");
+                return AVERROR_BUFFER_TOO_SMALL;
             }
+            bytestream_put_buffer(&buf, row->buf, row->size);
         }
 
         picture_size = buf - (picture_size_pos - 1);
@@ -874,6 +922,12 @@ static av_cold int encode_close(AVCodecContext *avctx)
     av_freep(&ctx->tdata);
     av_freep(&ctx->slice_q);
 
+    if (ctx->rows) {
+        for (i = 0; i < ctx->mb_height; i++)
+            av_free(ctx->rows[i].buf);
+    }
+    av_freep(&ctx->rows);
+
     return 0;
 }
 
@@ -930,6 +984,13 @@ static av_cold int encode_init(AVCodecContext *avctx)
         return AVERROR_INVALIDDATA;
     }
 
+    ctx->tdata = av_mallocz(avctx->thread_count * sizeof(*ctx->tdata));
+    ctx->rows  = av_mallocz(ctx->mb_height * sizeof(*ctx->rows));
+    if (!ctx->tdata || !ctx->rows) {
+        encode_close(avctx);
+        return AVERROR(ENOMEM);
+    }
+
     ctx->force_quant = avctx->global_quality / FF_QP2LAMBDA;
     if (!ctx->force_quant) {
         if (!ctx->bits_per_mb) {
@@ -956,12 +1017,6 @@ static av_cold int encode_init(AVCodecContext *avctx)
             return AVERROR(ENOMEM);
         }
 
-        ctx->tdata = av_mallocz(avctx->thread_count * sizeof(*ctx->tdata));
-        if (!ctx->tdata) {
-            encode_close(avctx);
-            return AVERROR(ENOMEM);
-        }
-
         for (j = 0; j < avctx->thread_count; j++) {
             ctx->tdata[j].nodes = av_malloc((ctx->slices_width + 1)
                                             * TRELLIS_WIDTH
@@ -1002,6 +1057,13 @@ static av_cold int encode_init(AVCodecContext *avctx)
                                    (mps * ctx->bits_per_mb) / 8)
                                   + 200;
 
+    /* A coefficient is coded with at most 67 bits, a level code of up to
+     * 36 bits and a run code of up to 31 bits, and each plane is padded
+     * to a whole byte. */
+    ctx->max_slice_size = 2 + 2 * ctx->num_planes + ctx->num_planes +
+                          mps * (4 + 2 * (ctx->chroma_factor == CFACTOR_Y444 ? 4 : 2)) *
+                          64 * 9;
+
     avctx->codec_tag   = ctx->profile_info->tag;
 
     av_log(avctx, AV_LOG_DEBUG,
@@ -67,6 +67,8 @@ typedef int (action_func)(AVCodecContext *c, void *arg);
 typedef int (action_func2)(AVCodecContext *c, void *arg, int jobnr, int threadnr);
 
 typedef struct ThreadContext {
+    AVCodecContext *avctx;
+    int thread_count;
     pthread_t *workers;
     action_func *func;
     action_func2 *func2;
@@ -134,6 +136,8 @@ typedef struct PerThreadContext {
     volatile uint8_t progress_used[MAX_BUFFERS];
 
     AVFrame *requested_frame;       ///< AVFrame the codec passed to get_buffer()
+
+    ThreadContext *slice;           ///< Slice threads started by ff_thread_get_slice_count().
 } PerThreadContext;
 
 /**
@@ -201,10 +205,10 @@ int ff_get_logical_cpus(AVCodecContext *avctx)
 
 static void* attribute_align_arg worker(void *v)
 {
-    AVCodecContext *avctx = v;
-    ThreadContext *c = avctx->thread_opaque;
+    ThreadContext *c = v;
+    AVCodecContext *avctx = c->avctx;
     int our_job = c->job_count;
-    int thread_count = avctx->thread_count;
+    int thread_count = c->thread_count;
     int self_id;
 
     pthread_mutex_lock(&c->current_job_lock);
@@ -238,9 +242,8 @@ static av_always_inline void avcodec_thread_park_workers(ThreadContext *c, int t
     pthread_mutex_unlock(&c->current_job_lock);
 }
 
-static void thread_free(AVCodecContext *avctx)
+static void slice_threads_free(ThreadContext *c)
 {
-    ThreadContext *c = avctx->thread_opaque;
     int i;
 
     pthread_mutex_lock(&c->current_job_lock);
@@ -248,22 +251,41 @@ static void thread_free(AVCodecContext *avctx)
     pthread_cond_broadcast(&c->current_job_cond);
     pthread_mutex_unlock(&c->current_job_lock);
 
-    for (i=0; i<avctx->thread_count; i++)
+    for (i=0; i<c->thread_count; i++)
          pthread_join(c->workers[i], NULL);
 
     pthread_mutex_destroy(&c->current_job_lock);
     pthread_cond_destroy(&c->current_job_cond);
     pthread_cond_destroy(&c->last_job_cond);
     av_free(c->workers);
-    av_freep(&avctx->thread_opaque);
+    av_free(c);
+}
+
+static void thread_free(AVCodecContext *avctx)
+{
+    slice_threads_free(avctx->thread_opaque);
+    avctx->thread_opaque = NULL;
+}
+
+/**
+ * Get the slice threads running the jobs of avctx->execute(), which are
+ * those of the frame thread for frame threading.
+ */
+static ThreadContext *get_slice_threads(AVCodecContext *avctx)
+{
+    if (avctx->active_thread_type&FF_THREAD_FRAME) {
+        PerThreadContext *p = avctx->thread_opaque;
+        return p ? p->slice : NULL;
+    }
+    return avctx->active_thread_type&FF_THREAD_SLICE ? avctx->thread_opaque : NULL;
 }
 
 static int avcodec_thread_execute(AVCodecContext *avctx, action_func* func, void *arg, int *ret, int job_count, int job_size)
 {
-    ThreadContext *c= avctx->thread_opaque;
+    ThreadContext *c = get_slice_threads(avctx);
     int dummy_ret;
 
-    if (!(avctx->active_thread_type&FF_THREAD_SLICE) || avctx->thread_count <= 1)
+    if (!c || c->thread_count <= 1)
         return avcodec_default_execute(avctx, func, arg, ret, job_count, job_size);
 
     if (job_count <= 0)
@@ -271,7 +293,7 @@ static int avcodec_thread_execute(AVCodecContext *avctx, action_func* func, void
 
     pthread_mutex_lock(&c->current_job_lock);
 
-    c->current_job = avctx->thread_count;
+    c->current_job = c->thread_count;
     c->job_count = job_count;
     c->job_size = job_size;
     c->args = arg;
@@ -285,49 +307,42 @@ static int avcodec_thread_execute(AVCodecContext *avctx, action_func* func, void
     }
     pthread_cond_broadcast(&c->current_job_cond);
 
-    avcodec_thread_park_workers(c, avctx->thread_count);
+    avcodec_thread_park_workers(c, c->thread_count);
 
     return 0;
 }
 
 static int avcodec_thread_execute2(AVCodecContext *avctx, action_func2* func2, void *arg, int *ret, int job_count)
 {
-    ThreadContext *c= avctx->thread_opaque;
+    ThreadContext *c = get_slice_threads(avctx);
+
+    if (!c || c->thread_count <= 1)
+        return avcodec_default_execute2(avctx, func2, arg, ret, job_count);
+
     c->func2 = func2;
     return avcodec_thread_execute(avctx, NULL, arg, ret, job_count, 0);
 }
 
-static int thread_init(AVCodecContext *avctx)
+/**
+ * Start thread_count threads running the jobs of execute() for avctx.
+ */
+static ThreadContext *slice_threads_init(AVCodecContext *avctx, int thread_count)
 {
     int i;
     ThreadContext *c;
-    int thread_count = avctx->thread_count;
-
-    if (!thread_count) {
-        int nb_cpus = ff_get_logical_cpus(avctx);
-        // use number of cores + 1 as thread count if there is more than one
-        if (nb_cpus > 1)
-            thread_count = avctx->thread_count = FFMIN(nb_cpus + 1, MAX_AUTO_THREADS);
-        else
-            thread_count = avctx->thread_count = 1;
-    }
-
-    if (thread_count <= 1) {
-        avctx->active_thread_type = 0;
-        return 0;
-    }
 
     c = av_mallocz(sizeof(ThreadContext));
     if (!c)
-        return -1;
+        return NULL;
 
     c->workers = av_mallocz(sizeof(pthread_t)*thread_count);
     if (!c->workers) {
         av_free(c);
-        return -1;
+        return NULL;
     }
 
-    avctx->thread_opaque = c;
+    c->avctx = avctx;
+    c->thread_count = thread_count;
     c->current_job = 0;
     c->job_count = 0;
     c->job_size = 0;
@@ -337,16 +352,41 @@ static int thread_init(AVCodecContext *avctx)
     pthread_mutex_init(&c->current_job_lock, NULL);
     pthread_mutex_lock(&c->current_job_lock);
     for (i=0; i<thread_count; i++) {
-        if(pthread_create(&c->workers[i], NULL, worker, avctx)) {
-           avctx->thread_count = i;
+        if(pthread_create(&c->workers[i], NULL, worker, c)) {
+           c->thread_count = i;
            pthread_mutex_unlock(&c->current_job_lock);
-           ff_thread_free(avctx);
-           return -1;
+           slice_threads_free(c);
+           return NULL;
         }
     }
 
     avcodec_thread_park_workers(c, thread_count);
 
+    return c;
+}
+
+static int thread_init(AVCodecContext *avctx)
+{
+    int thread_count = avctx->thread_count;
+
+    if (!thread_count) {
+        int nb_cpus = ff_get_logical_cpus(avctx);
+        // use number of cores + 1 as thread count if there is more than one
+        if (nb_cpus > 1)
+            thread_count = avctx->thread_count = FFMIN(nb_cpus + 1, MAX_AUTO_THREADS);
+        else
+            thread_count = avctx->thread_count = 1;
+    }
+
+    if (thread_count <= 1) {
+        avctx->active_thread_type = 0;
+        return 0;
+    }
+
+    avctx->thread_opaque = slice_threads_init(avctx, thread_count);
+    if (!avctx->thread_opaque)
+        return -1;
+
     avctx->execute = avcodec_thread_execute;
     avctx->execute2 = avcodec_thread_execute2;
     return 0;
@@ -757,6 +797,10 @@ static void frame_thread_free(AVCodecContext *avctx, int thread_count)
             pthread_join(p->thread, NULL);
         p->thread_init=0;
 
+        if (p->slice)
+            slice_threads_free(p->slice);
+        p->slice = NULL;
+
         if (codec->close)
             codec->close(p->avctx);
 
@@ -940,6 +984,27 @@ int ff_thread_can_start_frame(AVCodecContext *avctx)
     return 1;
 }
 
+int ff_thread_get_slice_count(AVCodecContext *avctx, int max_threads)
+{
+    PerThreadContext *p;
+
+    if (avctx->active_thread_type&FF_THREAD_SLICE)
+        return avctx->thread_count;
+    if (!(avctx->active_thread_type&FF_THREAD_FRAME) ||
+        !(avctx->codec->capabilities & CODEC_CAP_SLICE_THREADS) ||
+        !(avctx->thread_type & FF_THREAD_SLICE) || max_threads <= 1)
+        return 1;
+
+    p = avctx->thread_opaque;
+    if (!p->slice) {
+        if (!(p->slice = slice_threads_init(avctx, FFMIN(max_threads, avctx->thread_count))))
+            return 1;
+        avctx->execute  = avcodec_thread_execute;
+        avctx->execute2 = avcodec_thread_execute2;
+    }
+    return p->slice->thread_count;
+}
+
 int ff_thread_get_buffer(AVCodecContext *avctx, AVFrame *f)
 {
     PerThreadContext *p = avctx->thread_opaque;
@@ -110,6 +110,24 @@ int ff_thread_get_buffer(AVCodecContext *avctx, AVFrame *f);
  */
 void ff_thread_release_buffer(AVCodecContext *avctx, AVFrame *f);
 
+/**
+ * Get the number of jobs of avctx->execute() and avctx->execute2() which
+ * run concurrently.
+ * With frame threading, codecs which also have the CODEC_CAP_SLICE_THREADS
+ * capability can run the jobs of a frame on slice threads of their own,
+ * which are started by the first call to this function in each frame
+ * thread, unless slice threading is disabled in avctx->thread_type.
+ * Since every frame thread starts its own pool, the codec should only ask
+ * for one when the user requested it, e.g. through a private option.
+ *
+ * @param avctx The current context.
+ * @param max_threads maximum number of slice threads to start in each frame
+ *                    thread, at most avctx->thread_count are started;
+ *                    0 or 1 to not start any
+ * @return the number of concurrent jobs, 1 if jobs run one after another
+ */
+int ff_thread_get_slice_count(AVCodecContext *avctx, int max_threads);
+
 int ff_thread_init(AVCodecContext *s);
 void ff_thread_free(AVCodecContext *s);
 
@@ -31,6 +31,7 @@
 #include <zlib.h>
 #endif
 #include "lzw.h"
+#include "thread.h"
 #include "tiff.h"
 #include "tiff_data.h"
 #include "faxcompr.h"
@@ -589,8 +590,8 @@ static int init_image(TiffContext *s)
         avcodec_set_dimensions(s->avctx, s->width, s->height);
     }
     if (s->picture.data[0])
-        s->avctx->release_buffer(s->avctx, &s->picture);
-    if ((ret = s->avctx->get_buffer(s->avctx, &s->picture)) < 0) {
+        ff_thread_release_buffer(s->avctx, &s->picture);
+    if ((ret = ff_thread_get_buffer(s->avctx, &s->picture)) < 0) {
         av_log(s->avctx, AV_LOG_ERROR, "get_buffer() failed\n");
         return ret;
     }
@@ -1155,6 +1156,17 @@ static av_cold int tiff_init(AVCodecContext *avctx)
     return 0;
 }
 
+static av_cold int tiff_init_thread_copy(AVCodecContext *avctx)
+{
+    TiffContext *s = avctx->priv_data;
+
+    s->avctx = avctx;
+    avctx->coded_frame = &s->picture;
+    ff_lzw_decode_open(&s->lzw);
+
+    return 0;
+}
+
 static av_cold int tiff_end(AVCodecContext *avctx)
 {
     TiffContext *const s = avctx->priv_data;
@@ -1170,13 +1182,14 @@ static av_cold int tiff_end(AVCodecContext *avctx)
 }
 
 AVCodec ff_tiff_decoder = {
-    .name           = "tiff",
-    .type           = AVMEDIA_TYPE_VIDEO,
-    .id             = AV_CODEC_ID_TIFF,
-    .priv_data_size = sizeof(TiffContext),
-    .init           = tiff_init,
-    .close          = tiff_end,
-    .decode         = decode_frame,
-    .capabilities   = CODEC_CAP_DR1,
-    .long_name      = NULL_IF_CONFIG_SMALL("TIFF image"),
+    .name             = "tiff",
+    .type             = AVMEDIA_TYPE_VIDEO,
+    .id               = AV_CODEC_ID_TIFF,
+    .priv_data_size   = sizeof(TiffContext),
+    .init             = tiff_init,
+    .close            = tiff_end,
+    .decode           = decode_frame,
+    .capabilities     = CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS,
+    .init_thread_copy = ONLY_IF_THREADS_ENABLED(tiff_init_thread_copy),
+    .long_name        = NULL_IF_CONFIG_SMALL("TIFF image"),
 };
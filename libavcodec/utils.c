@@ -355,12 +355,154 @@ int avcodec_fill_audio_frame(AVFrame *frame, int nb_channels,
     return ret;
 }
 
+/**
+ * Lay out the batch output frame over a buffer of capacity samples,
+ * keeping the samples already in it.
+ */
+static int batch_alloc(AVCodecContext *avctx, int capacity)
+{
+    AVCodecInternal *avci = avctx->internal;
+    AVFrame *out   = avci->batch_frame;
+    int channels   = avci->batch_channels;
+    int nb_planes  = av_sample_fmt_is_planar(out->format) ? channels : 1;
+    uint8_t *buf   = avci->batch_buf;
+    uint8_t **planes = avci->batch_planes;
+    int ch, ret, size;
+
+    size = av_samples_get_buffer_size(NULL, channels, capacity, out->format, 0);
+    if (size < 0)
+        return size;
+
+    /* the old buffer is reused as long as nothing has to be moved */
+    if (out->nb_samples || size > avci->batch_buf_size) {
+        if (!(buf = av_malloc(size)))
+            return AVERROR(ENOMEM);
+    } else {
+        /* use all of the old buffer, av_samples_fill_arrays() pads the
+         * sample count to a multiple of 32 */
+        int max = avci->batch_buf_size /
+                  (av_get_bytes_per_sample(out->format) * channels) & ~31;
+        if (av_samples_get_buffer_size(NULL, channels, max, out->format, 0) <=
+            avci->batch_buf_size)
+            capacity = FFMAX(capacity, max);
+    }
+    if (out->nb_samples || nb_planes > avci->batch_nb_planes) {
+        if (!(planes = av_mallocz(2 * nb_planes * sizeof(*planes)))) {
+            if (buf != avci->batch_buf)
+                av_free(buf);
+            return AVERROR(ENOMEM);
+        }
+    }
+
+    ret = av_samples_fill_arrays(planes, &out->linesize[0], buf, channels,
+                                 capacity, out->format, 0);
+    if (ret >= 0 && out->nb_samples)
+        av_samples_copy(planes, out->extended_data, 0, 0, out->nb_samples,
+                        channels, out->format);
+
+    if (buf != avci->batch_buf) {
+        av_free(avci->batch_buf);
+        avci->batch_buf      = buf;
+        avci->batch_buf_size = size;
+    }
+    if (planes != avci->batch_planes) {
+        av_free(avci->batch_planes);
+        avci->batch_planes    = planes;
+        avci->batch_nb_planes = nb_planes;
+    }
+    if (ret < 0)
+        return ret;
+
+    avci->batch_capacity = capacity;
+    out->extended_data   = planes;
+    for (ch = 0; ch < FFMIN(nb_planes, AV_NUM_DATA_POINTERS); ch++)
+        out->data[ch] = planes[ch];
+
+    return 0;
+}
+
+/**
+ * Make room for nb_samples more samples in the batch output frame,
+ * starting the batch with the given parameters if it is still empty.
+ *
+ * @return 0 on success, AVERROR(EINVAL) if the parameters differ from
+ *         those of the samples already in the batch
+ */
+static int batch_reserve(AVCodecContext *avctx, enum AVSampleFormat sample_fmt,
+                         int channels, int nb_samples)
+{
+    AVCodecInternal *avci = avctx->internal;
+    AVFrame *out = avci->batch_frame;
+    int needed;
+
+    if (nb_samples <= 0)
+        return AVERROR(EINVAL);
+    if (out->format == AV_SAMPLE_FMT_NONE) {
+        out->format          = sample_fmt;
+        avci->batch_channels = channels;
+        avci->batch_capacity = 0;
+        if (nb_samples > INT_MAX / FFMAX(avci->batch_pkts_left, 1))
+            return AVERROR(EINVAL);
+        return batch_alloc(avctx, nb_samples * FFMAX(avci->batch_pkts_left, 1));
+    }
+    if (out->format != sample_fmt || avci->batch_channels != channels)
+        return AVERROR(EINVAL);
+
+    if (nb_samples > INT_MAX - out->nb_samples)
+        return AVERROR(EINVAL);
+    needed = out->nb_samples + nb_samples;
+    if (needed > avci->batch_capacity)
+        return batch_alloc(avctx, FFMAX(needed,
+                                        FFMIN(2LL * avci->batch_capacity, INT_MAX)));
+    return 0;
+}
+
+/**
+ * Point frame at the samples of the batch output frame following those
+ * already decoded.
+ */
+static int batch_get_buffer(AVCodecContext *avctx, AVFrame *frame)
+{
+    AVCodecInternal *avci = avctx->internal;
+    AVFrame *out = avci->batch_frame;
+    uint8_t **window;
+    int p, ret, nb_planes, offset;
+
+    if ((ret = batch_reserve(avctx, avctx->sample_fmt, avctx->channels,
+                             frame->nb_samples)) < 0)
+        return ret;
+
+    nb_planes = av_sample_fmt_is_planar(out->format) ? avci->batch_channels : 1;
+    offset    = out->nb_samples * av_get_bytes_per_sample(out->format) *
+                (nb_planes == 1 ? avci->batch_channels : 1);
+    window    = avci->batch_planes + avci->batch_nb_planes;
+    for (p = 0; p < nb_planes; p++)
+        window[p] = avci->batch_planes[p] + offset;
+
+    frame->extended_data = window;
+    for (p = 0; p < FFMIN(nb_planes, AV_NUM_DATA_POINTERS); p++)
+        frame->data[p] = window[p];
+    frame->linesize[0] = out->linesize[0] - offset;
+
+    frame->type = FF_BUFFER_TYPE_INTERNAL;
+    ff_init_buffer_info(avctx, frame);
+
+    return 0;
+}
+
 static int audio_get_buffer(AVCodecContext *avctx, AVFrame *frame)
 {
     AVCodecInternal *avci = avctx->internal;
     InternalBuffer *buf;
     int buf_size, ret;
 
+    /* decode into the batch buffer unless the parameters changed */
+    if (avci->batch_frame &&
+        (avci->batch_frame->format == AV_SAMPLE_FMT_NONE ||
+         (avci->batch_frame->format == avctx->sample_fmt &&
+          avci->batch_channels      == avctx->channels)))
+        return batch_get_buffer(avctx, frame);
+
     buf_size = av_samples_get_buffer_size(NULL, avctx->channels,
                                           frame->nb_samples, avctx->sample_fmt,
                                           0);
@@ -432,13 +574,132 @@ static int audio_get_buffer(AVCodecContext *avctx, AVFrame *frame)
     return 0;
 }
 
-static int video_get_buffer(AVCodecContext *s, AVFrame *pic)
+static AVBufferRef *alloc_gray_buffer(int size)
+{
+    AVBufferRef *ret = av_buffer_alloc(size);
+    if (ret)
+        memset(ret->data, 128, size);
+    return ret;
+}
+
+static void free_frame_pool(FramePool *pool)
 {
     int i;
-    int w= s->width;
-    int h= s->height;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(pool->pools); i++)
+        av_buffer_pool_uninit(&pool->pools[i]);
+}
+
+/**
+ * (Re)initialize the plane pools for the current frame parameters.
+ * Buffers from the previous pools stay valid until they are released.
+ */
+static int update_frame_pool(AVCodecContext *s)
+{
+    FramePool *pool = &s->internal->pool;
+    int w = s->width;
+    int h = s->height;
+    int emu_edge = !!(s->flags & CODEC_FLAG_EMU_EDGE);
+    int h_chroma_shift, v_chroma_shift;
+    int size[4] = {0};
+    int tmpsize;
+    int unaligned;
+    int i;
+    AVPicture picture;
+    int stride_align[AV_NUM_DATA_POINTERS];
+    const int pixel_size = av_pix_fmt_descriptors[s->pix_fmt].comp[0].step_minus1+1;
+
+    if (pool->pools[0] && pool->width == w && pool->height == h &&
+        pool->pix_fmt == s->pix_fmt && pool->emu_edge == emu_edge)
+        return 0;
+
+    free_frame_pool(pool);
+
+    avcodec_get_chroma_sub_sample(s->pix_fmt, &h_chroma_shift, &v_chroma_shift);
+
+    avcodec_align_dimensions2(s, &w, &h, stride_align);
+
+    if (!emu_edge) {
+        w+= EDGE_WIDTH*2;
+        h+= EDGE_WIDTH*2;
+    }
+
+    do {
+        // NOTE: do not align linesizes individually, this breaks e.g. assumptions
+        // that linesize[0] == 2*linesize[1] in the MPEG-encoder for 4:2:2
+        av_image_fill_linesizes(picture.linesize, s->pix_fmt, w);
+        // increase alignment of w for next try (rhs gives the lowest bit set in w)
+        w += w & ~(w-1);
+
+        unaligned = 0;
+        for (i=0; i<4; i++){
+            unaligned |= picture.linesize[i] % stride_align[i];
+        }
+    } while (unaligned);
+
+    tmpsize = av_image_fill_pointers(picture.data, s->pix_fmt, h, NULL, picture.linesize);
+    if (tmpsize < 0)
+        return -1;
+
+    for (i=0; i<3 && picture.data[i+1]; i++)
+        size[i] = picture.data[i+1] - picture.data[i];
+    size[i] = tmpsize - (picture.data[i] - picture.data[0]);
+
+    for(i=0; i<4 && size[i]; i++){
+        const int h_shift= i==0 ? 0 : h_chroma_shift;
+        const int v_shift= i==0 ? 0 : v_chroma_shift;
+
+        pool->linesize[i] = picture.linesize[i];
+
+        pool->pools[i] = av_buffer_pool_init(size[i] + 16, alloc_gray_buffer); //FIXME 16
+        if (!pool->pools[i]) {
+            free_frame_pool(pool);
+            return AVERROR(ENOMEM);
+        }
+
+        // no edge if EDGE EMU or not planar YUV
+        if (emu_edge || !size[2])
+            pool->offset[i] = 0;
+        else
+            pool->offset[i] = FFALIGN((pool->linesize[i]*EDGE_WIDTH>>v_shift) + (pixel_size*EDGE_WIDTH>>h_shift), stride_align[i]);
+    }
+    for (; i < 4; i++) {
+        pool->linesize[i] = 0;
+        pool->offset[i]   = 0;
+    }
+    pool->width    = s->width;
+    pool->height   = s->height;
+    pool->pix_fmt  = s->pix_fmt;
+    pool->emu_edge = emu_edge;
+
+    return 0;
+}
+
+/**
+ * Give the frame access to the InternalBuffer planes.
+ */
+static void export_internal_buffer(AVCodecContext *s, AVFrame *pic,
+                                   InternalBuffer *buf)
+{
+    /* Decoders without DR1 may modify their output after returning it,
+     * so their buffers are not shared with the user. */
+    int share = !!(s->codec->capabilities & CODEC_CAP_DR1);
+    int i;
+
+    for (i = 0; i < AV_NUM_DATA_POINTERS; i++) {
+        pic->base[i]= buf->base[i];
+        pic->data[i]= buf->data[i];
+        pic->linesize[i]= buf->linesize[i];
+        pic->buf[i] = share ? buf->buf[i] : NULL;
+    }
+}
+
+static int video_get_buffer(AVCodecContext *s, AVFrame *pic)
+{
+    int i, ret;
     InternalBuffer *buf;
     AVCodecInternal *avci = s->internal;
+    FramePool *pool = &avci->pool;
 
     if(pic->data[0]!=NULL) {
         av_log(s, AV_LOG_ERROR, "pic->data[0]!=NULL in avcodec_default_get_buffer\n");
@@ -449,7 +710,7 @@ static int video_get_buffer(AVCodecContext *s, AVFrame *pic)
         return -1;
     }
 
-    if(av_image_check_size(w, h, 0, s) || s->pix_fmt<0) {
+    if(av_image_check_size(s->width, s->height, 0, s) || s->pix_fmt<0) {
         av_log(s, AV_LOG_ERROR, "video_get_buffer: image parameters invalid\n");
         return -1;
     }
@@ -457,93 +718,42 @@ static int video_get_buffer(AVCodecContext *s, AVFrame *pic)
     if (!avci->buffer) {
         avci->buffer = av_mallocz((INTERNAL_BUFFER_SIZE+1) *
                                   sizeof(InternalBuffer));
+        if (!avci->buffer)
+            return AVERROR(ENOMEM);
     }
 
-    buf = &avci->buffer[avci->buffer_count];
-
-    if(buf->base[0] && (buf->width != w || buf->height != h || buf->pix_fmt != s->pix_fmt)){
-        for (i = 0; i < AV_NUM_DATA_POINTERS; i++) {
-            av_freep(&buf->base[i]);
-            buf->data[i]= NULL;
-        }
-    }
-
-    if (!buf->base[0]) {
-        int h_chroma_shift, v_chroma_shift;
-        int size[4] = {0};
-        int tmpsize;
-        int unaligned;
-        AVPicture picture;
-        int stride_align[AV_NUM_DATA_POINTERS];
-        const int pixel_size = av_pix_fmt_descriptors[s->pix_fmt].comp[0].step_minus1+1;
-
-        avcodec_get_chroma_sub_sample(s->pix_fmt, &h_chroma_shift, &v_chroma_shift);
-
-        avcodec_align_dimensions2(s, &w, &h, stride_align);
+    if ((ret = update_frame_pool(s)) < 0)
+        return ret;
 
-        if(!(s->flags&CODEC_FLAG_EMU_EDGE)){
-            w+= EDGE_WIDTH*2;
-            h+= EDGE_WIDTH*2;
-        }
+    buf = &avci->buffer[avci->buffer_count];
 
-        do {
-            // NOTE: do not align linesizes individually, this breaks e.g. assumptions
-            // that linesize[0] == 2*linesize[1] in the MPEG-encoder for 4:2:2
-            av_image_fill_linesizes(picture.linesize, s->pix_fmt, w);
-            // increase alignment of w for next try (rhs gives the lowest bit set in w)
-            w += w & ~(w-1);
-
-            unaligned = 0;
-            for (i=0; i<4; i++){
-                unaligned |= picture.linesize[i] % stride_align[i];
+    for (i = 0; i < 4 && pool->pools[i]; i++) {
+        buf->buf[i] = av_buffer_pool_get(pool->pools[i]);
+        if (!buf->buf[i]) {
+            while (i--) {
+                av_buffer_unref(&buf->buf[i]);
+                buf->base[i] = buf->data[i] = NULL;
             }
-        } while (unaligned);
-
-        tmpsize = av_image_fill_pointers(picture.data, s->pix_fmt, h, NULL, picture.linesize);
-        if (tmpsize < 0)
-            return -1;
-
-        for (i=0; i<3 && picture.data[i+1]; i++)
-            size[i] = picture.data[i+1] - picture.data[i];
-        size[i] = tmpsize - (picture.data[i] - picture.data[0]);
-
-        memset(buf->base, 0, sizeof(buf->base));
-        memset(buf->data, 0, sizeof(buf->data));
-
-        for(i=0; i<4 && size[i]; i++){
-            const int h_shift= i==0 ? 0 : h_chroma_shift;
-            const int v_shift= i==0 ? 0 : v_chroma_shift;
-
-            buf->linesize[i]= picture.linesize[i];
-
-            buf->base[i]= av_malloc(size[i]+16); //FIXME 16
-            if(buf->base[i]==NULL)
-                return AVERROR(ENOMEM);
-            memset(buf->base[i], 128, size[i]);
-
-            // no edge if EDGE EMU or not planar YUV
-            if((s->flags&CODEC_FLAG_EMU_EDGE) || !size[2])
-                buf->data[i] = buf->base[i];
-            else
-                buf->data[i] = buf->base[i] + FFALIGN((buf->linesize[i]*EDGE_WIDTH>>v_shift) + (pixel_size*EDGE_WIDTH>>h_shift), stride_align[i]);
-        }
-        for (; i < AV_NUM_DATA_POINTERS; i++) {
-            buf->base[i] = buf->data[i] = NULL;
-            buf->linesize[i] = 0;
+            return AVERROR(ENOMEM);
         }
-        if(size[1] && !size[2])
-            ff_set_systematic_pal2((uint32_t*)buf->data[1], s->pix_fmt);
-        buf->width  = s->width;
-        buf->height = s->height;
-        buf->pix_fmt= s->pix_fmt;
+        buf->base[i]     = buf->buf[i]->data;
+        buf->data[i]     = buf->base[i] + pool->offset[i];
+        buf->linesize[i] = pool->linesize[i];
+    }
+    for (; i < AV_NUM_DATA_POINTERS; i++) {
+        buf->buf[i]  = NULL;
+        buf->base[i] = buf->data[i] = NULL;
+        buf->linesize[i] = 0;
     }
+    if(pool->pools[1] && !pool->pools[2])
+        ff_set_systematic_pal2((uint32_t*)buf->data[1], s->pix_fmt);
+    buf->width  = s->width;
+    buf->height = s->height;
+    buf->pix_fmt= s->pix_fmt;
+
     pic->type= FF_BUFFER_TYPE_INTERNAL;
 
-    for (i = 0; i < AV_NUM_DATA_POINTERS; i++) {
-        pic->base[i]= buf->base[i];
-        pic->data[i]= buf->data[i];
-        pic->linesize[i]= buf->linesize[i];
-    }
+    export_internal_buffer(s, pic, buf);
     pic->extended_data = pic->data;
     avci->buffer_count++;
     pic->width  = buf->width;
@@ -571,6 +781,17 @@ int avcodec_default_get_buffer(AVCodecContext *avctx, AVFrame *frame)
     }
 }
 
+static InternalBuffer *find_internal_buffer(AVCodecContext *s, AVFrame *pic)
+{
+    AVCodecInternal *avci = s->internal;
+    int i;
+
+    for (i = 0; i < avci->buffer_count; i++) //just 3-5 checks so is not worth to optimize
+        if (avci->buffer[i].data[0] == pic->data[0])
+            return &avci->buffer[i];
+    return NULL;
+}
+
 void avcodec_default_release_buffer(AVCodecContext *s, AVFrame *pic){
     int i;
     InternalBuffer *buf, *last;
@@ -582,13 +803,14 @@ void avcodec_default_release_buffer(AVCodecContext *s, AVFrame *pic){
     assert(avci->buffer_count);
 
     if (avci->buffer) {
-        buf = NULL; /* avoids warning */
-        for (i = 0; i < avci->buffer_count; i++) { //just 3-5 checks so is not worth to optimize
-            buf = &avci->buffer[i];
-            if (buf->data[0] == pic->data[0])
-                break;
+        buf = find_internal_buffer(s, pic);
+        av_assert0(buf);
+
+        for (i = 0; i < AV_NUM_DATA_POINTERS; i++) {
+            av_buffer_unref(&buf->buf[i]);
+            buf->base[i] = buf->data[i] = NULL;
         }
-        av_assert0(i < avci->buffer_count);
+
         avci->buffer_count--;
         last = &avci->buffer[avci->buffer_count];
 
@@ -598,6 +820,7 @@ void avcodec_default_release_buffer(AVCodecContext *s, AVFrame *pic){
 
     for (i = 0; i < AV_NUM_DATA_POINTERS; i++) {
         pic->data[i]=NULL;
+        pic->buf[i] =NULL;
 //        pic->base[i]=NULL;
     }
 //printf("R%X\n", pic->opaque);
@@ -607,6 +830,43 @@ void avcodec_default_release_buffer(AVCodecContext *s, AVFrame *pic){
                "buffers used\n", pic, avci->buffer_count);
 }
 
+/**
+ * Copy the planes of an internal buffer which are still referenced
+ * elsewhere, so that the decoder can modify them.
+ */
+static int make_internal_buffer_writable(AVCodecContext *s, AVFrame *pic)
+{
+    FramePool *pool = &s->internal->pool;
+    InternalBuffer *buf = find_internal_buffer(s, pic);
+    int i;
+
+    if (!buf)
+        return 0;
+
+    for (i = 0; i < AV_NUM_DATA_POINTERS && buf->buf[i]; i++) {
+        AVBufferRef *old = buf->buf[i], *new = NULL;
+
+        if (av_buffer_is_writable(old))
+            continue;
+
+        if (i < 4 && pool->pools[i])
+            new = av_buffer_pool_get(pool->pools[i]);
+        if (new && new->size != old->size)
+            av_buffer_unref(&new);
+        if (!new && !(new = av_buffer_alloc(old->size)))
+            return AVERROR(ENOMEM);
+        memcpy(new->data, old->data, old->size);
+
+        buf->data[i] = new->data + (buf->data[i] - buf->base[i]);
+        buf->base[i] = new->data;
+        buf->buf[i]  = new;
+        av_buffer_unref(&old);
+    }
+
+    export_internal_buffer(s, pic, buf);
+    return 0;
+}
+
 int avcodec_default_reget_buffer(AVCodecContext *s, AVFrame *pic){
     AVFrame temp_pic;
     int i;
@@ -630,9 +890,9 @@ int avcodec_default_reget_buffer(AVCodecContext *s, AVFrame *pic){
 
     assert(s->pix_fmt == pic->format);
 
-    /* If internal buffer type return the same buffer */
+    /* If internal buffer type return the same buffer, unless it is shared */
     if(pic->type == FF_BUFFER_TYPE_INTERNAL) {
-        return 0;
+        return make_internal_buffer_writable(s, pic);
     }
 
     /*
@@ -712,6 +972,21 @@ MAKE_ACCESSORS(AVFrame, frame, int,     sample_rate)
 MAKE_ACCESSORS(AVFrame, frame, AVDictionary *, metadata)
 MAKE_ACCESSORS(AVFrame, frame, int,     decode_error_flags)
 
+AVBufferRef *av_frame_get_plane_buffer(const AVFrame *frame, int plane)
+{
+    AVBufferRef *buf;
+
+    if (plane < 0 || plane >= AV_NUM_DATA_POINTERS || !frame->data[plane])
+        return NULL;
+    buf = frame->buf[plane];
+
+    /* the data pointers may have been changed after the buffers were set */
+    if (!buf || frame->data[plane] <  buf->data ||
+                frame->data[plane] >= buf->data + buf->size)
+        return NULL;
+    return buf;
+}
+
 MAKE_ACCESSORS(AVCodecContext, codec, AVRational, pkt_timebase)
 MAKE_ACCESSORS(AVCodecContext, codec, const AVCodecDescriptor *, codec_descriptor)
 
@@ -1687,6 +1962,126 @@ int attribute_align_arg avcodec_decode_audio4(AVCodecContext *avctx,
     return ret;
 }
 
+/**
+ * Add the samples of a decoded frame to the batch output frame, unless the
+ * decoder already wrote them there through batch_get_buffer().
+ */
+static int batch_append(AVCodecContext *avctx, AVFrame *frame)
+{
+    AVCodecInternal *avci = avctx->internal;
+    AVFrame *out = avci->batch_frame;
+    int channels = frame->channels;
+    int offset, ret;
+
+    if (!frame->nb_samples)
+        return 0;
+
+    if (out->format != AV_SAMPLE_FMT_NONE &&
+        (frame->format != out->format || channels != avci->batch_channels ||
+         (out->nb_samples && (frame->sample_rate    != out->sample_rate ||
+                              frame->channel_layout != out->channel_layout)))) {
+        av_log(avctx, AV_LOG_ERROR, "Audio parameters changed within a batch\n");
+        return AVERROR_INVALIDDATA;
+    }
+
+    offset = out->nb_samples * av_get_bytes_per_sample(out->format) *
+             (av_sample_fmt_is_planar(out->format) ? 1 : channels);
+    if (out->format == AV_SAMPLE_FMT_NONE ||
+        frame->extended_data[0] != avci->batch_planes[0] + offset) {
+        if ((ret = batch_reserve(avctx, frame->format, channels,
+                                 frame->nb_samples)) < 0)
+            return ret;
+        av_samples_copy(out->extended_data, frame->extended_data,
+                        out->nb_samples, 0, frame->nb_samples,
+                        channels, frame->format);
+    }
+
+    if (!out->nb_samples) {
+        out->pkt_pts               = frame->pkt_pts;
+        out->pkt_dts               = frame->pkt_dts;
+        out->pkt_pos               = frame->pkt_pos;
+        out->best_effort_timestamp = frame->best_effort_timestamp;
+        out->sample_rate           = frame->sample_rate;
+        out->channel_layout        = frame->channel_layout;
+        out->channels              = channels;
+        out->pkt_duration          = 0;
+    }
+    out->pkt_duration += frame->pkt_duration;
+    out->nb_samples   += frame->nb_samples;
+
+    return 0;
+}
+
+int attribute_align_arg avcodec_decode_audio_batch(AVCodecContext *avctx,
+                                                   AVFrame *frame,
+                                                   int *got_frame_ptr,
+                                                   const AVPacket *pkts,
+                                                   int nb_pkts)
+{
+    AVCodecInternal *avci = avctx->internal;
+    AVFrame decoded;
+    int i, p, ret = 0, got_frame;
+
+    *got_frame_ptr = 0;
+
+    if (nb_pkts <= 0)
+        return AVERROR(EINVAL);
+    if (avctx->codec->type != AVMEDIA_TYPE_AUDIO) {
+        av_log(avctx, AV_LOG_ERROR, "Invalid media type for audio\n");
+        return AVERROR(EINVAL);
+    }
+
+    frame->nb_samples    = 0;
+    frame->format        = AV_SAMPLE_FMT_NONE;
+    frame->extended_data = frame->data;
+    for (p = 0; p < AV_NUM_DATA_POINTERS; p++) {
+        frame->data[p] = NULL;
+        frame->buf[p]  = NULL;
+    }
+
+    for (i = 0; i < nb_pkts; i++) {
+        AVPacket pkt = pkts[i];
+
+        /* packets changing the parameters start a new batch */
+        if (i && av_packet_get_side_data(&pkt, AV_PKT_DATA_PARAM_CHANGE, NULL))
+            break;
+
+        avci->batch_pkts_left = nb_pkts - i;
+        do {
+            avcodec_get_frame_defaults(&decoded);
+            avci->batch_frame = frame;
+            ret = avcodec_decode_audio4(avctx, &decoded, &got_frame, &pkt);
+            if (ret >= 0 && got_frame) {
+                int err = batch_append(avctx, &decoded);
+                if (err < 0)
+                    ret = err;
+            }
+            avci->batch_frame = NULL;
+            if (ret < 0)
+                break;
+
+            pkt.data += ret;
+            pkt.size -= ret;
+            pkt.dts   =
+            pkt.pts   = AV_NOPTS_VALUE;
+        } while (pkt.size > 0 ? ret || got_frame : !pkts[i].size && got_frame);
+
+        if (ret < 0) {
+            if (!i) {
+                frame->nb_samples = 0;
+                return ret;
+            }
+            av_log(avctx, AV_LOG_WARNING,
+                   "Error decoding packet %d of the batch, ending the batch\n", i);
+            i++;
+            break;
+        }
+    }
+
+    *got_frame_ptr = frame->nb_samples > 0;
+    return i;
+}
+
 int avcodec_decode_subtitle2(AVCodecContext *avctx, AVSubtitle *sub,
                             int *got_sub_ptr,
                             AVPacket *avpkt)
@@ -1756,6 +2151,8 @@ av_cold int avcodec_close(AVCodecContext *avctx)
         avctx->coded_frame = NULL;
         avctx->internal->byte_buffer_size = 0;
         av_freep(&avctx->internal->byte_buffer);
+        av_freep(&avctx->internal->batch_buf);
+        av_freep(&avctx->internal->batch_planes);
         av_freep(&avctx->internal);
     }
 
@@ -2045,12 +2442,13 @@ static void video_free_buffers(AVCodecContext *s)
                avci->buffer_count);
     for(i=0; i<INTERNAL_BUFFER_SIZE; i++){
         InternalBuffer *buf = &avci->buffer[i];
-        for(j=0; j<4; j++){
-            av_freep(&buf->base[j]);
-            buf->data[j]= NULL;
+        for(j=0; j<AV_NUM_DATA_POINTERS; j++){
+            av_buffer_unref(&buf->buf[j]);
+            buf->base[j] = buf->data[j] = NULL;
         }
     }
     av_freep(&avci->buffer);
+    free_frame_pool(&avci->pool);
 
     avci->buffer_count=0;
 }
@@ -2478,6 +2876,11 @@ int ff_thread_can_start_frame(AVCodecContext *avctx)
     return 1;
 }
 
+int ff_thread_get_slice_count(AVCodecContext *avctx, int max_threads)
+{
+    return 1;
+}
+
 #endif
 
 enum AVMediaType avcodec_get_type(enum AVCodecID codec_id)
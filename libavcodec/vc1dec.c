@@ -35,6 +35,7 @@
 #include "vc1data.h"
 #include "vc1acdata.h"
 #include "msmpeg4data.h"
+#include "thread.h"
 #include "unary.h"
 #include "mathops.h"
 #include "vdpau_internal.h"
@@ -4307,6 +4308,43 @@ static void vc1_decode_b_mb_intfi(VC1Context *v)
     }
 }
 
+/** Wait until the reference pictures are decoded far enough for the
+ * MB row s->mb_y to be motion compensated from them.
+ * Interlaced pictures wait for their references to be fully decoded.
+ */
+static void vc1_await_references(VC1Context *v)
+{
+    MpegEncContext *s = &v->s;
+    int row = INT_MAX;
+
+    if (v->fcm == PROGRESSIVE) {
+        /* direct mode B MVs are scaled from the next picture ones, which
+         * may use a larger MV range */
+        int range = s->pict_type == AV_PICTURE_TYPE_B ? 1 << 10 : v->range_y;
+        /* the MV range is in quarter pels, add the bicubic filter taps */
+        row = FFMIN(s->mb_y + (((range >> 2) + 3 + 15) >> 4), s->mb_height - 1);
+    }
+
+    if (s->last_picture_ptr)
+        ff_thread_await_progress(&s->last_picture_ptr->f, row, 0);
+    if (s->pict_type == AV_PICTURE_TYPE_B && s->next_picture_ptr)
+        ff_thread_await_progress(&s->next_picture_ptr->f, row, 0);
+}
+
+/** Report the MB rows which cannot change anymore once row s->mb_y has
+ * been decoded. The overlap smoothing and the loop filter modify the row
+ * above the current one, so the progress lags two rows behind.
+ * Interlaced pictures report their progress in ff_MPV_frame_end().
+ */
+static void vc1_report_progress(VC1Context *v)
+{
+    MpegEncContext *s = &v->s;
+
+    if (v->fcm == PROGRESSIVE && s->pict_type != AV_PICTURE_TYPE_B &&
+        !s->error_occurred)
+        ff_thread_report_progress(&s->current_picture_ptr->f, s->mb_y - 2, 0);
+}
+
 /** Decode blocks of I-frame
  */
 static void vc1_decode_i_blocks(VC1Context *v)
@@ -4436,6 +4474,7 @@ static void vc1_decode_i_blocks(VC1Context *v)
             ff_draw_horiz_band(s, s->mb_y * 16, 16);
         else if (s->mb_y)
             ff_draw_horiz_band(s, (s->mb_y - 1) * 16, 16);
+        vc1_report_progress(v);
 
         s->first_slice_line = 0;
     }
@@ -4564,6 +4603,7 @@ static void vc1_decode_i_blocks_adv(VC1Context *v)
             ff_draw_horiz_band(s, s->mb_y * 16, 16);
         else if (s->mb_y)
             ff_draw_horiz_band(s, (s->mb_y-1) * 16, 16);
+        vc1_report_progress(v);
         s->first_slice_line = 0;
     }
 
@@ -4616,6 +4656,7 @@ static void vc1_decode_p_blocks(VC1Context *v)
     s->first_slice_line = 1;
     memset(v->cbp_base, 0, sizeof(v->cbp_base[0])*2*s->mb_stride);
     for (s->mb_y = s->start_mb_y; s->mb_y < s->end_mb_y; s->mb_y++) {
+        vc1_await_references(v);
         s->mb_x = 0;
         ff_init_block_index(s);
         for (; s->mb_x < s->mb_width; s->mb_x++) {
@@ -4641,6 +4682,7 @@ static void vc1_decode_p_blocks(VC1Context *v)
         memmove(v->is_intra_base, v->is_intra, sizeof(v->is_intra_base[0]) * s->mb_stride);
         memmove(v->luma_mv_base,  v->luma_mv,  sizeof(v->luma_mv_base[0])  * s->mb_stride);
         if (s->mb_y != s->start_mb_y) ff_draw_horiz_band(s, (s->mb_y - 1) * 16, 16);
+        vc1_report_progress(v);
         s->first_slice_line = 0;
     }
     if (apply_loop_filter && v->fcm == PROGRESSIVE) {
@@ -4688,6 +4730,7 @@ static void vc1_decode_b_blocks(VC1Context *v)
 
     s->first_slice_line = 1;
     for (s->mb_y = s->start_mb_y; s->mb_y < s->end_mb_y; s->mb_y++) {
+        vc1_await_references(v);
         s->mb_x = 0;
         ff_init_block_index(s);
         for (; s->mb_x < s->mb_width; s->mb_x++) {
@@ -4725,6 +4768,7 @@ static void vc1_decode_skip_blocks(VC1Context *v)
     ff_er_add_slice(s, 0, s->start_mb_y, s->mb_width - 1, s->end_mb_y - 1, ER_MB_END);
     s->first_slice_line = 1;
     for (s->mb_y = s->start_mb_y; s->mb_y < s->end_mb_y; s->mb_y++) {
+        vc1_await_references(v);
         s->mb_x = 0;
         ff_init_block_index(s);
         ff_update_block_index(s);
@@ -4732,6 +4776,7 @@ static void vc1_decode_skip_blocks(VC1Context *v)
         memcpy(s->dest[1], s->last_picture.f.data[1] + s->mb_y *  8 * s->uvlinesize, s->uvlinesize *  8);
         memcpy(s->dest[2], s->last_picture.f.data[2] + s->mb_y *  8 * s->uvlinesize, s->uvlinesize *  8);
         ff_draw_horiz_band(s, s->mb_y * 16, 16);
+        vc1_report_progress(v);
         s->first_slice_line = 0;
     }
     s->pict_type = AV_PICTURE_TYPE_P;
@@ -5303,6 +5348,87 @@ av_cold int ff_vc1_decode_end(AVCodecContext *avctx)
 }
 
 
+#if HAVE_THREADS
+static void vc1_rebase_mv_f(uint8_t *dst[2], uint8_t *const src[2],
+                            VC1Context *v, const VC1Context *v1)
+{
+    int off = v->s.b8_stride + 1;
+
+    if (src[0] == v1->mv_f_last_base + off)
+        dst[0] = v->mv_f_last_base + off;
+    else if (src[0] == v1->mv_f_next_base + off)
+        dst[0] = v->mv_f_next_base + off;
+    else
+        dst[0] = v->mv_f_base + off;
+    dst[1] = dst[0] + (src[1] - src[0]);
+}
+
+static int vc1_update_thread_context(AVCodecContext *dst,
+                                     const AVCodecContext *src)
+{
+    VC1Context *v = dst->priv_data, *v1 = src->priv_data;
+    MpegEncContext *s = &v->s;
+    const MpegEncContext *s1 = &v1->s;
+    int initialized = s->context_initialized, ret;
+
+    if (dst == src)
+        return 0;
+
+    if ((ret = ff_mpeg_update_thread_context(dst, src)) < 0)
+        return ret;
+
+    if (!initialized && s->context_initialized &&
+        ff_vc1_decode_init_alloc_tables(v) < 0)
+        return AVERROR(ENOMEM);
+
+    // sequence header and entry point
+    memcpy(&v->res_sprite, &v1->res_sprite,
+           (char *) &v1->mv_mode - (char *) &v1->res_sprite);
+    v->broken_link      = v1->broken_link;
+    v->closed_entry     = v1->closed_entry;
+    v->range_mapy_flag  = v1->range_mapy_flag;
+    v->range_mapuv_flag = v1->range_mapuv_flag;
+    v->range_mapy       = v1->range_mapy;
+    v->range_mapuv      = v1->range_mapuv;
+    s->loop_filter      = s1->loop_filter;
+    s->resync_marker    = s1->resync_marker;
+
+    // state inherited from the previous pictures
+    v->respic           = v1->respic;
+    v->rnd              = v1->rnd;
+    v->qs_last          = v1->qs_last;
+    v->refdist          = v1->refdist;
+    s->quarter_sample   = s1->quarter_sample;
+    s->mspel            = s1->mspel;
+
+    // intensity compensation
+    v->use_ic           = v1->use_ic;
+    v->lumscale         = v1->lumscale;
+    v->lumshift         = v1->lumshift;
+    v->lumscale2        = v1->lumscale2;
+    v->lumshift2        = v1->lumshift2;
+    memcpy(v->luty,   v1->luty,   sizeof(v->luty));
+    memcpy(v->lutuv,  v1->lutuv,  sizeof(v->lutuv));
+    memcpy(v->luty2,  v1->luty2,  sizeof(v->luty2));
+    memcpy(v->lutuv2, v1->lutuv2, sizeof(v->lutuv2));
+
+    // field pictures reference the field flags of the previous ones
+    if (v->interlace && v->mv_f_base && v1->mv_f_base) {
+        int size = 2 * (s->b8_stride * (s->mb_height * 2 + 1) +
+                        s->mb_stride * (s->mb_height + 1) * 2);
+        memcpy(v->mv_f_base,      v1->mv_f_base,      size);
+        memcpy(v->mv_f_last_base, v1->mv_f_last_base, size);
+        memcpy(v->mv_f_next_base, v1->mv_f_next_base, size);
+        vc1_rebase_mv_f(v->mv_f,      v1->mv_f,      v, v1);
+        vc1_rebase_mv_f(v->mv_f_last, v1->mv_f_last, v, v1);
+        vc1_rebase_mv_f(v->mv_f_next, v1->mv_f_next, v, v1);
+    }
+
+    return 0;
+}
+#endif
+
+
 /** Decode a VC1/WMV3 frame
  * @todo TODO: Handle VC-1 IDUs (Transport level?)
  */
@@ -5316,7 +5442,7 @@ static int vc1_decode_frame(AVCodecContext *avctx, void *data,
     AVFrame *pict = data;
     uint8_t *buf2 = NULL;
     const uint8_t *buf_start = buf;
-    int mb_height, n_slices1=-1;
+    int mb_height, n_slices1=-1, late_setup;
     struct {
         uint8_t *buf;
         GetBitContext gb;
@@ -5580,6 +5706,12 @@ static int vc1_decode_frame(AVCodecContext *avctx, void *data,
             v->mv_f[0] = tmp[0];
             v->mv_f[1] = tmp[1];
         }
+        /* Field pictures and the progressive pictures of interlaced
+         * sequences update v->mv_f while decoding, the next frame
+         * can only start once they are done. */
+        late_setup = v->field_mode || (v->interlace && v->fcm != ILACE_FRAME);
+        if (!late_setup)
+            ff_thread_finish_setup(avctx);
         mb_height = s->mb_height >> v->field_mode;
         for (i = 0; i <= n_slices; i++) {
             if (i > 0 &&  slices[i - 1].mby_start >= mb_height) {
@@ -5640,6 +5772,8 @@ static int vc1_decode_frame(AVCodecContext *avctx, void *data,
 //av_log(s->avctx, AV_LOG_INFO, "Consumed %i/%i bits\n", get_bits_count(&s->gb), s->gb.size_in_bits);
 //  if (get_bits_count(&s->gb) > buf_size * 8)
 //      return -1;
+        if (late_setup)
+            ff_thread_finish_setup(avctx);
         if(s->error_occurred && s->pict_type == AV_PICTURE_TYPE_B)
             goto err;
         if(!v->field_mode)
@@ -5704,9 +5838,10 @@ AVCodec ff_vc1_decoder = {
     .init           = vc1_decode_init,
     .close          = ff_vc1_decode_end,
     .decode         = vc1_decode_frame,
-    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_DELAY,
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_DELAY | CODEC_CAP_FRAME_THREADS,
     .long_name      = NULL_IF_CONFIG_SMALL("SMPTE VC-1"),
     .pix_fmts       = ff_hwaccel_pixfmt_list_420,
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(vc1_update_thread_context),
     .profiles       = NULL_IF_CONFIG_SMALL(profiles)
 };
 
@@ -5719,9 +5854,10 @@ AVCodec ff_wmv3_decoder = {
     .init           = vc1_decode_init,
     .close          = ff_vc1_decode_end,
     .decode         = vc1_decode_frame,
-    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_DELAY,
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_DELAY | CODEC_CAP_FRAME_THREADS,
     .long_name      = NULL_IF_CONFIG_SMALL("Windows Media Video 9"),
     .pix_fmts       = ff_hwaccel_pixfmt_list_420,
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(vc1_update_thread_context),
     .profiles       = NULL_IF_CONFIG_SMALL(profiles)
 };
 #endif
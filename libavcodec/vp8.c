@@ -24,6 +24,7 @@
  */
 
 #include "libavutil/imgutils.h"
+#include "libavutil/opt.h"
 #include "avcodec.h"
 #include "internal.h"
 #include "vp8.h"
@@ -130,12 +131,12 @@ static int update_dimensions(VP8Context *s, int width, int height)
     s->mb_width  = (s->avctx->coded_width +15) / 16;
     s->mb_height = (s->avctx->coded_height+15) / 16;
 
-    s->mb_layout = (avctx->active_thread_type == FF_THREAD_SLICE) && (FFMIN(s->num_coeff_partitions, avctx->thread_count) > 1);
-    if (!s->mb_layout) { // Frame threading and one thread
+    s->mb_layout = s->num_coeff_partitions > 1 && ff_thread_get_slice_count(avctx, s->partition_threads) > 1;
+    if (!s->mb_layout) { // One partition or one thread per frame
         s->macroblocks_base       = av_mallocz((s->mb_width+s->mb_height*2+1)*sizeof(*s->macroblocks));
         s->intra4x4_pred_mode_top = av_mallocz(s->mb_width*4);
     }
-    else // Sliced threading
+    else // Partitions decoded in parallel
         s->macroblocks_base       = av_mallocz((s->mb_width+2)*(s->mb_height+2)*sizeof(*s->macroblocks));
     s->top_nnz                    = av_mallocz(s->mb_width*sizeof(*s->top_nnz));
     s->top_border                 = av_mallocz((s->mb_width+1)*sizeof(*s->top_border));
@@ -1194,7 +1195,7 @@ void vp8_mc_luma(VP8Context *s, VP8ThreadData *td, uint8_t *dst,
         y_off += mv->y >> 2;
 
         // edge emulation
-        ff_thread_await_progress(ref, (3 + y_off + block_h + subpel_idx[2][my]) >> 4, 0);
+        ff_thread_await_progress(ref, FFMAX(3 + y_off + block_h + subpel_idx[2][my], 0) >> 4, 0);
         src += y_off * linesize + x_off;
         if (x_off < mx_idx || x_off >= width  - block_w - subpel_idx[2][mx] ||
             y_off < my_idx || y_off >= height - block_h - subpel_idx[2][my]) {
@@ -1245,7 +1246,7 @@ void vp8_mc_chroma(VP8Context *s, VP8ThreadData *td, uint8_t *dst1, uint8_t *dst
         // edge emulation
         src1 += y_off * linesize + x_off;
         src2 += y_off * linesize + x_off;
-        ff_thread_await_progress(ref, (3 + y_off + block_h + subpel_idx[2][my]) >> 3, 0);
+        ff_thread_await_progress(ref, FFMAX(3 + y_off + block_h + subpel_idx[2][my], 0) >> 3, 0);
         if (x_off < mx_idx || x_off >= width  - block_w - subpel_idx[2][mx] ||
             y_off < my_idx || y_off >= height - block_h - subpel_idx[2][my]) {
             s->dsp.emulated_edge_mc(td->edge_emu_buffer, src1 - my_idx * linesize - mx_idx, linesize,
@@ -1612,6 +1613,10 @@ static void vp8_decode_mv_mb_modes(AVCodecContext *avctx, AVFrame *curframe,
 
         AV_WN32A(s->intra4x4_pred_mode_left, DC_PRED*0x01010101);
 
+        // the segmentation map of the previous frame is written row by row
+        if (prev_frame && s->segmentation.enabled && !s->segmentation.update_map)
+            ff_thread_await_progress(prev_frame, mb_y, 0);
+
         s->mv_min.x = -MARGIN;
         s->mv_max.x = ((s->mb_width - 1) << 6) + MARGIN;
         for (mb_x = 0; mb_x < s->mb_width; mb_x++, mb_xy++, mb++) {
@@ -1647,7 +1652,7 @@ static void vp8_decode_mv_mb_modes(AVCodecContext *avctx, AVFrame *curframe,
 #define update_pos(td, mb_y, mb_x)\
     do {\
     int pos              = (mb_y << 16) | (mb_x & 0xFFFF);\
-    int sliced_threading = (avctx->active_thread_type == FF_THREAD_SLICE) && (num_jobs > 1);\
+    int sliced_threading = num_jobs > 1;\
     int is_null          = (next_td == NULL) || (prev_td == NULL);\
     int pos_check        = (is_null) ? 1 :\
                             (next_td != td && pos >= next_td->wait_mb_pos) ||\
@@ -1698,9 +1703,6 @@ static void vp8_decode_mb_row_no_filter(AVCodecContext *avctx, void *tdata,
         for (i = 0; i < 3; i++)
             for (y = 0; y < 16>>!!i; y++)
                 dst[i][y*curframe->linesize[i]-1] = 129;
-        if (mb_y == 1) {
-            s->top_border[0][15] = s->top_border[0][23] = s->top_border[0][31] = 129;
-        }
     }
 
     s->mv_min.x = -MARGIN;
@@ -1716,6 +1718,11 @@ static void vp8_decode_mb_row_no_filter(AVCodecContext *avctx, void *tdata,
             }
         }
 
+        // the first row may still be using the top-left edge of 127, so
+        // only change it once the row above is past the first macroblock
+        if (!mb_x && mb_y == 1 && !(avctx->flags & CODEC_FLAG_EMU_EDGE))
+            s->top_border[0][15] = s->top_border[0][23] = s->top_border[0][31] = 129;
+
         s->dsp.prefetch(dst[0] + (mb_x&3)*4*s->linesize + 64, s->linesize, 4);
         s->dsp.prefetch(dst[1] + (mb_x&7)*s->uvlinesize + 64, dst[2] - dst[1], 2);
 
@@ -1977,10 +1984,12 @@ static int vp8_decode_frame(AVCodecContext *avctx, void *data, int *data_size,
     if (s->mb_layout == 1)
         vp8_decode_mv_mb_modes(avctx, curframe, prev_frame);
 
-    if (avctx->active_thread_type == FF_THREAD_FRAME)
-        num_jobs = 1;
+    // rows of different partitions are decoded in parallel, also within
+    // each frame thread, when the macroblock modes were decoded beforehand
+    if (s->mb_layout == 1)
+        num_jobs = FFMIN(s->num_coeff_partitions, ff_thread_get_slice_count(avctx, s->partition_threads));
     else
-        num_jobs = FFMIN(s->num_coeff_partitions, avctx->thread_count);
+        num_jobs = 1;
     s->num_jobs   = num_jobs;
     s->curframe   = curframe;
     s->prev_frame = prev_frame;
@@ -2071,6 +2080,18 @@ static int vp8_decode_update_thread_context(AVCodecContext *dst, const AVCodecCo
     return 0;
 }
 
+static const AVOption vp8_options[] = {
+    {"partition_threads", "slice threads decoding the token partitions in each frame thread", offsetof(VP8Context, partition_threads), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 8, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_VIDEO_PARAM},
+    {NULL}
+};
+
+static const AVClass vp8_class = {
+    .class_name = "VP8 Decoder",
+    .item_name  = av_default_item_name,
+    .option     = vp8_options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 AVCodec ff_vp8_decoder = {
     .name                  = "vp8",
     .type                  = AVMEDIA_TYPE_VIDEO,
@@ -2084,4 +2105,5 @@ AVCodec ff_vp8_decoder = {
     .long_name             = NULL_IF_CONFIG_SMALL("On2 VP8"),
     .init_thread_copy      = ONLY_IF_THREADS_ENABLED(vp8_decode_init_thread_copy),
     .update_thread_context = ONLY_IF_THREADS_ENABLED(vp8_decode_update_thread_context),
+    .priv_class            = &vp8_class,
 };
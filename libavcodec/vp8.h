@@ -124,6 +124,7 @@ typedef struct {
 
 #define MAX_THREADS 8
 typedef struct {
+    const AVClass *class;
     VP8ThreadData *thread_data;
     AVCodecContext *avctx;
     AVFrame *framep[4];
@@ -269,6 +270,12 @@ typedef struct {
      * 1 -> Macroblocks for entire frame alloced (sliced thread).
      */
     int mb_layout;
+
+    /**
+     * Maximum number of slice threads decoding the token partitions of a
+     * frame in each frame thread, 0 or 1 to decode them on the frame thread.
+     */
+    int partition_threads;
 } VP8Context;
 
 #endif /* AVCODEC_VP8_H */
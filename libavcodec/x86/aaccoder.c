@@ -0,0 +1,112 @@
+/*
+ * AAC encoder SIMD functions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/avassert.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/asm.h"
+#include "libavcodec/aacenc.h"
+
+#if HAVE_INLINE_ASM
+
+/* sqrtps is correctly rounded like sqrtf(), so this matches the C version.
+ * The loops below run at least once and handle 4 coefficients per pass. */
+static void abs_pow34_sse2(float *out, const float *in, int size)
+{
+    x86_reg i = -4 * size;
+
+    av_assert2(size > 0 && !(size & 3));
+    __asm__ volatile(
+        "pcmpeqd   %%xmm2, %%xmm2       \n\t"
+        "psrld     $1, %%xmm2           \n\t" // ~sign
+        "1:                             \n\t"
+        "movups    (%1, %0), %%xmm0     \n\t"
+        "andps     %%xmm2, %%xmm0       \n\t"
+        "sqrtps    %%xmm0, %%xmm1       \n\t"
+        "mulps     %%xmm1, %%xmm0       \n\t"
+        "sqrtps    %%xmm0, %%xmm0       \n\t"
+        "movups    %%xmm0, (%2, %0)     \n\t"
+        "add       $16, %0              \n\t"
+        " jl 1b                         \n\t"
+        : "+r" (i)
+        : "r"(in + size), "r"(out + size)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",) "memory"
+    );
+}
+
+/* The rounding and clipping are done on doubles as in the C version.
+ * The sign is applied as (q ^ m) - m, with m = in < 0 masked by is_signed. */
+static void quantize_bands_sse2(int *out, const float *in, const float *scaled,
+                                int size, float Q34, int is_signed, int maxval)
+{
+    const double rnd = 0.4054, clip = maxval;
+    const int sign = -is_signed;
+    x86_reg i = -4 * size;
+
+    av_assert2(size > 0 && !(size & 3));
+    __asm__ volatile(
+        "movss     %4, %%xmm4           \n\t"
+        "shufps    $0, %%xmm4, %%xmm4   \n\t"
+        "movsd     %5, %%xmm5           \n\t"
+        "unpcklpd  %%xmm5, %%xmm5       \n\t"
+        "movsd     %6, %%xmm6           \n\t"
+        "unpcklpd  %%xmm6, %%xmm6       \n\t"
+        "movd      %7, %%xmm3           \n\t"
+        "pshufd    $0, %%xmm3, %%xmm3   \n\t"
+        "xorps     %%xmm7, %%xmm7       \n\t"
+        "1:                             \n\t"
+        "movups    (%2, %0), %%xmm0     \n\t"
+        "mulps     %%xmm4, %%xmm0       \n\t"
+        "cvtps2pd  %%xmm0, %%xmm1       \n\t"
+        "movhlps   %%xmm0, %%xmm0       \n\t"
+        "cvtps2pd  %%xmm0, %%xmm0       \n\t"
+        "addpd     %%xmm6, %%xmm1       \n\t"
+        "addpd     %%xmm6, %%xmm0       \n\t"
+        "minpd     %%xmm5, %%xmm1       \n\t"
+        "minpd     %%xmm5, %%xmm0       \n\t"
+        "cvttpd2dq %%xmm1, %%xmm1       \n\t"
+        "cvttpd2dq %%xmm0, %%xmm0       \n\t"
+        "punpcklqdq %%xmm0, %%xmm1      \n\t"
+        "movups    (%3, %0), %%xmm2     \n\t"
+        "cmpltps   %%xmm7, %%xmm2       \n\t"
+        "pand      %%xmm3, %%xmm2       \n\t"
+        "pxor      %%xmm2, %%xmm1       \n\t"
+        "psubd     %%xmm2, %%xmm1       \n\t"
+        "movdqu    %%xmm1, (%1, %0)     \n\t"
+        "add       $16, %0              \n\t"
+        " jl 1b                         \n\t"
+        : "+r" (i)
+        : "r"(out + size), "r"(scaled + size), "r"(in + size),
+          "m"(Q34), "m"(clip), "m"(rnd), "m"(sign)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",) "memory"
+    );
+}
+
+#endif /* HAVE_INLINE_ASM */
+
+void ff_aac_coder_init_x86(AACEncContext *s)
+{
+#if HAVE_INLINE_ASM
+    if (av_get_cpu_flags() & AV_CPU_FLAG_SSE2) {
+        s->abs_pow34   = abs_pow34_sse2;
+        s->quant_bands = quantize_bands_sse2;
+    }
+#endif /* HAVE_INLINE_ASM */
+}
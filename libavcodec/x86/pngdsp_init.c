@@ -21,6 +21,8 @@
 
 #include "libavutil/common.h"
 #include "libavutil/cpu.h"
+#include "libavutil/x86/asm.h"
+#include "libavcodec/png.h"
 #include "libavcodec/pngdsp.h"
 
 void ff_add_png_paeth_prediction_mmx2 (uint8_t *dst, uint8_t *src,
@@ -32,6 +34,101 @@ void ff_add_bytes_l2_mmx (uint8_t *dst, uint8_t *src1,
 void ff_add_bytes_l2_sse2(uint8_t *dst, uint8_t *src1,
                           uint8_t *src2, int w);
 
+#if HAVE_INLINE_ASM
+
+/* 8 pixels per iteration on 16-bit words, the predictor is picked with masks
+ * instead of branches: not a = (pa > pb) | (pa > pc), c = pb > pc */
+static void sub_paeth_prediction_sse2(uint8_t *dst, uint8_t *src,
+                                      uint8_t *top, int w, int bpp)
+{
+    x86_reg i = 0, j = -bpp;
+    if (w >= 8)
+    __asm__ volatile(
+        "pxor      %%xmm7, %%xmm7       \n\t"
+        "1:                             \n\t"
+        "movq      (%3, %1), %%xmm0     \n\t" // a
+        "movq      (%4, %0), %%xmm1     \n\t" // b
+        "movq      (%4, %1), %%xmm2     \n\t" // c
+        "punpcklbw %%xmm7, %%xmm0       \n\t"
+        "punpcklbw %%xmm7, %%xmm1       \n\t"
+        "punpcklbw %%xmm7, %%xmm2       \n\t"
+        "movdqa    %%xmm1, %%xmm3       \n\t"
+        "movdqa    %%xmm0, %%xmm4       \n\t"
+        "psubw     %%xmm2, %%xmm3       \n\t" // p = b - c
+        "psubw     %%xmm2, %%xmm4       \n\t" // a - c
+        "movdqa    %%xmm3, %%xmm6       \n\t"
+        "paddw     %%xmm4, %%xmm6       \n\t"
+        "movdqa    %%xmm7, %%xmm5       \n\t"
+        "psubw     %%xmm3, %%xmm5       \n\t"
+        "pmaxsw    %%xmm5, %%xmm3       \n\t" // pa
+        "movdqa    %%xmm7, %%xmm5       \n\t"
+        "psubw     %%xmm4, %%xmm5       \n\t"
+        "pmaxsw    %%xmm5, %%xmm4       \n\t" // pb
+        "movdqa    %%xmm7, %%xmm5       \n\t"
+        "psubw     %%xmm6, %%xmm5       \n\t"
+        "pmaxsw    %%xmm5, %%xmm6       \n\t" // pc
+        "movdqa    %%xmm3, %%xmm5       \n\t"
+        "pcmpgtw   %%xmm4, %%xmm5       \n\t"
+        "pcmpgtw   %%xmm6, %%xmm3       \n\t"
+        "por       %%xmm5, %%xmm3       \n\t"
+        "pcmpgtw   %%xmm6, %%xmm4       \n\t"
+        "pxor      %%xmm1, %%xmm2       \n\t"
+        "pand      %%xmm4, %%xmm2       \n\t"
+        "pxor      %%xmm1, %%xmm2       \n\t" // pb > pc ? c : b
+        "pxor      %%xmm0, %%xmm2       \n\t"
+        "pand      %%xmm3, %%xmm2       \n\t"
+        "pxor      %%xmm0, %%xmm2       \n\t"
+        "packuswb  %%xmm2, %%xmm2       \n\t"
+        "movq      (%3, %0), %%xmm0     \n\t"
+        "psubb     %%xmm2, %%xmm0       \n\t"
+        "movq      %%xmm0, (%2, %0)     \n\t"
+        "add       $8, %0               \n\t"
+        "add       $8, %1               \n\t"
+        "cmp       %5, %0               \n\t"
+        " jb 1b                         \n\t"
+        : "+r" (i), "+r" (j)
+        : "r"(dst), "r"(src), "r"(top), "g"((x86_reg)w - 7)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",) "memory"
+    );
+    ff_sub_png_paeth_prediction(dst + i, src + i, top + i, w - i, bpp);
+}
+
+/* floor((a + b) / 2) = pavgb(a, b) - ((a ^ b) & 1) */
+static void sub_avg_prediction_sse2(uint8_t *dst, uint8_t *src,
+                                    uint8_t *top, int w, int bpp)
+{
+    x86_reg i = 0, j = -bpp;
+    if (w >= 16)
+    __asm__ volatile(
+        "pcmpeqb   %%xmm7, %%xmm7       \n\t"
+        "psrlw     $15, %%xmm7          \n\t"
+        "packuswb  %%xmm7, %%xmm7       \n\t" // pb_1
+        "1:                             \n\t"
+        "movdqu    (%3, %1), %%xmm0     \n\t" // a
+        "movdqu    (%4, %0), %%xmm1     \n\t" // b
+        "movdqa    %%xmm0, %%xmm2       \n\t"
+        "pxor      %%xmm1, %%xmm2       \n\t"
+        "pand      %%xmm7, %%xmm2       \n\t"
+        "pavgb     %%xmm1, %%xmm0       \n\t"
+        "psubb     %%xmm2, %%xmm0       \n\t"
+        "movdqu    (%3, %0), %%xmm1     \n\t"
+        "psubb     %%xmm0, %%xmm1       \n\t"
+        "movdqu    %%xmm1, (%2, %0)     \n\t"
+        "add       $16, %0              \n\t"
+        "add       $16, %1              \n\t"
+        "cmp       %5, %0               \n\t"
+        " jb 1b                         \n\t"
+        : "+r" (i), "+r" (j)
+        : "r"(dst), "r"(src), "r"(top), "g"((x86_reg)w - 15)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm7",) "memory"
+    );
+    for (; i < w; i++)
+        dst[i] = src[i] - ((src[i - bpp] + top[i]) >> 1);
+}
+
+#endif /* HAVE_INLINE_ASM */
+
 void ff_pngdsp_init_x86(PNGDSPContext *dsp)
 {
 #if HAVE_YASM
@@ -48,4 +145,10 @@ void ff_pngdsp_init_x86(PNGDSPContext *dsp)
     if (flags & AV_CPU_FLAG_SSSE3)
         dsp->add_paeth_prediction = ff_add_png_paeth_prediction_ssse3;
 #endif
+#if HAVE_INLINE_ASM
+    if (av_get_cpu_flags() & AV_CPU_FLAG_SSE2) {
+        dsp->sub_paeth_prediction = sub_paeth_prediction_sse2;
+        dsp->sub_avg_prediction   = sub_avg_prediction_sse2;
+    }
+#endif /* HAVE_INLINE_ASM */
 }
@@ -119,6 +119,9 @@ int avfilter_fill_frame_from_buffer_ref(AVFrame *frame,
 /**
  * Add frame data to buffer_src.
  *
+ * Video frames whose planes are all reference counted (see
+ * av_frame_get_plane_buffer()) are referenced instead of being copied.
+ *
  * @param buffer_src  pointer to a buffer source context
  * @param frame       a frame, or NULL to mark EOF
  * @param flags       a combination of AV_BUFFERSRC_FLAG_*
@@ -488,6 +488,26 @@ const AVClass *avfilter_get_class(void)
     return &avfilter_class;
 }
 
+static int default_execute(AVFilterContext *ctx, avfilter_action_func *func,
+                           void *arg, int *ret, int nb_jobs)
+{
+    int i;
+
+    for (i = 0; i < nb_jobs; i++) {
+        int r = func(ctx, arg, i, nb_jobs);
+        if (ret)
+            ret[i] = r;
+    }
+    return 0;
+}
+
+int ff_filter_get_nb_threads(AVFilterContext *ctx)
+{
+    if (ctx->graph && ctx->graph->thread_opaque)
+        return ctx->graph->nb_threads;
+    return 1;
+}
+
 int avfilter_open(AVFilterContext **filter_ctx, AVFilter *filter, const char *inst_name)
 {
     AVFilterContext *ret;
@@ -502,6 +522,7 @@ int avfilter_open(AVFilterContext **filter_ctx, AVFilter *filter, const char *in
 
     ret->av_class = &avfilter_class;
     ret->filter   = filter;
+    ret->execute  = default_execute;
     ret->name     = inst_name ? av_strdup(inst_name) : NULL;
     if (filter->priv_size) {
         ret->priv     = av_mallocz(filter->priv_size);
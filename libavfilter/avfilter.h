@@ -484,6 +484,26 @@ typedef struct AVFilter {
     const AVClass *priv_class;      ///< private class, containing filter specific options
 } AVFilter;
 
+/**
+ * A function run by AVFilterContext.execute() for one job of a parallel
+ * operation.
+ *
+ * @param arg    the argument passed to execute()
+ * @param jobnr  index of the job, between 0 and nb_jobs - 1
+ * @param nb_jobs total number of jobs of the operation
+ * @return the result stored in the ret array passed to execute()
+ */
+typedef int (avfilter_action_func)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
+
+/**
+ * A function running nb_jobs jobs of func, possibly in parallel.
+ *
+ * @param ret    array of nb_jobs return values of func, may be NULL
+ * @return 0 on success, a negative AVERROR code otherwise
+ */
+typedef int (avfilter_execute_func)(AVFilterContext *ctx, avfilter_action_func *func,
+                                    void *arg, int *ret, int nb_jobs);
+
 /** An instance of a filter */
 struct AVFilterContext {
     const AVClass *av_class;        ///< needed for av_log()
@@ -509,6 +529,17 @@ struct AVFilterContext {
     void *priv;                     ///< private data for use by the filter
 
     struct AVFilterCommand *command_queue;
+
+    struct AVFilterGraph *graph;    ///< filtergraph this filter belongs to, NULL if none
+
+    /**
+     * Run the jobs of a parallel operation. Filters may use this to split
+     * the processing of a frame into independent slices; the jobs are
+     * executed on the thread pool of the filtergraph if it has one, or
+     * sequentially in the calling thread otherwise.
+     * The jobs of a single call must not depend on each other.
+     */
+    avfilter_execute_func *execute;
 };
 
 /**
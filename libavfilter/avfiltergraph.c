@@ -59,6 +59,8 @@ void avfilter_graph_free(AVFilterGraph **graph)
         return;
     for (; (*graph)->filter_count > 0; (*graph)->filter_count--)
         avfilter_free((*graph)->filters[(*graph)->filter_count - 1]);
+    if (HAVE_PTHREADS)
+        ff_graph_thread_free(*graph);
     av_freep(&(*graph)->sink_links);
     av_freep(&(*graph)->scale_sws_opts);
     av_freep(&(*graph)->filters);
@@ -74,6 +76,9 @@ int avfilter_graph_add_filter(AVFilterGraph *graph, AVFilterContext *filter)
 
     graph->filters = filters;
     graph->filters[graph->filter_count++] = filter;
+    filter->graph  = graph;
+    if (HAVE_PTHREADS && graph->thread_opaque)
+        filter->execute = ff_graph_thread_execute;
 
     return 0;
 }
@@ -926,8 +931,12 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
 
     if ((ret = graph_check_validity(graphctx, log_ctx)))
         return ret;
+    if (HAVE_PTHREADS && (ret = ff_graph_thread_init(graphctx)) < 0)
+        return ret;
     if ((ret = graph_insert_fifos(graphctx, log_ctx)) < 0)
         return ret;
+    if (HAVE_PTHREADS && (ret = ff_graph_insert_pipelines(graphctx, log_ctx)) < 0)
+        return ret;
     if ((ret = graph_config_formats(graphctx, log_ctx)))
         return ret;
     if ((ret = graph_config_links(graphctx, log_ctx)))
@@ -957,7 +966,11 @@ int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const
     for (i = 0; i < graph->filter_count; i++) {
         AVFilterContext *filter = graph->filters[i];
         if(!strcmp(target, "all") || (filter->name && !strcmp(target, filter->name)) || !strcmp(target, filter->filter->name)){
+            if (HAVE_PTHREADS)
+                ff_graph_pause_pipeline(graph, filter);
             r = avfilter_process_command(filter, cmd, arg, res, res_len, flags);
+            if (HAVE_PTHREADS)
+                ff_graph_resume_pipeline(graph, filter);
             if(r != AVERROR(ENOSYS)) {
                 if((flags & AVFILTER_CMD_FLAG_ONE) || r<0)
                     return r;
@@ -979,6 +992,8 @@ int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const
         AVFilterContext *filter = graph->filters[i];
         if(filter && (!strcmp(target, "all") || !strcmp(target, filter->name) || !strcmp(target, filter->filter->name))){
             AVFilterCommand **que = &filter->command_queue, *next;
+            if (HAVE_PTHREADS)
+                ff_graph_pause_pipeline(graph, filter);
             while(*que && (*que)->time <= ts)
                 que = &(*que)->next;
             next= *que;
@@ -988,6 +1003,8 @@ int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const
             (*que)->time    = ts;
             (*que)->flags   = flags;
             (*que)->next    = next;
+            if (HAVE_PTHREADS)
+                ff_graph_resume_pipeline(graph, filter);
             if(flags & AVFILTER_CMD_FLAG_ONE)
                 return 0;
         }
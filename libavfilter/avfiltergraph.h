@@ -32,6 +32,23 @@ typedef struct AVFilterGraph {
 
     char *scale_sws_opts; ///< sws options to use for the auto-inserted scale filters
 
+    /**
+     * Number of threads used by the filters supporting slice threading.
+     * A value of 0 or 1 runs every filter in the calling thread.
+     * Must be set before avfilter_graph_config().
+     */
+    int nb_threads;
+
+    /**
+     * If nonzero, every single input, single output video filter runs in
+     * its own thread, and at most this many frames are queued at its input
+     * and at its output. Frames are passed between the threads by reference.
+     * Commands sent or queued to such a filter are applied while its thread
+     * is paused between two frames.
+     * Must be set before avfilter_graph_config().
+     */
+    int pipeline_queue_size;
+
     /**
      * Private fields
      *
@@ -43,6 +60,8 @@ typedef struct AVFilterGraph {
     int sink_links_count;
 
     unsigned disable_auto_convert;
+
+    void *thread_opaque;    ///< worker threads state, see ff_graph_thread_init()
 } AVFilterGraph;
 
 /**
@@ -81,64 +81,9 @@ AVFilterBufferRef *avfilter_ref_buffer(AVFilterBufferRef *ref, int pmask)
 
 void ff_free_pool(AVFilterPool *pool)
 {
-    int i;
-
-    av_assert0(pool->refcount > 0);
-
-    for (i = 0; i < POOL_SIZE; i++) {
-        if (pool->pic[i]) {
-            AVFilterBufferRef *picref = pool->pic[i];
-            /* free buffer: picrefs stored in the pool are not
-             * supposed to contain a free callback */
-            av_assert0(!picref->buf->refcount);
-            av_freep(&picref->buf->data[0]);
-            av_freep(&picref->buf);
-
-            av_freep(&picref->audio);
-            av_freep(&picref->video);
-            av_freep(&pool->pic[i]);
-            pool->count--;
-        }
-    }
-    pool->draining = 1;
-
-    if (!--pool->refcount) {
-        av_assert0(!pool->count);
-        av_free(pool);
-    }
-}
-
-static void store_in_pool(AVFilterBufferRef *ref)
-{
-    int i;
-    AVFilterPool *pool= ref->buf->priv;
-
-    av_assert0(ref->buf->data[0]);
-    av_assert0(pool->refcount>0);
-
-    if (pool->count == POOL_SIZE) {
-        AVFilterBufferRef *ref1 = pool->pic[0];
-        av_freep(&ref1->video);
-        av_freep(&ref1->audio);
-        av_freep(&ref1->buf->data[0]);
-        av_freep(&ref1->buf);
-        av_free(ref1);
-        memmove(&pool->pic[0], &pool->pic[1], sizeof(void*)*(POOL_SIZE-1));
-        pool->count--;
-        pool->pic[POOL_SIZE-1] = NULL;
-    }
-
-    for (i = 0; i < POOL_SIZE; i++) {
-        if (!pool->pic[i]) {
-            pool->pic[i] = ref;
-            pool->count++;
-            break;
-        }
-    }
-    if (pool->draining) {
-        ff_free_pool(pool);
-    } else
-        --pool->refcount;
+    /* the buffers still referenced keep the underlying pool alive */
+    av_buffer_pool_uninit(&pool->buffers);
+    av_free(pool);
 }
 
 void avfilter_unref_buffer(AVFilterBufferRef *ref)
@@ -146,13 +91,8 @@ void avfilter_unref_buffer(AVFilterBufferRef *ref)
     if (!ref)
         return;
     av_assert0(ref->buf->refcount > 0);
-    if (!(--ref->buf->refcount)) {
-        if (!ref->buf->free) {
-            store_in_pool(ref);
-            return;
-        }
+    if (!(--ref->buf->refcount))
         ref->buf->free(ref->buf);
-    }
     if (ref->extended_data != ref->data)
         av_freep(&ref->extended_data);
     av_freep(&ref->video);
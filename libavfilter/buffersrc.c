@@ -75,6 +75,58 @@ typedef struct {
         return AVERROR(EINVAL);\
     }
 
+static void free_frame_buffers(AVFilterBuffer *ptr)
+{
+    AVBufferRef **bufs = ptr->priv;
+    int i;
+
+    for (i = 0; i < 4; i++)
+        av_buffer_unref(&bufs[i]);
+    av_free(bufs);
+    av_free(ptr);
+}
+
+/**
+ * Reference the planes of a video frame instead of copying them.
+ *
+ * @return a read-only buffer ref, or NULL if the frame data is not
+ *         reference counted
+ */
+static AVFilterBufferRef *ref_frame_buffers(AVFilterContext *s,
+                                            const AVFrame *frame)
+{
+    AVFilterBufferRef *picref;
+    AVBufferRef **bufs;
+    int i;
+
+    if (s->outputs[0]->type != AVMEDIA_TYPE_VIDEO)
+        return NULL;
+    for (i = 0; i < 4 && frame->data[i]; i++)
+        if (!av_frame_get_plane_buffer(frame, i))
+            return NULL;
+    if (!i || !(bufs = av_mallocz(4 * sizeof(*bufs))))
+        return NULL;
+
+    for (i = 0; i < 4 && frame->data[i]; i++)
+        if (!(bufs[i] = av_buffer_ref(av_frame_get_plane_buffer(frame, i))))
+            goto fail;
+
+    /* the frame may still be used as a reference by the decoder */
+    picref = avfilter_get_video_buffer_ref_from_frame(frame, AV_PERM_READ |
+                                                             AV_PERM_PRESERVE);
+    if (!picref)
+        goto fail;
+    picref->buf->priv = bufs;
+    picref->buf->free = free_frame_buffers;
+
+    return picref;
+fail:
+    for (i = 0; i < 4; i++)
+        av_buffer_unref(&bufs[i]);
+    av_free(bufs);
+    return NULL;
+}
+
 int av_buffersrc_add_frame(AVFilterContext *buffer_src,
                            const AVFrame *frame, int flags)
 {
@@ -84,6 +136,22 @@ int av_buffersrc_add_frame(AVFilterContext *buffer_src,
     if (!frame) /* NULL for EOF */
         return av_buffersrc_add_ref(buffer_src, NULL, flags);
 
+    if ((picref = ref_frame_buffers(buffer_src, frame))) {
+        ret = av_buffersrc_add_ref(buffer_src, picref,
+                                   (flags & ~AV_BUFFERSRC_FLAG_PUSH) |
+                                   AV_BUFFERSRC_FLAG_NO_COPY);
+        if (ret < 0) {
+            avfilter_unref_buffer(picref);
+            return ret;
+        }
+        if (flags & AV_BUFFERSRC_FLAG_PUSH) {
+            ret = buffer_src->output_pads[0].request_frame(buffer_src->outputs[0]);
+            if (ret < 0)
+                return ret;
+        }
+        return 0;
+    }
+
     picref = avfilter_get_buffer_ref_from_frame(buffer_src->outputs[0]->type,
                                                 frame, AV_PERM_WRITE);
     if (!picref)
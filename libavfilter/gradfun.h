@@ -31,7 +31,7 @@ typedef struct {
     int chroma_w;  ///< width of the chroma planes
     int chroma_h;  ///< weight of the chroma planes
     int chroma_r;  ///< blur radius for the chroma planes
-    uint16_t *buf; ///< holds image data for blur algorithm passed into filter.
+    uint16_t *buf[3]; ///< holds image data for blur algorithm passed into filter, one per plane.
     /// DSP functions.
     void (*filter_line) (uint8_t *dst, const uint8_t *src, const uint16_t *dc, int width, int thresh, const uint16_t *dithers);
     void (*blur_line) (uint16_t *dc, uint16_t *buf, const uint16_t *buf1, const uint8_t *src, int src_linesize, int width);
@@ -24,17 +24,17 @@
  * internal API functions
  */
 
+#include "libavutil/buffer.h"
 #include "avfilter.h"
 #include "avfiltergraph.h"
 #include "formats.h"
 #include "video.h"
 
-#define POOL_SIZE 32
 typedef struct AVFilterPool {
-    AVFilterBufferRef *pic[POOL_SIZE];
-    int count;
-    int refcount;
-    int draining;
+    AVBufferPool *buffers;      ///< image buffers for the parameters below
+    int w, h;
+    enum PixelFormat format;
+    int linesize[4];
 } AVFilterPool;
 
 typedef struct AVFilterCommand {
@@ -50,6 +50,49 @@ typedef struct AVFilterCommand {
  */
 void ff_avfilter_graph_update_heap(AVFilterGraph *graph, AVFilterLink *link);
 
+/**
+ * Start the worker threads of a graph if graph->nb_threads asks for more
+ * than one thread, and make every filter of the graph use them.
+ */
+int ff_graph_thread_init(AVFilterGraph *graph);
+
+/**
+ * Stop the worker threads of a graph and free their state.
+ */
+void ff_graph_thread_free(AVFilterGraph *graph);
+
+/**
+ * AVFilterContext.execute() implementation running the jobs on the thread
+ * pool of the graph the filter belongs to.
+ */
+int ff_graph_thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
+                            void *arg, int *ret, int nb_jobs);
+
+/**
+ * Get the number of threads a filter can expect its jobs to be spread
+ * over, use it to choose the number of jobs passed to execute().
+ */
+int ff_filter_get_nb_threads(AVFilterContext *ctx);
+
+/**
+ * Move every single input, single output video filter of a graph to its own
+ * thread if graph->pipeline_queue_size asks for it.
+ */
+int ff_graph_insert_pipelines(AVFilterGraph *graph, void *log_ctx);
+
+/**
+ * Stop the thread running filter, if it is pipelined, between two frames,
+ * so that the filter can be accessed from the calling thread until
+ * ff_graph_resume_pipeline() is called.
+ */
+void ff_graph_pause_pipeline(AVFilterGraph *graph, AVFilterContext *filter);
+
+/**
+ * Let the thread running filter, if it is pipelined, filter frames again
+ * after ff_graph_pause_pipeline().
+ */
+void ff_graph_resume_pipeline(AVFilterGraph *graph, AVFilterContext *filter);
+
 #if !FF_API_AVFILTERPAD_PUBLIC
 /**
  * A filter pad used for either input or output.
@@ -0,0 +1,838 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Pipelined filters.
+ *
+ * Every single input, single output video filter of a graph is moved to its
+ * own thread, so consecutive filters work on consecutive frames at the same
+ * time. The filter is cut from the rest of the graph by two filters:
+ * pipeline_enter queues the frames pushed into the filter for the worker
+ * thread, pipeline_leave queues the frames output by the filter for the
+ * thread driving the graph.
+ *
+ * Frames are not copied when crossing the boundary. The sending thread
+ * wraps the data of its reference into a new AVFilterBuffer, whose reference
+ * count is only touched by the receiving thread. When the receiving side
+ * releases it, the original reference is handed back to the sending thread
+ * to be released, so that AVFilterBuffer reference counts, and the free
+ * callbacks of the buffers, only ever run in the thread which owns them.
+ *
+ * Requests and polls coming from the filters following the pipelined
+ * filter are forwarded to the worker thread, and the requests and polls the
+ * filter makes on its input are forwarded back to the calling thread, so
+ * the rest of the graph keeps running in the caller's thread with the usual
+ * request_frame()/poll_frame() semantics.
+ *
+ * Commands sent or queued to a pipelined filter are applied from the
+ * calling thread while the worker is paused between two frames.
+ */
+
+#include <pthread.h>
+
+#include "libavutil/mem.h"
+#include "avfilter.h"
+#include "avfiltergraph.h"
+#include "bufferqueue.h"
+#include "internal.h"
+#include "video.h"
+
+enum PipelineCall {
+    CALL_NONE,
+    CALL_REQUEST,
+    CALL_POLL,
+};
+
+typedef struct PipelineFrame PipelineFrame;
+
+typedef struct PipelineContext {
+    pthread_t thread;
+    int thread_started;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;            ///< Broadcast on every state change.
+    int refcount;                   ///< Number of boundary filters and frames using the context.
+
+    AVFilterContext *enter, *leave;
+    int queue_size;
+    struct FFBufQueue in_queue;     ///< frames waiting to enter the filter
+    PipelineFrame *in_done;         ///< frames released by the filter, to release
+    struct FFBufQueue out_queue;    ///< frames output by the filter
+    PipelineFrame *out_done;        ///< frames released after the filter, to release
+    unsigned delivered;             ///< number of frames passed on after the filter
+    int in_eof;                     ///< the input of the filter is exhausted
+    int out_eof;                    ///< the filter is exhausted
+    int error;                      ///< error returned while pushing a frame in the worker
+    int busy;                       ///< the worker is running the filter
+    int paused;                     ///< the worker must not start running the filter
+    int done;                       ///< the worker must exit, or has exited
+
+    /* call made on the output of the filter, run by the worker */
+    enum PipelineCall call;         ///< call waiting to be started
+    int call_pending;               ///< a call was made and has not returned yet
+    int call_done;
+    int call_ret;
+    int call_orphan;                ///< the caller does not wait for the result anymore
+
+    /* call made by the filter on its input, run by the calling thread */
+    enum PipelineCall upcall;
+    int upcall_pending;
+    int upcall_done;
+    int upcall_ret;
+    int upcall_orphan;
+} PipelineContext;
+
+/**
+ * A frame passed across the boundary, wrapped in the AVFilterBuffer given to
+ * the receiving side.
+ */
+struct PipelineFrame {
+    PipelineContext *s;
+    AVFilterBufferRef *buf;         ///< the reference of the sending side
+    PipelineFrame **done;           ///< list to return buf to once released
+    PipelineFrame *next;
+};
+
+static void context_unref(PipelineContext *s)
+{
+    int last;
+
+    pthread_mutex_lock(&s->lock);
+    last = !--s->refcount;
+    pthread_mutex_unlock(&s->lock);
+
+    if (last) {
+        pthread_mutex_destroy(&s->lock);
+        pthread_cond_destroy(&s->cond);
+        av_free(s);
+    }
+}
+
+static void free_frame(PipelineFrame *f)
+{
+    PipelineContext *s = f->s;
+
+    avfilter_unref_buffer(f->buf);
+    av_free(f);
+    context_unref(s);
+}
+
+/**
+ * Free callback of the wrapped frames, run by the receiving side.
+ */
+static void release_frame(AVFilterBuffer *ptr)
+{
+    PipelineFrame *f = ptr->priv;
+    PipelineContext *s = f->s;
+
+    av_free(ptr);
+
+    pthread_mutex_lock(&s->lock);
+    if (!s->done) {
+        f->next  = *f->done;
+        *f->done = f;
+        f = NULL;
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    /* no thread is running anymore, release it directly */
+    if (f)
+        free_frame(f);
+}
+
+/**
+ * Wrap buf, a reference owned by the calling thread, into a new reference
+ * to the same data for the other side of the boundary.
+ */
+static AVFilterBufferRef *wrap_frame(PipelineContext *s, AVFilterBufferRef *buf,
+                                     PipelineFrame **done)
+{
+    PipelineFrame *f = av_mallocz(sizeof(*f));
+    AVFilterBufferRef *ref;
+
+    if (!f)
+        return NULL;
+    ref = avfilter_get_video_buffer_ref_from_arrays(buf->data, buf->linesize,
+                                                    buf->perms, buf->video->w,
+                                                    buf->video->h, buf->format);
+    if (!ref) {
+        av_free(f);
+        return NULL;
+    }
+    avfilter_copy_buffer_ref_props(ref, buf);
+    f->s           = s;
+    f->buf         = buf;
+    f->done        = done;
+    ref->buf->priv = f;
+    ref->buf->free = release_frame;
+
+    pthread_mutex_lock(&s->lock);
+    s->refcount++;
+    pthread_mutex_unlock(&s->lock);
+
+    return ref;
+}
+
+/**
+ * Release the frames of a done list. Must be called with the lock held,
+ * returns with the lock held, but releases it meanwhile if the list is not
+ * empty: the frames may be wrapped frames of another boundary. The state
+ * must thus be checked again before waiting on the condition.
+ */
+static void discard_done(PipelineContext *s, PipelineFrame **done)
+{
+    PipelineFrame *f = *done, *next;
+
+    if (!f)
+        return;
+    *done = NULL;
+    pthread_mutex_unlock(&s->lock);
+    for (; f; f = next) {
+        next = f->next;
+        free_frame(f);
+    }
+    pthread_mutex_lock(&s->lock);
+}
+
+static int push_frame(AVFilterLink *link, AVFilterBufferRef *buf)
+{
+    int ret;
+
+    if ((ret = ff_start_frame(link, buf)) < 0 ||
+        (ret = ff_draw_slice(link, 0, link->h, 1)) < 0 ||
+        (ret = ff_end_frame(link)) < 0)
+        return ret;
+    return 0;
+}
+
+/**
+ * Push the next frame of a queue to link.
+ * Must be called with the lock held, returns with the lock held.
+ */
+static int forward_frame(PipelineContext *s, struct FFBufQueue *queue,
+                         AVFilterLink *link)
+{
+    AVFilterBufferRef *buf = ff_bufqueue_get(queue);
+    int ret;
+
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+
+    ret = push_frame(link, buf);
+
+    pthread_mutex_lock(&s->lock);
+    return ret;
+}
+
+/**
+ * Pass on a frame output by the filter, in the calling thread.
+ * Must be called with the lock held, returns with the lock held.
+ */
+static int deliver_frame(PipelineContext *s)
+{
+    s->delivered++;
+    return forward_frame(s, &s->out_queue, s->leave->outputs[0]);
+}
+
+/**
+ * Run a call made by the filter on its input, in the calling thread.
+ * Must be called with the lock held, returns with the lock held.
+ */
+static void run_upcall(PipelineContext *s)
+{
+    enum PipelineCall call = s->upcall;
+    AVFilterLink *inlink = s->enter->inputs[0];
+    int ret;
+
+    s->upcall = CALL_NONE;
+    pthread_mutex_unlock(&s->lock);
+
+    ret = call == CALL_REQUEST ? ff_request_frame(inlink) : ff_poll_frame(inlink);
+
+    pthread_mutex_lock(&s->lock);
+    if (call == CALL_REQUEST && ret == AVERROR_EOF)
+        s->in_eof = 1;
+    s->upcall_pending = 0;
+    if (s->upcall_orphan) {
+        s->upcall_orphan = 0;
+    } else {
+        s->upcall_done = 1;
+        s->upcall_ret  = ret;
+    }
+    pthread_cond_broadcast(&s->cond);
+}
+
+/**
+ * Give up waiting for the result of a call made on the input of the filter.
+ * Must be called with the lock held.
+ */
+static void drop_upcall(PipelineContext *s)
+{
+    if (!s->upcall_pending)
+        return;
+    if (s->upcall) {
+        /* not started yet, cancel it */
+        s->upcall         = CALL_NONE;
+        s->upcall_pending = 0;
+    } else {
+        s->upcall_orphan  = 1;
+    }
+}
+
+/**
+ * Give up waiting for the result of a call made on the output of the filter.
+ * Must be called with the lock held.
+ */
+static void drop_call(PipelineContext *s)
+{
+    if (!s->call_pending)
+        return;
+    if (s->call) {
+        s->call         = CALL_NONE;
+        s->call_pending = 0;
+    } else {
+        s->call_orphan  = 1;
+    }
+}
+
+/**
+ * Make a call on the output of the filter from the calling thread, and
+ * serve the calls the filter makes on its input meanwhile.
+ */
+static int call_output(PipelineContext *s, enum PipelineCall call)
+{
+    unsigned delivered;
+    int input_requested = 0, input_eagain = 0;
+    int ret = 0;
+
+    pthread_mutex_lock(&s->lock);
+    delivered = s->delivered;
+    for (;;) {
+        discard_done(s, &s->in_done);
+        if (call == CALL_REQUEST && s->delivered != delivered)
+            break;
+        if (s->out_queue.available) {
+            if (call == CALL_REQUEST)
+                ret = deliver_frame(s);
+            else
+                ret = s->out_queue.available;
+            break;
+        }
+        if (s->error) {
+            ret = s->error;
+            s->error = 0;
+            break;
+        }
+        if (s->out_eof) {
+            ret = AVERROR_EOF;
+            break;
+        }
+        if (s->upcall) {
+            run_upcall(s);
+            continue;
+        }
+        if (call == CALL_REQUEST && !input_requested && !s->in_eof &&
+            (s->busy || s->in_queue.available) &&
+            s->in_queue.available < s->queue_size) {
+            /* while the filter is filtering, fetch its next input frame so
+             * that it does not have to wait for it afterwards */
+            input_requested = 1;
+            pthread_mutex_unlock(&s->lock);
+            ret = ff_request_frame(s->enter->inputs[0]);
+            pthread_mutex_lock(&s->lock);
+            if (ret == AVERROR_EOF)
+                s->in_eof = 1;
+            else if (ret == AVERROR(EAGAIN))
+                input_eagain = 1;
+            else if (ret < 0)
+                break;
+            ret = 0;
+            continue;
+        }
+        if (input_eagain) {
+            /* let the caller feed the graph rather than wait for the filter */
+            ret = AVERROR(EAGAIN);
+            break;
+        }
+        if (s->call_done) {
+            s->call_done = 0;
+            /* a successful request may not have output anything yet, for
+             * example if the filter dropped the frame; ask again */
+            if (s->call_ret < 0 || call == CALL_POLL) {
+                ret = s->call_ret;
+                break;
+            }
+            continue;
+        }
+        if (!s->call_pending && !s->busy && !s->in_queue.available) {
+            s->call         = call;
+            s->call_pending = 1;
+            pthread_cond_broadcast(&s->cond);
+        }
+        pthread_cond_wait(&s->cond, &s->lock);
+    }
+    drop_call(s);
+    pthread_mutex_unlock(&s->lock);
+
+    return ret;
+}
+
+static void *attribute_align_arg worker(void *arg)
+{
+    PipelineContext *s = arg;
+
+    pthread_mutex_lock(&s->lock);
+    discard_done(s, &s->out_done);
+    while (!s->done) {
+        if (s->paused) {
+            pthread_cond_wait(&s->cond, &s->lock);
+        } else if (s->in_queue.available) {
+            int ret;
+
+            s->busy = 1;
+            ret = forward_frame(s, &s->in_queue, s->enter->outputs[0]);
+            s->busy = 0;
+            if (ret < 0 && !s->error)
+                s->error = ret;
+            pthread_cond_broadcast(&s->cond);
+        } else if (s->call) {
+            enum PipelineCall call = s->call;
+            AVFilterLink *outlink = s->leave->inputs[0];
+            int ret;
+
+            s->call = CALL_NONE;
+            s->busy = 1;
+            pthread_mutex_unlock(&s->lock);
+
+            ret = call == CALL_REQUEST ? ff_request_frame(outlink) :
+                                         ff_poll_frame(outlink);
+
+            pthread_mutex_lock(&s->lock);
+            s->busy = 0;
+            if (call == CALL_REQUEST && ret == AVERROR_EOF)
+                s->out_eof = 1;
+            s->call_pending = 0;
+            if (s->call_orphan) {
+                s->call_orphan = 0;
+            } else {
+                s->call_done = 1;
+                s->call_ret  = ret;
+            }
+            pthread_cond_broadcast(&s->cond);
+        } else {
+            pthread_cond_wait(&s->cond, &s->lock);
+        }
+        discard_done(s, &s->out_done);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return NULL;
+}
+
+static void stop_worker(PipelineContext *s)
+{
+    pthread_mutex_lock(&s->lock);
+    s->done = 1;
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+
+    if (!s->thread_started)
+        return;
+    pthread_join(s->thread, NULL);
+    s->thread_started = 0;
+}
+
+static av_cold int enter_init(AVFilterContext *ctx, const char *args, void *opaque)
+{
+    PipelineContext **priv = ctx->priv;
+    PipelineContext *s;
+
+    if (!(s = av_mallocz(sizeof(*s))))
+        return AVERROR(ENOMEM);
+
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->cond, NULL);
+    s->refcount   = 1;
+    s->enter      = ctx;
+    s->queue_size = av_clip(*(int *)opaque, 1, FF_BUFQUEUE_SIZE);
+    *priv = s;
+
+    return 0;
+}
+
+static av_cold int leave_init(AVFilterContext *ctx, const char *args, void *opaque)
+{
+    PipelineContext **priv = ctx->priv;
+    PipelineContext *s = opaque;
+
+    s->refcount++;
+    s->leave = ctx;
+    *priv = s;
+
+    return 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    PipelineContext **priv = ctx->priv;
+    PipelineContext *s = *priv;
+
+    if (!s)
+        return;
+
+    /* the worker must not run the filter anymore once any of its ends
+     * is gone; the frames released from now on are released directly */
+    stop_worker(s);
+
+    /* release the frames coming from the side of the filter, while the
+     * links they were allocated on still exist */
+    if (ctx == s->enter) {
+        ff_bufqueue_discard_all(&s->in_queue);
+        pthread_mutex_lock(&s->lock);
+        discard_done(s, &s->in_done);
+        pthread_mutex_unlock(&s->lock);
+        s->enter = NULL;
+    } else {
+        ff_bufqueue_discard_all(&s->out_queue);
+        pthread_mutex_lock(&s->lock);
+        discard_done(s, &s->out_done);
+        pthread_mutex_unlock(&s->lock);
+        s->leave = NULL;
+    }
+
+    context_unref(s);
+    *priv = NULL;
+}
+
+static int null_start_frame(AVFilterLink *inlink, AVFilterBufferRef *buf)
+{
+    return 0;
+}
+
+static int null_draw_slice(AVFilterLink *inlink, int y, int h, int slice_dir)
+{
+    return 0;
+}
+
+static int enter_end_frame(AVFilterLink *inlink)
+{
+    PipelineContext *s = *(PipelineContext **)inlink->dst->priv;
+    AVFilterBufferRef *buf = wrap_frame(s, inlink->cur_buf, &s->in_done);
+    int ret = 0;
+
+    if (!buf) {
+        avfilter_unref_bufferp(&inlink->cur_buf);
+        return AVERROR(ENOMEM);
+    }
+    inlink->cur_buf = NULL;
+
+    pthread_mutex_lock(&s->lock);
+    /* the frames output by the filter meanwhile are passed on while waiting,
+     * like they would be from within this call if there were no thread */
+    discard_done(s, &s->in_done);
+    while (s->in_queue.available >= s->queue_size && ret >= 0) {
+        if (s->out_queue.available)
+            ret = deliver_frame(s);
+        else
+            pthread_cond_wait(&s->cond, &s->lock);
+        discard_done(s, &s->in_done);
+    }
+    if (ret < 0) {
+        pthread_mutex_unlock(&s->lock);
+        avfilter_unref_buffer(buf);
+        return ret;
+    }
+    ff_bufqueue_add(inlink->dst, &s->in_queue, buf);
+    pthread_cond_broadcast(&s->cond);
+
+    while (s->out_queue.available && ret >= 0)
+        ret = deliver_frame(s);
+    if (ret >= 0 && s->error) {
+        ret = s->error;
+        s->error = 0;
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return ret;
+}
+
+static int enter_config_props(AVFilterLink *outlink)
+{
+    PipelineContext *s = *(PipelineContext **)outlink->src->priv;
+
+    if (s->thread_started)
+        return 0;
+
+    if (pthread_create(&s->thread, NULL, worker, s)) {
+        av_log(outlink->src, AV_LOG_ERROR, "Failed to start the pipeline thread\n");
+        return AVERROR(ENOMEM);
+    }
+    s->thread_started = 1;
+
+    return 0;
+}
+
+/**
+ * Request or poll the input of the filter from the worker thread.
+ */
+static int call_input(PipelineContext *s, enum PipelineCall call)
+{
+    int ret;
+
+    pthread_mutex_lock(&s->lock);
+    for (;;) {
+        if (s->in_queue.available) {
+            if (call == CALL_REQUEST) {
+                drop_upcall(s);
+                ret = forward_frame(s, &s->in_queue, s->enter->outputs[0]);
+                break;
+            }
+            ret = s->in_queue.available;
+            break;
+        }
+        if (s->in_eof || s->done) {
+            ret = AVERROR_EOF;
+            break;
+        }
+        if (s->upcall_done) {
+            s->upcall_done = 0;
+            if (s->upcall_ret < 0 || call == CALL_POLL) {
+                ret = s->upcall_ret;
+                break;
+            }
+            continue;
+        }
+        if (!s->upcall_pending) {
+            s->upcall         = call;
+            s->upcall_pending = 1;
+            pthread_cond_broadcast(&s->cond);
+        }
+        pthread_cond_wait(&s->cond, &s->lock);
+    }
+    drop_upcall(s);
+    pthread_mutex_unlock(&s->lock);
+
+    return ret;
+}
+
+static int enter_request_frame(AVFilterLink *outlink)
+{
+    return call_input(*(PipelineContext **)outlink->src->priv, CALL_REQUEST);
+}
+
+static int enter_poll_frame(AVFilterLink *outlink)
+{
+    return call_input(*(PipelineContext **)outlink->src->priv, CALL_POLL);
+}
+
+static int leave_end_frame(AVFilterLink *inlink)
+{
+    PipelineContext *s = *(PipelineContext **)inlink->dst->priv;
+    AVFilterBufferRef *buf = wrap_frame(s, inlink->cur_buf, &s->out_done);
+
+    if (!buf) {
+        avfilter_unref_bufferp(&inlink->cur_buf);
+        return AVERROR(ENOMEM);
+    }
+    inlink->cur_buf = NULL;
+
+    pthread_mutex_lock(&s->lock);
+    discard_done(s, &s->out_done);
+    while (s->out_queue.available >= s->queue_size && !s->done) {
+        pthread_cond_wait(&s->cond, &s->lock);
+        discard_done(s, &s->out_done);
+    }
+    if (s->done) {
+        pthread_mutex_unlock(&s->lock);
+        avfilter_unref_buffer(buf);
+        return AVERROR_EOF;
+    }
+    ff_bufqueue_add(inlink->dst, &s->out_queue, buf);
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+
+    return 0;
+}
+
+static int leave_request_frame(AVFilterLink *outlink)
+{
+    return call_output(*(PipelineContext **)outlink->src->priv, CALL_REQUEST);
+}
+
+static int leave_poll_frame(AVFilterLink *outlink)
+{
+    return call_output(*(PipelineContext **)outlink->src->priv, CALL_POLL);
+}
+
+static AVFilter pipeline_enter = {
+    .name        = "pipeline_enter",
+    .description = NULL_IF_CONFIG_SMALL("Queue frames for a filter running in another thread."),
+    .priv_size   = sizeof(PipelineContext *),
+    .init_opaque = enter_init,
+    .uninit      = uninit,
+
+    .inputs    = (const AVFilterPad[]) {{ .name             = "default",
+                                          .type             = AVMEDIA_TYPE_VIDEO,
+                                          .start_frame      = null_start_frame,
+                                          .draw_slice       = null_draw_slice,
+                                          .end_frame        = enter_end_frame,
+                                          .min_perms        = AV_PERM_READ, },
+                                        { .name = NULL }},
+    .outputs   = (const AVFilterPad[]) {{ .name             = "default",
+                                          .type             = AVMEDIA_TYPE_VIDEO,
+                                          .config_props     = enter_config_props,
+                                          .request_frame    = enter_request_frame,
+                                          .poll_frame       = enter_poll_frame, },
+                                        { .name = NULL }},
+};
+
+static AVFilter pipeline_leave = {
+    .name        = "pipeline_leave",
+    .description = NULL_IF_CONFIG_SMALL("Queue frames output by a filter running in another thread."),
+    .priv_size   = sizeof(PipelineContext *),
+    .init_opaque = leave_init,
+    .uninit      = uninit,
+
+    .inputs    = (const AVFilterPad[]) {{ .name             = "default",
+                                          .type             = AVMEDIA_TYPE_VIDEO,
+                                          .start_frame      = null_start_frame,
+                                          .draw_slice       = null_draw_slice,
+                                          .end_frame        = leave_end_frame,
+                                          .min_perms        = AV_PERM_READ, },
+                                        { .name = NULL }},
+    .outputs   = (const AVFilterPad[]) {{ .name             = "default",
+                                          .type             = AVMEDIA_TYPE_VIDEO,
+                                          .request_frame    = leave_request_frame,
+                                          .poll_frame       = leave_poll_frame, },
+                                        { .name = NULL }},
+};
+
+static int can_pipeline(AVFilterContext *f)
+{
+    return f->nb_inputs == 1 && f->nb_outputs == 1 &&
+           f->inputs[0]  && f->inputs[0] ->type == AVMEDIA_TYPE_VIDEO &&
+           f->outputs[0] && f->outputs[0]->type == AVMEDIA_TYPE_VIDEO &&
+           f->filter != &pipeline_enter && f->filter != &pipeline_leave &&
+           strcmp(f->filter->name, "fifo");
+}
+
+/**
+ * Find the pipeline running filter in its thread, if any.
+ */
+static PipelineContext *find_pipeline(AVFilterGraph *graph, AVFilterContext *filter)
+{
+    unsigned i;
+
+    for (i = 0; i < graph->filter_count; i++) {
+        AVFilterContext *f = graph->filters[i];
+        PipelineContext *s;
+
+        if (f->filter != &pipeline_enter)
+            continue;
+        s = *(PipelineContext **)f->priv;
+        while (f->outputs[0] && (f = f->outputs[0]->dst) && f != s->leave)
+            if (f == filter)
+                return s->thread_started ? s : NULL;
+    }
+    return NULL;
+}
+
+void ff_graph_pause_pipeline(AVFilterGraph *graph, AVFilterContext *filter)
+{
+    PipelineContext *s = find_pipeline(graph, filter);
+    int ret;
+
+    if (!s)
+        return;
+
+    pthread_mutex_lock(&s->lock);
+    s->paused = 1;
+    /* the worker may be waiting for the calling thread to finish the frame
+     * it is filtering, serve it as call_output() would */
+    discard_done(s, &s->in_done);
+    while (s->busy) {
+        if (s->upcall) {
+            run_upcall(s);
+        } else if (s->out_queue.available >= s->queue_size) {
+            if ((ret = deliver_frame(s)) < 0 && !s->error)
+                s->error = ret;
+        } else {
+            pthread_cond_wait(&s->cond, &s->lock);
+        }
+        discard_done(s, &s->in_done);
+    }
+    pthread_mutex_unlock(&s->lock);
+}
+
+void ff_graph_resume_pipeline(AVFilterGraph *graph, AVFilterContext *filter)
+{
+    PipelineContext *s = find_pipeline(graph, filter);
+
+    if (!s)
+        return;
+
+    pthread_mutex_lock(&s->lock);
+    s->paused = 0;
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+}
+
+int ff_graph_insert_pipelines(AVFilterGraph *graph, void *log_ctx)
+{
+    unsigned i, nb_filters = graph->filter_count;
+    int count = 0, ret;
+
+    if (graph->pipeline_queue_size <= 0)
+        return 0;
+
+    for (i = 0; i < nb_filters; i++) {
+        AVFilterContext *filter = graph->filters[i];
+        AVFilterContext *enter, *leave;
+        char name[64];
+
+        if (!can_pipeline(filter))
+            continue;
+
+        snprintf(name, sizeof(name), "auto-inserted pipeline_enter %d", count);
+        if ((ret = avfilter_open(&enter, &pipeline_enter, name)) < 0)
+            return ret;
+        if ((ret = avfilter_init_filter(enter, NULL, &graph->pipeline_queue_size)) < 0 ||
+            (ret = avfilter_graph_add_filter(graph, enter)) < 0) {
+            avfilter_free(enter);
+            return ret;
+        }
+
+        snprintf(name, sizeof(name), "auto-inserted pipeline_leave %d", count++);
+        if ((ret = avfilter_open(&leave, &pipeline_leave, name)) < 0)
+            return ret;
+        if ((ret = avfilter_init_filter(leave, NULL, *(PipelineContext **)enter->priv)) < 0 ||
+            (ret = avfilter_graph_add_filter(graph, leave)) < 0) {
+            avfilter_free(leave);
+            return ret;
+        }
+
+        if ((ret = avfilter_insert_filter(filter->inputs[0], enter, 0, 0)) < 0 ||
+            (ret = avfilter_insert_filter(filter->outputs[0], leave, 0, 0)) < 0)
+            return ret;
+
+        av_log(log_ctx, AV_LOG_VERBOSE, "Running '%s' in its own thread\n",
+               filter->name);
+    }
+
+    return 0;
+}
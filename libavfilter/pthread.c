@@ -0,0 +1,201 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Slice threading for libavfilter.
+ *
+ * Every filtergraph owns one pool of worker threads, shared by all its
+ * filters. Filters are still called one at a time from the thread pushing
+ * frames into the graph, they only hand the independent parts of their work
+ * to the pool through AVFilterContext.execute(). When filters run in
+ * several threads (see pipeline.c), the pool serves one execute() call at a
+ * time and the others run their jobs serially.
+ */
+
+#include <pthread.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "avfilter.h"
+#include "avfiltergraph.h"
+#include "internal.h"
+
+typedef struct ThreadContext {
+    pthread_t *workers;
+    int nb_workers;
+
+    pthread_mutex_t execute_lock;   ///< Held for the duration of an execute() call.
+    pthread_mutex_t lock;
+    pthread_cond_t job_cond;        ///< Signaled when new jobs are queued or on exit.
+    pthread_cond_t done_cond;       ///< Signaled when the last job has finished.
+    int job_count;
+    int current_job;
+    int finished_jobs;
+    int done;
+
+    /* arguments of the current ff_graph_thread_execute() call */
+    AVFilterContext *ctx;
+    avfilter_action_func *func;
+    void *arg;
+    int *rets;
+} ThreadContext;
+
+static void run_job(ThreadContext *t, int jobnr)
+{
+    int ret = t->func(t->ctx, t->arg, jobnr, t->job_count);
+
+    if (t->rets)
+        t->rets[jobnr] = ret;
+}
+
+static void *attribute_align_arg worker(void *arg)
+{
+    ThreadContext *t = arg;
+
+    pthread_mutex_lock(&t->lock);
+    for (;;) {
+        int jobnr;
+
+        while (!t->done && t->current_job >= t->job_count)
+            pthread_cond_wait(&t->job_cond, &t->lock);
+        if (t->done)
+            break;
+
+        jobnr = t->current_job++;
+        pthread_mutex_unlock(&t->lock);
+
+        run_job(t, jobnr);
+
+        pthread_mutex_lock(&t->lock);
+        if (++t->finished_jobs == t->job_count)
+            pthread_cond_signal(&t->done_cond);
+    }
+    pthread_mutex_unlock(&t->lock);
+
+    return NULL;
+}
+
+int ff_graph_thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
+                            void *arg, int *ret, int nb_jobs)
+{
+    ThreadContext *t = ctx->graph->thread_opaque;
+
+    if (nb_jobs <= 0)
+        return 0;
+
+    if (pthread_mutex_trylock(&t->execute_lock)) {
+        int i;
+        for (i = 0; i < nb_jobs; i++) {
+            int r = func(ctx, arg, i, nb_jobs);
+            if (ret)
+                ret[i] = r;
+        }
+        return 0;
+    }
+
+    pthread_mutex_lock(&t->lock);
+    t->ctx           = ctx;
+    t->func          = func;
+    t->arg           = arg;
+    t->rets          = ret;
+    t->finished_jobs = 0;
+    t->current_job   = 0;
+    t->job_count     = nb_jobs;
+    if (nb_jobs > 1)
+        pthread_cond_broadcast(&t->job_cond);
+
+    /* the calling thread takes its share of the jobs too */
+    while (t->current_job < t->job_count) {
+        int jobnr = t->current_job++;
+        pthread_mutex_unlock(&t->lock);
+
+        run_job(t, jobnr);
+
+        pthread_mutex_lock(&t->lock);
+        t->finished_jobs++;
+    }
+    while (t->finished_jobs < t->job_count)
+        pthread_cond_wait(&t->done_cond, &t->lock);
+    pthread_mutex_unlock(&t->lock);
+    pthread_mutex_unlock(&t->execute_lock);
+
+    return 0;
+}
+
+av_cold int ff_graph_thread_init(AVFilterGraph *graph)
+{
+    ThreadContext *t;
+    int i;
+
+    if (graph->nb_threads <= 1 || graph->thread_opaque)
+        return 0;
+
+    t = av_mallocz(sizeof(*t));
+    if (!t)
+        return AVERROR(ENOMEM);
+    graph->thread_opaque = t;
+    pthread_mutex_init(&t->execute_lock, NULL);
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->job_cond, NULL);
+    pthread_cond_init(&t->done_cond, NULL);
+
+    t->workers = av_mallocz((graph->nb_threads - 1) * sizeof(*t->workers));
+    if (!t->workers)
+        goto fail;
+
+    for (i = 0; i < graph->nb_threads - 1; i++) {
+        if (pthread_create(&t->workers[i], NULL, worker, t))
+            goto fail;
+        t->nb_workers++;
+    }
+
+    for (i = 0; i < graph->filter_count; i++)
+        graph->filters[i]->execute = ff_graph_thread_execute;
+
+    return 0;
+fail:
+    av_log(graph, AV_LOG_ERROR, "Failed to start %d filter threads\n",
+           graph->nb_threads);
+    ff_graph_thread_free(graph);
+    return AVERROR(ENOMEM);
+}
+
+av_cold void ff_graph_thread_free(AVFilterGraph *graph)
+{
+    ThreadContext *t = graph->thread_opaque;
+    int i;
+
+    if (!t)
+        return;
+
+    pthread_mutex_lock(&t->lock);
+    t->done = 1;
+    pthread_cond_broadcast(&t->job_cond);
+    pthread_mutex_unlock(&t->lock);
+
+    for (i = 0; i < t->nb_workers; i++)
+        pthread_join(t->workers[i], NULL);
+
+    pthread_mutex_destroy(&t->execute_lock);
+    pthread_mutex_destroy(&t->lock);
+    pthread_cond_destroy(&t->job_cond);
+    pthread_cond_destroy(&t->done_cond);
+    av_freep(&t->workers);
+    av_freep(&graph->thread_opaque);
+}
@@ -70,9 +70,16 @@ typedef struct {
     int hsub, vsub;
     int radius[4];
     int power[4];
-    uint8_t *temp[2]; ///< temporary buffer used in blur_power()
+    uint8_t *temp[2]; ///< temporary buffers used in blur_power(), one slice of temp_size bytes per thread
+    int temp_size;
+    int nb_threads;
 } BoxBlurContext;
 
+typedef struct {
+    AVFilterBufferRef *in, *out;
+    int w[4], h[4];
+} ThreadData;
+
 #define Y 0
 #define U 1
 #define V 2
@@ -148,8 +155,10 @@ static int config_input(AVFilterLink *inlink)
     char *expr;
     int ret;
 
-    if (!(boxblur->temp[0] = av_malloc(FFMAX(w, h))) ||
-        !(boxblur->temp[1] = av_malloc(FFMAX(w, h))))
+    boxblur->nb_threads = ff_filter_get_nb_threads(ctx);
+    boxblur->temp_size  = FFMAX(w, h);
+    if (!(boxblur->temp[0] = av_malloc(boxblur->nb_threads * boxblur->temp_size)) ||
+        !(boxblur->temp[1] = av_malloc(boxblur->nb_threads * boxblur->temp_size)))
         return AVERROR(ENOMEM);
 
     boxblur->hsub = desc->log2_chroma_w;
@@ -304,6 +313,46 @@ static void vblur(uint8_t *dst, int dst_linesize, const uint8_t *src, int src_li
 
 static int null_draw_slice(AVFilterLink *inlink, int y, int h, int slice_dir) { return 0; }
 
+static int filter_hblur(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    BoxBlurContext *boxblur = ctx->priv;
+    ThreadData *td = arg;
+    uint8_t *temp[2] = { boxblur->temp[0] + jobnr * boxblur->temp_size,
+                         boxblur->temp[1] + jobnr * boxblur->temp_size };
+    int plane;
+
+    for (plane = 0; td->in->data[plane] && plane < 4; plane++) {
+        int start = (td->h[plane] *  jobnr     ) / nb_jobs;
+        int end   = (td->h[plane] * (jobnr + 1)) / nb_jobs;
+
+        hblur(td->out->data[plane] + start * td->out->linesize[plane], td->out->linesize[plane],
+              td->in ->data[plane] + start * td->in ->linesize[plane], td->in ->linesize[plane],
+              td->w[plane], end - start, boxblur->radius[plane], boxblur->power[plane],
+              temp);
+    }
+    return 0;
+}
+
+static int filter_vblur(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    BoxBlurContext *boxblur = ctx->priv;
+    ThreadData *td = arg;
+    uint8_t *temp[2] = { boxblur->temp[0] + jobnr * boxblur->temp_size,
+                         boxblur->temp[1] + jobnr * boxblur->temp_size };
+    int plane;
+
+    for (plane = 0; td->in->data[plane] && plane < 4; plane++) {
+        int start = (td->w[plane] *  jobnr     ) / nb_jobs;
+        int end   = (td->w[plane] * (jobnr + 1)) / nb_jobs;
+
+        vblur(td->out->data[plane] + start, td->out->linesize[plane],
+              td->out->data[plane] + start, td->out->linesize[plane],
+              end - start, td->h[plane], boxblur->radius[plane], boxblur->power[plane],
+              temp);
+    }
+    return 0;
+}
+
 static int end_frame(AVFilterLink *inlink)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -311,22 +360,19 @@ static int end_frame(AVFilterLink *inlink)
     AVFilterLink *outlink = inlink->dst->outputs[0];
     AVFilterBufferRef *inpicref  = inlink ->cur_buf;
     AVFilterBufferRef *outpicref = outlink->out_buf;
-    int plane;
     int cw = inlink->w >> boxblur->hsub, ch = inlink->h >> boxblur->vsub;
-    int w[4] = { inlink->w, cw, cw, inlink->w };
-    int h[4] = { inlink->h, ch, ch, inlink->h };
-
-    for (plane = 0; inpicref->data[plane] && plane < 4; plane++)
-        hblur(outpicref->data[plane], outpicref->linesize[plane],
-              inpicref ->data[plane], inpicref ->linesize[plane],
-              w[plane], h[plane], boxblur->radius[plane], boxblur->power[plane],
-              boxblur->temp);
-
-    for (plane = 0; inpicref->data[plane] && plane < 4; plane++)
-        vblur(outpicref->data[plane], outpicref->linesize[plane],
-              outpicref->data[plane], outpicref->linesize[plane],
-              w[plane], h[plane], boxblur->radius[plane], boxblur->power[plane],
-              boxblur->temp);
+    int nb_jobs = FFMIN(boxblur->nb_threads, ff_filter_get_nb_threads(ctx));
+    ThreadData td = {
+        .in  = inpicref,
+        .out = outpicref,
+        .w   = { inlink->w, cw, cw, inlink->w },
+        .h   = { inlink->h, ch, ch, inlink->h },
+    };
+
+    /* every column is blurred vertically only once all lines are blurred
+     * horizontally, so the two passes are run as separate operations */
+    ctx->execute(ctx, filter_hblur, &td, NULL, nb_jobs);
+    ctx->execute(ctx, filter_vblur, &td, NULL, nb_jobs);
 
     ff_draw_slice(outlink, 0, inlink->h, 1);
     return avfilter_default_end_frame(inlink);
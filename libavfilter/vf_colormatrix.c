@@ -32,6 +32,7 @@
 #include <float.h>
 #include "avfilter.h"
 #include "formats.h"
+#include "internal.h"
 #include "video.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/avstring.h"
@@ -64,6 +65,10 @@ typedef struct {
     AVFilterBufferRef *outpicref;
 } ColorMatrixContext;
 
+typedef struct {
+    AVFilterBufferRef *dst, *src;
+} ThreadData;
+
 #define ma m[0][0]
 #define mb m[0][1]
 #define mc m[0][2]
@@ -183,15 +188,20 @@ static av_cold int init(AVFilterContext *ctx, const char *args)
     return 0;
 }
 
-static void process_frame_uyvy422(ColorMatrixContext *color,
-                                  AVFilterBufferRef *dst, AVFilterBufferRef *src)
+static int process_slice_uyvy422(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    const unsigned char *srcp = src->data[0];
-    const int src_pitch = src->linesize[0];
+    ColorMatrixContext *color = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFilterBufferRef *src = td->src;
+    AVFilterBufferRef *dst = td->dst;
     const int height = src->video->h;
+    const int slice_start = (height *  jobnr     ) / nb_jobs;
+    const int slice_end   = (height * (jobnr + 1)) / nb_jobs;
+    const int src_pitch = src->linesize[0];
     const int width = src->video->w*2;
-    unsigned char *dstp = dst->data[0];
     const int dst_pitch = dst->linesize[0];
+    const unsigned char *srcp = src->data[0] + slice_start * src_pitch;
+    unsigned char *dstp = dst->data[0] + slice_start * dst_pitch;
     const int c2 = color->yuv_convert[color->mode][0][1];
     const int c3 = color->yuv_convert[color->mode][0][2];
     const int c4 = color->yuv_convert[color->mode][1][1];
@@ -200,7 +210,7 @@ static void process_frame_uyvy422(ColorMatrixContext *color,
     const int c7 = color->yuv_convert[color->mode][2][2];
     int x, y;
 
-    for (y = 0; y < height; y++) {
+    for (y = slice_start; y < slice_end; y++) {
         for (x = 0; x < width; x += 4) {
             const int u = srcp[x + 0] - 128;
             const int v = srcp[x + 2] - 128;
@@ -213,23 +223,30 @@ static void process_frame_uyvy422(ColorMatrixContext *color,
         srcp += src_pitch;
         dstp += dst_pitch;
     }
+
+    return 0;
 }
 
-static void process_frame_yuv422p(ColorMatrixContext *color,
-                                  AVFilterBufferRef *dst, AVFilterBufferRef *src)
+static int process_slice_yuv422p(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    const unsigned char *srcpU = src->data[1];
-    const unsigned char *srcpV = src->data[2];
-    const unsigned char *srcpY = src->data[0];
+    ColorMatrixContext *color = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFilterBufferRef *src = td->src;
+    AVFilterBufferRef *dst = td->dst;
+    const int height = src->video->h;
+    const int slice_start = (height *  jobnr     ) / nb_jobs;
+    const int slice_end   = (height * (jobnr + 1)) / nb_jobs;
     const int src_pitchY  = src->linesize[0];
     const int src_pitchUV = src->linesize[1];
-    const int height = src->video->h;
+    const unsigned char *srcpU = src->data[1] + slice_start * src_pitchUV;
+    const unsigned char *srcpV = src->data[2] + slice_start * src_pitchUV;
+    const unsigned char *srcpY = src->data[0] + slice_start * src_pitchY;
     const int width = src->video->w;
-    unsigned char *dstpU = dst->data[1];
-    unsigned char *dstpV = dst->data[2];
-    unsigned char *dstpY = dst->data[0];
     const int dst_pitchY  = dst->linesize[0];
     const int dst_pitchUV = dst->linesize[1];
+    unsigned char *dstpU = dst->data[1] + slice_start * dst_pitchUV;
+    unsigned char *dstpV = dst->data[2] + slice_start * dst_pitchUV;
+    unsigned char *dstpY = dst->data[0] + slice_start * dst_pitchY;
     const int c2 = color->yuv_convert[color->mode][0][1];
     const int c3 = color->yuv_convert[color->mode][0][2];
     const int c4 = color->yuv_convert[color->mode][1][1];
@@ -238,7 +255,7 @@ static void process_frame_yuv422p(ColorMatrixContext *color,
     const int c7 = color->yuv_convert[color->mode][2][2];
     int x, y;
 
-    for (y = 0; y < height; y++) {
+    for (y = slice_start; y < slice_end; y++) {
         for (x = 0; x < width; x += 2) {
             const int u = srcpU[x >> 1] - 128;
             const int v = srcpV[x >> 1] - 128;
@@ -255,25 +272,34 @@ static void process_frame_yuv422p(ColorMatrixContext *color,
         dstpU += dst_pitchUV;
         dstpV += dst_pitchUV;
     }
+
+    return 0;
 }
 
-static void process_frame_yuv420p(ColorMatrixContext *color,
-                                  AVFilterBufferRef *dst, AVFilterBufferRef *src)
+static int process_slice_yuv420p(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    const unsigned char *srcpU = src->data[1];
-    const unsigned char *srcpV = src->data[2];
-    const unsigned char *srcpY = src->data[0];
-    const unsigned char *srcpN = src->data[0] + src->linesize[0];
+    ColorMatrixContext *color = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFilterBufferRef *src = td->src;
+    AVFilterBufferRef *dst = td->dst;
+    const int height = src->video->h;
+    /* lines are processed in pairs sharing the same chroma line */
+    const int nb_pairs = (height + 1) >> 1;
+    const int slice_start = ((nb_pairs *  jobnr     ) / nb_jobs) << 1;
+    const int slice_end   = ((nb_pairs * (jobnr + 1)) / nb_jobs) << 1;
     const int src_pitchY  = src->linesize[0];
     const int src_pitchUV = src->linesize[1];
-    const int height = src->video->h;
+    const unsigned char *srcpU = src->data[1] + (slice_start >> 1) * src_pitchUV;
+    const unsigned char *srcpV = src->data[2] + (slice_start >> 1) * src_pitchUV;
+    const unsigned char *srcpY = src->data[0] +  slice_start       * src_pitchY;
+    const unsigned char *srcpN = src->data[0] + (slice_start + 1)  * src_pitchY;
     const int width = src->video->w;
-    unsigned char *dstpU = dst->data[1];
-    unsigned char *dstpV = dst->data[2];
-    unsigned char *dstpY = dst->data[0];
-    unsigned char *dstpN = dst->data[0] + dst->linesize[0];
     const int dst_pitchY  = dst->linesize[0];
     const int dst_pitchUV = dst->linesize[1];
+    unsigned char *dstpU = dst->data[1] + (slice_start >> 1) * dst_pitchUV;
+    unsigned char *dstpV = dst->data[2] + (slice_start >> 1) * dst_pitchUV;
+    unsigned char *dstpY = dst->data[0] +  slice_start       * dst_pitchY;
+    unsigned char *dstpN = dst->data[0] + (slice_start + 1)  * dst_pitchY;
     const int c2 = color->yuv_convert[color->mode][0][1];
     const int c3 = color->yuv_convert[color->mode][0][2];
     const int c4 = color->yuv_convert[color->mode][1][1];
@@ -282,15 +308,23 @@ static void process_frame_yuv420p(ColorMatrixContext *color,
     const int c7 = color->yuv_convert[color->mode][2][2];
     int x, y;
 
-    for (y = 0; y < height; y += 2) {
+    for (y = slice_start; y < slice_end; y += 2) {
+        /* do not write past the last line of an odd-height picture, it may
+         * belong to another plane processed by another job */
+        if (y + 1 == height) {
+            srcpN = srcpY;
+            dstpN = dstpY;
+        }
         for (x = 0; x < width; x += 2) {
             const int u = srcpU[x >> 1] - 128;
             const int v = srcpV[x >> 1] - 128;
             const int uvval = c2 * u + c3 * v + 1081344;
-            dstpY[x + 0] = CB((65536 * (srcpY[x + 0] - 16) + uvval) >> 16);
-            dstpY[x + 1] = CB((65536 * (srcpY[x + 1] - 16) + uvval) >> 16);
-            dstpN[x + 0] = CB((65536 * (srcpN[x + 0] - 16) + uvval) >> 16);
-            dstpN[x + 1] = CB((65536 * (srcpN[x + 1] - 16) + uvval) >> 16);
+            const int y0 = srcpY[x + 0], y1 = srcpY[x + 1];
+            const int n0 = srcpN[x + 0], n1 = srcpN[x + 1];
+            dstpY[x + 0] = CB((65536 * (y0 - 16) + uvval) >> 16);
+            dstpY[x + 1] = CB((65536 * (y1 - 16) + uvval) >> 16);
+            dstpN[x + 0] = CB((65536 * (n0 - 16) + uvval) >> 16);
+            dstpN[x + 1] = CB((65536 * (n1 - 16) + uvval) >> 16);
             dstpU[x >> 1] = CB((c4 * u + c5 * v + 8421376) >> 16);
             dstpV[x >> 1] = CB((c6 * u + c7 * v + 8421376) >> 16);
         }
@@ -303,6 +337,8 @@ static void process_frame_yuv420p(ColorMatrixContext *color,
         dstpU += dst_pitchUV;
         dstpV += dst_pitchUV;
     }
+
+    return 0;
 }
 
 static int config_input(AVFilterLink *inlink)
@@ -355,14 +391,15 @@ static int end_frame(AVFilterLink *link)
 {
     AVFilterContext *ctx = link->dst;
     ColorMatrixContext *color = ctx->priv;
-    AVFilterBufferRef *out = color->outpicref;
+    ThreadData td = { .dst = color->outpicref, .src = link->cur_buf };
+    int nb_jobs = FFMIN((link->h + 1) / 2, ff_filter_get_nb_threads(ctx));
 
     if (link->cur_buf->format == PIX_FMT_YUV422P)
-        process_frame_yuv422p(color, out, link->cur_buf);
+        ctx->execute(ctx, process_slice_yuv422p, &td, NULL, nb_jobs);
     else if (link->cur_buf->format == PIX_FMT_YUV420P)
-        process_frame_yuv420p(color, out, link->cur_buf);
+        ctx->execute(ctx, process_slice_yuv420p, &td, NULL, nb_jobs);
     else
-        process_frame_uyvy422(color, out, link->cur_buf);
+        ctx->execute(ctx, process_slice_uyvy422, &td, NULL, nb_jobs);
 
     ff_draw_slice(ctx->outputs[0], 0, link->dst->outputs[0]->h, 1);
     return ff_end_frame(ctx->outputs[0]);
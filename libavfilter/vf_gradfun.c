@@ -78,13 +78,17 @@ void ff_gradfun_blur_line_c(uint16_t *dc, uint16_t *buf, const uint16_t *buf1, c
     }
 }
 
-static void filter(GradFunContext *ctx, uint8_t *dst, const uint8_t *src, int width, int height, int dst_linesize, int src_linesize, int r)
+typedef struct {
+    AVFilterBufferRef *in, *out;
+} ThreadData;
+
+static void filter(GradFunContext *ctx, uint16_t *plane_buf, uint8_t *dst, const uint8_t *src, int width, int height, int dst_linesize, int src_linesize, int r)
 {
     int bstride = FFALIGN(width, 16) / 2;
     int y;
     uint32_t dc_factor = (1 << 21) / (r * r);
-    uint16_t *dc = ctx->buf + 16;
-    uint16_t *buf = ctx->buf + bstride + 32;
+    uint16_t *dc = plane_buf + 16;
+    uint16_t *buf = plane_buf + bstride + 32;
     int thresh = ctx->thresh;
 
     memset(dc, 0, (bstride + 16) * sizeof(*buf));
@@ -146,7 +150,10 @@ static av_cold int init(AVFilterContext *ctx, const char *args)
 static av_cold void uninit(AVFilterContext *ctx)
 {
     GradFunContext *gf = ctx->priv;
-    av_freep(&gf->buf);
+    int p;
+
+    for (p = 0; p < 3; p++)
+        av_freep(&gf->buf[p]);
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -169,10 +176,13 @@ static int config_input(AVFilterLink *inlink)
     GradFunContext *gf = inlink->dst->priv;
     int hsub = av_pix_fmt_descriptors[inlink->format].log2_chroma_w;
     int vsub = av_pix_fmt_descriptors[inlink->format].log2_chroma_h;
+    int p;
 
-    gf->buf = av_mallocz((FFALIGN(inlink->w, 16) * (gf->radius + 1) / 2 + 32) * sizeof(uint16_t));
-    if (!gf->buf)
-        return AVERROR(ENOMEM);
+    for (p = 0; p < 3; p++) {
+        gf->buf[p] = av_mallocz((FFALIGN(inlink->w, 16) * (gf->radius + 1) / 2 + 32) * sizeof(uint16_t));
+        if (!gf->buf[p])
+            return AVERROR(ENOMEM);
+    }
 
     gf->chroma_w = -((-inlink->w) >> hsub);
     gf->chroma_h = -((-inlink->h) >> vsub);
@@ -186,29 +196,41 @@ static int null_draw_slice(AVFilterLink *link, int y, int h, int slice_dir)
     return 0;
 }
 
+/* the blur is computed incrementally from line to line, so each job
+ * handles a whole plane */
+static int filter_plane(AVFilterContext *ctx, void *arg, int p, int nb_jobs)
+{
+    GradFunContext *gf = ctx->priv;
+    ThreadData *td = arg;
+    AVFilterBufferRef *inpic  = td->in;
+    AVFilterBufferRef *outpic = td->out;
+    int w = ctx->inputs[0]->w;
+    int h = ctx->inputs[0]->h;
+    int r = gf->radius;
+
+    if (p) {
+        w = gf->chroma_w;
+        h = gf->chroma_h;
+        r = gf->chroma_r;
+    }
+
+    if (FFMIN(w, h) > 2 * r)
+        filter(gf, gf->buf[p], outpic->data[p], inpic->data[p], w, h, outpic->linesize[p], inpic->linesize[p], r);
+    else if (outpic->data[p] != inpic->data[p])
+        av_image_copy_plane(outpic->data[p], outpic->linesize[p], inpic->data[p], inpic->linesize[p], w, h);
+    return 0;
+}
+
 static int end_frame(AVFilterLink *inlink)
 {
-    GradFunContext *gf = inlink->dst->priv;
+    AVFilterContext *ctx = inlink->dst;
     AVFilterBufferRef *inpic = inlink->cur_buf;
-    AVFilterLink *outlink = inlink->dst->outputs[0];
-    AVFilterBufferRef *outpic = outlink->out_buf;
-    int p, ret;
-
-    for (p = 0; p < 4 && inpic->data[p]; p++) {
-        int w = inlink->w;
-        int h = inlink->h;
-        int r = gf->radius;
-        if (p) {
-            w = gf->chroma_w;
-            h = gf->chroma_h;
-            r = gf->chroma_r;
-        }
+    AVFilterLink *outlink = ctx->outputs[0];
+    ThreadData td = { .in = inpic, .out = outlink->out_buf };
+    int nb_planes, ret;
 
-        if (FFMIN(w, h) > 2 * r)
-            filter(gf, outpic->data[p], inpic->data[p], w, h, outpic->linesize[p], inpic->linesize[p], r);
-        else if (outpic->data[p] != inpic->data[p])
-            av_image_copy_plane(outpic->data[p], outpic->linesize[p], inpic->data[p], inpic->linesize[p], w, h);
-    }
+    for (nb_planes = 0; nb_planes < 3 && inpic->data[nb_planes]; nb_planes++);
+    ctx->execute(ctx, filter_plane, &td, NULL, nb_planes);
 
     if ((ret = ff_draw_slice(outlink, 0, inlink->h, 1)) < 0 ||
         (ret = ff_end_frame(outlink)) < 0)
@@ -36,7 +36,7 @@
 
 typedef struct {
     int16_t *coefs[4];
-    uint16_t *line;
+    uint16_t *line[3];
     uint16_t *frame_prev[3];
     double strength[4];
     int hsub, vsub;
@@ -44,6 +44,10 @@ typedef struct {
     void (*denoise_row[17])(uint8_t *src, uint8_t *dst, uint16_t *line_ant, uint16_t *frame_ant, ptrdiff_t w, int16_t *spatial, int16_t *temporal);
 } HQDN3DContext;
 
+typedef struct {
+    AVFilterBufferRef *in, *out;
+} ThreadData;
+
 void ff_hqdn3d_row_8_x86(uint8_t *src, uint8_t *dst, uint16_t *line_ant, uint16_t *frame_ant, ptrdiff_t w, int16_t *spatial, int16_t *temporal);
 void ff_hqdn3d_row_9_x86(uint8_t *src, uint8_t *dst, uint16_t *line_ant, uint16_t *frame_ant, ptrdiff_t w, int16_t *spatial, int16_t *temporal);
 void ff_hqdn3d_row_10_x86(uint8_t *src, uint8_t *dst, uint16_t *line_ant, uint16_t *frame_ant, ptrdiff_t w, int16_t *spatial, int16_t *temporal);
@@ -256,7 +260,9 @@ static void uninit(AVFilterContext *ctx)
     av_freep(&hqdn3d->coefs[1]);
     av_freep(&hqdn3d->coefs[2]);
     av_freep(&hqdn3d->coefs[3]);
-    av_freep(&hqdn3d->line);
+    av_freep(&hqdn3d->line[0]);
+    av_freep(&hqdn3d->line[1]);
+    av_freep(&hqdn3d->line[2]);
     av_freep(&hqdn3d->frame_prev[0]);
     av_freep(&hqdn3d->frame_prev[1]);
     av_freep(&hqdn3d->frame_prev[2]);
@@ -301,9 +307,11 @@ static int config_input(AVFilterLink *inlink)
     hqdn3d->vsub = av_pix_fmt_descriptors[inlink->format].log2_chroma_h;
     hqdn3d->depth = av_pix_fmt_descriptors[inlink->format].comp[0].depth_minus1+1;
 
-    hqdn3d->line = av_malloc(inlink->w * sizeof(*hqdn3d->line));
-    if (!hqdn3d->line)
-        return AVERROR(ENOMEM);
+    for (i = 0; i < 3; i++) {
+        hqdn3d->line[i] = av_malloc(inlink->w * sizeof(*hqdn3d->line[i]));
+        if (!hqdn3d->line[i])
+            return AVERROR(ENOMEM);
+    }
 
     for (i = 0; i < 4; i++) {
         hqdn3d->coefs[i] = precalc_coefs(hqdn3d->strength[i], hqdn3d->depth);
@@ -326,22 +334,33 @@ static int null_draw_slice(AVFilterLink *link, int y, int h, int slice_dir)
     return 0;
 }
 
+/* the spatial filter is recursive along both axes, so each job denoises
+ * a whole plane */
+static int denoise_plane(AVFilterContext *ctx, void *arg, int c, int nb_jobs)
+{
+    HQDN3DContext *hqdn3d = ctx->priv;
+    ThreadData *td = arg;
+    AVFilterBufferRef *inpic  = td->in;
+    AVFilterBufferRef *outpic = td->out;
+
+    denoise(hqdn3d, inpic->data[c], outpic->data[c],
+            hqdn3d->line[c], &hqdn3d->frame_prev[c],
+            inpic->video->w >> (!!c * hqdn3d->hsub),
+            inpic->video->h >> (!!c * hqdn3d->vsub),
+            inpic->linesize[c], outpic->linesize[c],
+            hqdn3d->coefs[c?2:0], hqdn3d->coefs[c?3:1]);
+    return 0;
+}
+
 static int end_frame(AVFilterLink *inlink)
 {
-    HQDN3DContext *hqdn3d = inlink->dst->priv;
-    AVFilterLink *outlink = inlink->dst->outputs[0];
+    AVFilterContext *ctx = inlink->dst;
+    AVFilterLink *outlink = ctx->outputs[0];
     AVFilterBufferRef *inpic  = inlink ->cur_buf;
-    AVFilterBufferRef *outpic = outlink->out_buf;
-    int ret, c;
-
-    for (c = 0; c < 3; c++) {
-        denoise(hqdn3d, inpic->data[c], outpic->data[c],
-                hqdn3d->line, &hqdn3d->frame_prev[c],
-                inpic->video->w >> (!!c * hqdn3d->hsub),
-                inpic->video->h >> (!!c * hqdn3d->vsub),
-                inpic->linesize[c], outpic->linesize[c],
-                hqdn3d->coefs[c?2:0], hqdn3d->coefs[c?3:1]);
-    }
+    ThreadData td = { .in = inpic, .out = outlink->out_buf };
+    int ret;
+
+    ctx->execute(ctx, denoise_plane, &td, NULL, 3);
 
     if ((ret = ff_draw_slice(outlink, 0, inpic->video->h, 1)) < 0 ||
         (ret = ff_end_frame(outlink)) < 0)
@@ -259,22 +259,30 @@ static int config_props(AVFilterLink *inlink)
     return 0;
 }
 
-static int draw_slice(AVFilterLink *inlink, int y, int h, int slice_dir)
+typedef struct {
+    AVFilterBufferRef *in, *out;
+    int y, h;   ///< slice passed to draw_slice()
+} ThreadData;
+
+static int lut_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    AVFilterContext *ctx = inlink->dst;
     LutContext *lut = ctx->priv;
-    AVFilterLink *outlink = ctx->outputs[0];
-    AVFilterBufferRef *inpic  = inlink ->cur_buf;
-    AVFilterBufferRef *outpic = outlink->out_buf;
+    ThreadData *td = arg;
+    AVFilterBufferRef *inpic  = td->in;
+    AVFilterBufferRef *outpic = td->out;
+    AVFilterLink *inlink = ctx->inputs[0];
     uint8_t *inrow, *outrow, *inrow0, *outrow0;
     int i, j, plane;
 
     if (lut->is_rgb) {
         /* packed */
-        inrow0  = inpic ->data[0] + y * inpic ->linesize[0];
-        outrow0 = outpic->data[0] + y * outpic->linesize[0];
+        int start = td->y + (td->h *  jobnr     ) / nb_jobs;
+        int end   = td->y + (td->h * (jobnr + 1)) / nb_jobs;
+
+        inrow0  = inpic ->data[0] + start * inpic ->linesize[0];
+        outrow0 = outpic->data[0] + start * outpic->linesize[0];
 
-        for (i = 0; i < h; i ++) {
+        for (i = start; i < end; i ++) {
             int w = inlink->w;
             const uint8_t (*tab)[256] = (const uint8_t (*)[256])lut->lut;
             inrow  = inrow0;
@@ -301,11 +309,14 @@ static int draw_slice(AVFilterLink *inlink, int y, int h, int slice_dir)
         for (plane = 0; plane < 4 && inpic->data[plane]; plane++) {
             int vsub = plane == 1 || plane == 2 ? lut->vsub : 0;
             int hsub = plane == 1 || plane == 2 ? lut->hsub : 0;
+            int h     = (td->h + (1<<vsub) - 1)>>vsub;
+            int start = (td->y>>vsub) + (h *  jobnr     ) / nb_jobs;
+            int end   = (td->y>>vsub) + (h * (jobnr + 1)) / nb_jobs;
 
-            inrow  = inpic ->data[plane] + (y>>vsub) * inpic ->linesize[plane];
-            outrow = outpic->data[plane] + (y>>vsub) * outpic->linesize[plane];
+            inrow  = inpic ->data[plane] + start * inpic ->linesize[plane];
+            outrow = outpic->data[plane] + start * outpic->linesize[plane];
 
-            for (i = 0; i < (h + (1<<vsub) - 1)>>vsub; i ++) {
+            for (i = start; i < end; i ++) {
                 const uint8_t *tab = lut->lut[plane];
                 int w = (inlink->w + (1<<hsub) - 1)>>hsub;
                 for (j = 0; j < w; j++)
@@ -316,6 +327,22 @@ static int draw_slice(AVFilterLink *inlink, int y, int h, int slice_dir)
         }
     }
 
+    return 0;
+}
+
+static int draw_slice(AVFilterLink *inlink, int y, int h, int slice_dir)
+{
+    AVFilterContext *ctx = inlink->dst;
+    AVFilterLink *outlink = ctx->outputs[0];
+    ThreadData td = {
+        .in  = inlink ->cur_buf,
+        .out = outlink->out_buf,
+        .y   = y,
+        .h   = h,
+    };
+
+    ctx->execute(ctx, lut_slice, &td, NULL, FFMIN(h, ff_filter_get_nb_threads(ctx)));
+
     return ff_draw_slice(outlink, y, h, slice_dir);
 }
 
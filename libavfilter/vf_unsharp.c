@@ -58,20 +58,24 @@ typedef struct FilterParam {
     int steps_y;                             ///< vertical step count
     int scalebits;                           ///< bits to shift pixel
     int32_t halfscale;                       ///< amount to add to pixel
-    uint32_t *sc[(MAX_SIZE * MAX_SIZE) - 1]; ///< finite state machine storage
 } FilterParam;
 
 typedef struct {
     FilterParam luma;   ///< luma parameters (width, height, amount)
     FilterParam chroma; ///< chroma parameters (width, height, amount)
     int hsub, vsub;
+    uint32_t *sc[3][(MAX_SIZE * MAX_SIZE) - 1]; ///< finite state machine storage, one per plane
 } UnsharpContext;
 
+typedef struct {
+    AVFilterBufferRef *in, *out;
+    int w[3], h[3];
+} ThreadData;
+
 static void apply_unsharp(      uint8_t *dst, int dst_stride,
                           const uint8_t *src, int src_stride,
-                          int width, int height, FilterParam *fp)
+                          int width, int height, FilterParam *fp, uint32_t **sc)
 {
-    uint32_t **sc = fp->sc;
     uint32_t sr[(MAX_SIZE * MAX_SIZE) - 1], tmp1, tmp2;
 
     int32_t res;
@@ -170,18 +174,22 @@ static int query_formats(AVFilterContext *ctx)
     return 0;
 }
 
-static void init_filter_param(AVFilterContext *ctx, FilterParam *fp, const char *effect_type, int width)
+static void init_filter_param(AVFilterContext *ctx, FilterParam *fp, const char *effect_type)
 {
-    int z;
     const char *effect;
 
     effect = fp->amount == 0 ? "none" : fp->amount < 0 ? "blur" : "sharpen";
 
     av_log(ctx, AV_LOG_VERBOSE, "effect:%s type:%s msize_x:%d msize_y:%d amount:%0.2f\n",
            effect, effect_type, fp->msize_x, fp->msize_y, fp->amount / 65535.0);
+}
+
+static void alloc_filter_state(FilterParam *fp, uint32_t **sc, int width)
+{
+    int z;
 
     for (z = 0; z < 2 * fp->steps_y; z++)
-        fp->sc[z] = av_malloc(sizeof(*(fp->sc[z])) * (width + 2 * fp->steps_x));
+        sc[z] = av_malloc(sizeof(*(sc[z])) * (width + 2 * fp->steps_x));
 }
 
 static int config_props(AVFilterLink *link)
@@ -191,40 +199,62 @@ static int config_props(AVFilterLink *link)
     unsharp->hsub = av_pix_fmt_descriptors[link->format].log2_chroma_w;
     unsharp->vsub = av_pix_fmt_descriptors[link->format].log2_chroma_h;
 
-    init_filter_param(link->dst, &unsharp->luma,   "luma",   link->w);
-    init_filter_param(link->dst, &unsharp->chroma, "chroma", SHIFTUP(link->w, unsharp->hsub));
+    init_filter_param(link->dst, &unsharp->luma,   "luma");
+    init_filter_param(link->dst, &unsharp->chroma, "chroma");
+
+    alloc_filter_state(&unsharp->luma,   unsharp->sc[0], link->w);
+    alloc_filter_state(&unsharp->chroma, unsharp->sc[1], SHIFTUP(link->w, unsharp->hsub));
+    alloc_filter_state(&unsharp->chroma, unsharp->sc[2], SHIFTUP(link->w, unsharp->hsub));
 
     return 0;
 }
 
-static void free_filter_param(FilterParam *fp)
+static void free_filter_state(FilterParam *fp, uint32_t **sc)
 {
     int z;
 
     for (z = 0; z < 2 * fp->steps_y; z++)
-        av_free(fp->sc[z]);
+        av_free(sc[z]);
 }
 
 static av_cold void uninit(AVFilterContext *ctx)
 {
     UnsharpContext *unsharp = ctx->priv;
 
-    free_filter_param(&unsharp->luma);
-    free_filter_param(&unsharp->chroma);
+    free_filter_state(&unsharp->luma,   unsharp->sc[0]);
+    free_filter_state(&unsharp->chroma, unsharp->sc[1]);
+    free_filter_state(&unsharp->chroma, unsharp->sc[2]);
+}
+
+/* the filter state is carried from line to line, so each job handles
+ * a whole plane */
+static int unsharp_plane(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    UnsharpContext *unsharp = ctx->priv;
+    ThreadData *td = arg;
+
+    apply_unsharp(td->out->data[jobnr], td->out->linesize[jobnr],
+                  td->in ->data[jobnr], td->in ->linesize[jobnr],
+                  td->w[jobnr], td->h[jobnr],
+                  jobnr ? &unsharp->chroma : &unsharp->luma, unsharp->sc[jobnr]);
+    return 0;
 }
 
 static int end_frame(AVFilterLink *link)
 {
-    UnsharpContext *unsharp = link->dst->priv;
-    AVFilterBufferRef *in  = link->cur_buf;
-    AVFilterBufferRef *out = link->dst->outputs[0]->out_buf;
+    AVFilterContext *ctx = link->dst;
+    UnsharpContext *unsharp = ctx->priv;
     int cw = SHIFTUP(link->w, unsharp->hsub);
     int ch = SHIFTUP(link->h, unsharp->vsub);
+    ThreadData td = {
+        .in  = link->cur_buf,
+        .out = ctx->outputs[0]->out_buf,
+        .w   = { link->w, cw, cw },
+        .h   = { link->h, ch, ch },
+    };
     int ret;
 
-    apply_unsharp(out->data[0], out->linesize[0], in->data[0], in->linesize[0], link->w, link->h, &unsharp->luma);
-    apply_unsharp(out->data[1], out->linesize[1], in->data[1], in->linesize[1], cw,      ch,      &unsharp->chroma);
-    apply_unsharp(out->data[2], out->linesize[2], in->data[2], in->linesize[2], cw,      ch,      &unsharp->chroma);
+    ctx->execute(ctx, unsharp_plane, &td, NULL, 3);
 
     if ((ret = ff_draw_slice(link->dst->outputs[0], 0, link->h, 1)) < 0 ||
         (ret = ff_end_frame(link->dst->outputs[0])) < 0)
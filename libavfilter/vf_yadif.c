@@ -102,18 +102,79 @@ static void filter_line_c_16bit(uint16_t *dst,
     FILTER
 }
 
+typedef struct {
+    AVFilterBufferRef *frame;
+    int plane;
+    int w, h;
+    int parity;
+    int tff;
+} ThreadData;
+
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    YADIFContext *yadif = ctx->priv;
+    ThreadData *td = arg;
+    AVFilterBufferRef *dstpic = td->frame;
+    int i = td->plane;
+    int w = td->w;
+    int h = td->h;
+    int parity = td->parity;
+    int refs = yadif->cur->linesize[i];
+    int absrefs = FFABS(refs);
+    int df = (yadif->csp->comp[i].depth_minus1 + 8) / 8;
+    int slice_start = (h *  jobnr     ) / nb_jobs;
+    int slice_end   = (h * (jobnr + 1)) / nb_jobs;
+    int y;
+
+    for (y = slice_start; y < slice_end; y++) {
+        if ((y ^ parity) & 1) {
+            uint8_t *prev = &yadif->prev->data[i][y*refs];
+            uint8_t *cur  = &yadif->cur ->data[i][y*refs];
+            uint8_t *next = &yadif->next->data[i][y*refs];
+            uint8_t *dst  = &dstpic->data[i][y*dstpic->linesize[i]];
+            int     mode  = y==1 || y+2==h ? 2 : yadif->mode;
+            int     prefs = y+1<h ? refs : -refs;
+            int     mrefs =     y ?-refs :  refs;
+
+            if(y<=1 || y+2>=h) {
+                /* the top and bottom edges may be filtered by different
+                 * jobs, each of them gets its own part of temp_line */
+                uint8_t *tmp = yadif->temp_line + (y > 1) * (2*64 + 5*absrefs)
+                                                + 64 + 2*absrefs;
+                if(mode<2)
+                    memcpy(tmp+2*mrefs, cur+2*mrefs, w*df);
+                memcpy(tmp+mrefs, cur+mrefs, w*df);
+                memcpy(tmp      , cur      , w*df);
+                if(prefs != mrefs) {
+                    memcpy(tmp+prefs, cur+prefs, w*df);
+                    if(mode<2)
+                        memcpy(tmp+2*prefs, cur+2*prefs, w*df);
+                }
+                cur = tmp;
+            }
+
+            yadif->filter_line(dst, prev, cur, next, w, prefs, mrefs, parity ^ td->tff, mode);
+        } else {
+            memcpy(&dstpic->data[i][y*dstpic->linesize[i]],
+                   &yadif->cur->data[i][y*refs], w*df);
+        }
+    }
+
+    emms_c();
+    return 0;
+}
+
 static void filter(AVFilterContext *ctx, AVFilterBufferRef *dstpic,
                    int parity, int tff)
 {
     YADIFContext *yadif = ctx->priv;
-    int y, i;
+    ThreadData td = { .frame = dstpic, .parity = parity, .tff = tff };
+    int i;
 
     for (i = 0; i < yadif->csp->nb_components; i++) {
         int w = dstpic->video->w;
         int h = dstpic->video->h;
-        int refs = yadif->cur->linesize[i];
-        int absrefs = FFABS(refs);
-        int df = (yadif->csp->comp[i].depth_minus1 + 8) / 8;
+        int absrefs = FFABS(yadif->cur->linesize[i]);
 
         if (i == 1 || i == 2) {
         /* Why is this not part of the per-plane description thing? */
@@ -123,43 +184,15 @@ static void filter(AVFilterContext *ctx, AVFilterBufferRef *dstpic,
 
         if(yadif->temp_line_size < absrefs) {
             av_free(yadif->temp_line);
-            yadif->temp_line = av_mallocz(2*64 + 5*absrefs);
+            yadif->temp_line = av_mallocz(2 * (2*64 + 5*absrefs));
             yadif->temp_line_size = absrefs;
         }
 
-        for (y = 0; y < h; y++) {
-            if ((y ^ parity) & 1) {
-                uint8_t *prev = &yadif->prev->data[i][y*refs];
-                uint8_t *cur  = &yadif->cur ->data[i][y*refs];
-                uint8_t *next = &yadif->next->data[i][y*refs];
-                uint8_t *dst  = &dstpic->data[i][y*dstpic->linesize[i]];
-                int     mode  = y==1 || y+2==h ? 2 : yadif->mode;
-                int     prefs = y+1<h ? refs : -refs;
-                int     mrefs =     y ?-refs :  refs;
-
-                if(y<=1 || y+2>=h) {
-                    uint8_t *tmp = yadif->temp_line + 64 + 2*absrefs;
-                    if(mode<2)
-                        memcpy(tmp+2*mrefs, cur+2*mrefs, w*df);
-                    memcpy(tmp+mrefs, cur+mrefs, w*df);
-                    memcpy(tmp      , cur      , w*df);
-                    if(prefs != mrefs) {
-                        memcpy(tmp+prefs, cur+prefs, w*df);
-                        if(mode<2)
-                            memcpy(tmp+2*prefs, cur+2*prefs, w*df);
-                    }
-                    cur = tmp;
-                }
-
-                yadif->filter_line(dst, prev, cur, next, w, prefs, mrefs, parity ^ tff, mode);
-            } else {
-                memcpy(&dstpic->data[i][y*dstpic->linesize[i]],
-                       &yadif->cur->data[i][y*refs], w*df);
-            }
-        }
+        td.plane = i;
+        td.w     = w;
+        td.h     = h;
+        ctx->execute(ctx, filter_slice, &td, NULL, FFMIN(h, ff_filter_get_nb_threads(ctx)));
     }
-
-    emms_c();
 }
 
 static int return_frame(AVFilterContext *ctx, int is_second)
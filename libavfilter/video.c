@@ -26,6 +26,7 @@
 #include "libavutil/avassert.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
 
 #include "avfilter.h"
 #include "internal.h"
@@ -36,57 +37,88 @@ AVFilterBufferRef *ff_null_get_video_buffer(AVFilterLink *link, int perms, int w
     return ff_get_video_buffer(link->dst->outputs[0], perms, w, h);
 }
 
+static AVBufferRef *alloc_gray_buffer(int size)
+{
+    AVBufferRef *ret = av_buffer_alloc(size);
+    if (ret)
+        memset(ret->data, 128, size);
+    return ret;
+}
+
+static void free_pool_buffer(AVFilterBuffer *ptr)
+{
+    AVBufferRef *buf = ptr->priv;
+    av_buffer_unref(&buf);
+    av_free(ptr);
+}
+
+/**
+ * Set up the link pool for pictures of the given size, with the layout
+ * av_image_alloc() would use.
+ */
+static int update_pool(AVFilterLink *link, int w, int h)
+{
+    AVFilterPool *pool = link->pool;
+    uint8_t *data[4];
+    int i, size;
+
+    if (pool->buffers && pool->w == w && pool->h == h &&
+        pool->format == link->format)
+        return 0;
+
+    av_buffer_pool_uninit(&pool->buffers);
+
+    if ((size = av_image_check_size(w, h, 0, link->dst)) < 0 ||
+        (size = av_image_fill_linesizes(pool->linesize, link->format, FFALIGN(w, 8))) < 0)
+        return size;
+    for (i = 0; i < 4; i++)
+        pool->linesize[i] = FFALIGN(pool->linesize[i], 32);
+    if ((size = av_image_fill_pointers(data, link->format, h, NULL, pool->linesize)) < 0)
+        return size;
+
+    // align: +2 is needed for swscaler, +16 to be SIMD-friendly
+    pool->buffers = av_buffer_pool_init(size + 32, alloc_gray_buffer);
+    if (!pool->buffers)
+        return AVERROR(ENOMEM);
+    pool->w      = w;
+    pool->h      = h;
+    pool->format = link->format;
+
+    return 0;
+}
+
 AVFilterBufferRef *ff_default_get_video_buffer(AVFilterLink *link, int perms, int w, int h)
 {
-    int linesize[4];
     uint8_t *data[4];
-    int i;
     AVFilterBufferRef *picref = NULL;
     AVFilterPool *pool = link->pool;
+    AVBufferRef *buf;
     int full_perms = AV_PERM_READ | AV_PERM_WRITE | AV_PERM_PRESERVE |
                      AV_PERM_REUSE | AV_PERM_REUSE2 | AV_PERM_ALIGN;
 
     av_assert1(!(perms & ~(full_perms | AV_PERM_NEG_LINESIZES)));
 
-    if (pool) {
-        for (i = 0; i < POOL_SIZE; i++) {
-            picref = pool->pic[i];
-            if (picref && picref->buf->format == link->format && picref->buf->w == w && picref->buf->h == h) {
-                AVFilterBuffer *pic = picref->buf;
-                pool->pic[i] = NULL;
-                pool->count--;
-                picref->video->w = w;
-                picref->video->h = h;
-                picref->perms = full_perms;
-                picref->format = link->format;
-                pic->refcount = 1;
-                memcpy(picref->data,     pic->data,     sizeof(picref->data));
-                memcpy(picref->linesize, pic->linesize, sizeof(picref->linesize));
-                pool->refcount++;
-                return picref;
-            }
-        }
-    } else {
-        pool = link->pool = av_mallocz(sizeof(AVFilterPool));
-        pool->refcount = 1;
-    }
+    if (!pool && !(pool = link->pool = av_mallocz(sizeof(AVFilterPool))))
+        return NULL;
+    if (update_pool(link, w, h) < 0)
+        return NULL;
 
-    // align: +2 is needed for swscaler, +16 to be SIMD-friendly
-    if ((i = av_image_alloc(data, linesize, w, h, link->format, 32)) < 0)
+    if (!(buf = av_buffer_pool_get(pool->buffers)))
         return NULL;
+    av_image_fill_pointers(data, link->format, h, buf->data, pool->linesize);
+    if (av_pix_fmt_descriptors[link->format].flags & PIX_FMT_PAL ||
+        av_pix_fmt_descriptors[link->format].flags & PIX_FMT_PSEUDOPAL)
+        ff_set_systematic_pal2((uint32_t*)data[1], link->format);
 
-    picref = avfilter_get_video_buffer_ref_from_arrays(data, linesize,
+    picref = avfilter_get_video_buffer_ref_from_arrays(data, pool->linesize,
                                                        full_perms, w, h, link->format);
     if (!picref) {
-        av_free(data[0]);
+        av_buffer_unref(&buf);
         return NULL;
     }
 
-    memset(data[0], 128, i);
-
-    picref->buf->priv = pool;
-    picref->buf->free = NULL;
-    pool->refcount++;
+    picref->buf->priv = buf;
+    picref->buf->free = free_pool_buffer;
 
     return picref;
 }
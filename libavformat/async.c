@@ -0,0 +1,324 @@
+/*
+ * Asynchronous read-ahead protocol
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Read the nested URL from a background thread into a ring buffer, so
+ * that the caller only blocks when the buffer runs empty.
+ */
+
+#include <pthread.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/fifo.h"
+#include "libavutil/opt.h"
+#include "libavutil/time.h"
+#include "avformat.h"
+#include "url.h"
+
+#define READ_CHUNK_SIZE 32768
+
+typedef struct AsyncContext {
+    const AVClass *class;
+    URLContext *inner;
+    int buffer_size;
+
+    AVFifoBuffer *fifo;
+    int64_t pos;                ///< position of the first byte in the fifo
+    int64_t size;               ///< size of the nested resource, < 0 if unknown
+    int eof;
+    int error;                  ///< error returned by the last read
+
+    int seek_request;
+    int64_t seek_pos;
+    int seek_whence;
+    int seek_completed;
+    int64_t seek_ret;
+
+    int abort_request;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond_wakeup_main;
+    pthread_cond_t cond_wakeup_reader;
+
+    uint8_t chunk[READ_CHUNK_SIZE];
+} AsyncContext;
+
+/* Interrupt the nested protocol when its pending read became useless.
+ * Never called with the mutex held. */
+static int async_check_interrupt(void *arg)
+{
+    URLContext *h = arg;
+    AsyncContext *c = h->priv_data;
+    int stop;
+
+    pthread_mutex_lock(&c->mutex);
+    stop = c->abort_request || c->seek_request;
+    pthread_mutex_unlock(&c->mutex);
+
+    if (stop)
+        return 1;
+    return ff_check_interrupt(&h->interrupt_callback);
+}
+
+static void *async_reader(void *arg)
+{
+    URLContext *h = arg;
+    AsyncContext *c = h->priv_data;
+    int ret;
+
+    pthread_mutex_lock(&c->mutex);
+    while (!c->abort_request) {
+        if (c->seek_request) {
+            int64_t pos = c->seek_pos, seek_ret;
+            int whence  = c->seek_whence;
+
+            c->seek_request = 0;
+            pthread_mutex_unlock(&c->mutex);
+            seek_ret = ffurl_seek(c->inner, pos, whence);
+            pthread_mutex_lock(&c->mutex);
+
+            if (seek_ret >= 0) {
+                av_fifo_reset(c->fifo);
+                c->pos   = seek_ret;
+                c->eof   = 0;
+                c->error = 0;
+            }
+            c->seek_ret       = seek_ret;
+            c->seek_completed = 1;
+            pthread_cond_signal(&c->cond_wakeup_main);
+            continue;
+        }
+
+        if (c->eof || c->error || av_fifo_space(c->fifo) < READ_CHUNK_SIZE) {
+            pthread_cond_wait(&c->cond_wakeup_reader, &c->mutex);
+            continue;
+        }
+
+        pthread_mutex_unlock(&c->mutex);
+        ret = ffurl_read(c->inner, c->chunk, READ_CHUNK_SIZE);
+        pthread_mutex_lock(&c->mutex);
+
+        /* the data read before a seek request is stale */
+        if (c->seek_request || c->abort_request)
+            continue;
+
+        if (ret > 0)
+            av_fifo_generic_write(c->fifo, c->chunk, ret, NULL);
+        else if (!ret || ret == AVERROR_EOF)
+            c->eof = 1;
+        else
+            c->error = ret;
+        pthread_cond_signal(&c->cond_wakeup_main);
+    }
+    pthread_mutex_unlock(&c->mutex);
+
+    return NULL;
+}
+
+static int async_open(URLContext *h, const char *arg, int flags,
+                      AVDictionary **options)
+{
+    AsyncContext *c = h->priv_data;
+    AVIOInterruptCB interrupt_callback = { async_check_interrupt, h };
+    int ret;
+
+    av_strstart(arg, "async:", &arg);
+
+    if (flags & AVIO_FLAG_WRITE) {
+        av_log(h, AV_LOG_ERROR, "Only reading is supported\n");
+        return AVERROR(ENOSYS);
+    }
+
+    ret = pthread_mutex_init(&c->mutex, NULL);
+    if (ret) {
+        av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
+        return AVERROR(ret);
+    }
+    ret = pthread_cond_init(&c->cond_wakeup_main, NULL);
+    if (ret) {
+        av_log(h, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", strerror(ret));
+        ret = AVERROR(ret);
+        goto cond_main_fail;
+    }
+    ret = pthread_cond_init(&c->cond_wakeup_reader, NULL);
+    if (ret) {
+        av_log(h, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", strerror(ret));
+        ret = AVERROR(ret);
+        goto cond_reader_fail;
+    }
+
+    /* the interrupt callback of the nested protocol takes the mutex */
+    ret = ffurl_open(&c->inner, arg, flags & ~AVIO_FLAG_NONBLOCK,
+                     &interrupt_callback, options);
+    if (ret < 0)
+        goto url_fail;
+    h->is_streamed = c->inner->is_streamed;
+    c->size        = ffurl_size(c->inner);
+
+    c->fifo = av_fifo_alloc(FFMAX(c->buffer_size, READ_CHUNK_SIZE));
+    if (!c->fifo) {
+        ret = AVERROR(ENOMEM);
+        goto fifo_fail;
+    }
+
+    ret = pthread_create(&c->thread, NULL, async_reader, h);
+    if (ret) {
+        av_log(h, AV_LOG_ERROR, "pthread_create failed : %s\n", strerror(ret));
+        ret = AVERROR(ret);
+        goto thread_fail;
+    }
+
+    return 0;
+
+thread_fail:
+    av_fifo_free(c->fifo);
+fifo_fail:
+    ffurl_close(c->inner);
+url_fail:
+    pthread_cond_destroy(&c->cond_wakeup_reader);
+cond_reader_fail:
+    pthread_cond_destroy(&c->cond_wakeup_main);
+cond_main_fail:
+    pthread_mutex_destroy(&c->mutex);
+    return ret;
+}
+
+static int async_read(URLContext *h, unsigned char *buf, int size)
+{
+    AsyncContext *c = h->priv_data;
+    int nonblock = h->flags & AVIO_FLAG_NONBLOCK;
+    int ret;
+
+    pthread_mutex_lock(&c->mutex);
+    for (;;) {
+        int avail = av_fifo_size(c->fifo);
+
+        if (avail) {
+            ret = FFMIN(size, avail);
+            av_fifo_generic_read(c->fifo, buf, ret, NULL);
+            c->pos += ret;
+            pthread_cond_signal(&c->cond_wakeup_reader);
+            break;
+        } else if (c->error || c->eof) {
+            ret = c->error;
+            break;
+        } else if (nonblock) {
+            ret = AVERROR(EAGAIN);
+            break;
+        } else {
+            /* wait a bit so that the caller gets to check its interrupt
+             * callback, see retry_transfer_wrapper() */
+            int64_t t = av_gettime() + 100000;
+            struct timespec tv = { .tv_sec  =  t / 1000000,
+                                   .tv_nsec = (t % 1000000) * 1000 };
+            pthread_cond_timedwait(&c->cond_wakeup_main, &c->mutex, &tv);
+            nonblock = 1;
+        }
+    }
+    pthread_mutex_unlock(&c->mutex);
+
+    return ret;
+}
+
+static int64_t async_seek(URLContext *h, int64_t pos, int whence)
+{
+    AsyncContext *c = h->priv_data;
+    int64_t ret;
+
+    if (whence == AVSEEK_SIZE)
+        return c->size >= 0 ? c->size : AVERROR(ENOSYS);
+
+    pthread_mutex_lock(&c->mutex);
+    if (whence == SEEK_CUR) {
+        pos   += c->pos;
+        whence = SEEK_SET;
+    } else if (whence == SEEK_END && c->size >= 0) {
+        pos   += c->size;
+        whence = SEEK_SET;
+    }
+
+    /* positions already in the buffer are reached without a new request */
+    if (whence == SEEK_SET && pos >= c->pos &&
+        pos <= c->pos + av_fifo_size(c->fifo)) {
+        av_fifo_drain(c->fifo, pos - c->pos);
+        c->pos = pos;
+        pthread_cond_signal(&c->cond_wakeup_reader);
+        pthread_mutex_unlock(&c->mutex);
+        return pos;
+    }
+
+    c->seek_request   = 1;
+    c->seek_pos       = pos;
+    c->seek_whence    = whence;
+    c->seek_completed = 0;
+    pthread_cond_signal(&c->cond_wakeup_reader);
+    while (!c->seek_completed)
+        pthread_cond_wait(&c->cond_wakeup_main, &c->mutex);
+    ret = c->seek_ret;
+    pthread_mutex_unlock(&c->mutex);
+
+    return ret;
+}
+
+static int async_close(URLContext *h)
+{
+    AsyncContext *c = h->priv_data;
+
+    pthread_mutex_lock(&c->mutex);
+    c->abort_request = 1;
+    pthread_cond_signal(&c->cond_wakeup_reader);
+    pthread_mutex_unlock(&c->mutex);
+
+    pthread_join(c->thread, NULL);
+    ffurl_close(c->inner);
+    av_fifo_free(c->fifo);
+
+    pthread_cond_destroy(&c->cond_wakeup_reader);
+    pthread_cond_destroy(&c->cond_wakeup_main);
+    pthread_mutex_destroy(&c->mutex);
+
+    return 0;
+}
+
+#define OFFSET(x) offsetof(AsyncContext, x)
+#define D AV_OPT_FLAG_DECODING_PARAM
+static const AVOption options[] = {
+    { "async_buffer_size", "size of the read-ahead buffer in bytes", OFFSET(buffer_size), AV_OPT_TYPE_INT, { 4 * 1024 * 1024 }, 0, INT_MAX, D },
+    { NULL }
+};
+
+static const AVClass async_class = {
+    .class_name     = "async",
+    .item_name      = av_default_item_name,
+    .option         = options,
+    .version        = LIBAVUTIL_VERSION_INT,
+};
+
+URLProtocol ff_async_protocol = {
+    .name                = "async",
+    .url_open2           = async_open,
+    .url_read            = async_read,
+    .url_seek            = async_seek,
+    .url_close           = async_close,
+    .priv_data_size      = sizeof(AsyncContext),
+    .priv_data_class     = &async_class,
+};
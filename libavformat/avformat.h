@@ -568,6 +568,13 @@ typedef struct AVInputFormat {
      * Active streams are all streams that have AVStream.discard < AVDISCARD_ALL.
      */
     int (*read_seek2)(struct AVFormatContext *s, int stream_index, int64_t min_ts, int64_t ts, int64_t max_ts, int flags);
+
+    /**
+     * Fill AVStream.index_entries of stream_index with the complete index,
+     * for demuxers which keep their index in another form.
+     * @see avformat_build_index()
+     */
+    int (*read_index)(struct AVFormatContext *s, int stream_index);
 } AVInputFormat;
 /**
  * @}
@@ -724,6 +731,18 @@ typedef struct AVStream {
      */
     AVPacket attached_pic;
 
+    /**
+     * Cost of avformat_find_stream_info() for this stream: number and
+     * total size of the packets demuxed, number of frames decoded and
+     * time spent decoding them, in microseconds.
+     * - encoding: unused
+     * - decoding: Set by libavformat.
+     */
+    int     probe_nb_packets;
+    int64_t probe_size;
+    int     probe_nb_frames;
+    int64_t probe_decode_time;
+
     /*****************************************************************
      * All fields below this line are not part of the public API. They
      * may not be used outside of libavformat and can be changed and
@@ -752,6 +771,17 @@ typedef struct AVStream {
         int64_t fps_last_dts;
         int     fps_last_dts_idx;
 
+        /**
+         * Decoder used by the probe threads, separate from codec as the
+         * parser keeps updating that one while the probe thread decodes.
+         */
+        AVCodecContext *probe_codec;
+        AVCodecContext *probe_codec_params; ///< probe_codec before decoding, to find what changed
+        int probe_nb_decoded_frames; ///< frames decoded with probe_codec
+        int probe_params_found;      ///< probe_codec knows the codec parameters
+        int probe_done;              ///< probe_codec needs no more packets
+        int probe_pending;           ///< packets queued to the probe thread
+        struct ProbeThread *probe_thread; ///< thread decoding with probe_codec
     } *info;
 
     int pts_wrap_bits; /**< number of bits in pts (used for wrapping control) */
@@ -1108,6 +1138,25 @@ typedef struct AVFormatContext {
      */
     int use_wallclock_as_timestamps;
 
+    /**
+     * Path of a file to load the stream parameters and the seek index of
+     * the input from, and to save them to when closing the input.
+     * It is only used for local files and ignored once the input size or
+     * modification time no longer match the ones it was written for.
+     * - encoding: unused
+     * - decoding: Set by user via AVOptions (NO direct access)
+     */
+    char *index_file;
+
+    /**
+     * Number of threads avformat_find_stream_info() decodes the audio and
+     * video probe packets with. The streams are spread over the threads,
+     * the packets of a stream are decoded in order by the same thread.
+     * - encoding: unused
+     * - decoding: Set by user via AVOptions (NO direct access)
+     */
+    int probe_threads;
+
     /*****************************************************************
      * All fields below this line are not part of the public API. They
      * may not be used outside of libavformat and can be changed and
@@ -1153,6 +1202,16 @@ typedef struct AVFormatContext {
      * to know how the duration was estimated.
      */
     enum AVDurationEstimationMethod duration_estimation_method;
+
+    /**
+     * Stream parameters to store in index_file, saved once they are known,
+     * either found by avformat_find_stream_info() or loaded from index_file.
+     */
+    uint8_t *index_file_params;
+    int index_file_params_size;
+    int index_file_nb_streams;  ///< number of streams in index_file_params
+    int index_file_loaded;      ///< all streams were loaded from index_file
+    int index_file_entries;     ///< number of index entries after loading index_file
 } AVFormatContext;
 
 /**
@@ -1856,6 +1915,15 @@ int av_find_default_stream_index(AVFormatContext *s);
  */
 int av_index_search_timestamp(AVStream *st, int64_t timestamp, int flags);
 
+/**
+ * Make sure AVStream.index_entries contains the whole index known to the
+ * demuxer. Some demuxers (e.g. mov) search their own compact index and only
+ * expand it into AVStream.index_entries when this is called.
+ *
+ * @return >= 0 on success, a negative AVERROR code on failure
+ */
+int avformat_build_index(AVFormatContext *s, int stream_index);
+
 /**
  * Add an index entry into a sorted list. Update the entry if the list
  * already contains it.
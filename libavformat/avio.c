@@ -390,6 +390,14 @@ int ffurl_get_file_handle(URLContext *h)
     return h->prot->url_get_file_handle(h);
 }
 
+int ffurl_get_mapping(URLContext *h, int64_t pos, const uint8_t **data,
+                      int64_t *start, int *size)
+{
+    if (!h->prot->url_get_mapping)
+        return AVERROR(ENOSYS);
+    return h->prot->url_get_mapping(h, pos, data, start, size);
+}
+
 int ffurl_get_multi_file_handle(URLContext *h, int **handles, int *numhandles)
 {
     if (!h->prot->url_get_multi_file_handle) {
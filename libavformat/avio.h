@@ -140,6 +140,14 @@ typedef struct {
      * This field is internal to libavformat and access from outside is not allowed.
      */
      int seek_count;
+
+    /**
+     * The buffer is a read-only mapping of a part of the resource owned by
+     * the protocol, it is replaced by the next part instead of being
+     * refilled, and never reallocated or freed.
+     * This field is internal to libavformat and access from outside is not allowed.
+     */
+     int mapped;
 } AVIOContext;
 
 /* unbuffered I/O */
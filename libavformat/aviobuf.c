@@ -67,6 +67,7 @@ const AVClass ffio_url_class = {
 
 static void fill_buffer(AVIOContext *s);
 static int url_resetbuf(AVIOContext *s, int flags);
+static int map_window(AVIOContext *s, int64_t pos);
 
 int ffio_init_context(AVIOContext *s,
                   unsigned char *buffer,
@@ -215,6 +216,17 @@ int64_t avio_seek(AVIOContext *s, int64_t offset, int whence)
         offset1 >= 0 && offset1 <= (s->buf_end - s->buffer)) {
         /* can do the seek inside the buffer */
         s->buf_ptr = s->buffer + offset1;
+    } else if (s->mapped) {
+        int64_t res;
+
+        if (offset < 0)
+            return AVERROR(EINVAL);
+        /* positions past the end behave like an empty buffer at EOF */
+        if ((res = map_window(s, offset)) == AVERROR_EOF) {
+            s->buf_end = s->buf_ptr = s->buffer;
+            s->pos     = offset;
+        } else if (res < 0)
+            return res;
     } else if ((!s->seekable ||
                offset1 <= s->buf_end + SHORT_SEEK_THRESHOLD - s->buffer) &&
                !s->write_flag && offset1 >= 0 &&
@@ -390,7 +402,7 @@ static void fill_buffer(AVIOContext *s)
     int max_buffer_size = s->max_packet_size ? s->max_packet_size : IO_BUFFER_SIZE;
 
     /* can't fill the buffer without read_packet, just set EOF if appropriate */
-    if (!s->read_packet && s->buf_ptr >= s->buf_end)
+    if (!s->read_packet && !s->mapped && s->buf_ptr >= s->buf_end)
         s->eof_reached = 1;
 
     /* no need to do anything if EOF already reached */
@@ -403,6 +415,20 @@ static void fill_buffer(AVIOContext *s)
         s->checksum_ptr= s->buffer;
     }
 
+    if (s->mapped) {
+        /* the next window starts where the current one ends */
+        len = map_window(s, s->pos);
+        if (len <= 0) {
+            s->eof_reached = 1;
+            if (len != AVERROR_EOF)
+                s->error = len;
+        } else {
+            s->checksum_ptr = s->buf_ptr;
+            s->bytes_read  += len;
+        }
+        return;
+    }
+
     /* make buffer smaller in case it ended up large after probing */
     if (s->read_packet && s->buffer_size > max_buffer_size) {
         ffio_set_buf_size(s, max_buffer_size);
@@ -473,7 +499,8 @@ int avio_read(AVIOContext *s, unsigned char *buf, int size)
         if (len > size)
             len = size;
         if (len == 0) {
-            if((s->direct || size > s->buffer_size) && !s->update_checksum){
+            if((s->direct || size > s->buffer_size) && !s->update_checksum &&
+               !s->mapped){
                 if(s->read_packet)
                     len = s->read_packet(s->opaque, buf, size);
                 if (len <= 0) {
@@ -665,10 +692,64 @@ uint64_t ffio_read_varlen(AVIOContext *bc){
     return val;
 }
 
+/**
+ * Make the window of the mapping containing pos the buffer of a mapped
+ * context, with buf_ptr at pos.
+ *
+ * @return the number of bytes from pos to the end of the buffer,
+ *         AVERROR_EOF if pos is past the end of the resource, or another
+ *         negative AVERROR code
+ */
+static int map_window(AVIOContext *s, int64_t pos)
+{
+    const uint8_t *data;
+    int64_t start;
+    int size, ret;
+
+    if ((ret = ffurl_get_mapping(s->opaque, pos, &data, &start, &size)) < 0)
+        return ret;
+    s->buffer      = (unsigned char *)data;
+    s->buffer_size = size;
+    s->buf_ptr     = s->buffer + pos - start;
+    s->buf_end     = s->buffer + size;
+    s->pos         = start + size;
+    return s->buf_end - s->buf_ptr;
+}
+
+/**
+ * Use the memory mapping of the resource as the buffer, so that reads are
+ * served from it directly and seeks inside the mapped window only move the
+ * buffer pointer.
+ */
+static int fdopen_mapped(AVIOContext **s, URLContext *h)
+{
+    const uint8_t *data;
+    int64_t start;
+    int size;
+
+    if ((h->flags & AVIO_FLAG_WRITE) || h->max_packet_size ||
+        (h->flags & AVIO_FLAG_DIRECT) ||
+        ffurl_get_mapping(h, 0, &data, &start, &size) < 0)
+        return AVERROR(ENOSYS);
+
+    *s = avio_alloc_context((unsigned char *)data, size, 0, h,
+                            NULL, NULL, (void*)ffurl_seek);
+    if (!*s)
+        return AVERROR(ENOMEM);
+    (*s)->mapped   = 1;
+    (*s)->seekable = AVIO_SEEKABLE_NORMAL;
+    (*s)->av_class = &ffio_url_class;
+    return 0;
+}
+
 int ffio_fdopen(AVIOContext **s, URLContext *h)
 {
     uint8_t *buffer;
     int buffer_size, max_packet_size;
+    int ret;
+
+    if ((ret = fdopen_mapped(s, h)) != AVERROR(ENOSYS))
+        return ret;
 
     max_packet_size = h->max_packet_size;
     if (max_packet_size) {
@@ -700,6 +781,9 @@ int ffio_fdopen(AVIOContext **s, URLContext *h)
 int ffio_set_buf_size(AVIOContext *s, int buf_size)
 {
     uint8_t *buffer;
+
+    if (s->mapped)
+        return 0;
     buffer = av_malloc(buf_size);
     if (!buffer)
         return AVERROR(ENOMEM);
@@ -735,6 +819,17 @@ int ffio_rewind_with_probe_data(AVIOContext *s, unsigned char *buf, int buf_size
     if (s->write_flag)
         return AVERROR(EINVAL);
 
+    if (s->mapped) {
+        int ret;
+
+        /* the probe data is still in the mapping */
+        av_free(buf);
+        if ((ret = map_window(s, 0)) < 0 && ret != AVERROR_EOF)
+            return ret;
+        s->eof_reached = 0;
+        return 0;
+    }
+
     buffer_size = s->buf_end - s->buffer;
 
     /* the buffers must touch or overlap */
@@ -796,7 +891,8 @@ int avio_close(AVIOContext *s)
 
     avio_flush(s);
     h = s->opaque;
-    av_freep(&s->buffer);
+    if (!s->mapped)
+        av_freep(&s->buffer);
     if (!s->write_flag)
         av_log(s, AV_LOG_DEBUG, "Statistics: %"PRId64" bytes read, %d seeks\n", s->bytes_read, s->seek_count);
     av_free(s);
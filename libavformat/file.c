@@ -20,6 +20,7 @@
  */
 
 #include "libavutil/avstring.h"
+#include "libavutil/opt.h"
 #include "avformat.h"
 #include <fcntl.h>
 #if HAVE_SETMODE
@@ -27,30 +28,50 @@
 #endif
 #include <unistd.h>
 #include <sys/stat.h>
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #include <stdlib.h>
 #include "os_support.h"
 #include "url.h"
 
+enum FileMmapMode {
+    FILE_MMAP_NONE,
+    FILE_MMAP_NORMAL,
+    FILE_MMAP_SEQUENTIAL,
+    FILE_MMAP_RANDOM,
+};
+
+typedef struct FileContext {
+    const AVClass *class;
+    int fd;
+    int mmap;
+    int mmap_window;
+    uint8_t *map;       ///< read-only mapping of a window of the file, if any
+    int64_t map_start;  ///< file offset of map
+    int map_size;
+} FileContext;
 
 /* standard file protocol */
 
 static int file_read(URLContext *h, unsigned char *buf, int size)
 {
-    int fd = (intptr_t) h->priv_data;
-    int r = read(fd, buf, size);
+    FileContext *c = h->priv_data;
+    int r = read(c->fd, buf, size);
     return (-1 == r)?AVERROR(errno):r;
 }
 
 static int file_write(URLContext *h, const unsigned char *buf, int size)
 {
-    int fd = (intptr_t) h->priv_data;
-    int r = write(fd, buf, size);
+    FileContext *c = h->priv_data;
+    int r = write(c->fd, buf, size);
     return (-1 == r)?AVERROR(errno):r;
 }
 
 static int file_get_handle(URLContext *h)
 {
-    return (intptr_t) h->priv_data;
+    FileContext *c = h->priv_data;
+    return c->fd;
 }
 
 static int file_check(URLContext *h, int mask)
@@ -68,8 +89,28 @@ static int file_check(URLContext *h, int mask)
 
 #if CONFIG_FILE_PROTOCOL
 
+#define OFFSET(x) offsetof(FileContext, x)
+#define D AV_OPT_FLAG_DECODING_PARAM
+static const AVOption file_options[] = {
+    { "mmap", "map input files into memory instead of reading them, they must not be truncated while mapped", OFFSET(mmap), AV_OPT_TYPE_INT, { FILE_MMAP_NONE }, FILE_MMAP_NONE, FILE_MMAP_RANDOM, D, "mmap" },
+    { "none",       "read the file",                              0, AV_OPT_TYPE_CONST, { FILE_MMAP_NONE },       0, 0, D, "mmap" },
+    { "normal",     "map the file",                               0, AV_OPT_TYPE_CONST, { FILE_MMAP_NORMAL },     0, 0, D, "mmap" },
+    { "sequential", "map the file, optimized for linear reading", 0, AV_OPT_TYPE_CONST, { FILE_MMAP_SEQUENTIAL }, 0, 0, D, "mmap" },
+    { "random",     "map the file, optimized for frequent seeks", 0, AV_OPT_TYPE_CONST, { FILE_MMAP_RANDOM },     0, 0, D, "mmap" },
+    { "mmap_window", "size of the parts of the file mapped at once", OFFSET(mmap_window), AV_OPT_TYPE_INT, { 64 << 20 }, 1, INT_MAX, D },
+    { NULL }
+};
+
+static const AVClass file_class = {
+    .class_name     = "file",
+    .item_name      = av_default_item_name,
+    .option         = file_options,
+    .version        = LIBAVUTIL_VERSION_INT,
+};
+
 static int file_open(URLContext *h, const char *filename, int flags)
 {
+    FileContext *c = h->priv_data;
     int access;
     int fd;
     struct stat st;
@@ -89,29 +130,98 @@ static int file_open(URLContext *h, const char *filename, int flags)
     fd = open(filename, access, 0666);
     if (fd == -1)
         return AVERROR(errno);
-    h->priv_data = (void *) (intptr_t) fd;
+    c->fd = fd;
 
     h->is_streamed = !fstat(fd, &st) && S_ISFIFO(st.st_mode);
 
+    /* the file is only mapped when it is read, see file_get_mapping() */
+    if (flags & AVIO_FLAG_WRITE)
+        c->mmap = FILE_MMAP_NONE;
+
     return 0;
 }
 
 /* XXX: use llseek */
 static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 {
-    int fd = (intptr_t) h->priv_data;
+    FileContext *c = h->priv_data;
     if (whence == AVSEEK_SIZE) {
         struct stat st;
-        int ret = fstat(fd, &st);
+        int ret = fstat(c->fd, &st);
         return ret < 0 ? AVERROR(errno) : (S_ISFIFO(st.st_mode) ? 0 : st.st_size);
     }
-    return lseek(fd, pos, whence);
+    return lseek(c->fd, pos, whence);
+}
+
+/**
+ * Map the window of the file containing pos, replacing the previous one.
+ * Windows start at multiples of the mmap_window option rounded up to the
+ * page size, so that the file is mapped in order when it is read in order.
+ */
+static int file_get_mapping(URLContext *h, int64_t pos, const uint8_t **data,
+                            int64_t *start, int *size)
+{
+#if HAVE_MMAP
+    FileContext *c = h->priv_data;
+
+    if (c->mmap == FILE_MMAP_NONE)
+        return AVERROR(ENOSYS);
+    if (!c->map || pos < c->map_start || pos >= c->map_start + c->map_size) {
+        struct stat st;
+        int64_t window = c->mmap_window, map_start;
+        int map_size;
+        void *map;
+
+#if HAVE_SYSCONF
+        window = FFALIGN(window, sysconf(_SC_PAGESIZE));
+#else
+        window = FFALIGN(window, 4096);
+#endif
+        if (fstat(c->fd, &st) < 0)
+            return AVERROR(errno);
+        if (!S_ISREG(st.st_mode))
+            return AVERROR(ENOSYS);
+        if (pos < 0 || pos >= st.st_size)
+            return AVERROR_EOF;
+        map_start = pos - pos % window;
+        map_size  = FFMIN(st.st_size - map_start, window);
+
+        map = mmap(NULL, map_size, PROT_READ, MAP_SHARED, c->fd, map_start);
+        if (map == MAP_FAILED) {
+            int err = AVERROR(errno);
+            av_log(h, AV_LOG_VERBOSE, "mmap of %d bytes at %"PRId64" failed\n",
+                   map_size, map_start);
+            return err;
+        }
+#if HAVE_POSIX_MADVISE
+        posix_madvise(map, map_size,
+                      c->mmap == FILE_MMAP_SEQUENTIAL ? POSIX_MADV_SEQUENTIAL :
+                      c->mmap == FILE_MMAP_RANDOM     ? POSIX_MADV_RANDOM     :
+                                                        POSIX_MADV_NORMAL);
+#endif
+        if (c->map)
+            munmap(c->map, c->map_size);
+        c->map       = map;
+        c->map_start = map_start;
+        c->map_size  = map_size;
+    }
+    *data  = c->map;
+    *start = c->map_start;
+    *size  = c->map_size;
+    return 0;
+#else
+    return AVERROR(ENOSYS);
+#endif
 }
 
 static int file_close(URLContext *h)
 {
-    int fd = (intptr_t) h->priv_data;
-    return close(fd);
+    FileContext *c = h->priv_data;
+#if HAVE_MMAP
+    if (c->map)
+        munmap(c->map, c->map_size);
+#endif
+    return close(c->fd);
 }
 
 URLProtocol ff_file_protocol = {
@@ -123,6 +233,9 @@ URLProtocol ff_file_protocol = {
     .url_close           = file_close,
     .url_get_file_handle = file_get_handle,
     .url_check           = file_check,
+    .url_get_mapping     = file_get_mapping,
+    .priv_data_size      = sizeof(FileContext),
+    .priv_data_class     = &file_class,
 };
 
 #endif /* CONFIG_FILE_PROTOCOL */
@@ -131,6 +244,7 @@ URLProtocol ff_file_protocol = {
 
 static int pipe_open(URLContext *h, const char *filename, int flags)
 {
+    FileContext *c = h->priv_data;
     int fd;
     char *final;
     av_strstart(filename, "pipe:", &filename);
@@ -146,7 +260,7 @@ static int pipe_open(URLContext *h, const char *filename, int flags)
 #if HAVE_SETMODE
     setmode(fd, O_BINARY);
 #endif
-    h->priv_data = (void *) (intptr_t) fd;
+    c->fd = fd;
     h->is_streamed = 1;
     return 0;
 }
@@ -158,6 +272,7 @@ URLProtocol ff_pipe_protocol = {
     .url_write           = file_write,
     .url_get_file_handle = file_get_handle,
     .url_check           = file_check,
+    .priv_data_size      = sizeof(FileContext),
 };
 
 #endif /* CONFIG_PIPE_PROTOCOL */
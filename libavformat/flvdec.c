@@ -738,8 +738,11 @@ static int flv_read_packet(AVFormatContext *s, AVPacket *pkt)
         avio_seek(s->pb, next, SEEK_SET);
         continue;
     }
-    if ((flags & FLV_VIDEO_FRAMETYPE_MASK) == FLV_FRAME_KEY)
+    if ((flags & FLV_VIDEO_FRAMETYPE_MASK) == FLV_FRAME_KEY) {
+        if (!s->pb->seekable)
+            ff_reduce_index(s, st->index);
         av_add_index_entry(st, pos, dts, size, 0, AVINDEX_KEYFRAME);
+    }
     break;
  }
 
@@ -0,0 +1,487 @@
+/*
+ * index file: persistent stream parameters and seek index of an input
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Index file support.
+ *
+ * The index file stores what avformat_find_stream_info() found out about an
+ * input together with the index entries gathered while reading and seeking
+ * in it, so that reopening the same, unmodified, file neither probes the
+ * streams again nor searches for the timestamps it already found.
+ *
+ * Layout, all values big-endian:
+ * @code
+ * 'FFIX', version
+ * name of the demuxer, size and modification time of the input
+ * start_time, duration, bit_rate, duration_estimation_method
+ * nb_streams, followed for each stream by
+ *     id, stream parameters, codec parameters, extradata
+ * index entries of each stream
+ * 'FFIE'
+ * @endcode
+ * The parameters are saved when avformat_find_stream_info() returns, before
+ * the caller decodes with the codec contexts of the streams, only the index
+ * entries are taken when the input is closed. The file is written under a
+ * temporary name and renamed over the previous one, a file without the
+ * trailing tag is ignored.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+
+#include "libavutil/avstring.h"
+#include "avformat.h"
+#include "internal.h"
+#include "os_support.h"
+
+#define INDEX_FILE_VERSION 1
+#define INDEX_FILE_TAG     MKBETAG('F','F','I','X')
+#define INDEX_FILE_END_TAG MKBETAG('F','F','I','E')
+
+static int get_input_key(AVFormatContext *s, int64_t *size, int64_t *mtime)
+{
+    const char *filename = s->filename;
+    struct stat st;
+
+    av_strstart(filename, "file:", &filename);
+    if (stat(filename, &st) < 0)
+        return AVERROR(errno);
+    *size  = st.st_size;
+    *mtime = st.st_mtime;
+    return 0;
+}
+
+static int count_index_entries(AVFormatContext *s)
+{
+    int i, nb = 0;
+
+    for (i = 0; i < s->nb_streams; i++)
+        nb += s->streams[i]->nb_index_entries;
+    return nb;
+}
+
+static void put_rational(AVIOContext *pb, AVRational q)
+{
+    avio_wb32(pb, q.num);
+    avio_wb32(pb, q.den);
+}
+
+static AVRational get_rational(AVIOContext *pb)
+{
+    AVRational q;
+
+    q.num = avio_rb32(pb);
+    q.den = avio_rb32(pb);
+    return q;
+}
+
+static void write_stream_params(AVIOContext *pb, AVStream *st)
+{
+    AVCodecContext *avctx = st->codec;
+
+    avio_wb32(pb, st->id);
+    put_rational(pb, st->time_base);
+    avio_wb32(pb, st->need_parsing);
+    avio_wb64(pb, st->start_time);
+    avio_wb64(pb, st->duration);
+    avio_wb64(pb, st->nb_frames);
+    put_rational(pb, st->r_frame_rate);
+    put_rational(pb, st->avg_frame_rate);
+    put_rational(pb, st->sample_aspect_ratio);
+    avio_wb32(pb, st->disposition);
+    avio_wb32(pb, st->codec_info_nb_frames);
+
+    avio_wb32(pb, avctx->codec_type);
+    avio_wb32(pb, avctx->codec_id);
+    avio_wb32(pb, avctx->codec_tag);
+    avio_wb32(pb, avctx->bit_rate);
+    avio_wb32(pb, avctx->profile);
+    avio_wb32(pb, avctx->level);
+    put_rational(pb, avctx->time_base);
+    avio_wb32(pb, avctx->ticks_per_frame);
+    avio_wb32(pb, avctx->width);
+    avio_wb32(pb, avctx->height);
+    avio_wb32(pb, avctx->pix_fmt);
+    put_rational(pb, avctx->sample_aspect_ratio);
+    avio_wb32(pb, avctx->has_b_frames);
+    avio_wb32(pb, avctx->refs);
+    avio_wb64(pb, avctx->timecode_frame_start);
+    avio_wb32(pb, avctx->sample_rate);
+    avio_wb32(pb, avctx->channels);
+    avio_wb64(pb, avctx->channel_layout);
+    avio_wb32(pb, avctx->sample_fmt);
+    avio_wb32(pb, avctx->frame_size);
+    avio_wb32(pb, avctx->block_align);
+    avio_wb32(pb, avctx->bits_per_coded_sample);
+    avio_wb32(pb, avctx->bits_per_raw_sample);
+    avio_wb32(pb, avctx->extradata_size);
+    avio_write(pb, avctx->extradata, avctx->extradata_size);
+}
+
+static void write_index_entries(AVIOContext *pb, AVStream *st)
+{
+    int i;
+
+    avio_wb32(pb, st->nb_index_entries);
+    for (i = 0; i < st->nb_index_entries; i++) {
+        AVIndexEntry *e = &st->index_entries[i];
+        avio_wb64(pb, e->pos);
+        avio_wb64(pb, e->timestamp);
+        avio_wb32(pb, e->size);
+        avio_wb32(pb, e->flags);
+        avio_wb32(pb, e->min_distance);
+    }
+}
+
+/**
+ * Parameters of a stream read from the index file, kept aside until the
+ * whole file was validated.
+ */
+typedef struct StreamParams {
+    int need_parsing;
+    int64_t start_time, duration, nb_frames;
+    AVRational r_frame_rate, avg_frame_rate, sample_aspect_ratio;
+    int disposition, codec_info_nb_frames;
+
+    enum AVMediaType codec_type;
+    enum AVCodecID codec_id;
+    unsigned int codec_tag;
+    int bit_rate, profile, level;
+    AVRational time_base;
+    int ticks_per_frame, width, height;
+    enum PixelFormat pix_fmt;
+    AVRational codec_sample_aspect_ratio;
+    int has_b_frames, refs;
+    int64_t timecode_frame_start;
+    int sample_rate, channels;
+    uint64_t channel_layout;
+    enum AVSampleFormat sample_fmt;
+    int frame_size, block_align, bits_per_coded_sample, bits_per_raw_sample;
+    uint8_t *extradata;
+    int extradata_size;
+
+    AVIndexEntry *index_entries;
+    int nb_index_entries;
+} StreamParams;
+
+static int read_stream_params(AVIOContext *pb, AVStream *st, StreamParams *p,
+                              int64_t end)
+{
+    if (avio_rb32(pb) != st->id)
+        return AVERROR_INVALIDDATA;
+    if (av_cmp_q(get_rational(pb), st->time_base))
+        return AVERROR_INVALIDDATA;
+    p->need_parsing         = avio_rb32(pb);
+    p->start_time           = avio_rb64(pb);
+    p->duration             = avio_rb64(pb);
+    p->nb_frames            = avio_rb64(pb);
+    p->r_frame_rate         = get_rational(pb);
+    p->avg_frame_rate       = get_rational(pb);
+    p->sample_aspect_ratio  = get_rational(pb);
+    p->disposition          = avio_rb32(pb);
+    p->codec_info_nb_frames = avio_rb32(pb);
+
+    p->codec_type                = avio_rb32(pb);
+    p->codec_id                  = avio_rb32(pb);
+    p->codec_tag                 = avio_rb32(pb);
+    p->bit_rate                  = avio_rb32(pb);
+    p->profile                   = avio_rb32(pb);
+    p->level                     = avio_rb32(pb);
+    p->time_base                 = get_rational(pb);
+    p->ticks_per_frame           = avio_rb32(pb);
+    p->width                     = avio_rb32(pb);
+    p->height                    = avio_rb32(pb);
+    p->pix_fmt                   = avio_rb32(pb);
+    p->codec_sample_aspect_ratio = get_rational(pb);
+    p->has_b_frames              = avio_rb32(pb);
+    p->refs                      = avio_rb32(pb);
+    p->timecode_frame_start      = avio_rb64(pb);
+    p->sample_rate               = avio_rb32(pb);
+    p->channels                  = avio_rb32(pb);
+    p->channel_layout            = avio_rb64(pb);
+    p->sample_fmt                = avio_rb32(pb);
+    p->frame_size                = avio_rb32(pb);
+    p->block_align               = avio_rb32(pb);
+    p->bits_per_coded_sample     = avio_rb32(pb);
+    p->bits_per_raw_sample       = avio_rb32(pb);
+
+    p->extradata_size = avio_rb32(pb);
+    if (p->extradata_size < 0 || p->extradata_size > end - avio_tell(pb))
+        return AVERROR_INVALIDDATA;
+    if (p->extradata_size) {
+        p->extradata = av_mallocz(p->extradata_size +
+                                  FF_INPUT_BUFFER_PADDING_SIZE);
+        if (!p->extradata)
+            return AVERROR(ENOMEM);
+        avio_read(pb, p->extradata, p->extradata_size);
+    }
+    if (pb->eof_reached)
+        return AVERROR_INVALIDDATA;
+    return 0;
+}
+
+static int read_index_entries(AVIOContext *pb, StreamParams *p, int64_t end)
+{
+    int i, nb_entries;
+
+    nb_entries = avio_rb32(pb);
+    if (nb_entries < 0 || nb_entries > (end - avio_tell(pb)) / 28)
+        return AVERROR_INVALIDDATA;
+    if (nb_entries &&
+        !(p->index_entries = av_malloc(nb_entries * sizeof(*p->index_entries))))
+        return AVERROR(ENOMEM);
+    for (i = 0; i < nb_entries; i++) {
+        AVIndexEntry *e = &p->index_entries[i];
+        e->pos          = avio_rb64(pb);
+        e->timestamp    = avio_rb64(pb);
+        e->size         = avio_rb32(pb);
+        e->flags        = avio_rb32(pb);
+        e->min_distance = avio_rb32(pb);
+    }
+    p->nb_index_entries = nb_entries;
+    return 0;
+}
+
+static int set_index_entries(AVStream *st, const StreamParams *p)
+{
+    int i;
+
+    for (i = 0; i < p->nb_index_entries; i++) {
+        const AVIndexEntry *e = &p->index_entries[i];
+        if (av_add_index_entry(st, e->pos, e->timestamp, e->size,
+                               e->min_distance, e->flags) < 0)
+            return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+static void set_stream_params(AVStream *st, StreamParams *p)
+{
+    AVCodecContext *avctx = st->codec;
+
+    st->need_parsing         = p->need_parsing;
+    st->start_time           = p->start_time;
+    st->duration             = p->duration;
+    st->nb_frames            = p->nb_frames;
+    st->r_frame_rate         = p->r_frame_rate;
+    st->avg_frame_rate       = p->avg_frame_rate;
+    st->sample_aspect_ratio  = p->sample_aspect_ratio;
+    st->disposition          = p->disposition;
+    st->codec_info_nb_frames = p->codec_info_nb_frames;
+
+    avctx->codec_type            = p->codec_type;
+    avctx->codec_id              = p->codec_id;
+    avctx->codec_tag             = p->codec_tag;
+    avctx->bit_rate              = p->bit_rate;
+    avctx->profile               = p->profile;
+    avctx->level                 = p->level;
+    avctx->time_base             = p->time_base;
+    avctx->ticks_per_frame       = p->ticks_per_frame;
+    avctx->width                 = p->width;
+    avctx->height                = p->height;
+    avctx->pix_fmt               = p->pix_fmt;
+    avctx->sample_aspect_ratio   = p->codec_sample_aspect_ratio;
+    avctx->has_b_frames          = p->has_b_frames;
+    avctx->refs                  = p->refs;
+    avctx->timecode_frame_start  = p->timecode_frame_start;
+    avctx->sample_rate           = p->sample_rate;
+    avctx->channels              = p->channels;
+    avctx->channel_layout        = p->channel_layout;
+    avctx->sample_fmt            = p->sample_fmt;
+    avctx->frame_size            = p->frame_size;
+    avctx->block_align           = p->block_align;
+    avctx->bits_per_coded_sample = p->bits_per_coded_sample;
+    avctx->bits_per_raw_sample   = p->bits_per_raw_sample;
+
+    av_freep(&avctx->extradata);
+    avctx->extradata      = p->extradata;
+    avctx->extradata_size = p->extradata_size;
+    p->extradata          = NULL;
+
+    /* the codec is known now, do not probe it again */
+    if (st->request_probe > 0 && avctx->codec_id != AV_CODEC_ID_NONE)
+        st->request_probe = -1;
+}
+
+void ff_index_file_read(AVFormatContext *s)
+{
+    AVIOContext *pb;
+    StreamParams *params = NULL;
+    int64_t size = 0, mtime = 0, end;
+    int64_t start_time, duration;
+    int bit_rate, duration_estimation_method;
+    char name[64];
+    int i, nb_streams, ret;
+
+    if (!s->pb || get_input_key(s, &size, &mtime) < 0)
+        return;
+    if (avio_open2(&pb, s->index_file, AVIO_FLAG_READ,
+                   &s->interrupt_callback, NULL) < 0)
+        return;
+
+    end = avio_size(pb) - 4;
+    if (end < 8 || avio_seek(pb, end, SEEK_SET) < 0 ||
+        avio_rb32(pb) != INDEX_FILE_END_TAG || avio_seek(pb, 0, SEEK_SET) < 0 ||
+        avio_rb32(pb) != INDEX_FILE_TAG || avio_rb32(pb) != INDEX_FILE_VERSION) {
+        av_log(s, AV_LOG_WARNING, "Ignoring invalid index file %s\n",
+               s->index_file);
+        goto end;
+    }
+    avio_get_str(pb, INT_MAX, name, sizeof(name));
+    if (avio_rb64(pb) != size || avio_rb64(pb) != mtime ||
+        strcmp(name, s->iformat->name)) {
+        av_log(s, AV_LOG_VERBOSE, "Index file %s does not match the input\n",
+               s->index_file);
+        goto end;
+    }
+
+    start_time                 = avio_rb64(pb);
+    duration                   = avio_rb64(pb);
+    bit_rate                   = avio_rb32(pb);
+    duration_estimation_method = avio_rb32(pb);
+    nb_streams                 = avio_rb32(pb);
+
+    if (nb_streams != s->nb_streams) {
+        av_log(s, AV_LOG_VERBOSE, "Index file %s does not match the streams "
+               "of the input\n", s->index_file);
+        goto end;
+    }
+    if (!(params = av_mallocz(nb_streams * sizeof(*params))))
+        goto end;
+
+    /* nothing is changed before the whole file was read */
+    for (i = 0; i < nb_streams; i++) {
+        if ((ret = read_stream_params(pb, s->streams[i], &params[i], end)) < 0)
+            goto fail;
+    }
+    for (i = 0; i < nb_streams; i++) {
+        if ((ret = read_index_entries(pb, &params[i], end)) < 0)
+            goto fail;
+    }
+    if (avio_tell(pb) != end) {
+        av_log(s, AV_LOG_WARNING, "Ignoring invalid index file %s\n",
+               s->index_file);
+        goto end;
+    }
+
+    /* missing index entries are only found again, so add them first */
+    for (i = 0; i < nb_streams; i++) {
+        if (set_index_entries(s->streams[i], &params[i]) < 0)
+            goto end;
+    }
+    for (i = 0; i < nb_streams; i++)
+        set_stream_params(s->streams[i], &params[i]);
+    s->start_time                 = start_time;
+    s->duration                   = duration;
+    s->bit_rate                   = bit_rate;
+    s->duration_estimation_method = duration_estimation_method;
+
+    s->index_file_loaded  = 1;
+    s->index_file_entries = count_index_entries(s);
+    av_log(s, AV_LOG_VERBOSE, "Loaded %d streams and %d index entries "
+           "from %s\n", nb_streams, s->index_file_entries, s->index_file);
+    goto end;
+fail:
+    av_log(s, AV_LOG_WARNING, "Error reading stream %d from index file %s\n",
+           i, s->index_file);
+end:
+    if (params) {
+        for (i = 0; i < nb_streams; i++) {
+            av_free(params[i].extradata);
+            av_free(params[i].index_entries);
+        }
+        av_free(params);
+    }
+    avio_close(pb);
+}
+
+void ff_index_file_save_params(AVFormatContext *s)
+{
+    AVIOContext *pb;
+    int i;
+
+    av_freep(&s->index_file_params);
+    s->index_file_params_size = 0;
+    if (avio_open_dyn_buf(&pb) < 0)
+        return;
+
+    avio_wb64(pb, s->start_time);
+    avio_wb64(pb, s->duration);
+    avio_wb32(pb, s->bit_rate);
+    avio_wb32(pb, s->duration_estimation_method);
+    avio_wb32(pb, s->nb_streams);
+    for (i = 0; i < s->nb_streams; i++)
+        write_stream_params(pb, s->streams[i]);
+
+    s->index_file_params_size = avio_close_dyn_buf(pb, &s->index_file_params);
+    s->index_file_nb_streams  = s->nb_streams;
+}
+
+void ff_index_file_write(AVFormatContext *s)
+{
+    AVIOContext *pb;
+    const char *path, *tmp_path;
+    char *tmp_name;
+    int64_t size = 0, mtime = 0;
+    int i, err;
+
+    if (!s->pb || !s->index_file_params ||
+        get_input_key(s, &size, &mtime) < 0)
+        return;
+    /* nothing new was found since the file was loaded */
+    if (s->index_file_loaded &&
+        s->index_file_entries == count_index_entries(s))
+        return;
+
+    if (!(tmp_name = av_asprintf("%s.tmp", s->index_file)))
+        return;
+    if (avio_open2(&pb, tmp_name, AVIO_FLAG_WRITE,
+                   &s->interrupt_callback, NULL) < 0) {
+        av_log(s, AV_LOG_WARNING, "Could not write index file %s\n",
+               tmp_name);
+        av_free(tmp_name);
+        return;
+    }
+
+    avio_wb32(pb, INDEX_FILE_TAG);
+    avio_wb32(pb, INDEX_FILE_VERSION);
+    avio_put_str(pb, s->iformat->name);
+    avio_wb64(pb, size);
+    avio_wb64(pb, mtime);
+    avio_write(pb, s->index_file_params, s->index_file_params_size);
+    for (i = 0; i < s->index_file_nb_streams; i++)
+        write_index_entries(pb, s->streams[i]);
+    avio_wb32(pb, INDEX_FILE_END_TAG);
+    avio_flush(pb);
+    err = pb->error;
+    avio_close(pb);
+
+    path     = s->index_file;
+    tmp_path = tmp_name;
+    av_strstart(path,     "file:", &path);
+    av_strstart(tmp_path, "file:", &tmp_path);
+    if (err < 0 || rename(tmp_path, path) < 0) {
+        av_log(s, AV_LOG_WARNING, "Could not write index file %s\n",
+               s->index_file);
+        remove(tmp_path);
+    }
+    av_free(tmp_name);
+}
@@ -346,4 +346,23 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
 
 void ff_free_stream(AVFormatContext *s, AVStream *st);
 
+/**
+ * Load the stream parameters and index entries stored in
+ * AVFormatContext.index_file, if it was written for the current input.
+ */
+void ff_index_file_read(AVFormatContext *s);
+
+/**
+ * Keep the current stream parameters of the input for
+ * ff_index_file_write(), before the codec contexts are used for decoding.
+ */
+void ff_index_file_save_params(AVFormatContext *s);
+
+/**
+ * Save the stream parameters kept by ff_index_file_save_params() and the
+ * index entries of the input to AVFormatContext.index_file, unless it is
+ * up to date.
+ */
+void ff_index_file_write(AVFormatContext *s);
+
 #endif /* AVFORMAT_INTERNAL_H */
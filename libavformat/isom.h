@@ -53,6 +53,15 @@ typedef struct {
     int id;
 } MOVStsc;
 
+/**
+ * Samples of an stts entry, as used by the compact sample index.
+ */
+typedef struct {
+    unsigned int first_sample;
+    int duration;
+    int64_t first_dts;
+} MOVTimeRun;
+
 typedef struct {
     uint32_t type;
     char *path;
@@ -96,6 +105,7 @@ typedef struct MOVStreamContext {
     unsigned int stts_count;
     MOVStts *stts_data;
     unsigned int ctts_count;
+    unsigned int ctts_allocated_size;
     MOVStts *ctts_data;
     unsigned int stsc_count;
     MOVStsc *stsc_data;
@@ -136,6 +146,21 @@ typedef struct MOVStreamContext {
     uint32_t tmcd_flags;  ///< tmcd track flags
     int64_t track_end;    ///< used for dts generation in fragmented movie files
     int start_pad;        ///< amount of samples to skip due to enc-dec delay
+
+    /**
+     * Compact sample index, used instead of AVStream.index_entries for the
+     * samples described by the moov atom. Samples added later by fragments
+     * follow them in AVStream.index_entries.
+     */
+    unsigned int index_samples;   ///< number of samples in the compact index
+    unsigned int *chunk_first_sample; ///< first sample of each chunk, chunk_count + 1 entries
+    unsigned int time_runs_count;
+    MOVTimeRun *time_runs;
+    int key_off;          ///< 1 if stss/stps sample numbers start at 1
+    int cur_index_sample; ///< sample held in cur_index_entry, -1 if none
+    unsigned int cur_chunk;
+    unsigned int cur_time_run;
+    AVIndexEntry cur_index_entry;
 } MOVStreamContext;
 
 typedef struct MOVContext {
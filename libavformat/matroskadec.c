@@ -1900,8 +1900,11 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
         if (track->type == MATROSKA_TRACK_TYPE_SUBTITLE
             && timecode < track->end_timecode)
             is_keyframe = 0;  /* overlapping subtitles are not key frame */
-        if (is_keyframe)
+        if (is_keyframe) {
+            if (!matroska->ctx->pb->seekable)
+                ff_reduce_index(matroska->ctx, st->index);
             av_add_index_entry(st, cluster_pos, timecode, 0,0,AVINDEX_KEYFRAME);
+        }
     }
 
     if (matroska->skip_to_keyframe && track->type != MATROSKA_TRACK_TYPE_SUBTITLE) {
@@ -2255,6 +2258,17 @@ static int matroska_read_packet(AVFormatContext *s, AVPacket *pkt)
     return 0;
 }
 
+static int matroska_read_index(AVFormatContext *s, int stream_index)
+{
+    MatroskaDemuxContext *matroska = s->priv_data;
+
+    if (matroska->cues_parsing_deferred > 0) {
+        matroska->cues_parsing_deferred = 0;
+        matroska_parse_cues(matroska);
+    }
+    return 0;
+}
+
 static int matroska_read_seek(AVFormatContext *s, int stream_index,
                               int64_t timestamp, int flags)
 {
@@ -2264,10 +2278,7 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
     int i, index, index_sub, index_min;
 
     /* Parse the CUES now since we need the index data to seek. */
-    if (matroska->cues_parsing_deferred > 0) {
-        matroska->cues_parsing_deferred = 0;
-        matroska_parse_cues(matroska);
-    }
+    matroska_read_index(s, stream_index);
 
     if (!st->nb_index_entries)
         goto err;
@@ -2351,4 +2362,5 @@ AVInputFormat ff_matroska_demuxer = {
     .read_packet    = matroska_read_packet,
     .read_close     = matroska_read_close,
     .read_seek      = matroska_read_seek,
+    .read_index     = matroska_read_index,
 };
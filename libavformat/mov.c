@@ -1843,6 +1843,260 @@ static int mov_read_ctts(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     return 0;
 }
 
+static unsigned int mov_sample_size(MOVStreamContext *sc, unsigned int sample)
+{
+    return sc->alt_sample_size > 0 ? sc->alt_sample_size : sc->sample_sizes[sample];
+}
+
+/**
+ * Find the sync sample number in tab closest to sample, in the given
+ * direction (including sample itself).
+ * @return the sync sample number, -1 if there is none
+ */
+static int64_t mov_search_sync_table(const unsigned int *tab, unsigned int count,
+                                     int64_t sample, int backward)
+{
+    unsigned int a = 0, b = count;
+
+    while (a < b) {
+        unsigned int m = (a + b) >> 1;
+        if (backward ? tab[m] <= sample : tab[m] < sample)
+            a = m + 1;
+        else
+            b = m;
+    }
+    if (backward)
+        return a ? (int64_t)tab[a - 1] : -1;
+    return a < count ? (int64_t)tab[a] : -1;
+}
+
+/**
+ * Find the keyframe closest to a sample of the compact index.
+ * @return the keyframe sample index, -1 if there is none in that direction
+ */
+static int64_t mov_find_keyframe(MOVStreamContext *sc, unsigned int sample, int backward)
+{
+    int64_t key = -1, k;
+
+    if (!sc->keyframe_absent) {
+        if (!sc->keyframe_count)
+            return sample;
+        key = mov_search_sync_table((const unsigned int *)sc->keyframes, sc->keyframe_count,
+                                    sample + sc->key_off, backward);
+    }
+    if (sc->stps_count) {
+        k = mov_search_sync_table(sc->stps_data, sc->stps_count,
+                                  sample + sc->key_off, backward);
+        if (k >= 0 && (key < 0 || (backward ? k > key : k < key)))
+            key = k;
+    }
+    return key < 0 ? -1 : key - sc->key_off;
+}
+
+/**
+ * Get an index entry of a stream. The samples of the compact index are
+ * computed on the fly, reading them in order only costs a few additions.
+ * The returned entry is only valid until the next call for the same stream.
+ *
+ * @return the entry, NULL if sample is out of range
+ */
+static const AVIndexEntry *mov_get_sample(AVStream *st, int sample)
+{
+    MOVStreamContext *sc = st->priv_data;
+    AVIndexEntry *e = &sc->cur_index_entry;
+    unsigned int chunk, run, a, b, i;
+    int64_t key;
+
+    if (sample < 0)
+        return NULL;
+    if (sample >= sc->index_samples) {
+        sample -= sc->index_samples;
+        return sample < st->nb_index_entries ? &st->index_entries[sample] : NULL;
+    }
+    if (sample == sc->cur_index_sample)
+        return e;
+
+    if (sc->cur_index_sample >= 0 && sample == sc->cur_index_sample + 1) {
+        chunk = sc->cur_chunk;
+        run   = sc->cur_time_run;
+        e->pos += mov_sample_size(sc, sample - 1);
+        while (sample >= sc->chunk_first_sample[chunk + 1])
+            e->pos = sc->chunk_offsets[++chunk];
+        if (run + 1 < sc->time_runs_count && sample >= sc->time_runs[run + 1].first_sample)
+            run++;
+    } else {
+        for (a = 0, b = sc->chunk_count; b - a > 1; ) {
+            unsigned int m = (a + b) >> 1;
+            if (sc->chunk_first_sample[m] <= sample)
+                a = m;
+            else
+                b = m;
+        }
+        chunk = a;
+        for (a = 0, b = sc->time_runs_count; b - a > 1; ) {
+            unsigned int m = (a + b) >> 1;
+            if (sc->time_runs[m].first_sample <= sample)
+                a = m;
+            else
+                b = m;
+        }
+        run = a;
+        e->pos = sc->chunk_offsets[chunk];
+        for (i = sc->chunk_first_sample[chunk]; i < sample; i++)
+            e->pos += mov_sample_size(sc, i);
+    }
+
+    e->timestamp = sc->time_runs[run].first_dts +
+                   (int64_t)(sample - sc->time_runs[run].first_sample) * sc->time_runs[run].duration;
+    e->size = mov_sample_size(sc, sample);
+    key = mov_find_keyframe(sc, sample, 1);
+    e->flags = key == sample ? AVINDEX_KEYFRAME : 0;
+    e->min_distance = sample - FFMAX(key, 0);
+
+    sc->cur_index_sample = sample;
+    sc->cur_chunk        = chunk;
+    sc->cur_time_run     = run;
+    return e;
+}
+
+static int mov_sync_table_valid(const unsigned int *tab, unsigned int count, int key_off)
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++)
+        if (tab[i] < key_off || tab[i] > INT_MAX || (i && tab[i] <= tab[i - 1]))
+            return 0;
+    return 1;
+}
+
+/**
+ * Set up the compact sample index of a stream from its sample tables,
+ * without expanding them into one index entry per sample.
+ * Only the tables which can be searched directly are supported.
+ *
+ * @return 0 on success, a negative value if the full index must be built
+ */
+static int mov_build_compact_index(MOVContext *mov, AVStream *st, int64_t current_dts)
+{
+    MOVStreamContext *sc = st->priv_data;
+    unsigned int stsc_index = 0, i, j;
+    uint64_t total = 0, stream_size = 0;
+    int wrong_count = 0;
+
+    if (!sc->stts_count)
+        return AVERROR_INVALIDDATA;
+    if (sc->pseudo_stream_id != -1)
+        for (i = 0; i < sc->stsc_count; i++)
+            if (sc->stsc_data[i].id - 1 != sc->pseudo_stream_id)
+                return AVERROR_PATCHWELCOME;
+
+    sc->key_off = (sc->keyframe_count && sc->keyframes[0] > 0) || (sc->stps_data && sc->stps_data[0] > 0);
+    /* sync samples are matched in order by the full index, which is only
+     * equivalent to a lookup for sorted tables without common entries */
+    if (!sc->keyframe_absent && sc->keyframe_count) {
+        if (!mov_sync_table_valid((const unsigned int *)sc->keyframes, sc->keyframe_count, sc->key_off) ||
+            !mov_sync_table_valid(sc->stps_data, sc->stps_count, sc->key_off))
+            return AVERROR_PATCHWELCOME;
+        for (i = j = 0; i < sc->keyframe_count && j < sc->stps_count; ) {
+            if (sc->keyframes[i] == sc->stps_data[j])
+                return AVERROR_PATCHWELCOME;
+            if (sc->keyframes[i] < sc->stps_data[j])
+                i++;
+            else
+                j++;
+        }
+    } else if (sc->keyframe_absent &&
+               !mov_sync_table_valid(sc->stps_data, sc->stps_count, sc->key_off))
+        return AVERROR_PATCHWELCOME;
+
+    sc->chunk_first_sample = av_malloc((sc->chunk_count + 1) * sizeof(*sc->chunk_first_sample));
+    sc->time_runs          = av_malloc(sc->stts_count * sizeof(*sc->time_runs));
+    if (!sc->chunk_first_sample || !sc->time_runs) {
+        av_freep(&sc->chunk_first_sample);
+        av_freep(&sc->time_runs);
+        return AVERROR(ENOMEM);
+    }
+
+    for (i = 0; i < sc->chunk_count; i++) {
+        while (stsc_index + 1 < sc->stsc_count &&
+            i + 1 == sc->stsc_data[stsc_index + 1].first)
+            stsc_index++;
+        sc->chunk_first_sample[i] = total;
+        total += (unsigned int)sc->stsc_data[stsc_index].count;
+        if (total > sc->sample_count) {
+            total = sc->sample_count;
+            wrong_count = 1;
+        }
+    }
+    sc->chunk_first_sample[sc->chunk_count] = total;
+    sc->index_samples = total;
+    if (wrong_count)
+        av_log(mov->fc, AV_LOG_ERROR, "wrong sample count\n");
+
+    /* the last stts entry, or one with a count of 0, lasts until the end */
+    for (total = 0, i = 0; i < sc->stts_count; i++) {
+        unsigned int count = sc->stts_data[i].count;
+
+        sc->time_runs[i].first_sample = total;
+        sc->time_runs[i].duration     = sc->stts_data[i].duration;
+        sc->time_runs[i].first_dts    = current_dts;
+        total       += count;
+        current_dts += (int64_t)count * sc->stts_data[i].duration;
+        if (!count || total >= sc->index_samples)
+            break;
+    }
+    sc->time_runs_count = FFMIN(i + 1, sc->stts_count);
+    sc->cur_index_sample = -1;
+
+    av_dlog(mov->fc, "compact index stream %d, %u samples, %u chunks, %u time runs\n",
+            st->index, sc->index_samples, sc->chunk_count, sc->time_runs_count);
+
+    if (!wrong_count && st->duration > 0) {
+        if (sc->alt_sample_size > 0)
+            stream_size = (uint64_t)sc->index_samples * sc->alt_sample_size;
+        else
+            for (i = 0; i < sc->index_samples; i++)
+                stream_size += (unsigned int)sc->sample_sizes[i];
+        st->codec->bit_rate = stream_size*8*sc->time_scale/st->duration;
+    }
+    return 0;
+}
+
+/**
+ * Expand the compact index of a stream into AVStream.index_entries.
+ */
+static int mov_expand_index(AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    AVIndexEntry *entries;
+    unsigned int i;
+
+    if (!sc->index_samples)
+        return 0;
+    if (sc->index_samples >= UINT_MAX / sizeof(*entries) - st->nb_index_entries)
+        return AVERROR(ENOMEM);
+    entries = av_malloc((sc->index_samples + st->nb_index_entries) * sizeof(*entries));
+    if (!entries)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < sc->index_samples; i++)
+        entries[i] = *mov_get_sample(st, i);
+    if (st->nb_index_entries)
+        memcpy(entries + i, st->index_entries, st->nb_index_entries * sizeof(*entries));
+    av_free(st->index_entries);
+    st->index_entries = entries;
+    st->nb_index_entries += sc->index_samples;
+    st->index_entries_allocated_size = st->nb_index_entries * sizeof(*entries);
+
+    sc->index_samples = 0;
+    av_freep(&sc->chunk_first_sample);
+    av_freep(&sc->time_runs);
+    av_freep(&sc->chunk_offsets);
+    av_freep(&sc->sample_sizes);
+    av_freep(&sc->keyframes);
+    av_freep(&sc->stps_data);
+    return 0;
+}
+
 static void mov_build_index(MOVContext *mov, AVStream *st)
 {
     MOVStreamContext *sc = st->priv_data;
@@ -1884,6 +2138,8 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
 
         if (!sc->sample_count || st->nb_index_entries)
             return;
+        if (mov_build_compact_index(mov, st, current_dts) >= 0)
+            return;
         if (sc->sample_count >= UINT_MAX / sizeof(*st->index_entries) - st->nb_index_entries)
             return;
         mem = av_realloc(st->index_entries, (st->nb_index_entries + sc->sample_count) * sizeof(*st->index_entries));
@@ -2161,13 +2417,15 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         break;
     }
 
-    /* Do not need those anymore. */
-    av_freep(&sc->chunk_offsets);
+    /* Do not need those anymore, except for the compact index. */
     av_freep(&sc->stsc_data);
-    av_freep(&sc->sample_sizes);
-    av_freep(&sc->keyframes);
     av_freep(&sc->stts_data);
-    av_freep(&sc->stps_data);
+    if (!sc->index_samples) {
+        av_freep(&sc->chunk_offsets);
+        av_freep(&sc->sample_sizes);
+        av_freep(&sc->keyframes);
+        av_freep(&sc->stps_data);
+    }
 
     return 0;
 }
@@ -2402,14 +2660,15 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         if (!ctts_data)
             return AVERROR(ENOMEM);
         sc->ctts_data = ctts_data;
+        sc->ctts_allocated_size = sizeof(*sc->ctts_data);
         sc->ctts_data[sc->ctts_count].count = sc->sample_count;
         sc->ctts_data[sc->ctts_count].duration = 0;
         sc->ctts_count++;
     }
     if ((uint64_t)entries+sc->ctts_count >= UINT_MAX/sizeof(*sc->ctts_data))
         return AVERROR_INVALIDDATA;
-    ctts_data = av_realloc(sc->ctts_data,
-                           (entries+sc->ctts_count)*sizeof(*sc->ctts_data));
+    ctts_data = av_fast_realloc(sc->ctts_data, &sc->ctts_allocated_size,
+                                (entries+sc->ctts_count)*sizeof(*sc->ctts_data));
     if (!ctts_data)
         return AVERROR(ENOMEM);
     sc->ctts_data = ctts_data;
@@ -2819,9 +3078,10 @@ static void mov_read_chapters(AVFormatContext *s)
     sc = st->priv_data;
     cur_pos = avio_tell(sc->pb);
 
-    for (i = 0; i < st->nb_index_entries; i++) {
-        AVIndexEntry *sample = &st->index_entries[i];
-        int64_t end = i+1 < st->nb_index_entries ? st->index_entries[i+1].timestamp : st->duration;
+    for (i = 0; mov_get_sample(st, i); i++) {
+        AVIndexEntry sample_entry = *mov_get_sample(st, i), *sample = &sample_entry;
+        const AVIndexEntry *next = mov_get_sample(st, i + 1);
+        int64_t end = next ? next->timestamp : st->duration;
         uint8_t *title;
         uint16_t ch;
         int len, title_len;
@@ -2886,12 +3146,13 @@ static int mov_read_timecode_track(AVFormatContext *s, AVStream *st)
     MOVStreamContext *sc = st->priv_data;
     int flags = 0;
     int64_t cur_pos = avio_tell(sc->pb);
+    const AVIndexEntry *sample = mov_get_sample(st, 0);
     uint32_t value;
 
-    if (!st->nb_index_entries)
+    if (!sample)
         return -1;
 
-    avio_seek(sc->pb, st->index_entries->pos, SEEK_SET);
+    avio_seek(sc->pb, sample->pos, SEEK_SET);
     value = avio_rb32(s->pb);
 
     if (sc->tmcd_flags & 0x0001) flags |= AV_TIMECODE_FLAG_DROPFRAME;
@@ -2934,6 +3195,8 @@ static int mov_read_close(AVFormatContext *s)
         av_freep(&sc->stps_data);
         av_freep(&sc->stsc_data);
         av_freep(&sc->stts_data);
+        av_freep(&sc->chunk_first_sample);
+        av_freep(&sc->time_runs);
     }
 
     if (mov->dv_demux) {
@@ -3060,16 +3323,16 @@ static int mov_read_header(AVFormatContext *s)
     return 0;
 }
 
-static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
+static const AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
 {
-    AVIndexEntry *sample = NULL;
+    const AVIndexEntry *sample = NULL;
     int64_t best_dts = INT64_MAX;
     int i;
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *avst = s->streams[i];
         MOVStreamContext *msc = avst->priv_data;
-        if (msc->pb && msc->current_sample < avst->nb_index_entries) {
-            AVIndexEntry *current_sample = &avst->index_entries[msc->current_sample];
+        const AVIndexEntry *current_sample;
+        if (msc->pb && (current_sample = mov_get_sample(avst, msc->current_sample))) {
             int64_t dts = av_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
             av_dlog(s, "stream %d, sample %d, dts %"PRId64"\n", i, msc->current_sample, dts);
             if (!sample || (!s->pb->seekable && current_sample->pos < sample->pos) ||
@@ -3086,17 +3349,45 @@ static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
     return sample;
 }
 
+/**
+ * Discard the index entries of the fragments which have been read, when
+ * the input cannot seek back to them anyway. The index of a live stream
+ * thus only spans a window of AVFormatContext.max_index_size bytes instead
+ * of growing for the whole session.
+ */
+static void mov_discard_read_samples(AVFormatContext *s, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int read = sc->current_sample - sc->index_samples;
+
+    if (s->pb->seekable || read <= 0 ||
+        read < s->max_index_size / 2 / sizeof(*st->index_entries))
+        return;
+
+    memmove(st->index_entries, st->index_entries + read,
+            (st->nb_index_entries - read) * sizeof(*st->index_entries));
+    st->nb_index_entries -= read;
+    sc->current_sample   -= read;
+    if (sc->ctts_data && sc->ctts_index > 0) {
+        memmove(sc->ctts_data, sc->ctts_data + sc->ctts_index,
+                (sc->ctts_count - sc->ctts_index) * sizeof(*sc->ctts_data));
+        sc->ctts_count -= sc->ctts_index;
+        sc->ctts_index  = 0;
+    }
+}
+
 static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MOVContext *mov = s->priv_data;
     MOVStreamContext *sc;
-    AVIndexEntry *sample;
+    const AVIndexEntry *next;
+    AVIndexEntry sample_entry, *sample = &sample_entry;
     AVStream *st = NULL;
     int ret;
     mov->fc = s;
  retry:
-    sample = mov_find_next_sample(s, &st);
-    if (!sample) {
+    next = mov_find_next_sample(s, &st);
+    if (!next) {
         mov->found_mdat = 0;
         if (!mov->next_root_atom)
             return AVERROR_EOF;
@@ -3108,9 +3399,11 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         av_dlog(s, "read fragments, offset 0x%"PRIx64"\n", avio_tell(s->pb));
         goto retry;
     }
+    sample_entry = *next;
     sc = st->priv_data;
     /* must be done just before reading, to avoid infinite loop on sample */
     sc->current_sample++;
+    mov_discard_read_samples(s, st);
 
     if (st->discard != AVDISCARD_ALL) {
         if (avio_seek(sc->pb, sample->pos, SEEK_SET) != sample->pos) {
@@ -3158,8 +3451,8 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         if (sc->wrong_dts)
             pkt->dts = AV_NOPTS_VALUE;
     } else {
-        int64_t next_dts = (sc->current_sample < st->nb_index_entries) ?
-            st->index_entries[sc->current_sample].timestamp : st->duration;
+        int64_t next_dts = (next = mov_get_sample(st, sc->current_sample)) ?
+            next->timestamp : st->duration;
         pkt->duration = next_dts - pkt->dts;
         pkt->pts = pkt->dts;
     }
@@ -3172,15 +3465,62 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
     return 0;
 }
 
+/**
+ * Search a timestamp in the index of a stream, as av_index_search_timestamp()
+ * does for AVStream.index_entries.
+ */
+static int mov_index_search_timestamp(AVStream *st, int64_t wanted_timestamp, int flags)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int nb_entries = sc->index_samples + st->nb_index_entries;
+    int a, b, m;
+    int64_t timestamp, key;
+
+    a = - 1;
+    b = nb_entries;
+
+    if (b && mov_get_sample(st, b - 1)->timestamp < wanted_timestamp)
+        a = b - 1;
+
+    while (b - a > 1) {
+        m = (a + b) >> 1;
+        timestamp = mov_get_sample(st, m)->timestamp;
+        if (timestamp >= wanted_timestamp)
+            b = m;
+        if (timestamp <= wanted_timestamp)
+            a = m;
+    }
+    m = (flags & AVSEEK_FLAG_BACKWARD) ? a : b;
+
+    if (!(flags & AVSEEK_FLAG_ANY)) {
+        while (m >= 0 && m < nb_entries && !(mov_get_sample(st, m)->flags & AVINDEX_KEYFRAME)) {
+            if (m < sc->index_samples) {
+                /* jump to the keyframe directly instead of walking there */
+                key = mov_find_keyframe(sc, m, flags & AVSEEK_FLAG_BACKWARD);
+                if (flags & AVSEEK_FLAG_BACKWARD)
+                    m = key;
+                else
+                    m = key < 0 || key >= sc->index_samples ? sc->index_samples : key;
+            } else
+                m += (flags & AVSEEK_FLAG_BACKWARD) ? -1 : 1;
+        }
+    }
+
+    if (m == nb_entries)
+        return -1;
+    return m;
+}
+
 static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp, int flags)
 {
     MOVStreamContext *sc = st->priv_data;
+    const AVIndexEntry *first;
     int sample, time_sample;
     int i;
 
-    sample = av_index_search_timestamp(st, timestamp, flags);
+    sample = mov_index_search_timestamp(st, timestamp, flags);
     av_dlog(s, "stream %d, timestamp %"PRId64", sample %d\n", st->index, timestamp, sample);
-    if (sample < 0 && st->nb_index_entries && timestamp < st->index_entries[0].timestamp)
+    if (sample < 0 && (first = mov_get_sample(st, 0)) && timestamp < first->timestamp)
         sample = 0;
     if (sample < 0) /* not sure what to do */
         return AVERROR_INVALIDDATA;
@@ -3218,7 +3558,7 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
         return sample;
 
     /* adjust seek timestamp to found sample timestamp */
-    seek_timestamp = st->index_entries[sample].timestamp;
+    seek_timestamp = mov_get_sample(st, sample)->timestamp;
 
     for (i = 0; i < s->nb_streams; i++) {
         MOVStreamContext *sc = s->streams[i]->priv_data;
@@ -3234,6 +3574,11 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
     return 0;
 }
 
+static int mov_read_index(AVFormatContext *s, int stream_index)
+{
+    return mov_expand_index(s->streams[stream_index]);
+}
+
 static const AVOption options[] = {
     {"use_absolute_path",
         "allow using absolute path when opening alias, this is a possible security issue",
@@ -3258,5 +3603,6 @@ AVInputFormat ff_mov_demuxer = {
     .read_packet    = mov_read_packet,
     .read_close     = mov_read_close,
     .read_seek      = mov_read_seek,
+    .read_index     = mov_read_index,
     .priv_class     = &class,
 };
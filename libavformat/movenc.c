@@ -52,6 +52,7 @@ static const AVOption options[] = {
     { "separate_moof", "Write separate moof/mdat atoms for each track", 0, AV_OPT_TYPE_CONST, {.dbl = FF_MOV_FLAG_SEPARATE_MOOF}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "frag_custom", "Flush fragments on caller requests", 0, AV_OPT_TYPE_CONST, {.dbl = FF_MOV_FLAG_FRAG_CUSTOM}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "isml", "Create a live smooth streaming feed (for pushing to a publishing point)", 0, AV_OPT_TYPE_CONST, {.dbl = FF_MOV_FLAG_ISML}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
+    { "faststart", "Run a second pass moving the moov atom to the start of the file", 0, AV_OPT_TYPE_CONST, {.dbl = FF_MOV_FLAG_FASTSTART}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     FF_RTP_FLAG_OPTS(MOVMuxContext, rtp_flags),
     { "skip_iods", "Skip writing iods atom.", offsetof(MOVMuxContext, iods_skip), AV_OPT_TYPE_INT, {.dbl = 1}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM},
     { "iods_audio_profile", "iods audio profile atom.", offsetof(MOVMuxContext, iods_audio_profile), AV_OPT_TYPE_INT, {.dbl = -1}, -1, 255, AV_OPT_FLAG_ENCODING_PARAM},
@@ -89,7 +90,9 @@ static int mov_write_stco_tag(AVIOContext *pb, MOVTrack *track)
     int mode64 = 0; //   use 32 bit size variant if possible
     int64_t pos = avio_tell(pb);
     avio_wb32(pb, 0); /* size */
-    if (pos > UINT32_MAX) {
+    /* the moov atom may be written before the data it points to */
+    if (pos > UINT32_MAX || (track->entry &&
+        track->cluster[track->entry - 1].pos + track->data_offset > UINT32_MAX)) {
         mode64 = 1;
         ffio_wfourcc(pb, "co64");
     } else
@@ -3537,11 +3540,17 @@ static int mov_write_header(AVFormatContext *s)
                       FF_MOV_FLAG_FRAGMENT;
     }
 
-    if(mov->reserved_moov_size){
-        mov->reserved_moov_pos= avio_tell(pb);
-        avio_skip(pb, mov->reserved_moov_size);
+    if (mov->flags & FF_MOV_FLAG_FASTSTART && mov->flags & FF_MOV_FLAG_FRAGMENT) {
+        av_log(s, AV_LOG_WARNING, "The faststart flag is incompatible with "
+               "fragmentation, disabling faststart\n");
+        mov->flags &= ~FF_MOV_FLAG_FASTSTART;
     }
 
+    /* the moov atom goes here with moov_size or faststart */
+    mov->reserved_moov_pos= avio_tell(pb);
+    if(mov->reserved_moov_size)
+        avio_skip(pb, mov->reserved_moov_size);
+
     if (!(mov->flags & FF_MOV_FLAG_FRAGMENT))
         mov_write_mdat_tag(pb, mov);
 
@@ -3599,6 +3608,156 @@ static int mov_write_header(AVFormatContext *s)
     return -1;
 }
 
+static int get_moov_size(AVFormatContext *s)
+{
+    MOVMuxContext *mov = s->priv_data;
+    AVIOContext *moov_buf;
+    uint8_t *buf;
+    int ret, size;
+
+    if ((ret = avio_open_dyn_buf(&moov_buf)) < 0)
+        return ret;
+    mov_write_moov_tag(moov_buf, mov, s);
+    size = avio_close_dyn_buf(moov_buf, &buf);
+    av_free(buf);
+    return size;
+}
+
+/**
+ * Move the chunk offsets of all tracks so that a moov atom fits before the
+ * media data, in addition to reserved bytes which are already there.
+ *
+ * @return the size of the moov atom with the moved offsets
+ */
+static int compute_moov_size(AVFormatContext *s, int reserved)
+{
+    MOVMuxContext *mov = s->priv_data;
+    int i, moov_size, moov_size2;
+
+    moov_size = get_moov_size(s);
+    if (moov_size < 0)
+        return moov_size;
+    for (i = 0; i < mov->nb_streams; i++)
+        mov->tracks[i].data_offset += moov_size - reserved;
+
+    /* the new offsets may need co64 instead of stco */
+    moov_size2 = get_moov_size(s);
+    if (moov_size2 < 0)
+        return moov_size2;
+    for (i = 0; i < mov->nb_streams; i++)
+        mov->tracks[i].data_offset += moov_size2 - moov_size;
+    return moov_size2;
+}
+
+/**
+ * Move the data between start and end forward by shift bytes, reading it
+ * through another context opened on the output file. The data is copied in
+ * blocks of shift bytes, each one being read before the previous one is
+ * written over it.
+ */
+static int shift_data(AVFormatContext *s, AVIOContext *read_pb,
+                      int64_t start, int64_t end, int shift)
+{
+    uint8_t *buf[2];
+    int size[2], cur = 0;
+    int64_t pos = start;
+
+    if (!shift)
+        return 0;
+    if (!(buf[0] = av_malloc(2 * shift)))
+        return AVERROR(ENOMEM);
+    buf[1] = buf[0] + shift;
+
+    avio_flush(s->pb);
+    avio_seek(read_pb, start, SEEK_SET);
+    avio_seek(s->pb, start + shift, SEEK_SET);
+
+    size[cur] = avio_read(read_pb, buf[cur], FFMIN(shift, end - pos));
+    while (size[cur] > 0) {
+        pos += size[cur];
+        size[!cur] = pos < end ? avio_read(read_pb, buf[!cur], FFMIN(shift, end - pos)) : 0;
+        avio_write(s->pb, buf[cur], size[cur]);
+        cur = !cur;
+    }
+    av_free(buf[0]);
+    if (pos != end) {
+        av_log(s, AV_LOG_ERROR, "Could only shift %"PRId64" of %"PRId64" bytes\n",
+               pos - start, end - start);
+        return AVERROR(EIO);
+    }
+    return 0;
+}
+
+/**
+ * Write the moov atom before the media data, into the space reserved with
+ * moov_size if it is large enough, else by moving the media data.
+ *
+ * @param end end of the media data
+ * @return 1 if moov was written, 0 if it must be written at the end, or a
+ *         negative error code
+ */
+static int mov_write_moov_front(AVFormatContext *s, int64_t end)
+{
+    MOVMuxContext *mov = s->priv_data;
+    AVIOContext *pb = s->pb, *read_pb;
+    int64_t start = mov->reserved_moov_pos + mov->reserved_moov_size;
+    int reserved = mov->reserved_moov_size, base;
+    int moov_size, ret;
+
+    if ((moov_size = get_moov_size(s)) < 0)
+        return moov_size;
+
+    if (reserved && moov_size <= reserved - 8) {
+        avio_seek(pb, mov->reserved_moov_pos, SEEK_SET);
+        mov_write_moov_tag(pb, mov, s);
+        avio_wb32(pb, reserved - moov_size);
+        ffio_wfourcc(pb, "free");
+        ffio_fill(pb, 0, reserved - moov_size - 8);
+        avio_seek(pb, end, SEEK_SET);
+        return 1;
+    }
+
+    if (!(mov->flags & FF_MOV_FLAG_FASTSTART) ||
+        (ret = avio_open2(&read_pb, s->filename, AVIO_FLAG_READ,
+                          &s->interrupt_callback, NULL)) < 0) {
+        if (reserved)
+            av_log(s, AV_LOG_WARNING, "reserved_moov_size is too small, needed %d "
+                   "additional, writing moov at the end\n", moov_size + 8 - reserved);
+        else
+            av_log(s, AV_LOG_WARNING, "Unable to reopen %s for moving moov to "
+                   "the start, writing it at the end\n", s->filename);
+        if (reserved >= 8) {
+            avio_seek(pb, mov->reserved_moov_pos, SEEK_SET);
+            avio_wb32(pb, reserved);
+            ffio_wfourcc(pb, "free");
+            ffio_fill(pb, 0, reserved - 8);
+        }
+        return 0;
+    }
+
+    /* if moov almost fits, what is left of the reserved space is too small
+     * for a free atom, so make room for an empty one */
+    base = moov_size >= reserved ? reserved : reserved - 8;
+    if ((moov_size = compute_moov_size(s, base)) < 0) {
+        avio_close(read_pb);
+        return moov_size;
+    }
+    av_log(s, AV_LOG_INFO, "Moving moov to the start of the file\n");
+    ret = shift_data(s, read_pb, start, end, moov_size - base);
+    avio_close(read_pb);
+    if (ret < 0)
+        return ret;
+
+    avio_seek(pb, mov->reserved_moov_pos, SEEK_SET);
+    mov_write_moov_tag(pb, mov, s);
+    if (base != reserved) {
+        avio_wb32(pb, 8);
+        ffio_wfourcc(pb, "free");
+    }
+    avio_seek(pb, end + moov_size - base, SEEK_SET);
+    return 1;
+}
+
 static int mov_write_trailer(AVFormatContext *s)
 {
     MOVMuxContext *mov = s->priv_data;
@@ -3636,20 +3795,13 @@ static int mov_write_trailer(AVFormatContext *s)
             ffio_wfourcc(pb, "mdat");
             avio_wb64(pb, mov->mdat_size + 16);
         }
-        avio_seek(pb, mov->reserved_moov_size ? mov->reserved_moov_pos : moov_pos, SEEK_SET);
-
-        mov_write_moov_tag(pb, mov, s);
-        if(mov->reserved_moov_size){
-            int64_t size=  mov->reserved_moov_size - (avio_tell(pb) - mov->reserved_moov_pos);
-            if(size < 8){
-                av_log(s, AV_LOG_ERROR, "reserved_moov_size is too small, needed %"PRId64" additional\n", 8-size);
-                return -1;
-            }
-            avio_wb32(pb, size);
-            ffio_wfourcc(pb, "free");
-            for(i=0; i<size; i++)
-                avio_w8(pb, 0);
+        if (mov->reserved_moov_size || mov->flags & FF_MOV_FLAG_FASTSTART)
+            res = mov_write_moov_front(s, moov_pos);
+        if (!res) {
             avio_seek(pb, moov_pos, SEEK_SET);
+            mov_write_moov_tag(pb, mov, s);
+        } else if (res > 0) {
+            res = 0;
         }
     } else {
         mov_flush_fragment(s);
@@ -71,6 +71,8 @@ static const AVOption options[]={
 {"compliant",  "consider all spec non compliancies as errors", 0, AV_OPT_TYPE_CONST, {.dbl = AV_EF_COMPLIANT }, INT_MIN, INT_MAX, D, "err_detect"},
 {"aggressive", "consider things that a sane encoder shouldnt do as an error", 0, AV_OPT_TYPE_CONST, {.dbl = AV_EF_AGGRESSIVE }, INT_MIN, INT_MAX, D, "err_detect"},
 {"use_wallclock_as_timestamps", "use wallclock as timestamps", OFFSET(use_wallclock_as_timestamps), AV_OPT_TYPE_INT, {.dbl = 0}, 0, INT_MAX-1, D},
+{"index_file", "file to load and save the stream parameters and seek index in", OFFSET(index_file), AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, D},
+{"probe_threads", "number of threads decoding the packets probed by avformat_find_stream_info()", OFFSET(probe_threads), AV_OPT_TYPE_INT, {.dbl = 1}, 1, INT_MAX, D},
 {NULL},
 };
 
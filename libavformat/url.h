@@ -89,6 +89,13 @@ typedef struct URLProtocol {
     const AVClass *priv_data_class;
     int flags;
     int (*url_check)(URLContext *h, int mask);
+    /**
+     * Return a read-only mapping of a window of the resource containing
+     * pos, valid until the next call or url_close. Only implemented by
+     * protocols that can map their data.
+     */
+    int (*url_get_mapping)(URLContext *h, int64_t pos, const uint8_t **data,
+                           int64_t *start, int *size);
 } URLProtocol;
 
 /**
@@ -212,6 +219,19 @@ int ffurl_get_file_handle(URLContext *h);
  */
 int ffurl_get_multi_file_handle(URLContext *h, int **handles, int *numhandles);
 
+/**
+ * Get a memory mapping of the part of the resource containing pos, if the
+ * protocol provides one. The data must not be written to and stays valid
+ * until the next call or until the URLContext is closed.
+ *
+ * @param start set to the position in the resource of the mapped data
+ * @param size  set to the size of the mapped data
+ * @return 0 on success, AVERROR_EOF if pos is at or past the end of the
+ *         resource, another negative AVERROR code if it cannot be mapped
+ */
+int ffurl_get_mapping(URLContext *h, int64_t pos, const uint8_t **data,
+                      int64_t *start, int *size);
+
 /**
  * Signal the URLContext that we are done reading or writing the stream.
  *
@@ -46,6 +46,9 @@
 #if CONFIG_NETWORK
 #include "network.h"
 #endif
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 
 #undef NDEBUG
 #include <assert.h>
@@ -651,6 +654,9 @@ int avformat_open_input(AVFormatContext **ps, const char *filename, AVInputForma
     if (!(s->flags&AVFMT_FLAG_PRIV_OPT) && s->pb && !s->data_offset)
         s->data_offset = avio_tell(s->pb);
 
+    if (s->index_file)
+        ff_index_file_read(s);
+
     s->raw_packet_buffer_remaining_size = RAW_PACKET_BUFFER_SIZE;
 
     if (options) {
@@ -892,20 +898,21 @@ static int is_intra_only(AVCodecContext *enc){
     return 0;
 }
 
-static int has_decode_delay_been_guessed(AVStream *st)
+static int has_decode_delay_been_guessed(AVCodecContext *avctx,
+                                         int nb_decoded_frames)
 {
-    if(st->codec->codec_id != AV_CODEC_ID_H264) return 1;
+    if(avctx->codec_id != AV_CODEC_ID_H264) return 1;
 #if CONFIG_H264_DECODER
-    if(st->codec->has_b_frames &&
-       avpriv_h264_has_num_reorder_frames(st->codec) == st->codec->has_b_frames)
+    if(avctx->has_b_frames &&
+       avpriv_h264_has_num_reorder_frames(avctx) == avctx->has_b_frames)
         return 1;
 #endif
-    if(st->codec->has_b_frames<3)
-        return st->nb_decoded_frames >= 7;
-    else if(st->codec->has_b_frames<4)
-        return st->nb_decoded_frames >= 18;
+    if(avctx->has_b_frames<3)
+        return nb_decoded_frames >= 7;
+    else if(avctx->has_b_frames<4)
+        return nb_decoded_frames >= 18;
     else
-        return st->nb_decoded_frames >= 20;
+        return nb_decoded_frames >= 20;
 }
 
 static AVPacketList *get_next_pkt(AVFormatContext *s, AVStream *st, AVPacketList *pktl)
@@ -994,11 +1001,16 @@ static void update_initial_durations(AVFormatContext *s, AVStream *st,
         st->cur_dts= cur_dts;
 }
 
+static void sync_probe_codec(AVStream *st);
+
 static void compute_pkt_fields(AVFormatContext *s, AVStream *st,
                                AVCodecParserContext *pc, AVPacket *pkt)
 {
     int num, den, presentation_delayed, delay, i;
     int64_t offset;
+    /* the decoder of a probe thread is idle here, see sync_probe_codec() */
+    AVCodecContext *dec = st->info && st->info->probe_codec ?
+                          st->info->probe_codec : st->codec;
 
     if (s->flags & AVFMT_FLAG_NOFILLIN)
         return;
@@ -1135,7 +1147,8 @@ static void compute_pkt_fields(AVFormatContext *s, AVStream *st,
         }
     }
 
-    if(pkt->pts != AV_NOPTS_VALUE && delay <= MAX_REORDER_DELAY && has_decode_delay_been_guessed(st)){
+    if(pkt->pts != AV_NOPTS_VALUE && delay <= MAX_REORDER_DELAY &&
+       has_decode_delay_been_guessed(dec, st->nb_decoded_frames)){
         st->pts_buffer[0]= pkt->pts;
         for(i=0; i<delay && st->pts_buffer[i] > st->pts_buffer[i+1]; i++)
             FFSWAP(int64_t, st->pts_buffer[i], st->pts_buffer[i+1]);
@@ -1304,8 +1317,10 @@ static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
             /* flush the parsers */
             for(i = 0; i < s->nb_streams; i++) {
                 st = s->streams[i];
-                if (st->parser && st->need_parsing)
+                if (st->parser && st->need_parsing) {
+                    sync_probe_codec(st);
                     parse_packet(s, NULL, st->index);
+                }
             }
             /* all remaining packets are now in parse_queue =>
              * really terminate parsing */
@@ -1313,6 +1328,7 @@ static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
         }
         ret = 0;
         st  = s->streams[cur_pkt.stream_index];
+        sync_probe_codec(st);
 
         if (cur_pkt.pts != AV_NOPTS_VALUE &&
             cur_pkt.dts != AV_NOPTS_VALUE &&
@@ -1581,6 +1597,7 @@ int ff_add_index_entry(AVIndexEntry **index_entries,
 {
     AVIndexEntry *entries, *ie;
     int index;
+    unsigned int min_size;
 
     if((unsigned)*nb_index_entries + 1 >= UINT_MAX / sizeof(AVIndexEntry))
         return -1;
@@ -1591,10 +1608,14 @@ int ff_add_index_entry(AVIndexEntry **index_entries,
     if (is_relative(timestamp)) //FIXME this maintains previous behavior but we should shift by the correct offset once known
         timestamp -= RELATIVE_TS_BASE;
 
+    /* grow by half at once, demuxers add entries one by one for whole
+     * streams, so the reallocations must stay rare */
+    min_size = (*nb_index_entries + 1) * sizeof(AVIndexEntry);
+    if (min_size > *index_entries_allocated_size)
+        min_size = FFMIN((uint64_t)min_size * 3 / 2, UINT_MAX / sizeof(AVIndexEntry) * sizeof(AVIndexEntry));
     entries = av_fast_realloc(*index_entries,
                               index_entries_allocated_size,
-                              (*nb_index_entries + 1) *
-                              sizeof(AVIndexEntry));
+                              min_size);
     if(!entries)
         return -1;
 
@@ -1675,6 +1696,15 @@ int av_index_search_timestamp(AVStream *st, int64_t wanted_timestamp,
                                      wanted_timestamp, flags);
 }
 
+int avformat_build_index(AVFormatContext *s, int stream_index)
+{
+    if (stream_index < 0 || stream_index >= s->nb_streams)
+        return AVERROR(EINVAL);
+    if (!s->iformat || !s->iformat->read_index)
+        return 0;
+    return s->iformat->read_index(s, stream_index);
+}
+
 int ff_seek_frame_binary(AVFormatContext *s, int stream_index, int64_t target_ts, int flags)
 {
     AVInputFormat *avif= s->iformat;
@@ -2288,10 +2318,9 @@ static void estimate_timings(AVFormatContext *ic, int64_t old_offset)
     }
 }
 
-static int has_codec_parameters(AVStream *st, const char **errmsg_ptr)
+static int has_codec_parameters(AVStream *st, AVCodecContext *avctx,
+                                const char **errmsg_ptr)
 {
-    AVCodecContext *avctx = st->codec;
-
 #define FAIL(errmsg) do {                                         \
         if (errmsg_ptr)                                           \
             *errmsg_ptr = errmsg;                                 \
@@ -2328,20 +2357,40 @@ static int has_codec_parameters(AVStream *st, const char **errmsg_ptr)
     return 1;
 }
 
+/**
+ * Check whether decoding more packets may still tell something about the
+ * stream, nb_packets packets of which were demuxed before.
+ */
+static int need_decoding(AVStream *st, AVCodecContext *avctx,
+                         int nb_decoded_frames, int nb_packets)
+{
+    return !has_codec_parameters(st, avctx, NULL) ||
+           !has_decode_delay_been_guessed(avctx, nb_decoded_frames) ||
+           (!nb_packets && avctx->codec->capabilities & CODEC_CAP_CHANNEL_CONF);
+}
+
 /* returns 1 or 0 if or if not decoded data was returned, or a negative error */
-static int try_decode_frame(AVStream *st, AVPacket *avpkt, AVDictionary **options)
+/**
+ * Decode a packet of st with avctx, which is either st->codec or the
+ * decoder of a probe thread, counting the frames in nb_decoded_frames.
+ * nb_packets is the number of packets of st demuxed before this one.
+ */
+static int try_decode_frame(AVStream *st, AVCodecContext *avctx,
+                            int *nb_decoded_frames, int nb_packets,
+                            AVPacket *avpkt, AVDictionary **options)
 {
     const AVCodec *codec;
     int got_picture = 1, ret = 0;
     AVFrame picture;
     AVSubtitle subtitle;
     AVPacket pkt = *avpkt;
+    int64_t start_time;
 
-    if (!avcodec_is_open(st->codec) && !st->info->found_decoder) {
+    if (!avcodec_is_open(avctx) && !st->info->found_decoder) {
         AVDictionary *thread_opt = NULL;
 
-        codec = st->codec->codec ? st->codec->codec :
-                                   avcodec_find_decoder(st->codec->codec_id);
+        codec = avctx->codec ? avctx->codec :
+                               avcodec_find_decoder(avctx->codec_id);
 
         if (!codec) {
             st->info->found_decoder = -1;
@@ -2351,7 +2400,7 @@ static int try_decode_frame(AVStream *st, AVPacket *avpkt, AVDictionary **option
         /* force thread count to 1 since the h264 decoder will not extract SPS
          *  and PPS to extradata during multi-threaded decoding */
         av_dict_set(options ? options : &thread_opt, "threads", "1", 0);
-        ret = avcodec_open2(st->codec, codec, options ? options : &thread_opt);
+        ret = avcodec_open2(avctx, codec, options ? options : &thread_opt);
         if (!options)
             av_dict_free(&thread_opt);
         if (ret < 0) {
@@ -2365,23 +2414,22 @@ static int try_decode_frame(AVStream *st, AVPacket *avpkt, AVDictionary **option
     if (st->info->found_decoder < 0)
         return -1;
 
+    start_time = av_gettime();
     while ((pkt.size > 0 || (!pkt.data && got_picture)) &&
            ret >= 0 &&
-           (!has_codec_parameters(st, NULL)   ||
-           !has_decode_delay_been_guessed(st) ||
-           (!st->codec_info_nb_frames && st->codec->codec->capabilities & CODEC_CAP_CHANNEL_CONF))) {
+           need_decoding(st, avctx, *nb_decoded_frames, nb_packets)) {
         got_picture = 0;
         avcodec_get_frame_defaults(&picture);
-        switch(st->codec->codec_type) {
+        switch(avctx->codec_type) {
         case AVMEDIA_TYPE_VIDEO:
-            ret = avcodec_decode_video2(st->codec, &picture,
+            ret = avcodec_decode_video2(avctx, &picture,
                                         &got_picture, &pkt);
             break;
         case AVMEDIA_TYPE_AUDIO:
-            ret = avcodec_decode_audio4(st->codec, &picture, &got_picture, &pkt);
+            ret = avcodec_decode_audio4(avctx, &picture, &got_picture, &pkt);
             break;
         case AVMEDIA_TYPE_SUBTITLE:
-            ret = avcodec_decode_subtitle2(st->codec, &subtitle,
+            ret = avcodec_decode_subtitle2(avctx, &subtitle,
                                            &got_picture, &pkt);
             ret = pkt.size;
             break;
@@ -2389,18 +2437,396 @@ static int try_decode_frame(AVStream *st, AVPacket *avpkt, AVDictionary **option
             break;
         }
         if (ret >= 0) {
-            if (got_picture)
-                st->nb_decoded_frames++;
+            if (got_picture) {
+                (*nb_decoded_frames)++;
+                st->probe_nb_frames++;
+            }
             pkt.data += ret;
             pkt.size -= ret;
             ret       = got_picture;
         }
     }
+    st->probe_decode_time += av_gettime() - start_time;
     if(!pkt.data && !got_picture)
         return -1;
     return ret;
 }
 
+/**
+ * Copy the codec parameters which the decoder of a probe thread changed
+ * since the last call into st->codec, as if st->codec had decoded the
+ * packets itself. The probe thread must not be decoding a packet of st.
+ */
+static void update_probe_params(AVStream *st)
+{
+    AVCodecContext *avctx = st->info->probe_codec;
+    AVCodecContext *old   = st->info->probe_codec_params;
+    AVCodecContext *dst   = st->codec;
+
+#define COPY_IF_CHANGED(field)                                          \
+    if (memcmp(&avctx->field, &old->field, sizeof(avctx->field)))       \
+        dst->field = avctx->field
+    if (old && avcodec_is_open(avctx)) {
+        COPY_IF_CHANGED(width);
+        COPY_IF_CHANGED(height);
+        COPY_IF_CHANGED(coded_width);
+        COPY_IF_CHANGED(coded_height);
+        COPY_IF_CHANGED(pix_fmt);
+        COPY_IF_CHANGED(sample_aspect_ratio);
+        COPY_IF_CHANGED(time_base);
+        COPY_IF_CHANGED(ticks_per_frame);
+        COPY_IF_CHANGED(has_b_frames);
+        COPY_IF_CHANGED(refs);
+        COPY_IF_CHANGED(profile);
+        COPY_IF_CHANGED(level);
+        COPY_IF_CHANGED(bit_rate);
+        COPY_IF_CHANGED(bits_per_raw_sample);
+        COPY_IF_CHANGED(bits_per_coded_sample);
+        COPY_IF_CHANGED(timecode_frame_start);
+        COPY_IF_CHANGED(color_primaries);
+        COPY_IF_CHANGED(color_trc);
+        COPY_IF_CHANGED(colorspace);
+        COPY_IF_CHANGED(color_range);
+        COPY_IF_CHANGED(chroma_sample_location);
+        COPY_IF_CHANGED(sample_rate);
+        COPY_IF_CHANGED(channels);
+        COPY_IF_CHANGED(channel_layout);
+        COPY_IF_CHANGED(sample_fmt);
+        COPY_IF_CHANGED(frame_size);
+        COPY_IF_CHANGED(block_align);
+        COPY_IF_CHANGED(audio_service_type);
+        memcpy(old, avctx, sizeof(*avctx));
+    }
+#undef COPY_IF_CHANGED
+    st->nb_decoded_frames = st->info->probe_nb_decoded_frames;
+}
+
+/**
+ * Copy the codec parameters found by the decoder of a probe thread into
+ * st->codec and free that decoder.
+ */
+static void close_probe_codec(AVStream *st)
+{
+    AVCodecContext *avctx = st->info->probe_codec;
+
+    if (!avctx)
+        return;
+    update_probe_params(st);
+
+    avcodec_close(avctx);
+    av_freep(&avctx->extradata);
+    av_freep(&avctx->intra_matrix);
+    av_freep(&avctx->inter_matrix);
+    av_freep(&avctx->rc_override);
+    av_freep(&st->info->probe_codec);
+    av_freep(&st->info->probe_codec_params);
+    st->info->probe_thread = NULL;
+}
+
+#if HAVE_PTHREADS
+typedef struct ProbePacket {
+    AVPacket pkt;
+    AVStream *st;
+    int nb_packets;                 ///< packets of st demuxed before pkt
+    int own_data;                   ///< pkt.data was duplicated for the queue
+    struct ProbePacket *next;
+} ProbePacket;
+
+/**
+ * Open a separate decoder for a probe thread, as the parser keeps
+ * updating st->codec while the packets are decoded.
+ */
+static int open_probe_codec(AVStream *st, AVDictionary **options)
+{
+    AVCodecContext *avctx;
+    AVDictionary *opts = NULL;
+    const AVCodec *codec;
+    int ret;
+
+    /* the parser may have changed the codec id since st->codec was opened */
+    codec = st->codec->codec && st->codec->codec->id == st->codec->codec_id ?
+            st->codec->codec : avcodec_find_decoder(st->codec->codec_id);
+    if (!codec) {
+        st->info->found_decoder = -1;
+        return 0;
+    }
+    if (!(avctx = avcodec_alloc_context3(NULL)))
+        return AVERROR(ENOMEM);
+    if ((ret = avcodec_copy_context(avctx, st->codec)) < 0) {
+        av_free(avctx);
+        return ret;
+    }
+
+    st->info->probe_codec             = avctx;
+    st->info->probe_nb_decoded_frames = st->nb_decoded_frames;
+    if (!(st->info->probe_codec_params = av_malloc(sizeof(*avctx))))
+        return AVERROR(ENOMEM);
+
+    /* st->codec is updated with what the decoder changes, as if it had
+     * decoded the packets itself: if it was opened already, that does not
+     * include what the decoder set when it was opened */
+    if (!avcodec_is_open(st->codec))
+        memcpy(st->info->probe_codec_params, avctx, sizeof(*avctx));
+    if (options)
+        av_dict_copy(&opts, *options, 0);
+    /* see try_decode_frame() */
+    av_dict_set(&opts, "threads", "1", 0);
+    ret = avcodec_open2(avctx, codec, &opts);
+    av_dict_free(&opts);
+    if (avcodec_is_open(st->codec))
+        memcpy(st->info->probe_codec_params, avctx, sizeof(*avctx));
+
+    st->info->found_decoder = ret < 0 ? -1 : 1;
+    /* the probe thread updates these once it decoded a packet */
+    st->info->probe_params_found = has_codec_parameters(st, avctx, NULL);
+    st->info->probe_done         = ret < 0 ||
+        !need_decoding(st, avctx, st->info->probe_nb_decoded_frames,
+                       st->codec_info_nb_frames);
+    return 0;
+}
+
+/**
+ * Thread decoding the probe packets of some of the streams in
+ * avformat_find_stream_info().
+ */
+typedef struct ProbeThread {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;            ///< signaled when a packet is queued
+    pthread_cond_t done_cond;       ///< signaled when a packet was decoded
+    ProbePacket *queue, *queue_end;
+    int finish;
+} ProbeThread;
+
+static void *probe_thread(void *arg)
+{
+    ProbeThread *t = arg;
+
+    pthread_mutex_lock(&t->mutex);
+    for (;;) {
+        ProbePacket *p;
+        AVStream *st;
+        AVCodecContext *avctx;
+        int params_found, done;
+
+        while (!t->queue && !t->finish)
+            pthread_cond_wait(&t->cond, &t->mutex);
+        if (!(p = t->queue))
+            break;
+        if (!(t->queue = p->next))
+            t->queue_end = NULL;
+        pthread_mutex_unlock(&t->mutex);
+
+        st    = p->st;
+        avctx = st->info->probe_codec;
+        try_decode_frame(st, avctx, &st->info->probe_nb_decoded_frames,
+                         p->nb_packets, &p->pkt, NULL);
+        params_found = has_codec_parameters(st, avctx, NULL);
+        done         = !need_decoding(st, avctx,
+                                      st->info->probe_nb_decoded_frames,
+                                      p->nb_packets + 1);
+        if (p->own_data)
+            av_free_packet(&p->pkt);
+        av_free(p);
+
+        pthread_mutex_lock(&t->mutex);
+        st->info->probe_params_found = params_found;
+        st->info->probe_done         = done;
+        st->info->probe_pending--;
+        pthread_cond_broadcast(&t->done_cond);
+    }
+    pthread_mutex_unlock(&t->mutex);
+    return NULL;
+}
+
+static int start_probe_threads(AVFormatContext *ic, ProbeThread **threads,
+                               int *nb_threads)
+{
+    int i;
+
+    *nb_threads = 0;
+    if (ic->probe_threads <= 1)
+        return 0;
+    if (!(*threads = av_mallocz(ic->probe_threads * sizeof(**threads))))
+        return AVERROR(ENOMEM);
+    for (i = 0; i < ic->probe_threads; i++) {
+        ProbeThread *t = &(*threads)[i];
+
+        pthread_mutex_init(&t->mutex, NULL);
+        pthread_cond_init(&t->cond, NULL);
+        pthread_cond_init(&t->done_cond, NULL);
+        if (pthread_create(&t->thread, NULL, probe_thread, t)) {
+            pthread_cond_destroy(&t->done_cond);
+            pthread_cond_destroy(&t->cond);
+            pthread_mutex_destroy(&t->mutex);
+            break;
+        }
+        (*nb_threads)++;
+    }
+    if (!*nb_threads)
+        av_freep(threads);
+    return 0;
+}
+
+static void join_probe_threads(ProbeThread **threads, int *nb_threads)
+{
+    int i;
+
+    for (i = 0; i < *nb_threads; i++) {
+        ProbeThread *t = &(*threads)[i];
+
+        pthread_mutex_lock(&t->mutex);
+        t->finish = 1;
+        pthread_cond_signal(&t->cond);
+        pthread_mutex_unlock(&t->mutex);
+        pthread_join(t->thread, NULL);
+        pthread_cond_destroy(&t->done_cond);
+        pthread_cond_destroy(&t->cond);
+        pthread_mutex_destroy(&t->mutex);
+    }
+    *nb_threads = 0;
+    av_freep(threads);
+}
+
+/**
+ * Check whether the codec parameters of st are known, asking the probe
+ * thread decoding it if there is one.
+ * Unless they are known already, this waits for the queued packets of st
+ * to be decoded, so that the result does not depend on the timing of the
+ * threads.
+ */
+static int probe_params_found(AVStream *st, ProbeThread *threads,
+                              int nb_threads)
+{
+    ProbeThread *t;
+    int found;
+
+    if (!st->info->probe_codec)
+        return has_codec_parameters(st, st->codec, NULL);
+    t = &threads[st->index % nb_threads];
+    pthread_mutex_lock(&t->mutex);
+    while (!st->info->probe_params_found && st->info->probe_pending)
+        pthread_cond_wait(&t->done_cond, &t->mutex);
+    found = st->info->probe_params_found;
+    pthread_mutex_unlock(&t->mutex);
+    return found;
+}
+
+/**
+ * Queue pkt to the probe thread decoding st, opening its decoder on the
+ * first packet.
+ *
+ * @return 1 if the packet was handled by a probe thread, 0 if it must be
+ *         decoded by the caller, < 0 on error
+ */
+static int submit_probe_packet(AVFormatContext *ic, ProbeThread *threads,
+                               int nb_threads, AVStream *st, AVPacket *pkt,
+                               AVDictionary **options)
+{
+    ProbeThread *t;
+    ProbePacket *p;
+    int done, ret;
+
+    if (!nb_threads ||
+        (st->codec->codec_type != AVMEDIA_TYPE_VIDEO &&
+         st->codec->codec_type != AVMEDIA_TYPE_AUDIO))
+        return 0;
+    if (!st->info->probe_codec) {
+        if (st->info->found_decoder < 0)
+            return 1;
+        if ((ret = open_probe_codec(st, options)) < 0)
+            return ret;
+        if (!st->info->probe_codec)
+            return 1;
+        st->info->probe_thread = &threads[st->index % nb_threads];
+    }
+    if (st->info->found_decoder < 0)
+        return 1;
+
+    t = st->info->probe_thread;
+    pthread_mutex_lock(&t->mutex);
+    done = st->info->probe_done;
+    pthread_mutex_unlock(&t->mutex);
+    /* the decoder needs no more packets of this stream */
+    if (done)
+        return 1;
+
+    if (!(p = av_mallocz(sizeof(*p))))
+        return AVERROR(ENOMEM);
+    p->pkt        = *pkt;
+    p->st         = st;
+    p->nb_packets = st->codec_info_nb_frames;
+    if ((ret = av_dup_packet(&p->pkt)) < 0) {
+        av_free(p);
+        return ret;
+    }
+    p->own_data = p->pkt.data != pkt->data;
+
+    pthread_mutex_lock(&t->mutex);
+    if (t->queue_end)
+        t->queue_end->next = p;
+    else
+        t->queue = p;
+    t->queue_end = p;
+    st->info->probe_pending++;
+    pthread_cond_signal(&t->cond);
+    pthread_mutex_unlock(&t->mutex);
+    return 1;
+}
+
+/**
+ * Wait until the probe thread decoded the queued packets of st and update
+ * st->codec and st->nb_decoded_frames with what its decoder found.
+ * This is done before the next packet of st is parsed, so that the
+ * timestamps computed for it are the same as without probe threads.
+ */
+static void sync_probe_codec(AVStream *st)
+{
+    ProbeThread *t;
+
+    if (!st->info || !st->info->probe_thread)
+        return;
+    t = st->info->probe_thread;
+    pthread_mutex_lock(&t->mutex);
+    while (st->info->probe_pending)
+        pthread_cond_wait(&t->done_cond, &t->mutex);
+    pthread_mutex_unlock(&t->mutex);
+    update_probe_params(st);
+}
+#else
+typedef struct ProbeThread {
+    int unused;
+} ProbeThread;
+
+static int start_probe_threads(AVFormatContext *ic, ProbeThread **threads,
+                               int *nb_threads)
+{
+    *nb_threads = 0;
+    return 0;
+}
+
+static void join_probe_threads(ProbeThread **threads, int *nb_threads)
+{
+}
+
+static int probe_params_found(AVStream *st, ProbeThread *threads,
+                              int nb_threads)
+{
+    return has_codec_parameters(st, st->codec, NULL);
+}
+
+static int submit_probe_packet(AVFormatContext *ic, ProbeThread *threads,
+                               int nb_threads, AVStream *st, AVPacket *pkt,
+                               AVDictionary **options)
+{
+    return 0;
+}
+
+static void sync_probe_codec(AVStream *st)
+{
+}
+#endif
+
 unsigned int ff_codec_get_tag(const AVCodecTag *tags, enum AVCodecID id)
 {
     while (tags->id != AV_CODEC_ID_NONE) {
@@ -2506,6 +2932,14 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
     int64_t old_offset = avio_tell(ic->pb);
     int orig_nb_streams = ic->nb_streams;        // new streams might appear, no options for those
     int flush_codecs = ic->probesize > 0;
+    ProbeThread *threads = NULL;
+    int nb_threads = 0;
+
+    if (ic->index_file_loaded) {
+        ff_index_file_save_params(ic);
+        compute_chapters_end(ic);
+        return 0;
+    }
 
     if(ic->pb)
         av_log(ic, AV_LOG_DEBUG, "File position before avformat_find_stream_info() is %"PRId64"\n", avio_tell(ic->pb));
@@ -2551,7 +2985,7 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
                               : &thread_opt);
 
         //try to just open decoders, in case this is enough to get parameters
-        if (!has_codec_parameters(st, NULL)) {
+        if (!has_codec_parameters(st, st->codec, NULL)) {
             if (codec && !st->codec->codec)
                 avcodec_open2(st->codec, codec, options ? &options[i]
                               : &thread_opt);
@@ -2566,8 +3000,15 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 #endif
         ic->streams[i]->info->fps_first_dts = AV_NOPTS_VALUE;
         ic->streams[i]->info->fps_last_dts  = AV_NOPTS_VALUE;
+        ic->streams[i]->probe_nb_packets  = 0;
+        ic->streams[i]->probe_size        = 0;
+        ic->streams[i]->probe_nb_frames   = 0;
+        ic->streams[i]->probe_decode_time = 0;
     }
 
+    if ((ret = start_probe_threads(ic, &threads, &nb_threads)) < 0)
+        goto find_stream_info_err;
+
     count = 0;
     read_size = 0;
     for(;;) {
@@ -2582,7 +3023,7 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
             int fps_analyze_framecount = 20;
 
             st = ic->streams[i];
-            if (!has_codec_parameters(st, NULL))
+            if (!probe_params_found(st, threads, nb_threads))
                 break;
             /* if the timebase is coarse (like the usual millisecond precision
                of mkv), we need to analyze more frames to reliably arrive at
@@ -2651,6 +3092,8 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
         read_size += pkt->size;
 
         st = ic->streams[pkt->stream_index];
+        st->probe_nb_packets++;
+        st->probe_size += pkt->size;
         if (pkt->dts != AV_NOPTS_VALUE && st->codec_info_nb_frames > 1) {
             /* check for non-increasing dts */
             if (st->info->fps_last_dts != AV_NOPTS_VALUE &&
@@ -2730,8 +3173,10 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
             if (i > 0 && i < FF_MAX_EXTRADATA_SIZE) {
                 st->codec->extradata_size= i;
                 st->codec->extradata= av_malloc(st->codec->extradata_size + FF_INPUT_BUFFER_PADDING_SIZE);
-                if (!st->codec->extradata)
-                    return AVERROR(ENOMEM);
+                if (!st->codec->extradata) {
+                    ret = AVERROR(ENOMEM);
+                    goto find_stream_info_err;
+                }
                 memcpy(st->codec->extradata, pkt->data, st->codec->extradata_size);
                 memset(st->codec->extradata + i, 0, FF_INPUT_BUFFER_PADDING_SIZE);
             }
@@ -2745,13 +3190,27 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
            If CODEC_CAP_CHANNEL_CONF is set this will force decoding of at
            least one frame of codec data, this makes sure the codec initializes
            the channel configuration and does not only trust the values from the container.
+
+           With probe threads, the audio and video packets are decoded
+           by the thread of their stream instead.
         */
-        try_decode_frame(st, pkt, (options && i < orig_nb_streams ) ? &options[i] : NULL);
+        ret = submit_probe_packet(ic, threads, nb_threads, st, pkt,
+                                  (options && st->index < orig_nb_streams) ?
+                                  &options[st->index] : NULL);
+        if (ret < 0)
+            goto find_stream_info_err;
+        if (!ret)
+            try_decode_frame(st, st->codec, &st->nb_decoded_frames,
+                             st->codec_info_nb_frames, pkt,
+                             (options && st->index < orig_nb_streams) ?
+                             &options[st->index] : NULL);
 
         st->codec_info_nb_frames++;
         count++;
     }
 
+    join_probe_threads(&threads, &nb_threads);
+
     if (flush_codecs) {
         AVPacket empty_pkt = { 0 };
         int err = 0;
@@ -2765,19 +3224,26 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 
             /* flush the decoders */
             if (st->info->found_decoder == 1) {
+                AVCodecContext *avctx = st->info->probe_codec ?
+                                        st->info->probe_codec : st->codec;
+                int *nb_decoded_frames = st->info->probe_codec ?
+                                         &st->info->probe_nb_decoded_frames :
+                                         &st->nb_decoded_frames;
                 do {
-                    err = try_decode_frame(st, &empty_pkt,
-                                            (options && i < orig_nb_streams) ?
-                                            &options[i] : NULL);
-                } while (err > 0 && !has_codec_parameters(st, NULL));
+                    err = try_decode_frame(st, avctx, nb_decoded_frames,
+                                           st->codec_info_nb_frames, &empty_pkt,
+                                           (options && i < orig_nb_streams) ?
+                                           &options[i] : NULL);
+                } while (err > 0 && !has_codec_parameters(st, avctx, NULL));
 
                 if (err < 0) {
                     av_log(ic, AV_LOG_INFO,
                         "decoding for stream %d failed\n", st->index);
                 }
             }
+            close_probe_codec(st);
 
-            if (!has_codec_parameters(st, &errmsg)) {
+            if (!has_codec_parameters(st, st->codec, &errmsg)) {
                 char buf[256];
                 avcodec_string(buf, sizeof(buf), st->codec, 0);
                 av_log(ic, AV_LOG_WARNING,
@@ -2793,6 +3259,7 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
     // close codecs which were opened in try_decode_frame()
     for(i=0;i<ic->nb_streams;i++) {
         st = ic->streams[i];
+        close_probe_codec(st);
         avcodec_close(st->codec);
     }
     for(i=0;i<ic->nb_streams;i++) {
@@ -2897,9 +3364,22 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
     estimate_timings(ic, old_offset);
 
     compute_chapters_end(ic);
+    if (ic->index_file)
+        ff_index_file_save_params(ic);
+
+    for (i = 0; i < ic->nb_streams; i++) {
+        st = ic->streams[i];
+        av_log(ic, AV_LOG_VERBOSE, "Stream #%d: probed %d packets, %"PRId64
+               " bytes, decoded %d frames in %"PRId64" us\n", i,
+               st->probe_nb_packets, st->probe_size, st->probe_nb_frames,
+               st->probe_decode_time);
+    }
 
  find_stream_info_err:
+    join_probe_threads(&threads, &nb_threads);
     for (i=0; i < ic->nb_streams; i++) {
+        if (ic->streams[i]->info)
+            close_probe_codec(ic->streams[i]);
         if (ic->streams[i]->codec)
             ic->streams[i]->codec->thread_count = 0;
         av_freep(&ic->streams[i]->info);
@@ -3043,6 +3523,7 @@ void avformat_free_context(AVFormatContext *s)
     av_freep(&s->chapters);
     av_dict_free(&s->metadata);
     av_freep(&s->streams);
+    av_freep(&s->index_file_params);
     av_free(s);
 }
 
@@ -3059,6 +3540,8 @@ void avformat_close_input(AVFormatContext **ps)
     AVIOContext *pb = (s->iformat && (s->iformat->flags & AVFMT_NOFILE)) || (s->flags & AVFMT_FLAG_CUSTOM_IO) ?
                        NULL : s->pb;
     flush_packet_queue(s);
+    if (s->index_file && s->iformat)
+        ff_index_file_write(s);
     if (s->iformat && (s->iformat->read_close))
         s->iformat->read_close(s);
     avformat_free_context(s);
@@ -0,0 +1,414 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * reference-counted data buffers and buffer pools
+ */
+
+#include <string.h>
+
+#include "config.h"
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "atomic.h"
+#include "buffer.h"
+#include "mem.h"
+
+struct AVBuffer {
+    uint8_t *data;
+    int      size;
+    /**
+     * number of AVBufferRef referring to this buffer, only accessed with
+     * the avpriv_atomic_int functions
+     */
+    volatile int refcount;
+
+    void (*free)(void *opaque, uint8_t *data);
+    void *opaque;
+    int flags;
+};
+
+/**
+ * A buffer of a pool. It keeps the free callback of the underlying
+ * allocation while the buffer is handed out with the pool release
+ * callback instead.
+ */
+typedef struct BufferPoolEntry {
+    uint8_t *data;
+    void *opaque;
+    void (*free)(void *opaque, uint8_t *data);
+
+    struct AVBufferPool *pool;
+    struct BufferPoolEntry *next;
+} BufferPoolEntry;
+
+struct AVBufferPool {
+#if HAVE_PTHREADS
+    pthread_mutex_t mutex;      ///< protects the fields below
+#endif
+    BufferPoolEntry *pool;      ///< buffers available for reuse
+    int refcount;               ///< buffers handed out, plus one until uninit
+    int draining;               ///< set by av_buffer_pool_uninit()
+
+    int size;
+    AVBufferRef* (*alloc)(int size);
+};
+
+#if HAVE_PTHREADS
+#define LOCK(pool)   pthread_mutex_lock(&(pool)->mutex)
+#define UNLOCK(pool) pthread_mutex_unlock(&(pool)->mutex)
+#else
+#define LOCK(pool)
+#define UNLOCK(pool)
+#endif
+
+AVBufferRef *av_buffer_create(uint8_t *data, int size,
+                              void (*free)(void *opaque, uint8_t *data),
+                              void *opaque, int flags)
+{
+    AVBufferRef *ref = NULL;
+    AVBuffer    *buf = NULL;
+
+    buf = av_mallocz(sizeof(*buf));
+    if (!buf)
+        return NULL;
+
+    buf->data     = data;
+    buf->size     = size;
+    buf->free     = free ? free : av_buffer_default_free;
+    buf->opaque   = opaque;
+    buf->refcount = 1;
+    buf->flags    = flags;
+
+    ref = av_mallocz(sizeof(*ref));
+    if (!ref) {
+        av_freep(&buf);
+        return NULL;
+    }
+
+    ref->buffer = buf;
+    ref->data   = data;
+    ref->size   = size;
+
+    return ref;
+}
+
+void av_buffer_default_free(void *opaque, uint8_t *data)
+{
+    av_free(data);
+}
+
+AVBufferRef *av_buffer_alloc(int size)
+{
+    AVBufferRef *ret = NULL;
+    uint8_t    *data = NULL;
+
+    data = av_malloc(size);
+    if (!data)
+        return NULL;
+
+    ret = av_buffer_create(data, size, av_buffer_default_free, NULL, 0);
+    if (!ret)
+        av_freep(&data);
+
+    return ret;
+}
+
+AVBufferRef *av_buffer_allocz(int size)
+{
+    AVBufferRef *ret = av_buffer_alloc(size);
+    if (!ret)
+        return NULL;
+
+    memset(ret->data, 0, size);
+    return ret;
+}
+
+AVBufferRef *av_buffer_ref(AVBufferRef *buf)
+{
+    AVBufferRef *ret = av_mallocz(sizeof(*ret));
+
+    if (!ret)
+        return NULL;
+
+    *ret = *buf;
+
+    avpriv_atomic_int_add_and_fetch(&buf->buffer->refcount, 1);
+
+    return ret;
+}
+
+void av_buffer_unref(AVBufferRef **buf)
+{
+    AVBuffer *b;
+
+    if (!buf || !*buf)
+        return;
+    b = (*buf)->buffer;
+    av_freep(buf);
+
+    if (!avpriv_atomic_int_add_and_fetch(&b->refcount, -1)) {
+        b->free(b->opaque, b->data);
+        av_freep(&b);
+    }
+}
+
+int av_buffer_is_writable(const AVBufferRef *buf)
+{
+    if (buf->buffer->flags & AV_BUFFER_FLAG_READONLY)
+        return 0;
+
+    return avpriv_atomic_int_get(&buf->buffer->refcount) == 1;
+}
+
+AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
+{
+    AVBufferPool *pool = av_mallocz(sizeof(*pool));
+    if (!pool)
+        return NULL;
+
+#if HAVE_PTHREADS
+    if (pthread_mutex_init(&pool->mutex, NULL)) {
+        av_free(pool);
+        return NULL;
+    }
+#endif
+
+    pool->size     = size;
+    pool->alloc    = alloc ? alloc : av_buffer_alloc;
+    pool->refcount = 1;
+
+    return pool;
+}
+
+static void pool_free(AVBufferPool *pool)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_destroy(&pool->mutex);
+#endif
+    av_free(pool);
+}
+
+/* Called with the pool lock held, returns the entries to free. */
+static BufferPoolEntry *pool_release(AVBufferPool *pool, int *last)
+{
+    BufferPoolEntry *list = NULL;
+
+    if (pool->draining) {
+        list       = pool->pool;
+        pool->pool = NULL;
+    }
+    *last = !--pool->refcount;
+    return list;
+}
+
+static void pool_free_entries(BufferPoolEntry *list)
+{
+    while (list) {
+        BufferPoolEntry *next = list->next;
+        list->free(list->opaque, list->data);
+        av_free(list);
+        list = next;
+    }
+}
+
+void av_buffer_pool_uninit(AVBufferPool **ppool)
+{
+    AVBufferPool *pool;
+    BufferPoolEntry *list;
+    int last;
+
+    if (!ppool || !*ppool)
+        return;
+    pool   = *ppool;
+    *ppool = NULL;
+
+    LOCK(pool);
+    pool->draining = 1;
+    list = pool_release(pool, &last);
+    UNLOCK(pool);
+
+    pool_free_entries(list);
+    if (last)
+        pool_free(pool);
+}
+
+static void pool_release_buffer(void *opaque, uint8_t *data)
+{
+    BufferPoolEntry *entry = opaque;
+    AVBufferPool    *pool  = entry->pool;
+    BufferPoolEntry *list;
+    int last;
+
+    LOCK(pool);
+    entry->next = pool->pool;
+    pool->pool  = entry;
+    list = pool_release(pool, &last);
+    UNLOCK(pool);
+
+    pool_free_entries(list);
+    if (last)
+        pool_free(pool);
+}
+
+/* Allocate a new buffer and hook the pool release callback into it. */
+static AVBufferRef *pool_alloc_buffer(AVBufferPool *pool)
+{
+    BufferPoolEntry *entry;
+    AVBufferRef     *ret;
+
+    ret = pool->alloc(pool->size);
+    if (!ret)
+        return NULL;
+
+    entry = av_mallocz(sizeof(*entry));
+    if (!entry) {
+        av_buffer_unref(&ret);
+        return NULL;
+    }
+
+    entry->data   = ret->buffer->data;
+    entry->opaque = ret->buffer->opaque;
+    entry->free   = ret->buffer->free;
+    entry->pool   = pool;
+
+    ret->buffer->opaque = entry;
+    ret->buffer->free   = pool_release_buffer;
+
+    return ret;
+}
+
+AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
+{
+    AVBufferRef *ret;
+    BufferPoolEntry *entry;
+
+    LOCK(pool);
+    entry = pool->pool;
+    if (entry)
+        pool->pool = entry->next;
+    pool->refcount++;
+    UNLOCK(pool);
+
+    if (entry) {
+        ret = av_buffer_create(entry->data, pool->size, pool_release_buffer,
+                               entry, 0);
+        if (!ret)
+            pool_release_buffer(entry, entry->data);
+    } else {
+        ret = pool_alloc_buffer(pool);
+        if (!ret) {
+            BufferPoolEntry *list;
+            int last;
+
+            LOCK(pool);
+            list = pool_release(pool, &last);
+            UNLOCK(pool);
+            pool_free_entries(list);
+            if (last)
+                pool_free(pool);
+        }
+    }
+
+    return ret;
+}
+
+#ifdef TEST
+
+#undef printf
+
+#if HAVE_PTHREADS
+#define NB_THREADS 4
+
+static AVBufferRef *shared;
+static AVBufferPool *shared_pool;
+
+/* take and drop references and pool buffers from several threads */
+static void *ref_thread(void *arg)
+{
+    int i;
+
+    for (i = 0; i < 100000; i++) {
+        AVBufferRef *ref = av_buffer_ref(shared);
+        AVBufferRef *buf = av_buffer_pool_get(shared_pool);
+        av_buffer_unref(&ref);
+        av_buffer_unref(&buf);
+    }
+    return NULL;
+}
+#endif
+
+int main(void)
+{
+    AVBufferPool *pool = av_buffer_pool_init(16, NULL);
+    AVBufferRef *a, *b, *c;
+    uint8_t *data;
+
+    a = av_buffer_pool_get(pool);
+    data = a->data;
+    printf("new buffer writable: %d\n", av_buffer_is_writable(a));
+
+    b = av_buffer_ref(a);
+    printf("shared buffer writable: %d %d\n",
+           av_buffer_is_writable(a), av_buffer_is_writable(b));
+    av_buffer_unref(&a);
+    printf("last reference writable: %d\n", av_buffer_is_writable(b));
+
+    c = av_buffer_pool_get(pool);
+    printf("referenced buffer reused: %d\n", c->data == data);
+    av_buffer_unref(&b);
+    a = av_buffer_pool_get(pool);
+    printf("released buffer reused: %d\n", a->data == data);
+
+    /* the buffers stay valid after uninit, the pool is freed with them */
+    av_buffer_pool_uninit(&pool);
+    memset(a->data, 0, a->size);
+    av_buffer_unref(&a);
+    av_buffer_unref(&c);
+
+    a = av_buffer_create(av_malloc(16), 16, NULL, NULL, AV_BUFFER_FLAG_READONLY);
+    printf("read-only buffer writable: %d\n", av_buffer_is_writable(a));
+    av_buffer_unref(&a);
+
+#if HAVE_PTHREADS
+    {
+        pthread_t threads[NB_THREADS];
+        int i;
+
+        shared      = av_buffer_alloc(16);
+        shared_pool = av_buffer_pool_init(16, NULL);
+        for (i = 0; i < NB_THREADS; i++)
+            pthread_create(&threads[i], NULL, ref_thread, NULL);
+        for (i = 0; i < NB_THREADS; i++)
+            pthread_join(threads[i], NULL);
+        printf("writable after threads: %d\n", av_buffer_is_writable(shared));
+        av_buffer_unref(&shared);
+        av_buffer_pool_uninit(&shared_pool);
+    }
+#else
+    printf("writable after threads: 1\n");
+#endif
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,157 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * reference-counted data buffers and buffer pools
+ */
+
+#ifndef AVUTIL_BUFFER_H
+#define AVUTIL_BUFFER_H
+
+#include <stdint.h>
+
+/**
+ * A reference-counted buffer. Its fields are private, it is only
+ * accessed through AVBufferRef.
+ */
+typedef struct AVBuffer AVBuffer;
+
+/**
+ * A reference to a data buffer.
+ *
+ * The buffer data stays valid as long as at least one reference to it
+ * exists. References are created with av_buffer_ref() and released with
+ * av_buffer_unref().
+ *
+ * When libavutil is built with pthreads, references to the same buffer may
+ * be created and released from different threads.
+ */
+typedef struct AVBufferRef {
+    AVBuffer *buffer;
+
+    /**
+     * The data buffer. It is writable only if this is the only reference
+     * to the buffer, see av_buffer_is_writable().
+     */
+    uint8_t *data;
+    /**
+     * Size of data in bytes.
+     */
+    int      size;
+} AVBufferRef;
+
+/**
+ * Allocate a buffer of the given size with av_malloc().
+ *
+ * @return an AVBufferRef of the given size or NULL when out of memory
+ */
+AVBufferRef *av_buffer_alloc(int size);
+
+/**
+ * Same as av_buffer_alloc(), except the returned buffer is zeroed.
+ */
+AVBufferRef *av_buffer_allocz(int size);
+
+/**
+ * Always treat the buffer as read-only, even when it has only one
+ * reference.
+ */
+#define AV_BUFFER_FLAG_READONLY (1 << 0)
+
+/**
+ * Create a buffer from existing data.
+ *
+ * @param data   data array
+ * @param size   size of data in bytes
+ * @param free   called with opaque and data when the last reference is
+ *               released, av_buffer_default_free() if NULL
+ * @param opaque passed to free
+ * @param flags  a combination of AV_BUFFER_FLAG_*
+ *
+ * @return an AVBufferRef referring to data on success, NULL on failure
+ */
+AVBufferRef *av_buffer_create(uint8_t *data, int size,
+                              void (*free)(void *opaque, uint8_t *data),
+                              void *opaque, int flags);
+
+/**
+ * Free a buffer allocated with av_malloc(). This is the default free
+ * callback of av_buffer_create().
+ */
+void av_buffer_default_free(void *opaque, uint8_t *data);
+
+/**
+ * Create a new reference to a buffer.
+ *
+ * @return a new AVBufferRef referring to the same data as buf or NULL when
+ *         out of memory
+ */
+AVBufferRef *av_buffer_ref(AVBufferRef *buf);
+
+/**
+ * Release a reference to a buffer and set *buf to NULL. The buffer is
+ * freed when its last reference is released.
+ */
+void av_buffer_unref(AVBufferRef **buf);
+
+/**
+ * @return 1 if the caller may write to the data referred to by buf (i.e.
+ *         buf is its only reference and the buffer is not read-only),
+ *         0 otherwise
+ */
+int av_buffer_is_writable(const AVBufferRef *buf);
+
+/**
+ * A pool of buffers of the same size.
+ *
+ * Buffers taken from the pool with av_buffer_pool_get() go back to it when
+ * their last reference is released, so that the memory is reused instead of
+ * being freed and allocated again. A pool may be used from several threads
+ * when libavutil is built with pthreads.
+ *
+ * Buffer contents are not cleared when they are reused.
+ */
+typedef struct AVBufferPool AVBufferPool;
+
+/**
+ * Allocate a buffer pool.
+ *
+ * @param size  size of each buffer in bytes
+ * @param alloc function used to allocate new buffers when the pool is
+ *              empty, av_buffer_alloc() if NULL
+ * @return the pool or NULL when out of memory
+ */
+AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size));
+
+/**
+ * Mark the pool as freeable and set *pool to NULL. The pool is freed once
+ * all the buffers taken from it have been released, so references to them
+ * stay valid after this call.
+ */
+void av_buffer_pool_uninit(AVBufferPool **pool);
+
+/**
+ * Take a buffer from the pool, allocating a new one if none is available.
+ *
+ * @return a reference to a buffer of the pool size or NULL when out of
+ *         memory
+ */
+AVBufferRef *av_buffer_pool_get(AVBufferPool *pool);
+
+#endif /* AVUTIL_BUFFER_H */
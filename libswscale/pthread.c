@@ -0,0 +1,302 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Slice threading for libswscale.
+ *
+ * A whole frame is split into horizontal bands of BAND_ALIGN-aligned height.
+ * Every band is handled by its own child SwsContext, so the line buffers,
+ * MMX filter tables and dither state are never shared between threads.
+ * Scaled conversions get the whole source picture and only output their
+ * band of destination lines, unscaled special converters are fed the
+ * matching band of source lines.
+ */
+
+#include <pthread.h>
+#include <string.h>
+
+#include "config.h"
+#include "libavutil/common.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+#include "swscale.h"
+#include "swscale_internal.h"
+
+/* a multiple of every vertical chroma subsampling factor and of the
+ * period of the ordered dither matrices used by the special converters */
+#define BAND_ALIGN 16
+
+typedef struct SwsThreadContext {
+    pthread_t *workers;
+    int nb_workers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t job_cond;        ///< Signaled when new jobs are queued or on exit.
+    pthread_cond_t done_cond;       ///< Signaled when the last job has finished.
+    int job_count;
+    int current_job;
+    int finished_jobs;
+    int done;
+
+    SwsContext *parent;
+    int band_height;                ///< Height of a band in lines (the last one may be shorter).
+    int unscaled;                   ///< Set if the context uses an unscaled special converter.
+
+    /* arguments of the current ff_sws_scale_threads() call */
+    const uint8_t **src;
+    int *srcStride;
+    uint8_t **dst;
+    int *dstStride;
+    int *rets;
+} SwsThreadContext;
+
+static void run_job(SwsThreadContext *t, int jobnr)
+{
+    SwsContext *c = t->parent->slice_ctx[jobnr];
+    const uint8_t *src[4] = { t->src[0], t->src[1], t->src[2], t->src[3] };
+    uint8_t *dst[4] = { t->dst[0], t->dst[1], t->dst[2], t->dst[3] };
+    int srcStride[4], dstStride[4];
+
+    /* swScale() may modify the pointer and stride arrays */
+    memcpy(srcStride, t->srcStride, sizeof(srcStride));
+    memcpy(dstStride, t->dstStride, sizeof(dstStride));
+
+    if (t->unscaled) {
+        const AVPixFmtDescriptor *desc = &av_pix_fmt_descriptors[c->srcFormat];
+        int y = jobnr * t->band_height;
+        int h = FFMIN(t->band_height, c->srcH - y);
+        int i;
+
+        for (i = 0; i < 4; i++) {
+            int shift = (i == 1 || i == 2) ? desc->log2_chroma_h : 0;
+            if (!src[i] || (i == 1 && usePal(c->srcFormat)))
+                continue;
+            src[i] += (y >> shift) * srcStride[i];
+        }
+        t->rets[jobnr] = c->swScale(c, src, srcStride, y, h, dst, dstStride);
+    } else {
+        t->rets[jobnr] = c->swScale(c, src, srcStride, 0, c->srcH,
+                                    dst, dstStride);
+    }
+}
+
+static void *attribute_align_arg worker(void *arg)
+{
+    SwsThreadContext *t = arg;
+
+    pthread_mutex_lock(&t->lock);
+    for (;;) {
+        int jobnr;
+
+        while (!t->done && t->current_job >= t->job_count)
+            pthread_cond_wait(&t->job_cond, &t->lock);
+        if (t->done)
+            break;
+
+        jobnr = t->current_job++;
+        pthread_mutex_unlock(&t->lock);
+
+        run_job(t, jobnr);
+
+        pthread_mutex_lock(&t->lock);
+        if (++t->finished_jobs == t->job_count)
+            pthread_cond_signal(&t->done_cond);
+    }
+    pthread_mutex_unlock(&t->lock);
+
+    return NULL;
+}
+
+/**
+ * The SIMD output functions may write up to 16 pixels past the end of a
+ * line. Bands must not be able to clobber the first line of the next band
+ * in a different order than the single-threaded code does, so threading
+ * is only used when the destination lines are padded enough for this.
+ */
+static int dst_lines_padded(SwsContext *c, const int dstStride[])
+{
+    int linesize[4], i;
+
+    if (av_image_fill_linesizes(linesize, c->dstFormat,
+                                FFALIGN(c->dstW, 16)) < 0)
+        return 0;
+    for (i = 0; i < 4; i++)
+        if (FFABS(dstStride[i]) < linesize[i])
+            return 0;
+
+    return 1;
+}
+
+int ff_sws_scale_threads(SwsContext *c, const uint8_t *src[], int srcStride[],
+                         uint8_t *dst[], int dstStride[])
+{
+    SwsThreadContext *t = c->thread_opaque;
+    int i, ret = 0;
+
+    if (!dst_lines_padded(c, dstStride))
+        return c->swScale(c, src, srcStride, 0, c->srcH, dst, dstStride);
+
+    if (usePal(c->srcFormat))
+        for (i = 0; i < c->nb_slice_ctx; i++) {
+            memcpy(c->slice_ctx[i]->pal_yuv, c->pal_yuv, sizeof(c->pal_yuv));
+            memcpy(c->slice_ctx[i]->pal_rgb, c->pal_rgb, sizeof(c->pal_rgb));
+        }
+
+    pthread_mutex_lock(&t->lock);
+    t->src           = src;
+    t->srcStride     = srcStride;
+    t->dst           = dst;
+    t->dstStride     = dstStride;
+    t->finished_jobs = 0;
+    t->current_job   = 0;
+    t->job_count     = c->nb_slice_ctx;
+    pthread_cond_broadcast(&t->job_cond);
+
+    /* the calling thread takes its share of the jobs too */
+    while (t->current_job < t->job_count) {
+        int jobnr = t->current_job++;
+        pthread_mutex_unlock(&t->lock);
+
+        run_job(t, jobnr);
+
+        pthread_mutex_lock(&t->lock);
+        t->finished_jobs++;
+    }
+    while (t->finished_jobs < t->job_count)
+        pthread_cond_wait(&t->done_cond, &t->lock);
+    pthread_mutex_unlock(&t->lock);
+
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        ret += t->rets[i];
+
+    return ret;
+}
+
+static SwsContext *alloc_slice_context(SwsContext *c, SwsFilter *srcFilter,
+                                       SwsFilter *dstFilter)
+{
+    SwsContext *s = sws_alloc_context();
+
+    if (!s)
+        return NULL;
+
+    s->flags     = c->flags & ~SWS_PRINT_INFO;
+    s->srcW      = c->srcW;
+    s->srcH      = c->srcH;
+    s->dstW      = c->dstW;
+    s->dstH      = c->dstH;
+    s->srcFormat = c->srcFormat;
+    s->dstFormat = c->dstFormat;
+    s->src0Alpha = c->src0Alpha;
+    s->dst0Alpha = c->dst0Alpha;
+    s->param[0]  = c->param[0];
+    s->param[1]  = c->param[1];
+    sws_setColorspaceDetails(s, c->srcColorspaceTable, c->srcRange,
+                             c->dstColorspaceTable, c->dstRange,
+                             c->brightness, c->contrast, c->saturation);
+
+    if (sws_init_context(s, srcFilter, dstFilter) < 0) {
+        sws_freeContext(s);
+        return NULL;
+    }
+
+    return s;
+}
+
+av_cold int ff_sws_init_threads(SwsContext *c, SwsFilter *srcFilter,
+                                SwsFilter *dstFilter)
+{
+    SwsThreadContext *t;
+    int nb_bands = FFMIN(c->nb_threads, (c->dstH + BAND_ALIGN - 1) / BAND_ALIGN);
+    int band_height, i;
+
+    band_height = FFALIGN((c->dstH + nb_bands - 1) / nb_bands, BAND_ALIGN);
+    nb_bands    = (c->dstH + band_height - 1) / band_height;
+    if (nb_bands <= 1)
+        return 0;
+
+    t = av_mallocz(sizeof(*t));
+    if (!t)
+        return AVERROR(ENOMEM);
+    c->thread_opaque = t;
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->job_cond, NULL);
+    pthread_cond_init(&t->done_cond, NULL);
+
+    t->parent      = c;
+    t->band_height = band_height;
+    /* special converters do not use the scaler line buffers */
+    t->unscaled    = !c->lumPixBuf;
+    t->rets        = av_mallocz(nb_bands * sizeof(*t->rets));
+    t->workers     = av_mallocz((nb_bands - 1) * sizeof(*t->workers));
+    c->slice_ctx   = av_mallocz(nb_bands * sizeof(*c->slice_ctx));
+    if (!t->rets || !t->workers || !c->slice_ctx)
+        goto fail;
+
+    for (i = 0; i < nb_bands; i++) {
+        SwsContext *s = alloc_slice_context(c, srcFilter, dstFilter);
+        if (!s)
+            goto fail;
+        s->dstSliceY = i * band_height;
+        s->dstSliceH = FFMIN(band_height, c->dstH - s->dstSliceY);
+        c->slice_ctx[c->nb_slice_ctx++] = s;
+    }
+
+    for (i = 0; i < nb_bands - 1; i++) {
+        if (pthread_create(&t->workers[i], NULL, worker, t))
+            goto fail;
+        t->nb_workers++;
+    }
+
+    return 0;
+fail:
+    av_log(c, AV_LOG_ERROR, "Failed to initialize %d slice threads\n",
+           c->nb_threads);
+    ff_sws_free_threads(c);
+    return AVERROR(ENOMEM);
+}
+
+av_cold void ff_sws_free_threads(SwsContext *c)
+{
+    SwsThreadContext *t = c->thread_opaque;
+    int i;
+
+    if (t) {
+        pthread_mutex_lock(&t->lock);
+        t->done = 1;
+        pthread_cond_broadcast(&t->job_cond);
+        pthread_mutex_unlock(&t->lock);
+
+        for (i = 0; i < t->nb_workers; i++)
+            pthread_join(t->workers[i], NULL);
+
+        pthread_mutex_destroy(&t->lock);
+        pthread_cond_destroy(&t->job_cond);
+        pthread_cond_destroy(&t->done_cond);
+        av_freep(&t->workers);
+        av_freep(&t->rets);
+        av_freep(&c->thread_opaque);
+    }
+
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        sws_freeContext(c->slice_ctx[i]);
+    av_freep(&c->slice_ctx);
+    c->nb_slice_ctx = 0;
+}
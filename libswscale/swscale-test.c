@@ -31,6 +31,7 @@
 #include "libavutil/crc.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/lfg.h"
+#include "libavutil/opt.h"
 #include "swscale.h"
 
 /* HACK Duplicated from swscale_internal.h.
@@ -66,6 +67,37 @@ static uint64_t getSSD(uint8_t *src1, uint8_t *src2, int stride1,
     return ssd;
 }
 
+/* threads of the tested context, 0 to use sws_getContext() */
+static int nb_threads;
+
+static struct SwsContext *get_context(int srcW, int srcH,
+                                      enum PixelFormat srcFormat,
+                                      int dstW, int dstH,
+                                      enum PixelFormat dstFormat, int flags)
+{
+    struct SwsContext *c;
+
+    if (!nb_threads)
+        return sws_getContext(srcW, srcH, srcFormat, dstW, dstH, dstFormat,
+                              flags, NULL, NULL, NULL);
+
+    if (!(c = sws_alloc_context()))
+        return NULL;
+    av_opt_set_int(c, "sws_flags",  flags,      0);
+    av_opt_set_int(c, "srcw",       srcW,       0);
+    av_opt_set_int(c, "srch",       srcH,       0);
+    av_opt_set_int(c, "src_format", srcFormat,  0);
+    av_opt_set_int(c, "dstw",       dstW,       0);
+    av_opt_set_int(c, "dsth",       dstH,       0);
+    av_opt_set_int(c, "dst_format", dstFormat,  0);
+    av_opt_set_int(c, "threads",    nb_threads, 0);
+    if (sws_init_context(c, NULL, NULL) < 0) {
+        sws_freeContext(c);
+        return NULL;
+    }
+    return c;
+}
+
 struct Results {
     uint64_t ssdY;
     uint64_t ssdU;
@@ -87,8 +119,8 @@ static int doTest(uint8_t *ref[4], int refStride[4], int w, int h,
     static int srcStride[4];
     uint8_t *dst[4] = { 0 };
     uint8_t *out[4] = { 0 };
-    int dstStride[4];
-    int i;
+    int dstStride[4], dstLineSize[4];
+    int i, y;
     uint64_t ssdY, ssdU = 0, ssdV = 0, ssdA = 0;
     struct SwsContext *dstContext = NULL, *outContext = NULL;
     uint32_t crc = 0;
@@ -148,8 +180,8 @@ static int doTest(uint8_t *ref[4], int refStride[4], int w, int h,
         }
     }
 
-    dstContext = sws_getContext(srcW, srcH, srcFormat, dstW, dstH, dstFormat,
-                                flags, NULL, NULL, NULL);
+    dstContext = get_context(srcW, srcH, srcFormat, dstW, dstH, dstFormat,
+                             flags);
     if (!dstContext) {
         fprintf(stderr, "Failed to get %s ---> %s\n",
                 av_pix_fmt_descriptors[srcFormat].name,
@@ -166,9 +198,13 @@ static int doTest(uint8_t *ref[4], int refStride[4], int w, int h,
 
     sws_scale(dstContext, src, srcStride, 0, srcH, dst, dstStride);
 
+    /* the padding at the end of the lines may be overwritten by SIMD code
+     * and is not part of the picture */
+    av_image_fill_linesizes(dstLineSize, dstFormat, dstW);
     for (i = 0; i < 4 && dstStride[i]; i++)
-        crc = av_crc(av_crc_get_table(AV_CRC_32_IEEE), crc, dst[i],
-                     dstStride[i] * dstH);
+        for (y = 0; y < dstH; y++)
+            crc = av_crc(av_crc_get_table(AV_CRC_32_IEEE), crc,
+                         dst[i] + y * dstStride[i], dstLineSize[i]);
 
     if (r && crc == r->crc) {
         ssdY = r->ssdY;
@@ -384,6 +420,12 @@ int main(int argc, char **argv)
                 fprintf(stderr, "invalid pixel format %s\n", argv[i + 1]);
                 return -1;
             }
+        } else if (!strcmp(argv[i], "-threads")) {
+            nb_threads = atoi(argv[i + 1]);
+            if (nb_threads < 1) {
+                fprintf(stderr, "invalid thread count %s\n", argv[i + 1]);
+                return -1;
+            }
         } else if (!strcmp(argv[i], "-dst")) {
             dstFormat = av_get_pix_fmt(argv[i + 1]);
             if (dstFormat == PIX_FMT_NONE) {
@@ -371,6 +371,7 @@ static int swScale(SwsContext *c, const uint8_t *src[],
     const int chrSrcSliceH           = -((-srcSliceH) >> c->chrSrcVSubSample);
     int should_dither                = is9_OR_10BPS(c->srcFormat) ||
                                        is16BPS(c->srcFormat);
+    const int dstSliceEnd            = c->dstSliceY + c->dstSliceH;
     int lastDstY;
 
     /* vars which will change and which we need to store back in the context */
@@ -432,7 +433,7 @@ static int swScale(SwsContext *c, const uint8_t *src[],
     if (srcSliceY == 0) {
         lumBufIndex  = -1;
         chrBufIndex  = -1;
-        dstY         = 0;
+        dstY         = c->dstSliceY;
         lastInLumBuf = -1;
         lastInChrBuf = -1;
     }
@@ -442,7 +443,7 @@ static int swScale(SwsContext *c, const uint8_t *src[],
     }
     lastDstY = dstY;
 
-    for (; dstY < dstH; dstY++) {
+    for (; dstY < dstSliceEnd; dstY++) {
         const int chrDstY = dstY >> c->chrDstVSubSample;
         uint8_t *dest[4]  = {
             dst[0] + dstStride[0] * dstY,
@@ -32,6 +32,7 @@
 #include "libavutil/log.h"
 #include "libavutil/pixfmt.h"
 #include "libavutil/pixdesc.h"
+#include "swscale.h"
 
 #define STR(s) AV_TOSTRING(s) // AV_STRINGIFY is too long
 
@@ -528,9 +529,52 @@ typedef struct SwsContext {
     void (*chrConvertRange)(int16_t *dst1, int16_t *dst2, int width);
 
     int needs_hcscale; ///< Set if there are chroma planes to be converted.
+
+    /**
+     * @name Slice threading.
+     * When more than one thread is requested, whole frames passed to
+     * sws_scale() are split into horizontal bands, each of which is
+     * processed by a child context owning its own line buffers and
+     * filter state, so the output is identical to the single-threaded one.
+     */
+    //@{
+    /**
+     * Number of threads requested by the user. Every band gets a complete
+     * child context with its own filters and line buffers, so the memory
+     * used by the scaler grows linearly with this.
+     */
+    int nb_threads;
+    struct SwsContext **slice_ctx; ///< Child contexts, one per band.
+    int nb_slice_ctx;             ///< Number of entries in slice_ctx.
+    void *thread_opaque;          ///< Private data of the slice thread pool.
+    int dstSliceY;                ///< First destination line output by this context for a whole frame.
+    int dstSliceH;                ///< Number of destination lines output by this context for a whole frame.
+    //@}
 } SwsContext;
 //FIXME check init (where 0)
 
+/**
+ * Create the child contexts and worker threads used for slice threading.
+ * Called by sws_init_context() once the context itself is initialized.
+ */
+int ff_sws_init_threads(SwsContext *c, SwsFilter *srcFilter,
+                        SwsFilter *dstFilter);
+
+/**
+ * Free the child contexts and worker threads of the context.
+ */
+void ff_sws_free_threads(SwsContext *c);
+
+/**
+ * Scale a whole frame using the slice threads of the context.
+ * The arguments are the same as for SwsContext.swScale(), with the slice
+ * covering the whole source picture.
+ *
+ * @return the number of output lines written
+ */
+int ff_sws_scale_threads(SwsContext *c, const uint8_t *src[], int srcStride[],
+                         uint8_t *dst[], int dstStride[]);
+
 SwsFunc ff_yuv2rgb_get_func_ptr(SwsContext *c);
 int ff_yuv2rgb_c_init_tables(SwsContext *c, const int inv_table[4],
                              int fullRange, int brightness,
@@ -1215,8 +1215,15 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
         if (srcSliceY + srcSliceH == c->srcH)
             c->sliceDir = 0;
 
-        ret = c->swScale(c, src2, srcStride2, srcSliceY, srcSliceH, dst2,
-                          dstStride2);
+        /* whole frames are split into bands processed by the slice threads,
+         * except when the special converter interpolates across lines */
+        if (HAVE_PTHREADS && c->nb_slice_ctx &&
+            srcSliceY == 0 && srcSliceH == c->srcH &&
+            c->swScale != yvu9ToYv12Wrapper)
+            ret = ff_sws_scale_threads(c, src2, srcStride2, dst2, dstStride2);
+        else
+            ret = c->swScale(c, src2, srcStride2, srcSliceY, srcSliceH, dst2,
+                              dstStride2);
     } else {
         // slices go from bottom to top => we flip the image internally
         int srcStride2[4] = { -srcStride[0], -srcStride[1], -srcStride[2],
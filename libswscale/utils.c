@@ -774,6 +774,12 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
                              int srcRange, const int table[4], int dstRange,
                              int brightness, int contrast, int saturation)
 {
+    int i;
+
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        sws_setColorspaceDetails(c->slice_ctx[i], inv_table, srcRange, table,
+                                 dstRange, brightness, contrast, saturation);
+
     memcpy(c->srcColorspaceTable, inv_table, sizeof(int) * 4);
     memcpy(c->dstColorspaceTable, table, sizeof(int) * 4);
 
@@ -857,8 +863,8 @@ SwsContext *sws_alloc_context(void)
     return c;
 }
 
-av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
-                             SwsFilter *dstFilter)
+static av_cold int context_init(SwsContext *c, SwsFilter *srcFilter,
+                                SwsFilter *dstFilter)
 {
     int i, j;
     int usesVFilter, usesHFilter;
@@ -892,6 +898,13 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
         c->dstFormat= dstFormat;
     }
 
+    /* contexts set up through AVOptions have no colorspace details yet,
+     * the slice contexts copy them from here */
+    if (!c->contrast && !c->saturation && !c->dstFormatBpp)
+        sws_setColorspaceDetails(c, ff_yuv2rgb_coeffs[SWS_CS_DEFAULT], c->srcRange,
+                                 ff_yuv2rgb_coeffs[SWS_CS_DEFAULT], c->dstRange,
+                                 0, 1 << 16, 1 << 16);
+
     if (!sws_isSupportedInput(srcFormat)) {
         av_log(c, AV_LOG_ERROR, "%s is not supported as input pixel format\n",
                av_get_pix_fmt_name(srcFormat));
@@ -932,6 +945,9 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
     if (!srcFilter)
         srcFilter = &dummyFilter;
 
+    c->dstSliceY    = 0;
+    c->dstSliceH    = dstH;
+
     c->lumXInc      = (((int64_t)srcW << 16) + (dstW >> 1)) / dstW;
     c->lumYInc      = (((int64_t)srcH << 16) + (dstH >> 1)) / dstH;
     c->dstFormatBpp = av_get_bits_per_pixel(&av_pix_fmt_descriptors[dstFormat]);
@@ -1300,6 +1316,20 @@ fail: // FIXME replace things by appropriate error codes
     return -1;
 }
 
+av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
+                             SwsFilter *dstFilter)
+{
+    int ret = context_init(c, srcFilter, dstFilter);
+
+    if (ret < 0)
+        return ret;
+
+    if (HAVE_PTHREADS && c->nb_threads > 1)
+        return ff_sws_init_threads(c, srcFilter, dstFilter);
+
+    return 0;
+}
+
 #if FF_API_SWS_GETCONTEXT
 SwsContext *sws_getContext(int srcW, int srcH, enum PixelFormat srcFormat,
                            int dstW, int dstH, enum PixelFormat dstFormat,
@@ -1655,6 +1685,9 @@ void sws_freeContext(SwsContext *c)
     if (!c)
         return;
 
+    if (HAVE_PTHREADS)
+        ff_sws_free_threads(c);
+
     if (c->lumPixBuf) {
         for (i = 0; i < c->vLumBufSize; i++)
             av_freep(&c->lumPixBuf[i]);
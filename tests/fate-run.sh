@@ -96,10 +96,30 @@ crc(){
     ffmpeg "$@" -f crc -
 }
 
+# run framecrc twice, the first run writes the index file the second loads
+indexfile(){
+    index=tests/data/fate/${test}.idx
+    cleanfiles="$index"
+    rm -f $index
+    framecrc -index_file $(target_path $index) "$@" || return
+    test -f $index || return
+    framecrc -index_file $(target_path $index) "$@"
+}
+
 md5(){
     ffmpeg "$@" md5:
 }
 
+# run swscale-test single threaded, then with $threads threads and the
+# single threaded results as reference, the outputs must be identical
+swscale_threads(){
+    single=tests/data/fate/${test}.single
+    cleanfiles="$single"
+    run libswscale/swscale-test "$@" -threads 1 > $single || return
+    run libswscale/swscale-test "$@" -threads $threads -ref $(target_path $single) |
+        diff -u $single -
+}
+
 pcm(){
     ffmpeg "$@" -vn -f s16le -
 }
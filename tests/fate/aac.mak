@@ -108,3 +108,7 @@ fate-aac: $(FATE_AAC) $(FATE_AAC_ENCODE)
 
 $(FATE_AAC): CMP = oneoff
 $(FATE_AAC): FUZZ = 2
+
+FATE-$(CONFIG_AAC_ENCODER) += fate-aaccoder
+fate-aaccoder: libavcodec/aaccoder-test$(EXESUF)
+fate-aaccoder: CMD = run libavcodec/aaccoder-test
@@ -81,3 +81,42 @@ fate-xwma-demux: CMD = crc -i $(SAMPLES)/xwma/ergon.xwma -acodec copy
 
 FATE_SAMPLES_FFMPEG += $(FATE_SAMPLES_DEMUX)
 fate-demux: $(FATE_SAMPLES_DEMUX)
+
+# Demux through the file protocol with and without mmap. The tiny windows
+# make the reads and the seeks cross many window boundaries.
+FATE_FILE_MMAP_READ = fate-file-mmap-read fate-file-mmap-read-sequential fate-file-mmap-read-random
+FATE_FILE_MMAP_SEEK = fate-file-mmap-seek fate-file-mmap-seek-sequential fate-file-mmap-seek-random
+
+fate-file-mmap-%-sequential: MMAP_OPTS = -mmap sequential -mmap_window 4096
+fate-file-mmap-%-random:     MMAP_OPTS = -mmap random -mmap_window 1
+
+$(FATE_FILE_MMAP_READ): CMD = framecrc $(MMAP_OPTS) -i $(TARGET_PATH)/tests/data/lavf/lavf.mpg -c copy
+$(FATE_FILE_MMAP_READ): REF = $(SRC_PATH)/tests/ref/fate/file-mmap-read
+$(FATE_FILE_MMAP_SEEK): CMD = framecrc $(MMAP_OPTS) -ss 1.5 -i $(TARGET_PATH)/tests/data/lavf/lavf.mpg -c copy
+$(FATE_FILE_MMAP_SEEK): REF = $(SRC_PATH)/tests/ref/fate/file-mmap-seek
+
+FATE_FILE_MMAP = $(FATE_FILE_MMAP_READ) $(FATE_FILE_MMAP_SEEK)
+$(FATE_FILE_MMAP): fate-lavf-mpg
+FATE_AVCONV += $(FATE_FILE_MMAP)
+fate-file-mmap: $(FATE_FILE_MMAP)
+
+# Demux through the async protocol, with a buffer smaller than the file so
+# that the reader thread refills it and the seeks miss it.
+FATE_ASYNC_FILE-$(CONFIG_ASYNC_PROTOCOL) += fate-async-file-read fate-async-file-seek
+fate-async-file-read: CMD = framecrc -async_buffer_size 32768 -i async:file:$(TARGET_PATH)/tests/data/lavf/lavf.mpg -c copy
+fate-async-file-read: REF = $(SRC_PATH)/tests/ref/fate/file-mmap-read
+fate-async-file-seek: CMD = framecrc -async_buffer_size 32768 -ss 1.5 -i async:file:$(TARGET_PATH)/tests/data/lavf/lavf.mpg -c copy
+fate-async-file-seek: REF = $(SRC_PATH)/tests/ref/fate/file-mmap-seek
+
+$(FATE_ASYNC_FILE-yes): fate-lavf-mpg
+FATE_AVCONV += $(FATE_ASYNC_FILE-yes)
+fate-async-file: $(FATE_ASYNC_FILE-yes)
+
+# Seek in an input opened twice with the same index file, the second time
+# with the stream parameters and index entries loaded from it.
+FATE_INDEX_FILE-$(CONFIG_NUT_DEMUXER) += fate-index-file-seek
+fate-index-file-seek: CMD = indexfile -ss 1.5 -i $(TARGET_PATH)/tests/data/lavf/lavf.nut -c copy
+
+$(FATE_INDEX_FILE-yes): fate-lavf-nut
+FATE_AVCONV += $(FATE_INDEX_FILE-yes)
+fate-index-file: $(FATE_INDEX_FILE-yes)
@@ -42,7 +42,22 @@ fate-filter-yadif-mode0: CMD = framecrc -flags bitexact -idct simple -i $(SAMPLE
 FATE_YADIF += fate-filter-yadif-mode1
 fate-filter-yadif-mode1: CMD = framecrc -flags bitexact -idct simple -i $(SAMPLES)/mpeg2/mpeg2_field_encoding.ts -vf yadif=1
 
+# yadif reads the edges of the decoder's buffers, which the pipelined
+# filter must get by reference
+FATE_YADIF += fate-filter-yadif-mode1-pipeline
+fate-filter-yadif-mode1-pipeline: CMD = framecrc -filter_pipeline 4 -flags bitexact -idct simple -i $(SAMPLES)/mpeg2/mpeg2_field_encoding.ts -vf yadif=1
+fate-filter-yadif-mode1-pipeline: REF = $(SRC_PATH)/tests/ref/fate/filter-yadif-mode1
+
 FATE_FILTER-$(CONFIG_YADIF_FILTER) += $(FATE_YADIF)
 
+# every filter of the chain in its own thread, compared to a single thread
+FATE_FILTER_PIPELINE = fate-filter-pipeline-0 fate-filter-pipeline-1 fate-filter-pipeline-4
+$(FATE_FILTER_PIPELINE): tests/vsynth1/00.pgm
+$(FATE_FILTER_PIPELINE): CMD = framecrc -filter_pipeline $(@:fate-filter-pipeline-%=%) -f image2 -vcodec pgmyuv -i $(TARGET_PATH)/tests/vsynth1/%02d.pgm -vf hue=h=30,unsharp,hflip,setpts=2*PTS,crop=200:100:10:10,vflip,negate,pad=256:128:5:5
+$(FATE_FILTER_PIPELINE): REF = $(SRC_PATH)/tests/ref/fate/filter-pipeline
+
+FATE_AVCONV-$(CONFIG_UNSHARP_FILTER) += $(FATE_FILTER_PIPELINE)
+fate-filter-pipeline: $(FATE_FILTER_PIPELINE)
+
 FATE_SAMPLES_AVCONV += $(FATE_FILTER-yes)
 fate-filter: $(FATE_FILTER-yes)
@@ -379,3 +379,35 @@ fate-h264-interlace-crop: CMD = framecrc -i $(SAMPLES)/h264/interlaced_crop.mp4
 fate-h264-lossless: CMD = framecrc -i $(SAMPLES)/h264/lossless.h264
 fate-h264-extreme-plane-pred: CMD = framemd5 -i $(SAMPLES)/h264/extreme-plane-pred.h264
 fate-h264-bsf-mp4toannexb: CMD = md5 -i $(SAMPLES)/h264/interlaced_crop.mp4 -vcodec copy -bsf h264_mp4toannexb -f h264
+
+FATE-$(CONFIG_H264_DECODER) += fate-h264dsp
+fate-h264dsp: libavcodec/h264dsp-test$(EXESUF)
+fate-h264dsp: CMD = run libavcodec/h264dsp-test $(CPUFLAGS:%=-c%)
+
+FATE-$(CONFIG_H264_DECODER) += fate-h264-bands
+fate-h264-bands: libavcodec/h264_bands-test$(EXESUF)
+fate-h264-bands: CMD = run libavcodec/h264_bands-test
+
+FATE-$(CONFIG_H264_DECODER) += fate-h264-deblock_thread
+fate-h264-deblock_thread: libavcodec/h264_deblock-test$(EXESUF)
+fate-h264-deblock_thread: CMD = run libavcodec/h264_deblock-test
+
+# Deblocking on a separate slice thread must give the same output as the
+# serial decode, so these tests share the references of the conformance
+# tests.
+define FATE_H264_DEBLOCK_THREAD_TEST
+FATE_H264_DEBLOCK_THREAD += fate-h264-deblock_thread-$(1)
+fate-h264-deblock_thread-$(1): CMD = framecrc -vsync drop -deblock_thread 1 -i $(SAMPLES)/h264-conformance/$(2)
+fate-h264-deblock_thread-$(1): REF = $(SRC_PATH)/tests/ref/fate/h264-conformance-$(1)
+endef
+
+$(eval $(call FATE_H264_DEBLOCK_THREAD_TEST,ba1_sony_d,BA1_Sony_D.jsv))
+$(eval $(call FATE_H264_DEBLOCK_THREAD_TEST,caba1_sva_b,CABA1_SVA_B.264))
+$(eval $(call FATE_H264_DEBLOCK_THREAD_TEST,cama1_sony_c,CAMA1_Sony_C.jsv))
+$(eval $(call FATE_H264_DEBLOCK_THREAD_TEST,camp_mot_mbaff_l30,CAMP_MOT_MBAFF_L30.26l))
+$(eval $(call FATE_H264_DEBLOCK_THREAD_TEST,frext-hpcv_brcm_a,FRext/HPCV_BRCM_A.264))
+
+$(FATE_H264_DEBLOCK_THREAD): THREADS = 2
+$(FATE_H264_DEBLOCK_THREAD): THREAD_TYPE = slice
+FATE_SAMPLES_AVCONV += $(FATE_H264_DEBLOCK_THREAD)
+fate-h264: $(FATE_H264_DEBLOCK_THREAD)
@@ -1,3 +1,7 @@
+FATE_LIBAVCODEC-$(CONFIG_PCM_S16LE_PLANAR_DECODER) += fate-audio-batch
+fate-audio-batch: libavcodec/audio_batch-test$(EXESUF)
+fate-audio-batch: CMD = run libavcodec/audio_batch-test
+
 FATE_LIBAVCODEC += fate-golomb
 fate-golomb: libavcodec/golomb-test$(EXESUF)
 fate-golomb: CMD = run libavcodec/golomb-test
@@ -7,4 +11,5 @@ FATE_LIBAVCODEC += fate-iirfilter
 fate-iirfilter: libavcodec/iirfilter-test$(EXESUF)
 fate-iirfilter: CMD = run libavcodec/iirfilter-test
 
+FATE_LIBAVCODEC += $(FATE_LIBAVCODEC-yes)
 fate-libavcodec: $(FATE_LIBAVCODEC)
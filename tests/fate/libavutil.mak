@@ -20,6 +20,10 @@ FATE_LIBAVUTIL += fate-bprint
 fate-bprint: libavutil/bprint-test$(EXESUF)
 fate-bprint: CMD = run libavutil/bprint-test
 
+FATE_LIBAVUTIL += fate-buffer
+fate-buffer: libavutil/buffer-test$(EXESUF)
+fate-buffer: CMD = run libavutil/buffer-test
+
 FATE_LIBAVUTIL += fate-crc
 fate-crc: libavutil/crc-test$(EXESUF)
 fate-crc: CMD = run libavutil/crc-test
@@ -0,0 +1,14 @@
+# Slice threaded scaling must give the same output as the single threaded
+# code, the scaled and the unscaled conversions from each format are run
+# with both.
+FATE_LIBSWSCALE_THREADS = yuv420p yuv422p yuv420p16le nv12 yuyv422 gray rgb24 bgra
+
+FATE_LIBSWSCALE += $(FATE_LIBSWSCALE_THREADS:%=fate-swscale-threads-%)
+fate-swscale-threads-%: libswscale/swscale-test$(EXESUF)
+fate-swscale-threads-%: CMD = swscale_threads -src $(@:fate-swscale-threads-%=%)
+fate-swscale-threads-%: THREADS = 3
+fate-swscale-threads-%: REF = /dev/null
+fate-swscale-threads-%: CMP = null
+fate-swscale-threads: $(FATE_LIBSWSCALE_THREADS:%=fate-swscale-threads-%)
+
+fate-libswscale: $(FATE_LIBSWSCALE)
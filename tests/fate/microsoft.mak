@@ -42,6 +42,27 @@ fate-vc1_sa10143: CMD = framecrc -i $(SAMPLES)/vc1/SA10143.vc1
 FATE_VC1 += fate-vc1-ism
 fate-vc1-ism: CMD = framecrc -i $(SAMPLES)/isom/vc1-wmapro.ism -an
 
+# Frame threaded decoding must give the same output as the serial decode,
+# so these tests share the references of the tests above.
+define FATE_VC1_MT_TEST
+FATE_VC1_MT += fate-vc1-mt-$(1)
+fate-vc1-mt-$(1): CMD = framecrc -i $(SAMPLES)/$(2) $(3)
+fate-vc1-mt-$(1): REF = $(SRC_PATH)/tests/ref/fate/$(4)
+endef
+
+$(eval $(call FATE_VC1_MT_TEST,sa00040,vc1/SA00040.vc1,,vc1_sa00040))
+$(eval $(call FATE_VC1_MT_TEST,sa00050,vc1/SA00050.vc1,,vc1_sa00050))
+$(eval $(call FATE_VC1_MT_TEST,sa10091,vc1/SA10091.vc1,,vc1_sa10091))
+$(eval $(call FATE_VC1_MT_TEST,sa20021,vc1/SA20021.vc1,,vc1_sa20021))
+$(eval $(call FATE_VC1_MT_TEST,sa10143,vc1/SA10143.vc1,,vc1_sa10143))
+$(eval $(call FATE_VC1_MT_TEST,ism,isom/vc1-wmapro.ism,-an,vc1-ism))
+
+$(FATE_VC1_MT): THREADS = 2
+$(FATE_VC1_MT): THREAD_TYPE = frame
+fate-vc1-mt: $(FATE_VC1_MT)
+
+FATE_VC1 += $(FATE_VC1_MT)
+
 FATE_MICROSOFT += $(FATE_VC1)
 fate-vc1: $(FATE_VC1)
 
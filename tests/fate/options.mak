@@ -5,5 +5,24 @@ fate-options-force_key_frames: CMD = enc_dec \
   avi "-c mpeg4 -g 240 -qscale 10 -force_key_frames 0.5,0:00:01.5" \
   framecrc "" "" "-skip_frame nokey"
 
+# the serial transcode would only output one keyframe with -g 1000
+FATE_SEGMENT_THREADS = fate-options-segment_threads-mkv                 \
+                       fate-options-segment_threads-mov                 \
+                       fate-options-segment_threads-rawpicture          \
+
+fate-options-segment_threads-mkv: fate-lavf-mkv
+fate-options-segment_threads-mkv: CMD = framecrc -segment_threads 2 \
+  -i $(TARGET_PATH)/tests/data/lavf/lavf.mkv -flags +bitexact \
+  -c:v mpeg4 -qscale 10 -g 1000 -c:a copy
+fate-options-segment_threads-mov: fate-lavf-mov
+fate-options-segment_threads-mov: CMD = framecrc -segment_threads 2 \
+  -i $(TARGET_PATH)/tests/data/lavf/lavf.mov -flags +bitexact \
+  -c:v mpeg4 -qscale 10 -g 1000 -c:a pcm_s16le
+fate-options-segment_threads-rawpicture: fate-lavf-avi
+fate-options-segment_threads-rawpicture: CMD = md5 -segment_threads 2 \
+  -i $(TARGET_PATH)/tests/data/lavf/lavf.avi -an -f yuv4mpegpipe
+
+FATE_OPTIONS += $(FATE_SEGMENT_THREADS)
+
 FATE_FFMPEG += $(FATE_OPTIONS)
 fate-options: $(FATE_OPTIONS)
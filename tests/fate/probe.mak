@@ -16,3 +16,22 @@ fate-probe-format: $(FATE_PROBE_FORMAT)
 $(FATE_PROBE_FORMAT): ffprobe$(EXESUF)
 $(FATE_PROBE_FORMAT): CMP = oneline
 fate-probe-format-%: CMD = probefmt $(SAMPLES)/probe-format/$(@:fate-probe-format-%=%)
+
+# The packets returned by avformat_find_stream_info() and the timestamps
+# computed for them must not depend on the number of probe threads.
+FATE_PROBE_THREADS_MPG   = fate-probe-threads-lavf-mpg-1 fate-probe-threads-lavf-mpg-4
+FATE_PROBE_THREADS_MPEG2 = fate-probe-threads-mpeg2-ps-1 fate-probe-threads-mpeg2-ps-4
+
+$(FATE_PROBE_THREADS_MPG): fate-lavf-mpg
+$(FATE_PROBE_THREADS_MPG): PROBE_SRC = tests/data/lavf/lavf.mpg
+$(FATE_PROBE_THREADS_MPG): REF = $(SRC_PATH)/tests/ref/fate/probe-threads-lavf-mpg
+$(FATE_PROBE_THREADS_MPEG2): fate-vsynth1-mpeg2-ps
+$(FATE_PROBE_THREADS_MPEG2): PROBE_SRC = tests/data/fate/vsynth1-mpeg2-ps.mpeg
+$(FATE_PROBE_THREADS_MPEG2): REF = $(SRC_PATH)/tests/ref/fate/probe-threads-mpeg2-ps
+
+FATE_PROBE_THREADS = $(FATE_PROBE_THREADS_MPG) $(FATE_PROBE_THREADS_MPEG2)
+$(FATE_PROBE_THREADS): ffprobe$(EXESUF)
+$(FATE_PROBE_THREADS): CMD = run ffprobe -v 0 -probe_threads $(lastword $(subst -, ,$(@))) -show_packets -print_format compact $(TARGET_PATH)/$(PROBE_SRC)
+
+FATE_AVCONV-$(CONFIG_FFPROBE) += $(FATE_PROBE_THREADS)
+fate-probe-threads: $(FATE_PROBE_THREADS)
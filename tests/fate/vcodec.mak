@@ -115,6 +115,7 @@ FATE_MPEG2 = mpeg2                                                      \
              mpeg2-idct-int                                             \
              mpeg2-ilace                                                \
              mpeg2-ivlc-qprd                                            \
+             mpeg2-gop-thread                                           \
              mpeg2-thread                                               \
              mpeg2-thread-ivlc
 
@@ -142,11 +143,24 @@ fate-vsynth%-mpeg2-ivlc-qprd:    ENCOPTS = -vb 500k                     \
                                            -intra_vlc 1                 \
                                            -cmp 2 -subcmp 2             \
                                            -mbd rd
+# -threads 2 overrides the -threads 1 of ENC_OPTS
+fate-vsynth%-mpeg2-gop-thread:   ENCOPTS = -qscale 10 -bf 2 -g 15 -flags +cgop \
+                                           -sc_threshold 1000000000        \
+                                           -timecode 01:00:00:00           \
+                                           -threads 2 -thread_type frame
 fate-vsynth%-mpeg2-thread:       ENCOPTS = -qscale 10 -bf 2 -flags +ildct+ilme \
                                            -threads 2 -slices 2
 fate-vsynth%-mpeg2-thread-ivlc:  ENCOPTS = -qscale 10 -bf 2 -flags +ildct+ilme \
                                            -intra_vlc 1 -threads 2 -slices 2
 
+FATE_VCODEC += mpeg2-ps
+fate-vsynth%-mpeg2-ps:           CODEC   = mpeg2video
+fate-vsynth%-mpeg2-ps:           FMT     = mpeg
+fate-vsynth%-mpeg2-ps:           ENCOPTS = -qscale 10 -bf 2 -g 15
+# built for the mpeg2-seek tests, keep their settings out
+fate-vsynth%-mpeg2-ps:           REF     = $(SRC_PATH)/tests/ref/fate/$(@:fate-%=%)
+fate-vsynth%-mpeg2-ps:           THREADS = 1
+
 FATE_VCODEC += mpeg4
 fate-vsynth%-mpeg4:              ENCOPTS = -qscale 10 -flags +mv4 -mbd bits
 fate-vsynth%-mpeg4:              FMT     = mp4
@@ -196,6 +210,12 @@ fate-vsynth%-msmpeg4v2:          ENCOPTS = -qscale 10
 FATE_VCODEC += mpng
 fate-vsynth%-mpng:               CODEC   = png
 
+# the banded deflate output depends on the thread count, the decoded
+# pictures must match the ones of mpng
+FATE_VCODEC += mpng-thread
+fate-vsynth%-mpng-thread:        CODEC   = png
+fate-vsynth%-mpng-thread:        ENCOPTS = -threads 3 -thread_type slice
+
 FATE_VCODEC += msvideo1
 
 FATE_VCODEC += prores
@@ -291,3 +311,23 @@ FATE_AVCONV += $(FATE_VSYNTH1) $(FATE_VSYNTH2)
 fate-vsynth1: $(FATE_VSYNTH1)
 fate-vsynth2: $(FATE_VSYNTH2)
 fate-vcodec:  fate-vsynth1 fate-vsynth2
+
+# Seek into an open GOP of the mpeg2-ps output and decode without and with
+# frame threads. Both runs are checked against the same reference.
+FATE_MPEG2_SEEK1 = fate-mpeg2-seek-vsynth1 fate-mpeg2-seek-vsynth1-thread
+FATE_MPEG2_SEEK2 = fate-mpeg2-seek-vsynth2 fate-mpeg2-seek-vsynth2-thread
+
+$(FATE_MPEG2_SEEK1): fate-vsynth1-mpeg2-ps
+$(FATE_MPEG2_SEEK1): CMD = framecrc -flags +bitexact -idct simple -ss 0.9 -i $(TARGET_PATH)/tests/data/fate/vsynth1-mpeg2-ps.mpeg
+$(FATE_MPEG2_SEEK1): REF = $(SRC_PATH)/tests/ref/fate/mpeg2-seek-vsynth1
+$(FATE_MPEG2_SEEK2): fate-vsynth2-mpeg2-ps
+$(FATE_MPEG2_SEEK2): CMD = framecrc -flags +bitexact -idct simple -ss 0.9 -i $(TARGET_PATH)/tests/data/fate/vsynth2-mpeg2-ps.mpeg
+$(FATE_MPEG2_SEEK2): REF = $(SRC_PATH)/tests/ref/fate/mpeg2-seek-vsynth2
+
+fate-mpeg2-seek-vsynth1 fate-mpeg2-seek-vsynth2: THREADS = 1
+fate-mpeg2-seek-vsynth%-thread: THREADS     = 4
+fate-mpeg2-seek-vsynth%-thread: THREAD_TYPE = frame
+
+FATE_MPEG2_SEEK = $(FATE_MPEG2_SEEK1) $(FATE_MPEG2_SEEK2)
+FATE_AVCONV += $(FATE_MPEG2_SEEK)
+fate-mpeg2-seek: $(FATE_MPEG2_SEEK)
@@ -49,5 +49,11 @@ endef
 
 $(eval $(call FATE_VP8_FULL))
 $(eval $(call FATE_VP8_FULL,-emu-edge,-flags +emu_edge))
+$(eval $(call FATE_VP8_FULL,-partition-threads,-partition_threads 4))
+
+# token partitions decoded on slice threads inside each frame thread
+FATE_VP8_PARTITION_THREADS = $(foreach T,$(FATE_VP8),$(if $(findstring -partition-threads,$(T)),$(T)))
+$(FATE_VP8_PARTITION_THREADS): THREADS = 4
+$(FATE_VP8_PARTITION_THREADS): THREAD_TYPE = frame+slice
 FATE_SAMPLES_AVCONV += $(FATE_VP8)
 fate-vp8: $(FATE_VP8)